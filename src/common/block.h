@@ -57,6 +57,7 @@ public:
         vchProof.clear();
         txMint.SetNull();
         vtx.clear();
+        hashCached = 0;
     }
     bool IsNull() const
     {
@@ -92,10 +93,17 @@ public:
     }
     uint256 GetHash() const
     {
-        xengine::CBufStream ss;
-        ss << nVersion << nType << nTimeStamp << hashPrev << hashMerkle << nBits << vchProof;
-        uint256 hash = minemon::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-        return uint256(GetBlockHeight(), uint224(hash));
+        if (hashCached != 0)
+        {
+            return hashCached;
+        }
+        return CalcHash();
+    }
+    // the hash is cached when the block is loaded from a stream,
+    // call it after changing the header of a loaded block
+    void ResetHash()
+    {
+        hashCached = 0;
     }
     std::size_t GetTxSerializedOffset() const
     {
@@ -103,7 +111,7 @@ public:
     }
     void GetSerializedProofOfWorkData(std::vector<unsigned char>& vchProofOfWork) const
     {
-        xengine::CBufStream ss;
+        xengine::CSpanStream ss;
         ss << nVersion << nType << hashPrev << hashMerkle << nBits;
         vchProofOfWork.assign(ss.GetData(), ss.GetData() + ss.GetSize());
     }
@@ -207,7 +215,26 @@ protected:
         s.Serialize(vchProof, opt);
         s.Serialize(txMint, opt);
         s.Serialize(vtx, opt);
+        UpdateHashCached(opt);
+    }
+    void UpdateHashCached(xengine::LoadType&)
+    {
+        hashCached = CalcHash();
+    }
+    template <typename O>
+    void UpdateHashCached(O&)
+    {
+    }
+    uint256 CalcHash() const
+    {
+        xengine::CSpanStream ss;
+        ss << nVersion << nType << nTimeStamp << hashPrev << hashMerkle << nBits << vchProof;
+        uint256 hash = minemon::crypto::CryptoHash(ss.GetData(), ss.GetSize());
+        return uint256(GetBlockHeight(), uint224(hash));
     }
+
+protected:
+    uint256 hashCached;
 };
 
 class CBlockEx : public CBlock
@@ -233,6 +260,74 @@ protected:
     }
 };
 
+/* Block relayed as header, mint tx and short ids of the other txs. A short
+   id is the low word of a hash keyed by the block hash and a nonce picked
+   by the sender, so that ids can not be ground ahead of the block. */
+class CCompactBlock
+{
+    friend class xengine::CStream;
+
+public:
+    CBlock block; // vtx is empty
+    uint64 nNonce;
+    std::vector<uint64> vShortId;
+
+public:
+    CCompactBlock()
+      : nNonce(0) {}
+    CCompactBlock(const CBlock& blockIn, uint64 nNonceIn)
+      : nNonce(nNonceIn)
+    {
+        block.nVersion = blockIn.nVersion;
+        block.nType = blockIn.nType;
+        block.nTimeStamp = blockIn.nTimeStamp;
+        block.hashPrev = blockIn.hashPrev;
+        block.hashMerkle = blockIn.hashMerkle;
+        block.nBits = blockIn.nBits;
+        block.vchProof = blockIn.vchProof;
+        block.txMint = blockIn.txMint;
+
+        uint256 hashKey = GetShortIdKey();
+        vShortId.reserve(blockIn.vtx.size());
+        for (const CTransaction& tx : blockIn.vtx)
+        {
+            vShortId.push_back(GetShortId(hashKey, tx.GetHash()));
+        }
+    }
+    uint256 GetHash() const
+    {
+        return block.GetHash();
+    }
+    uint256 GetShortIdKey() const
+    {
+        return minemon::crypto::CryptoHash(block.GetHash(), uint256(nNonce));
+    }
+    static uint64 GetShortId(const uint256& hashKey, const uint256& txid)
+    {
+        return minemon::crypto::CryptoHash(hashKey, txid).Get64(0);
+    }
+    // false if the txs do not match the merkle root of the header
+    bool Reconstruct(const std::vector<CTransaction>& vtx, CBlock& blockOut) const
+    {
+        if (vtx.size() != vShortId.size())
+        {
+            return false;
+        }
+        blockOut = block;
+        blockOut.vtx = vtx;
+        return (blockOut.CalcMerkleTreeRoot() == block.hashMerkle);
+    }
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(block, opt);
+        s.Serialize(nNonce, opt);
+        s.Serialize(vShortId, opt);
+    }
+};
+
 inline std::string GetBlockTypeStr(uint16 nType, uint16 nMintType)
 {
     if (nType == CBlock::BLOCK_GENESIS)
@@ -256,24 +351,25 @@ inline std::string GetBlockTypeStr(uint16 nType, uint16 nMintType)
 class CBlockIndex
 {
 public:
+    // traversal fields first, they share the first cache lines
     const uint256* phashBlock;
     CBlockIndex* pOrigin;
     CBlockIndex* pPrev;
     CBlockIndex* pNext;
-    uint256 txidMint;
-    uint16 nMintType;
-    CDestination destMint;
-    uint16 nVersion;
-    uint16 nType;
-    uint32 nTimeStamp;
-    uint32 nHeight;
-    uint64 nRandBeacon;
     uint256 nChainTrust;
+    uint32 nHeight;
+    uint32 nTimeStamp;
+    uint16 nType;
+    uint16 nVersion;
+    uint16 nMintType;
     int64 nMoneySupply;
+    uint64 nRandBeacon;
     //uint8 nProofAlgo;
     uint32 nProofBits;
     uint32 nFile;
     uint32 nOffset;
+    uint256 txidMint;
+    CDestination destMint;
 
 public:
     CBlockIndex()
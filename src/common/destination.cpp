@@ -6,6 +6,7 @@
 
 #include "block.h"
 #include "key.h"
+#include "sigcache.h"
 #include "template/exchange.h"
 #include "template/mint.h"
 #include "template/template.h"
@@ -16,6 +17,12 @@ using namespace std;
 using namespace xengine;
 using namespace minemon::crypto;
 
+static CSignatureCache& GetSignatureCache()
+{
+    static CSignatureCache cacheSignature;
+    return cacheSignature;
+}
+
 //////////////////////////////
 // CDestination
 
@@ -146,12 +153,34 @@ bool CDestination::VerifyTxSignature(const uint256& hash, const uint16 nType, co
 {
     if (IsPubKey())
     {
-        fCompleted = GetPubKey().Verify(hash, vchSig);
+        fCompleted = GetSignatureCache().Exists(*this, hash, vchSig);
+        if (!fCompleted && GetPubKey().Verify(hash, vchSig))
+        {
+            GetSignatureCache().AddNew(*this, hash, vchSig);
+            fCompleted = true;
+        }
         return fCompleted;
     }
     else if (IsTemplate())
     {
-        return CTemplate::VerifyTxSignature(GetTemplateId(), nType, hash, hashAnchor, destTo, vchSig, nForkHeight, fCompleted);
+        // the result of the other templates depends on the height, their
+        // owner keys are cached above
+        uint16 nTemplateType = GetTemplateId().GetType();
+        bool fCacheable = (nTemplateType == TEMPLATE_WEIGHTED || nTemplateType == TEMPLATE_MULTISIG);
+        if (fCacheable && GetSignatureCache().Exists(*this, hash, vchSig))
+        {
+            fCompleted = true;
+            return true;
+        }
+        if (!CTemplate::VerifyTxSignature(GetTemplateId(), nType, hash, hashAnchor, destTo, vchSig, nForkHeight, fCompleted))
+        {
+            return false;
+        }
+        if (fCacheable && fCompleted)
+        {
+            GetSignatureCache().AddNew(*this, hash, vchSig);
+        }
+        return true;
     }
     return false;
 }
@@ -103,5 +103,9 @@ inline bool operator<(const CDestination& a, const CDestination& b)
 {
     return (a.prefix < b.prefix || (a.prefix == b.prefix && a.data < b.data));
 }
+inline std::size_t hash_value(const CDestination& a)
+{
+    return (hash_value(a.data) ^ a.prefix);
+}
 
 #endif // COMMON_DESTINATION_H
@@ -38,7 +38,7 @@ public:
     {
         try
         {
-            xengine::CBufStream ss;
+            xengine::CSpanStream ss;
             ss << btcVersion << btcHashPrevBlock << btcHashMerkleRoot << btcTime << btcBits << btcNonce << auxOffset << coinbase << auxMerkleBranch << trMerkleBranch;
             vchProof.assign(ss.GetData(), ss.GetData() + ss.GetSize());
         }
@@ -52,8 +52,7 @@ public:
     {
         try
         {
-            xengine::CBufStream ss;
-            ss.Write((const char*)vchProof.data(),vchProof.size());
+            xengine::CSpanStream ss((const char*)vchProof.data(), vchProof.size());
             ss >> btcVersion >> btcHashPrevBlock >> btcHashMerkleRoot >> btcTime >> btcBits >> btcNonce >> auxOffset >> coinbase >> auxMerkleBranch >> trMerkleBranch;   
         }
         catch (const std::exception& e)
@@ -72,7 +71,7 @@ public:
             uint8_t buf[64] = {0};
             memcpy(buf,mam_pow.begin(),32);
             memcpy(buf+32,obj.begin(),32);
-            mam_pow = minemon::crypto::CryptoSHA256D(buf,64);
+            mam_pow = minemon::crypto::CryptoSHA256D64(buf);
         }
         std::vector<uint8_t> res;
         res.insert(res.end(),data1.begin(),data1.end());
@@ -99,7 +98,7 @@ public:
             uint8_t buf[64] = {0};
             memcpy(buf,root.begin(),32);
             memcpy(buf+32,obj.begin(),32);
-            root = minemon::crypto::CryptoSHA256D(buf,64);
+            root = minemon::crypto::CryptoSHA256D64(buf);
         }
         btcHashMerkleRoot = root;
         btcVersion = _btcVersion;
@@ -112,7 +111,7 @@ public:
     {
         try
         {
-            xengine::CBufStream ss;
+            xengine::CSpanStream ss;
             ss << btcVersion << btcHashPrevBlock << btcHashMerkleRoot << btcTime << btcBits << btcNonce;
             vch.assign(ss.GetData(), ss.GetData() + ss.GetSize());
         }
@@ -126,8 +125,7 @@ public:
     {
         try
         {
-            xengine::CBufStream ss;
-            ss.Write((const char*)vch.data(),vch.size());
+            xengine::CSpanStream ss((const char*)vch.data(), vch.size());
             ss >> btcVersion >> btcHashPrevBlock >> btcHashMerkleRoot >> btcTime >> btcBits >> btcNonce;
         }
         catch (const std::exception& e)
@@ -144,7 +142,7 @@ public:
             uint8_t buf[64] = {0};
             memcpy(buf,res.begin(),32);
             memcpy(buf+32,obj.begin(),32);
-            res = minemon::crypto::CryptoSHA256D(buf,64);
+            res = minemon::crypto::CryptoSHA256D64(buf);
         }
         return res == root;
     }
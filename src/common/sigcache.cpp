@@ -0,0 +1,53 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigcache.h"
+
+#include "crypto.h"
+
+using namespace std;
+using namespace xengine;
+using namespace minemon::crypto;
+
+//////////////////////////////
+// CSignatureCache
+
+CSignatureCache::CSignatureCache(size_t nMaxCount)
+  : cache(nMaxCount)
+{
+    CryptoGetRand256(nSalt);
+}
+
+bool CSignatureCache::Exists(const CDestination& dest, const uint256& hash, const vector<uint8>& vchSig)
+{
+    bool fValid = false;
+    return cache.Retrieve(GetKey(dest, hash, vchSig), fValid);
+}
+
+void CSignatureCache::AddNew(const CDestination& dest, const uint256& hash, const vector<uint8>& vchSig)
+{
+    cache.AddNew(GetKey(dest, hash, vchSig), true);
+}
+
+void CSignatureCache::GetStat(CCacheStat& stat) const
+{
+    cache.GetStat(stat);
+}
+
+void CSignatureCache::Clear()
+{
+    cache.Clear();
+}
+
+uint256 CSignatureCache::GetKey(const CDestination& dest, const uint256& hash, const vector<uint8>& vchSig) const
+{
+    vector<uint8> vchData;
+    vchData.reserve(uint256::size() * 3 + 1 + vchSig.size());
+    vchData.insert(vchData.end(), nSalt.begin(), nSalt.end());
+    vchData.push_back(dest.prefix);
+    vchData.insert(vchData.end(), dest.data.begin(), dest.data.end());
+    vchData.insert(vchData.end(), hash.begin(), hash.end());
+    vchData.insert(vchData.end(), vchSig.begin(), vchSig.end());
+    return CryptoHash(vchData.data(), vchData.size());
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMON_SIGCACHE_H
+#define COMMON_SIGCACHE_H
+
+#include <vector>
+
+#include "cache.h"
+#include "destination.h"
+#include "uint256.h"
+
+/* Signatures that have been verified valid, keyed by a salted hash of the
+   signer destination, the signed hash and the signature. A tx checked when
+   it enters the pool is not checked again when its block is connected.
+   Invalid signatures are never cached. */
+class CSignatureCache
+{
+public:
+    enum
+    {
+        DEFAULT_MAX_COUNT = 0x20000
+    };
+    CSignatureCache(std::size_t nMaxCount = DEFAULT_MAX_COUNT);
+    bool Exists(const CDestination& dest, const uint256& hash, const std::vector<uint8>& vchSig);
+    void AddNew(const CDestination& dest, const uint256& hash, const std::vector<uint8>& vchSig);
+    void GetStat(xengine::CCacheStat& stat) const;
+    void Clear();
+
+protected:
+    uint256 GetKey(const CDestination& dest, const uint256& hash, const std::vector<uint8>& vchSig) const;
+
+protected:
+    uint256 nSalt;
+    xengine::CCache<uint256, bool> cache;
+};
+
+#endif //COMMON_SIGCACHE_H
@@ -131,6 +131,7 @@ public:
         nTxFee = 0;
         vchData.clear();
         vchSig.clear();
+        hashCached = 0;
     }
     bool IsNull() const
     {
@@ -158,16 +159,21 @@ public:
     }
     uint256 GetHash() const
     {
-        xengine::CBufStream ss;
-        ss << (*this);
-
-        uint256 hash = minemon::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-
-        return uint256(nTimeStamp, uint224(hash));
+        if (hashCached != 0)
+        {
+            return hashCached;
+        }
+        return CalcHash();
+    }
+    // the hash is cached when the tx is loaded from a stream,
+    // call it after changing the fields of a loaded tx
+    void ResetHash()
+    {
+        hashCached = 0;
     }
     uint256 GetSignatureHash() const
     {
-        xengine::CBufStream ss;
+        xengine::CSpanStream ss;
         ss << nVersion << nType << nTimeStamp << nLockUntil /*<< hashAnchor*/ << vInput << sendTo << nAmount << nTxFee << vchData;
         return minemon::crypto::CryptoHash(ss.GetData(), ss.GetSize());
     }
@@ -191,6 +197,7 @@ public:
             return false;
         }
         nLockUntil = (n << 31) | nHeight;
+        ResetHash();
         return true;
     }
     friend bool operator==(const CTransaction& a, const CTransaction& b)
@@ -217,7 +224,28 @@ protected:
         s.Serialize(nTxFee, opt);
         s.Serialize(vchData, opt);
         s.Serialize(vchSig, opt);
+        UpdateHashCached(opt);
     }
+    void UpdateHashCached(xengine::LoadType&)
+    {
+        hashCached = CalcHash();
+    }
+    template <typename O>
+    void UpdateHashCached(O&)
+    {
+    }
+    uint256 CalcHash() const
+    {
+        xengine::CSpanStream ss;
+        ss << (*this);
+
+        uint256 hash = minemon::crypto::CryptoHash(ss.GetData(), ss.GetSize());
+
+        return uint256(nTimeStamp, uint224(hash));
+    }
+
+protected:
+    uint256 hashCached;
 };
 
 class CTxOut
@@ -174,6 +174,10 @@ public:
     {
         return nHeight < spWalletTx->GetLockUntil(n);
     }
+    uint32 GetLockUntil() const
+    {
+        return spWalletTx->GetLockUntil(n);
+    }
     int GetDepth(int nHeight) const
     {
         return (spWalletTx->nBlockHeight >= 0 ? nHeight - spWalletTx->nBlockHeight + 1 : 0);
@@ -8,6 +8,7 @@
 #include <sodium.h>
 #include <sys/mman.h>
 
+#include "sha256.h"
 #include "util.h"
 
 using namespace std;
@@ -122,6 +123,136 @@ uint256 CryptoSHA256D(const void* msg, size_t len)
     return hash;
 }
 
+//////////////////////////////
+// SHA256D 64-byte & midstate
+
+#define SHA256_BATCH (8)
+
+static inline void WriteBE32(uint8* p, const uint32 x)
+{
+    p[0] = (uint8)(x >> 24);
+    p[1] = (uint8)(x >> 16);
+    p[2] = (uint8)(x >> 8);
+    p[3] = (uint8)x;
+}
+
+static void SHA256Pad(uint8* block, const size_t nOffset, const uint64 nMsgLen)
+{
+    block[nOffset] = 0x80;
+    memset(block + nOffset + 1, 0, 55 - nOffset);
+    WriteBE32(block + 56, (uint32)((nMsgLen * 8) >> 32));
+    WriteBE32(block + 60, (uint32)(nMsgLen * 8));
+}
+
+// state holds the first sha256 of n messages, returns the second one
+static void SHA256DOuter(uint32* state, const size_t n, uint256* pHash)
+{
+    uint8 block[SHA256_BATCH * 64];
+    for (size_t i = 0; i < n; i++)
+    {
+        uint8* p = block + i * 64;
+        for (int j = 0; j < 8; j++)
+        {
+            WriteBE32(p + j * 4, state[i * 8 + j]);
+        }
+        SHA256Pad(p, 32, 32);
+        memcpy(state + i * 8, SHA256_IV, sizeof(SHA256_IV));
+    }
+    SHA256TransformMulti(state, block, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            WriteBE32(pHash[i].begin() + j * 4, state[i * 8 + j]);
+        }
+    }
+}
+
+uint256 CryptoSHA256D64(const void* msg)
+{
+    uint256 hash;
+    CryptoSHA256D64Multi(msg, 1, &hash);
+    return hash;
+}
+
+void CryptoSHA256D64Multi(const void* msg, size_t n, uint256* pHash)
+{
+    uint8 pad[SHA256_BATCH * 64];
+    for (size_t i = 0; i < SHA256_BATCH; i++)
+    {
+        SHA256Pad(pad + i * 64, 0, 64);
+    }
+
+    const uint8* p = (const uint8*)msg;
+    while (n > 0)
+    {
+        size_t nBatch = min(n, (size_t)SHA256_BATCH);
+        uint32 state[SHA256_BATCH * 8];
+        for (size_t i = 0; i < nBatch; i++)
+        {
+            memcpy(state + i * 8, SHA256_IV, sizeof(SHA256_IV));
+        }
+        SHA256TransformMulti(state, p, nBatch);
+        SHA256TransformMulti(state, pad, nBatch);
+        SHA256DOuter(state, nBatch, pHash);
+
+        p += nBatch * 64;
+        pHash += nBatch;
+        n -= nBatch;
+    }
+}
+
+size_t CryptoSHA256Lanes()
+{
+    return SHA256Lanes();
+}
+
+CCryptoSHA256DMidstate::CCryptoSHA256DMidstate()
+{
+    memcpy(state, SHA256_IV, sizeof(state));
+}
+
+void CCryptoSHA256DMidstate::Init(const void* block)
+{
+    memcpy(state, SHA256_IV, sizeof(state));
+    SHA256Transform(state, (const uint8*)block);
+}
+
+uint256 CCryptoSHA256DMidstate::Hash(const void* tail, size_t len) const
+{
+    uint256 hash;
+    HashMulti(tail, len, 1, &hash);
+    return hash;
+}
+
+void CCryptoSHA256DMidstate::HashMulti(const void* tails, size_t len, size_t n, uint256* pHash) const
+{
+    if (len >= 56)
+    {
+        throw CCryptoError("CCryptoSHA256DMidstate : tail is too long");
+    }
+
+    const uint8* p = (const uint8*)tails;
+    while (n > 0)
+    {
+        size_t nBatch = min(n, (size_t)SHA256_BATCH);
+        uint32 st[SHA256_BATCH * 8];
+        uint8 block[SHA256_BATCH * 64];
+        for (size_t i = 0; i < nBatch; i++)
+        {
+            memcpy(st + i * 8, state, sizeof(state));
+            memcpy(block + i * 64, p + i * len, len);
+            SHA256Pad(block + i * 64, len, 64 + len);
+        }
+        SHA256TransformMulti(st, block, nBatch);
+        SHA256DOuter(st, nBatch, pHash);
+
+        p += nBatch * len;
+        pHash += nBatch;
+        n -= nBatch;
+    }
+}
+
 //////////////////////////////
 // SHA256
 uint256 CryptoSHA256(const void* msg, size_t len)
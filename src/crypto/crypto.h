@@ -93,6 +93,29 @@ uint256 CryptoSHA256(const void* msg, size_t len);
 // SHA256D
 uint256 CryptoSHA256D(const void* msg, size_t len);
 
+// SHA256D of 64-byte messages (merkle nodes)
+//   CryptoSHA256D64Multi hashes n messages stored contiguously, CryptoSHA256Lanes
+//   of them at a time by the SIMD kernel selected for this CPU
+uint256 CryptoSHA256D64(const void* msg);
+void CryptoSHA256D64Multi(const void* msg, std::size_t n, uint256* pHash);
+std::size_t CryptoSHA256Lanes();
+
+// SHA256D midstate
+//   the state after the first 64-byte block of a message, reused to hash
+//   messages which share that block (e.g. PoW headers differing in the tail).
+//   tails are shorter than 56 bytes, HashMulti takes n tails stored contiguously
+class CCryptoSHA256DMidstate
+{
+public:
+    CCryptoSHA256DMidstate();
+    void Init(const void* block);
+    uint256 Hash(const void* tail, std::size_t len) const;
+    void HashMulti(const void* tails, std::size_t len, std::size_t n, uint256* pHash) const;
+
+protected:
+    uint32 state[8];
+};
+
 // Sign & verify
 struct CCryptoKey
 {
@@ -0,0 +1,278 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sha256.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace minemon
+{
+namespace crypto
+{
+
+const uint32 SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32 SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32 ReadBE32(const uint8* p)
+{
+    return (((uint32)p[0] << 24) | ((uint32)p[1] << 16) | ((uint32)p[2] << 8) | (uint32)p[3]);
+}
+
+//////////////////////////////
+// Scalar kernel
+
+static inline uint32 Ror(const uint32 x, const int n)
+{
+    return ((x >> n) | (x << (32 - n)));
+}
+
+void SHA256Transform(uint32* state, const uint8* block)
+{
+    uint32 w[16];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = ReadBE32(block + i * 4);
+    }
+
+    uint32 a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32 e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        if (i >= 16)
+        {
+            uint32 w2 = w[(i - 2) & 15], w15 = w[(i - 15) & 15];
+            w[i & 15] += (Ror(w2, 17) ^ Ror(w2, 19) ^ (w2 >> 10)) + w[(i - 7) & 15]
+                         + (Ror(w15, 7) ^ Ror(w15, 18) ^ (w15 >> 3));
+        }
+        uint32 t1 = h + (Ror(e, 6) ^ Ror(e, 11) ^ Ror(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i & 15];
+        uint32 t2 = (Ror(a, 2) ^ Ror(a, 13) ^ Ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+#ifdef SHA256_X86_KERNEL
+
+//////////////////////////////
+// Multi-lane kernels
+//   every vector lane carries one message, the rounds are the scalar ones
+//   written with the V* operations defined before each kernel
+
+#define SHA256_MULTI_ROUNDS(VEC)                                                          \
+    for (int i = 0; i < 64; i++)                                                          \
+    {                                                                                     \
+        if (i >= 16)                                                                      \
+        {                                                                                 \
+            VEC w2 = w[(i - 2) & 15], w15 = w[(i - 15) & 15];                             \
+            VEC s1 = VXOR(VXOR(VROR(w2, 17), VROR(w2, 19)), VSRL(w2, 10));                \
+            VEC s0 = VXOR(VXOR(VROR(w15, 7), VROR(w15, 18)), VSRL(w15, 3));               \
+            w[i & 15] = VADD(VADD(w[i & 15], s1), VADD(w[(i - 7) & 15], s0));             \
+        }                                                                                 \
+        VEC S1 = VXOR(VXOR(VROR(e, 6), VROR(e, 11)), VROR(e, 25));                        \
+        VEC ch = VXOR(VAND(e, f), VANDNOT(e, g));                                         \
+        VEC t1 = VADD(VADD(VADD(h, S1), VADD(ch, VSET1(SHA256_K[i]))), w[i & 15]);        \
+        VEC S0 = VXOR(VXOR(VROR(a, 2), VROR(a, 13)), VROR(a, 22));                        \
+        VEC maj = VOR(VAND(a, b), VAND(c, VOR(a, b)));                                    \
+        VEC t2 = VADD(S0, maj);                                                           \
+        h = g;                                                                            \
+        g = f;                                                                            \
+        f = e;                                                                            \
+        e = VADD(d, t1);                                                                  \
+        d = c;                                                                            \
+        c = b;                                                                            \
+        b = a;                                                                            \
+        a = VADD(t1, t2);                                                                 \
+    }
+
+#define SHA256_MULTI_LOAD(LANES, VEC, VLOAD)                                              \
+    VEC w[16];                                                                            \
+    for (int i = 0; i < 16; i++)                                                          \
+    {                                                                                     \
+        uint32 v[LANES];                                                                  \
+        for (int j = 0; j < LANES; j++)                                                   \
+        {                                                                                 \
+            v[j] = ReadBE32(block + j * 64 + i * 4);                                      \
+        }                                                                                 \
+        w[i] = VLOAD(v);                                                                  \
+    }                                                                                     \
+    VEC init[8];                                                                          \
+    for (int i = 0; i < 8; i++)                                                           \
+    {                                                                                     \
+        uint32 v[LANES];                                                                  \
+        for (int j = 0; j < LANES; j++)                                                   \
+        {                                                                                 \
+            v[j] = state[j * 8 + i];                                                      \
+        }                                                                                 \
+        init[i] = VLOAD(v);                                                               \
+    }                                                                                     \
+    VEC a = init[0], b = init[1], c = init[2], d = init[3];                               \
+    VEC e = init[4], f = init[5], g = init[6], h = init[7];
+
+#define SHA256_MULTI_STORE(LANES, VSTORE)                                                 \
+    VEC out[8] = { VADD(a, init[0]), VADD(b, init[1]), VADD(c, init[2]), VADD(d, init[3]), \
+                   VADD(e, init[4]), VADD(f, init[5]), VADD(g, init[6]), VADD(h, init[7]) }; \
+    for (int i = 0; i < 8; i++)                                                           \
+    {                                                                                     \
+        uint32 v[LANES];                                                                  \
+        VSTORE(v, out[i]);                                                                \
+        for (int j = 0; j < LANES; j++)                                                   \
+        {                                                                                 \
+            state[j * 8 + i] = v[j];                                                      \
+        }                                                                                 \
+    }
+
+// SSE4.1, 4 lanes
+#define VEC __m128i
+#define VADD(x, y) _mm_add_epi32(x, y)
+#define VXOR(x, y) _mm_xor_si128(x, y)
+#define VAND(x, y) _mm_and_si128(x, y)
+#define VOR(x, y) _mm_or_si128(x, y)
+#define VANDNOT(x, y) _mm_andnot_si128(x, y)
+#define VSRL(x, n) _mm_srli_epi32(x, n)
+#define VROR(x, n) _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+#define VSET1(x) _mm_set1_epi32(x)
+#define VLOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define VSTORE(p, x) _mm_storeu_si128((__m128i*)(p), x)
+
+__attribute__((target("sse4.1"))) static void SHA256TransformSSE41(uint32* state, const uint8* block)
+{
+    SHA256_MULTI_LOAD(4, VEC, VLOAD)
+    SHA256_MULTI_ROUNDS(VEC)
+    SHA256_MULTI_STORE(4, VSTORE)
+}
+
+#undef VEC
+#undef VADD
+#undef VXOR
+#undef VAND
+#undef VOR
+#undef VANDNOT
+#undef VSRL
+#undef VROR
+#undef VSET1
+#undef VLOAD
+#undef VSTORE
+
+// AVX2, 8 lanes
+#define VEC __m256i
+#define VADD(x, y) _mm256_add_epi32(x, y)
+#define VXOR(x, y) _mm256_xor_si256(x, y)
+#define VAND(x, y) _mm256_and_si256(x, y)
+#define VOR(x, y) _mm256_or_si256(x, y)
+#define VANDNOT(x, y) _mm256_andnot_si256(x, y)
+#define VSRL(x, n) _mm256_srli_epi32(x, n)
+#define VROR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define VSET1(x) _mm256_set1_epi32(x)
+#define VLOAD(p) _mm256_loadu_si256((const __m256i*)(p))
+#define VSTORE(p, x) _mm256_storeu_si256((__m256i*)(p), x)
+
+__attribute__((target("avx2"))) static void SHA256TransformAVX2(uint32* state, const uint8* block)
+{
+    SHA256_MULTI_LOAD(8, VEC, VLOAD)
+    SHA256_MULTI_ROUNDS(VEC)
+    SHA256_MULTI_STORE(8, VSTORE)
+}
+
+#undef VEC
+#undef VADD
+#undef VXOR
+#undef VAND
+#undef VOR
+#undef VANDNOT
+#undef VSRL
+#undef VROR
+#undef VSET1
+#undef VLOAD
+#undef VSTORE
+
+#endif // SHA256_X86_KERNEL
+
+//////////////////////////////
+// CPU dispatch
+
+static std::size_t SHA256DetectLanes()
+{
+#ifdef SHA256_X86_KERNEL
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return 8;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return 4;
+    }
+#endif
+    return 1;
+}
+
+static const std::size_t nSHA256Lanes = SHA256DetectLanes();
+
+std::size_t SHA256Lanes()
+{
+    return nSHA256Lanes;
+}
+
+const char* SHA256KernelName()
+{
+    return (nSHA256Lanes == 8 ? "avx2" : (nSHA256Lanes == 4 ? "sse4.1" : "scalar"));
+}
+
+void SHA256TransformMulti(uint32* state, const uint8* block, std::size_t n)
+{
+#ifdef SHA256_X86_KERNEL
+    if (nSHA256Lanes >= 8)
+    {
+        for (; n >= 8; n -= 8, state += 8 * 8, block += 8 * 64)
+        {
+            SHA256TransformAVX2(state, block);
+        }
+    }
+    if (nSHA256Lanes >= 4)
+    {
+        for (; n >= 4; n -= 4, state += 4 * 8, block += 4 * 64)
+        {
+            SHA256TransformSSE41(state, block);
+        }
+    }
+#endif
+    for (; n > 0; n--, state += 8, block += 64)
+    {
+        SHA256Transform(state, block);
+    }
+}
+
+} // namespace crypto
+} // namespace minemon
@@ -0,0 +1,33 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CRYPTO_SHA256_H
+#define CRYPTO_SHA256_H
+
+#include <cstddef>
+
+#include "uint256.h"
+
+namespace minemon
+{
+namespace crypto
+{
+
+// SHA256 compression function
+//   state : 8 words per message, lane-major (state[i * 8 + j] is word j of message i)
+//   block : 64 bytes per message, contiguous
+// Multi-lane kernels (SSE4.1 x4, AVX2 x8) are selected once by CPU dispatch,
+// the rest of the messages fall back to the scalar kernel.
+
+extern const uint32 SHA256_IV[8];
+
+std::size_t SHA256Lanes();
+const char* SHA256KernelName();
+void SHA256Transform(uint32* state, const uint8* block);
+void SHA256TransformMulti(uint32* state, const uint8* block, std::size_t n);
+
+} // namespace crypto
+} // namespace minemon
+
+#endif //CRYPTO_SHA256_H
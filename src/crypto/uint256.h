@@ -1065,6 +1065,10 @@ inline const uint256 operator-(const uint256& a, const uint256& b)
 {
     return (base_uint256)a - (base_uint256)b;
 }
+inline std::size_t hash_value(const uint256& a)
+{
+    return (std::size_t)a.GetLow64();
+}
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -41,8 +41,12 @@ public:
     virtual Errno ValidateBlock(const CBlock& block) = 0;
     virtual Errno ValidateOrigin(const CBlock& block, const CProfile& parentProfile, CProfile& forkProfile) = 0;
     virtual Errno VerifyProofOfWork(const CBlock& block, const CBlockIndex* pIndexPrev) = 0;
-    virtual Errno VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nForkHeight, const uint256& fork) = 0;
+    virtual Errno VerifyProofOfHashWork(const CBlock& block) = 0;
+    virtual Errno VerifyBlockTxContext(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nForkHeight, const uint256& fork) = 0;
+    virtual Errno VerifyBlockTxSignature(const CTransaction& tx, const CTxContxt& txContxt, int nForkHeight, const uint256& fork) = 0;
     virtual Errno VerifyTransaction(const CTransaction& tx, const std::vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& hashLastBlock, const uint256& fork) = 0;
+    virtual Errno VerifyTransactionContext(const CTransaction& tx, const std::vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& hashLastBlock, const uint256& fork) = 0;
+    virtual Errno VerifyTransactionSignature(const CTransaction& tx, const CDestination& destIn, int nForkHeight, const uint256& fork) = 0;
     virtual bool GetBlockTrust(const CBlock& block, uint256& nChainTrust) = 0;
     virtual bool GetProofOfWorkTarget(const CBlockIndex* pIndexPrev, int nAlgo, uint32_t& nBits) = 0;
     virtual int64 GetMintWorkReward(const int nHeight) = 0;
@@ -111,6 +115,7 @@ public:
     virtual bool ExistsTx(const uint256& txid) = 0;
     virtual bool FilterTx(const uint256& hashFork, CTxFilter& filter) = 0;
     virtual bool FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter) = 0;
+    virtual bool FilterTx(const uint256& hashFork, const uint256& hashFrom, CTxFilter& filter, uint256& hashLast) = 0;
     virtual bool ListForkContext(std::vector<CForkContext>& vForkCtxt) = 0;
     virtual Errno AddNewForkContext(const CTransaction& txFork, CForkContext& ctxt) = 0;
     virtual Errno AddNewBlock(const CBlock& block, CBlockChainUpdate& update) = 0;
@@ -162,6 +167,9 @@ public:
     virtual void Clear() = 0;
     virtual std::size_t Count(const uint256& fork) const = 0;
     virtual Errno Push(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn) = 0;
+    virtual void Push(const std::vector<CTransaction>& vtx, uint256& hashFork, std::vector<Errno>& vErr,
+                      std::vector<CDestination>& vDestIn, std::vector<int64>& vValueIn)
+        = 0;
     virtual void Pop(const uint256& txid) = 0;
     virtual bool Get(const uint256& txid, CTransaction& tx) const = 0;
     virtual bool Get(const uint256& txid, CAssembledTx& tx) const = 0;
@@ -174,6 +182,9 @@ public:
                                 std::vector<CTransaction>& vtx, int64& nTotalTxFee)
         = 0;
     virtual bool FetchInputs(const uint256& hashFork, const CTransaction& tx, std::vector<CTxOut>& vUnspent) = 0;
+    virtual void FillCompactBlock(const uint256& hashFork, const CCompactBlock& compact,
+                                  std::vector<CTransaction>& vtx, std::vector<uint32>& vMissing)
+        = 0;
     virtual bool SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChange& change) = 0;
     virtual int64 GetDestAmount(const CDestination& dest) = 0;
     virtual bool VerifyPledgeTx(const CDestination& dest) = 0;
@@ -241,6 +252,7 @@ public:
     virtual CTemplatePtr GetTemplate(const CTemplateId& tid) const = 0;
     /* Wallet Tx */
     virtual std::size_t GetTxCount() = 0;
+    virtual std::size_t GetTxCount(const uint256& hashFork, const CDestination& dest) = 0;
     virtual bool ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, std::vector<CWalletTx>& vWalletTx) = 0;
     virtual bool GetBalance(const CDestination& dest, const uint256& hashFork, int nForkHeight, CWalletBalance& balance) = 0;
     virtual bool SignTransaction(const CDestination& destIn, CTransaction& tx, const vector<uint8>& vchSendToData, const vector<uint8>& vchSignExtraData, const uint256& hashFork, const int32 nForkHeight, bool& fCompleted) = 0;
@@ -271,6 +283,7 @@ public:
       : IBase("dispatcher") {}
     virtual Errno AddNewBlock(const CBlock& block, uint64 nNonce = 0) = 0;
     virtual Errno AddNewTx(const CTransaction& tx, uint64 nNonce = 0) = 0;
+    virtual void AddNewTx(const std::vector<CTransaction>& vtx, std::vector<Errno>& vErr, bool fPeerTx = false) = 0;
 };
 
 class IService : public xengine::IBase
@@ -341,6 +354,7 @@ public:
     virtual bool ResynchronizeWalletTx() = 0;
     virtual bool SignOfflineTransaction(const CDestination& destIn, CTransaction& tx, bool& fCompleted) = 0;
     virtual Errno SendOfflineSignedTransaction(CTransaction& tx) = 0;
+    virtual void SendOfflineSignedTransactions(const std::vector<CTransaction>& vtx, std::vector<Errno>& vErr) = 0;
     virtual bool AesEncrypt(const crypto::CPubKey& pubkeyLocal, const crypto::CPubKey& pubkeyRemote, const std::vector<uint8>& vMessage, std::vector<uint8>& vCiphertext) = 0;
     virtual bool AesDecrypt(const crypto::CPubKey& pubkeyLocal, const crypto::CPubKey& pubkeyRemote, const std::vector<uint8>& vCiphertext, std::vector<uint8>& vMessage) = 0;
     /* Mint */
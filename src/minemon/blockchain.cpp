@@ -20,6 +20,7 @@ namespace minemon
 // CBlockChain
 
 CBlockChain::CBlockChain()
+  : poolVerify("blockverify")
 {
     pCoreProtocol = nullptr;
     pTxPool = nullptr;
@@ -62,6 +63,18 @@ bool CBlockChain::HandleInvoke()
         return false;
     }
 
+    // the thread connecting the block joins the verification, so it counts as one of them
+    int nVerifyThreads = StorageConfig()->nVerifyThreads;
+    if (nVerifyThreads <= 0)
+    {
+        nVerifyThreads = boost::thread::hardware_concurrency();
+    }
+    if (!poolVerify.Start(nVerifyThreads > 1 ? nVerifyThreads - 1 : 0))
+    {
+        Error("Failed to start verify pool");
+        return false;
+    }
+
     if (cntrBlock.IsEmpty())
     {
         CBlock block;
@@ -89,6 +102,7 @@ bool CBlockChain::HandleInvoke()
 
 void CBlockChain::HandleHalt()
 {
+    poolVerify.Stop();
     cntrBlock.Deinitialize();
 }
 
@@ -347,6 +361,11 @@ bool CBlockChain::FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filte
     return cntrBlock.FilterTx(hashFork, nDepth, filter);
 }
 
+bool CBlockChain::FilterTx(const uint256& hashFork, const uint256& hashFrom, CTxFilter& filter, uint256& hashLast)
+{
+    return cntrBlock.FilterTx(hashFork, hashFrom, filter, hashLast);
+}
+
 bool CBlockChain::ListForkContext(vector<CForkContext>& vForkCtxt)
 {
     return cntrBlock.ListForkContext(vForkCtxt);
@@ -495,7 +514,7 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
         }
         else
         {
-            err = pCoreProtocol->VerifyBlockTx(tx, txContxt, pIndexPrev, pIndexPrev->nHeight + 1, pIndexPrev->GetOriginHash());
+            err = pCoreProtocol->VerifyBlockTxContext(tx, txContxt, pIndexPrev, pIndexPrev->nHeight + 1, pIndexPrev->GetOriginHash());
             if (err != OK)
             {
                 Log("AddNewBlock Verify BlockTx Error(%s) : %s", ErrorString(err), txid.ToString().c_str());
@@ -519,6 +538,12 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
         StdTrace("BlockChain", "AddNewBlock: verify tx success, new tx: %s, new block: %s", txid.GetHex().c_str(), hash.GetHex().c_str());
     }
 
+    err = VerifyBlockTxSignature(blockex, pIndexPrev, vPledgeRewardTxList.size());
+    if (err != OK)
+    {
+        return err;
+    }
+
     if (!VerifyBlockMintRedeem(blockex))
     {
         Log("AddNewBlock verify block mint redeem fail, block: %s", hash.ToString().c_str());
@@ -544,6 +569,17 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
     }
     Log("AddNew Block : %s", pIndexNew->ToString().c_str());
 
+    if (pIndexNew->GetOriginHash() == pCoreProtocol->GetGenesisBlockHash())
+    {
+        // not fatal, the distribution falls back to walking the window
+        map<CDestination, int64> mapBlockPledgeReward;
+        if (!CalcBlockPledgeReward(pIndexNew, mapBlockPledgeReward)
+            || !cntrBlock.AddBlockPledgeReward(hash, block.hashPrev, mapBlockPledgeReward))
+        {
+            Log("AddNewBlock update pledge reward fail, block: %s", hash.GetHex().c_str());
+        }
+    }
+
     CBlockIndex* pIndexFork = nullptr;
     if (cntrBlock.RetrieveFork(pIndexNew->GetOriginHash(), &pIndexFork)
         && (pIndexFork->nChainTrust > pIndexNew->nChainTrust
@@ -978,6 +1014,13 @@ bool CBlockChain::CalcDistributePledgeReward(const uint256& hashBlock, std::map<
     }
     mapPledgeReward.clear();
 
+    if (cntrBlock.RetrieveDistributePledgeReward(hashBlock, mapPledgeReward))
+    {
+        return true;
+    }
+    StdLog("BlockChain", "calculate distribute pledge reward: accumulator not found, walk the window, hashBlock: %s", hashBlock.GetHex().c_str());
+    mapPledgeReward.clear();
+
     CBlockIndex* pIndex = nullptr;
     if (!cntrBlock.RetrieveIndex(hashBlock, &pIndex) || pIndex == nullptr)
     {
@@ -1139,6 +1182,7 @@ bool CBlockChain::GetDistributePledgeRewardTxList(const uint256& hashPrevBlock,
         for (auto& tx : vPledgeRewardTxList)
         {
             tx.nTimeStamp = nPrevBlockTime + 1;
+            tx.ResetHash();
         }
 
         StdDebug("BlockChain", "Get distribute pledge reward tx: distribute pledge reward, prev height: %d, reward list size: %lu, index: %d, reward tx count: %lu, hashPrevBlock: %s",
@@ -1205,6 +1249,42 @@ Errno CBlockChain::GetTxContxt(storage::CBlockView& view, const CTransaction& tx
     return OK;
 }
 
+Errno CBlockChain::VerifyBlockTxSignature(const CBlockEx& block, const CBlockIndex* pIndexPrev, const size_t nVerifyBegin)
+{
+    if (block.vtx.size() <= nVerifyBegin)
+    {
+        return OK;
+    }
+
+    const int nForkHeight = pIndexPrev->nHeight + 1;
+    const uint256 hashFork = pIndexPrev->GetOriginHash();
+    const size_t nGroup = min(block.vtx.size() - nVerifyBegin, poolVerify.GetWorkerCount() + 1);
+    vector<Errno> vErr(block.vtx.size(), OK);
+
+    vector<CWorkerPool::WorkFunc> vWork;
+    vWork.reserve(nGroup);
+    for (size_t n = 0; n < nGroup; n++)
+    {
+        vWork.push_back([&, n]() {
+            for (size_t i = nVerifyBegin + n; i < block.vtx.size(); i += nGroup)
+            {
+                vErr[i] = pCoreProtocol->VerifyBlockTxSignature(block.vtx[i], block.vTxContxt[i], nForkHeight, hashFork);
+            }
+        });
+    }
+    poolVerify.Execute(vWork);
+
+    for (size_t i = nVerifyBegin; i < block.vtx.size(); i++)
+    {
+        if (vErr[i] != OK)
+        {
+            Log("AddNewBlock Verify BlockTx Signature Error(%s) : %s", ErrorString(vErr[i]), block.vtx[i].GetHash().ToString().c_str());
+            return vErr[i];
+        }
+    }
+    return OK;
+}
+
 bool CBlockChain::GetBlockChanges(const CBlockIndex* pIndexNew, const CBlockIndex* pIndexFork,
                                   vector<CBlockEx>& vBlockAddNew, vector<CBlockEx>& vBlockRemove)
 {
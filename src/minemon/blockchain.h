@@ -42,6 +42,7 @@ public:
                       std::vector<CTxOut>& vOutput) override;
     bool FilterTx(const uint256& hashFork, CTxFilter& filter) override;
     bool FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter) override;
+    bool FilterTx(const uint256& hashFork, const uint256& hashFrom, CTxFilter& filter, uint256& hashLast) override;
     bool ListForkContext(std::vector<CForkContext>& vForkCtxt) override;
     Errno AddNewForkContext(const CTransaction& txFork, CForkContext& ctxt) override;
     Errno AddNewBlock(const CBlock& block, CBlockChainUpdate& update) override;
@@ -80,6 +81,7 @@ protected:
     void HandleHalt() override;
     bool InsertGenesisBlock(CBlock& block);
     Errno GetTxContxt(storage::CBlockView& view, const CTransaction& tx, CTxContxt& txContxt);
+    Errno VerifyBlockTxSignature(const CBlockEx& block, const CBlockIndex* pIndexPrev, const std::size_t nVerifyBegin);
     bool GetBlockChanges(const CBlockIndex* pIndexNew, const CBlockIndex* pIndexFork,
                          std::vector<CBlockEx>& vBlockAddNew, std::vector<CBlockEx>& vBlockRemove);
     Errno VerifyBlock(const uint256& hashBlock, const CBlock& block, CBlockIndex* pIndexPrev);
@@ -94,6 +96,7 @@ protected:
     ICoreProtocol* pCoreProtocol;
     ITxPool* pTxPool;
     storage::CBlockBase cntrBlock;
+    xengine::CWorkerPool poolVerify;
 
     std::map<int, CCheckPoint> mapCheckPoints;
     std::vector<CCheckPoint> vecCheckPoints;
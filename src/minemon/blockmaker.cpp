@@ -15,6 +15,12 @@ using namespace std;
 using namespace xengine;
 
 #define INITIAL_HASH_RATE (8000)
+#define POW_CHECK_INTERVAL (4096)
+#define POW_HASH_BATCH (8)
+#define POW_HEADER_SIZE (80)
+#define POW_HEADER_TAIL_OFFSET (64)
+#define POW_HEADER_TIME_OFFSET (68)
+#define POW_HEADER_NONCE_OFFSET (76)
 #define WAIT_AGREEMENT_TIME_OFFSET -5
 #define WAIT_NEWBLOCK_TIME (BLOCK_TARGET_SPACING + 5)
 #define WAIT_LAST_EXTENDED_TIME (BLOCK_TARGET_SPACING - 10)
@@ -44,11 +50,33 @@ bool CBlockMakerProfile::BuildTemplate()
     return (templMint != nullptr);
 }
 
+//////////////////////////////
+// CBlockMakerPowJob
+
+CBlockMakerPowJob::CBlockMakerPowJob(const vector<unsigned char>& vchWorkData, const uint256& hashTargetIn)
+  : hashTarget(hashTargetIn), fFound(false), nHashCount(0), nTime(0), nNonce(0)
+{
+    midstate.Init(&vchWorkData[0]);
+    memcpy(vchTail, &vchWorkData[POW_HEADER_TAIL_OFFSET], sizeof(vchTail));
+}
+
+bool CBlockMakerPowJob::SetResult(const uint32 nTimeIn, const uint32 nNonceIn, const uint256& hashIn)
+{
+    if (fFound.exchange(true))
+    {
+        return false;
+    }
+    nTime = nTimeIn;
+    nNonce = nNonceIn;
+    hash = hashIn;
+    return true;
+}
+
 //////////////////////////////
 // CBlockMaker
 
 CBlockMaker::CBlockMaker()
-  : thrPow("powmaker", boost::bind(&CBlockMaker::PowThreadFunc, this))
+  : thrPow("powmaker", boost::bind(&CBlockMaker::PowThreadFunc, this)), poolPow("powworker"), nPowThreads(1)
 {
     pCoreProtocol = nullptr;
     pBlockChain = nullptr;
@@ -128,6 +156,18 @@ bool CBlockMaker::HandleInvoke()
     fExit = true;
     if (!mapWorkProfile.empty())
     {
+        nPowThreads = MintConfig()->nMintThreads;
+        if (nPowThreads <= 0)
+        {
+            nPowThreads = max(boost::thread::hardware_concurrency(), 1u);
+        }
+        if (!poolPow.Start(nPowThreads - 1))
+        {
+            Error("Failed to start pow worker pool");
+            return false;
+        }
+        Log("Pow threads: %d, sha256 lanes: %lu", nPowThreads, crypto::CryptoSHA256Lanes());
+
         if (!ThreadDelayStart(thrPow))
         {
             return false;
@@ -144,6 +184,7 @@ void CBlockMaker::HandleHalt()
 
     thrPow.Interrupt();
     ThreadExit(thrPow);
+    poolPow.Stop();
 
     IBlockMaker::HandleHalt();
 }
@@ -153,10 +194,9 @@ bool CBlockMaker::HandleEvent(CEventBlockMakerUpdate& eventUpdate)
     return true;
 }
 
-bool CBlockMaker::InterruptedPoW(const uint256& hashPrimary)
+bool CBlockMaker::InterruptedPoW(const CBlockMakerPowJob& job)
 {
-    boost::unique_lock<boost::mutex> lock(mutex);
-    return fExit;
+    return (fExit || job.fFound);
 }
 
 bool CBlockMaker::WaitExit(const long nSeconds)
@@ -209,8 +249,7 @@ bool CBlockMaker::CreateProofOfWork()
     uint16_t nVersion;
     uint16_t nType;
     uint256 hashMerkle;
-    xengine::CBufStream ss;
-    ss.Write((const char*)vchWorkData.data(), vchWorkData.size());
+    xengine::CSpanStream ss((const char*)vchWorkData.data(), vchWorkData.size());
     ss >> nVersion >> nType >> hashPrev >> hashMerkle >> nBits;
 
     uint256 mam_pow = crypto::CryptoSHA256(vchWorkData.data(), vchWorkData.size());
@@ -233,67 +272,112 @@ bool CBlockMaker::CreateProofOfWork()
     vchWorkData.clear();
     obj.GetBtcPow(vchWorkData);
 
-    uint32& nTime = *((uint32*)&vchWorkData[68]);
+    uint32& nTime = *((uint32*)&vchWorkData[POW_HEADER_TIME_OFFSET]);
     nTime = max(nPrevTime + 1, (uint32_t)GetNetTime());
-    uint32_t& nNonce = *((uint32_t*)&vchWorkData[76]);
-
-    int64& nHashRate = pHashAlgo->nHashRate;
-    int64 nHashComputeCount = 0;
-    int64 nHashComputeBeginTime = GetTime();
+    uint32& nNonce = *((uint32*)&vchWorkData[POW_HEADER_NONCE_OFFSET]);
+    nNonce = 0;
 
     Log("Proof-of-work: start hash compute, target height: %d, difficulty bits: (0x%x)", nPrevBlockHeight + 1, nBits);
 
     uint256 hashTarget;
     hashTarget.SetCompact(nBits);
-    while (!InterruptedPoW(hashPrev))
+
+    // The first 64 bytes of the header is fixed during the search, so its
+    // sha256 state is computed once and every thread hashes only the tail
+    // over its own slice of the nonce space.
+    CBlockMakerPowJob job(vchWorkData, hashTarget);
+    vector<CWorkerPool::WorkFunc> vWork;
+    for (int i = 0; i < nPowThreads; i++)
     {
-        if (nHashRate == 0)
-        {
-            nHashRate = 1;
-        }
-        for (int i = 0; i < nHashRate; i++)
+        uint64 nNonceBegin = (0x100000000ULL * i) / nPowThreads;
+        uint64 nNonceEnd = (0x100000000ULL * (i + 1)) / nPowThreads;
+        vWork.push_back(boost::bind(&CBlockMaker::PowWorkFunc, this, boost::ref(job), nNonceBegin, nNonceEnd));
+    }
+
+    int64 nHashComputeBeginTime = GetTime();
+    poolPow.Execute(vWork);
+
+    int64 nHashComputeCount = job.nHashCount;
+    int64 nDuration = GetTime() - nHashComputeBeginTime;
+    pHashAlgo->nHashRate = ((nDuration <= 0) ? nHashComputeCount : (nHashComputeCount / nDuration));
+
+    if (!job.fFound)
+    {
+        Log("Proof-of-work: target height: %d, compute interrupted.", nPrevBlockHeight + 1);
+        return false;
+    }
+
+    Log("Proof-of-work: block found (%s), target height: %d, compute: (threads:%d, count:%ld, duration:%lds, hashrate:%ld), difficulty bits: (0x%x)\nhash :   %s\ntarget : %s",
+        pHashAlgo->strAlgo.c_str(), nPrevBlockHeight + 1, nPowThreads, nHashComputeCount, nDuration, pHashAlgo->nHashRate, nBits,
+        job.hash.GetHex().c_str(), hashTarget.GetHex().c_str());
+
+    nTime = job.nTime;
+    nNonce = job.nNonce;
+    uint32 nBlockTime = nTime;
+    obj.SetBtcPow(vchWorkData);
+    vchWorkData.clear();
+    obj.Save(vchWorkData);
+
+    xengine::CSpanStream ssWork;
+    ssWork << nVersion << nType << nBlockTime << hashPrev << hashMerkle << nBits << vchWorkData;
+    std::vector<uint8> data;
+    data.assign(ssWork.GetData(), ssWork.GetData() + ssWork.GetSize());
+    Errno err = pService->SubmitWork(data, profile.templMint, hashPrev);
+    if (err != OK)
+    {
+        return false;
+    }
+    return true;
+}
+
+void CBlockMaker::PowWorkFunc(CBlockMakerPowJob& job, const uint64 nNonceBegin, const uint64 nNonceEnd)
+{
+    unsigned char vchTail[sizeof(job.vchTail)];
+    memcpy(vchTail, job.vchTail, sizeof(vchTail));
+    uint32& nTime = *((uint32*)&vchTail[POW_HEADER_TIME_OFFSET - POW_HEADER_TAIL_OFFSET]);
+
+    // candidates are hashed in batches, so the sha256 kernel can fill its SIMD lanes
+    unsigned char vchBatch[POW_HASH_BATCH][sizeof(vchTail)];
+    uint256 vHash[POW_HASH_BATCH];
+
+    uint64 n = nNonceBegin;
+    while (!InterruptedPoW(job))
+    {
+        for (int i = 0; i < POW_CHECK_INTERVAL; i += POW_HASH_BATCH)
         {
-            uint256 hash = pHashAlgo->Hash(vchWorkData);
-            nHashComputeCount++;
-            if (hash <= hashTarget)
+            for (int j = 0; j < POW_HASH_BATCH; j++)
             {
-                int64 nDuration = GetTime() - nHashComputeBeginTime;
-                int nCompHashRate = ((nDuration <= 0) ? 0 : (nHashComputeCount / nDuration));
-
-                Log("Proof-of-work: block found (%s), target height: %d, compute: (rate:%ld, count:%ld, duration:%lds, hashrate:%ld), difficulty bits: (0x%x)\nhash :   %s\ntarget : %s",
-                    pHashAlgo->strAlgo.c_str(), nPrevBlockHeight + 1, nHashRate, nHashComputeCount, nDuration, nCompHashRate, nBits,
-                    hash.GetHex().c_str(), hashTarget.GetHex().c_str());
-                obj.SetBtcPow(vchWorkData);
-                vchWorkData.clear();
-                obj.Save(vchWorkData);
-
-                xengine::CBufStream ss;
-                ss << nVersion << nType << nTime << hashPrev << hashMerkle << nBits << vchWorkData;
-                std::vector<uint8> data;
-                data.assign(ss.GetData(), ss.GetData() + ss.GetSize());
-                Errno err = pService->SubmitWork(data, profile.templMint, hashPrev);
-                if (err != OK)
+                memcpy(vchBatch[j], vchTail, sizeof(vchTail));
+                *((uint32*)&vchBatch[j][POW_HEADER_NONCE_OFFSET - POW_HEADER_TAIL_OFFSET]) = (uint32)n;
+                if (++n == nNonceEnd)
                 {
-                    return false;
+                    // slice exhausted, roll the time and start over
+                    n = nNonceBegin;
+                    nTime++;
+                }
+            }
+
+            job.midstate.HashMulti(vchBatch, sizeof(vchTail), POW_HASH_BATCH, vHash);
+            for (int j = 0; j < POW_HASH_BATCH; j++)
+            {
+                if (vHash[j] <= job.hashTarget)
+                {
+                    job.nHashCount += i + j + 1;
+                    job.SetResult(*((uint32*)&vchBatch[j][POW_HEADER_TIME_OFFSET - POW_HEADER_TAIL_OFFSET]),
+                                  *((uint32*)&vchBatch[j][POW_HEADER_NONCE_OFFSET - POW_HEADER_TAIL_OFFSET]),
+                                  vHash[j]);
+                    return;
                 }
-                return true;
             }
-            nNonce++;
         }
+        job.nHashCount += POW_CHECK_INTERVAL;
 
-        int64 nNetTime = GetNetTime();
-        if (nTime + 1 < nNetTime)
+        uint32 nNetTime = GetNetTime();
+        if (nTime < nNetTime)
         {
-            nHashRate /= (nNetTime - nTime);
             nTime = nNetTime;
         }
-        else if (nTime == nNetTime)
-        {
-            nHashRate *= 2;
-        }
     }
-    Log("Proof-of-work: target height: %d, compute interrupted.", nPrevBlockHeight + 1);
-    return false;
 }
 
 void CBlockMaker::PowThreadFunc()
@@ -60,6 +60,23 @@ public:
     CTemplateMintPtr templMint;
 };
 
+class CBlockMakerPowJob
+{
+public:
+    CBlockMakerPowJob(const std::vector<unsigned char>& vchWorkData, const uint256& hashTargetIn);
+    bool SetResult(const uint32 nTimeIn, const uint32 nNonceIn, const uint256& hashIn);
+
+public:
+    crypto::CCryptoSHA256DMidstate midstate;
+    unsigned char vchTail[16];
+    uint256 hashTarget;
+    std::atomic<bool> fFound;
+    std::atomic<int64> nHashCount;
+    uint32 nTime;
+    uint32 nNonce;
+    uint256 hash;
+};
+
 class CBlockMaker : public IBlockMaker, virtual public CBlockMakerEventListener
 {
 public:
@@ -72,15 +89,18 @@ protected:
     void HandleDeinitialize() override;
     bool HandleInvoke() override;
     void HandleHalt() override;
-    bool InterruptedPoW(const uint256& hashPrimary);
+    bool InterruptedPoW(const CBlockMakerPowJob& job);
     bool WaitExit(const long nSeconds);
     bool CreateProofOfWork();
 
 private:
     void PowThreadFunc();
+    void PowWorkFunc(CBlockMakerPowJob& job, const uint64 nNonceBegin, const uint64 nNonceEnd);
 
 protected:
     xengine::CThread thrPow;
+    xengine::CWorkerPool poolPow;
+    int nPowThreads;
     boost::mutex mutex;
     boost::condition_variable condExit;
     std::atomic<bool> fExit;
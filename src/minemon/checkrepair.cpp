@@ -4,6 +4,9 @@
 
 #include "checkrepair.h"
 
+#include <boost/thread/thread.hpp>
+#include <deque>
+
 #include "template/mintpledge.h"
 #include "template/proof.h"
 
@@ -16,6 +19,45 @@ using namespace boost::filesystem;
 namespace minemon
 {
 
+/////////////////////////////////////////////////////////////////////////
+// CCheckProgress
+
+CCheckProgress::CCheckProgress(const string& strNameIn, int64 nTotalIn)
+  : strName(strNameIn), nTotal(nTotalIn), nCount(0)
+{
+    nStartTime = nReportTime = GetTime();
+}
+
+void CCheckProgress::Update(int64 nAdd)
+{
+    nCount += nAdd;
+    int64 nNow = GetTime();
+    if (nNow - nReportTime >= REPORT_INTERVAL)
+    {
+        Report(nNow);
+    }
+}
+
+void CCheckProgress::Finish()
+{
+    Report(GetTime());
+}
+
+void CCheckProgress::Report(int64 nTime)
+{
+    nReportTime = nTime;
+    int64 nElapse = max(nTime - nStartTime, (int64)1);
+    if (nTotal > 0)
+    {
+        StdLog("Check", "%s: %ld/%ld (%ld%%), %ld/s, elapse: %lds",
+               strName.c_str(), nCount, nTotal, nCount * 100 / nTotal, nCount / nElapse, nTime - nStartTime);
+    }
+    else
+    {
+        StdLog("Check", "%s: %ld, %ld/s, elapse: %lds", strName.c_str(), nCount, nCount / nElapse, nTime - nStartTime);
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////
 // CCheckForkUnspentWalker
 
@@ -23,7 +65,7 @@ bool CCheckForkUnspentWalker::Walk(const CTxOutPoint& txout, const CTxOut& outpu
 {
     if (!output.IsNull())
     {
-        if (!mapForkUnspent.insert(make_pair(txout, CCheckTxOut(output))).second)
+        if (!mapForkUnspent.GetShard(txout.hash).insert(make_pair(txout, CCheckTxOut(output))).second)
         {
             StdError("Check", "Insert leveldb unspent fail, unspent: [%d] %s.", txout.n, txout.hash.GetHex().c_str());
             return false;
@@ -36,48 +78,51 @@ bool CCheckForkUnspentWalker::Walk(const CTxOutPoint& txout, const CTxOut& outpu
     return true;
 }
 
-bool CCheckForkUnspentWalker::CheckForkUnspent(map<CTxOutPoint, CCheckTxOut>& mapBlockForkUnspent)
+bool CCheckForkUnspentWalker::CheckForkUnspent(const CCheckUnspentMap& mapBlockForkUnspent)
 {
-    {
-        map<CTxOutPoint, CCheckTxOut>::iterator it = mapBlockForkUnspent.begin();
-        for (; it != mapBlockForkUnspent.end(); ++it)
+    // both shards are sorted, compare them in one pass
+    vector<vector<CTxUnspent>> vShardAddUpdate(CCheckUnspentMap::SHARD_COUNT);
+    vector<vector<CTxOutPoint>> vShardRemove(CCheckUnspentMap::SHARD_COUNT);
+    ParallelFor(CCheckUnspentMap::SHARD_COUNT, 1, [&](size_t nBegin, size_t nEnd) -> bool {
+        for (size_t nShard = nBegin; nShard < nEnd; nShard++)
         {
-            map<CTxOutPoint, CCheckTxOut>::iterator mt = mapForkUnspent.find(it->first);
-            if (mt == mapForkUnspent.end())
-            {
-                StdLog("Check", "Check block unspent: find utxo fail, utxo: [%d] %s.", it->first.n, it->first.hash.GetHex().c_str());
-                mapForkUnspent.insert(*it);
-                vAddUpdate.push_back(CTxUnspent(it->first, static_cast<const CTxOut&>(it->second)));
-            }
-            else if (it->second != mt->second)
+            const CCheckUnspentMap::CShard& mapBlock = mapBlockForkUnspent.GetShard(nShard);
+            const CCheckUnspentMap::CShard& mapDB = mapForkUnspent.GetShard(nShard);
+            CCheckUnspentMap::CShard::const_iterator it = mapBlock.begin();
+            CCheckUnspentMap::CShard::const_iterator mt = mapDB.begin();
+            while (it != mapBlock.end() || mt != mapDB.end())
             {
-                StdLog("Check", "Check block unspent: txout error, utxo: [%d] %s.", it->first.n, it->first.hash.GetHex().c_str());
-                mt->second = it->second;
-                vAddUpdate.push_back(CTxUnspent(it->first, static_cast<const CTxOut&>(it->second)));
+                if (mt == mapDB.end() || (it != mapBlock.end() && it->first < mt->first))
+                {
+                    StdLog("Check", "Check block unspent: find utxo fail, utxo: [%d] %s.", it->first.n, it->first.hash.GetHex().c_str());
+                    vShardAddUpdate[nShard].push_back(CTxUnspent(it->first, static_cast<const CTxOut&>(it->second)));
+                    ++it;
+                }
+                else if (it == mapBlock.end() || mt->first < it->first)
+                {
+                    StdLog("Check", "Check db unspent: find utxo fail, utxo: [%d] %s.", mt->first.n, mt->first.hash.GetHex().c_str());
+                    vShardRemove[nShard].push_back(mt->first);
+                    ++mt;
+                }
+                else
+                {
+                    if (it->second != mt->second)
+                    {
+                        StdLog("Check", "Check block unspent: txout error, utxo: [%d] %s.", it->first.n, it->first.hash.GetHex().c_str());
+                        vShardAddUpdate[nShard].push_back(CTxUnspent(it->first, static_cast<const CTxOut&>(it->second)));
+                    }
+                    ++it;
+                    ++mt;
+                }
             }
         }
-    }
+        return true;
+    });
 
+    for (size_t nShard = 0; nShard < CCheckUnspentMap::SHARD_COUNT; nShard++)
     {
-        map<CTxOutPoint, CCheckTxOut>::iterator it = mapForkUnspent.begin();
-        for (; it != mapForkUnspent.end();)
-        {
-            map<CTxOutPoint, CCheckTxOut>::iterator mt = mapBlockForkUnspent.find(it->first);
-            if (mt == mapBlockForkUnspent.end())
-            {
-                StdLog("Check", "Check db unspent: find utxo fail, utxo: [%d] %s.", it->first.n, it->first.hash.GetHex().c_str());
-                vRemove.push_back(it->first);
-                mapForkUnspent.erase(it++);
-                continue;
-            }
-            else if (it->second != mt->second)
-            {
-                StdLog("Check", "Check db unspent: txout error, utxo: [%d] %s.", it->first.n, it->first.hash.GetHex().c_str());
-                it->second = mt->second;
-                vAddUpdate.push_back(CTxUnspent(it->first, static_cast<const CTxOut&>(it->second)));
-            }
-            ++it;
-        }
+        vAddUpdate.insert(vAddUpdate.end(), vShardAddUpdate[nShard].begin(), vShardAddUpdate[nShard].end());
+        vRemove.insert(vRemove.end(), vShardRemove[nShard].begin(), vShardRemove[nShard].end());
     }
     return !(vAddUpdate.size() > 0 || vRemove.size() > 0);
 }
@@ -511,12 +556,17 @@ bool CCheckForkTxPool::AddTx(const uint256& txid, const CAssembledTx& tx)
 bool CCheckForkTxPool::Spent(const CTxOutPoint& point, const uint256& txidSpent, const CDestination& sendTo)
 {
     map<CTxOutPoint, CCheckTxOut>::iterator it = mapTxPoolUnspent.find(point);
-    if (it == mapTxPoolUnspent.end())
+    if (it != mapTxPoolUnspent.end())
+    {
+        mapTxPoolUnspent.erase(it);
+        return true;
+    }
+    if (GetBlockUnspent(point) == nullptr)
     {
         StdError("Check", "TxPool Spent: find fail, utxo: [%d] %s", point.n, point.hash.GetHex().c_str());
         return false;
     }
-    mapTxPoolUnspent.erase(it);
+    setBlockSpent.insert(point);
     return true;
 }
 
@@ -524,7 +574,7 @@ bool CCheckForkTxPool::Unspent(const CTxOutPoint& point, const CTxOut& out)
 {
     if (!out.IsNull())
     {
-        if (!mapTxPoolUnspent.insert(make_pair(point, CCheckTxOut(out))).second)
+        if (GetBlockUnspent(point) != nullptr || !mapTxPoolUnspent.insert(make_pair(point, CCheckTxOut(out))).second)
         {
             StdError("Check", "TxPool Unspent: insert unspent fail, utxo: [%d] %s.", point.n, point.hash.GetHex().c_str());
             return false;
@@ -540,13 +590,22 @@ bool CCheckForkTxPool::CheckTxExist(const uint256& txid)
 
 bool CCheckForkTxPool::CheckTxPoolUnspent(const CTxOutPoint& point, const CCheckTxOut& out)
 {
+    const CCheckTxOut* pOut = nullptr;
     map<CTxOutPoint, CCheckTxOut>::iterator it = mapTxPoolUnspent.find(point);
-    if (it == mapTxPoolUnspent.end())
+    if (it != mapTxPoolUnspent.end())
+    {
+        pOut = &(it->second);
+    }
+    else
+    {
+        pOut = GetBlockUnspent(point);
+    }
+    if (pOut == nullptr)
     {
         StdLog("Check", "TxPool CheckTxPoolUnspent: find fail, utxo: [%d] %s", point.n, point.hash.GetHex().c_str());
         return false;
     }
-    if (it->second != out)
+    if (*pOut != out)
     {
         StdLog("Check", "TxPool CheckTxPoolUnspent: out error, utxo: [%d] %s", point.n, point.hash.GetHex().c_str());
         return false;
@@ -570,14 +629,50 @@ bool CCheckForkTxPool::GetWalletTx(const uint256& hashFork, const set<CDestinati
     return true;
 }
 
+bool CCheckForkTxPool::WalkThroughUnspent(const boost::function<bool(const CTxOutPoint&, const CCheckTxOut&)>& fnWalk)
+{
+    if (pBlockUnspent != nullptr)
+    {
+        for (size_t nShard = 0; nShard < CCheckUnspentMap::SHARD_COUNT; nShard++)
+        {
+            for (const auto& vd : pBlockUnspent->GetShard(nShard))
+            {
+                if (!setBlockSpent.count(vd.first) && !fnWalk(vd.first, vd.second))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    for (const auto& vd : mapTxPoolUnspent)
+    {
+        if (!fnWalk(vd.first, vd.second))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const CCheckTxOut* CCheckForkTxPool::GetBlockUnspent(const CTxOutPoint& point)
+{
+    if (pBlockUnspent == nullptr || setBlockSpent.count(point))
+    {
+        return nullptr;
+    }
+    const CCheckUnspentMap::CShard& mapShard = pBlockUnspent->GetShard(point.hash);
+    CCheckUnspentMap::CShard::const_iterator it = mapShard.find(point);
+    return (it != mapShard.end() ? &(it->second) : nullptr);
+}
+
 /////////////////////////////////////////////////////////////////////////
 // CCheckTxPoolData
 
-void CCheckTxPoolData::AddForkUnspent(const uint256& hashFork, const map<CTxOutPoint, CCheckTxOut>& mapUnspent)
+void CCheckTxPoolData::AddForkUnspent(const uint256& hashFork, const CCheckUnspentMap& mapUnspent)
 {
     if (hashFork != 0)
     {
-        mapForkTxPool[hashFork].mapTxPoolUnspent = mapUnspent;
+        mapForkTxPool[hashFork].pBlockUnspent = &mapUnspent;
     }
 }
 
@@ -668,23 +763,27 @@ void CCheckBlockFork::UpdateMaxTrust(CBlockIndex* pBlockIndex)
     }
 }
 
-bool CCheckBlockFork::AddBlockTx(const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn)
+bool CCheckBlockFork::AddBlockTx(size_t nShard, const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn)
 {
     const uint256 txid = txIn.GetHash();
-    map<uint256, CCheckBlockTx>::iterator mt = mapBlockTx.insert(make_pair(txid, CCheckBlockTx(txIn, contxtIn, nHeight, hashAtForkIn, nFileNoIn, nOffsetIn))).first;
-    if (mt == mapBlockTx.end())
+    const bool fTxShard = (CCheckBlockTxMap::GetShardIndex(txid) == nShard);
+    if (fTxShard)
     {
-        StdLog("Check", "AddBlockTx: add block tx fail, txid: %s.", txid.GetHex().c_str());
-        return false;
+        mapBlockTx.GetShard(nShard).insert(make_pair(txid, CCheckBlockTx(txIn, contxtIn, nHeight, hashAtForkIn, nFileNoIn, nOffsetIn)));
     }
     for (int i = 0; i < txIn.vInput.size(); i++)
     {
-        if (!AddBlockSpent(txIn.vInput[i].prevout, txid, txIn.sendTo))
+        const CTxOutPoint& prevout = txIn.vInput[i].prevout;
+        if (CCheckUnspentMap::GetShardIndex(prevout.hash) == nShard && !AddBlockSpent(prevout, txid, txIn.sendTo))
         {
             StdLog("Check", "AddBlockTx: block spent fail, txid: %s.", txid.GetHex().c_str());
             return false;
         }
     }
+    if (!fTxShard)
+    {
+        return true;
+    }
     if (!AddBlockUnspent(CTxOutPoint(txid, 0), CTxOut(txIn)))
     {
         StdLog("Check", "AddBlockTx: add block unspent 0 fail, txid: %s.", txid.GetHex().c_str());
@@ -703,13 +802,14 @@ bool CCheckBlockFork::AddBlockTx(const CTransaction& txIn, const CTxContxt& cont
 
 bool CCheckBlockFork::AddBlockSpent(const CTxOutPoint& txPoint, const uint256& txidSpent, const CDestination& sendTo)
 {
-    map<CTxOutPoint, CCheckTxOut>::iterator it = mapBlockUnspent.find(txPoint);
-    if (it == mapBlockUnspent.end())
+    CCheckUnspentMap::CShard& mapShard = mapBlockUnspent.GetShard(txPoint.hash);
+    CCheckUnspentMap::CShard::iterator it = mapShard.find(txPoint);
+    if (it == mapShard.end())
     {
         StdLog("Check", "AddBlockSpent: utxo find fail, utxo: [%d] %s.", txPoint.n, txPoint.hash.GetHex().c_str());
         return false;
     }
-    mapBlockUnspent.erase(it);
+    mapShard.erase(it);
     return true;
 }
 
@@ -717,7 +817,7 @@ bool CCheckBlockFork::AddBlockUnspent(const CTxOutPoint& txPoint, const CTxOut&
 {
     if (!txOut.IsNull())
     {
-        if (!mapBlockUnspent.insert(make_pair(txPoint, CCheckTxOut(txOut))).second)
+        if (!mapBlockUnspent.GetShard(txPoint.hash).insert(make_pair(txPoint, CCheckTxOut(txOut))).second)
         {
             StdLog("Check", "AddBlockUnspent: Add block unspent fail, utxo: [%d] %s.", txPoint.n, txPoint.hash.GetHex().c_str());
             return false;
@@ -728,8 +828,9 @@ bool CCheckBlockFork::AddBlockUnspent(const CTxOutPoint& txPoint, const CTxOut&
 
 bool CCheckBlockFork::CheckTxExist(const uint256& txid, int& nHeight)
 {
-    map<uint256, CCheckBlockTx>::iterator it = mapBlockTx.find(txid);
-    if (it == mapBlockTx.end())
+    const CCheckBlockTxMap::CShard& mapShard = mapBlockTx.GetShard(txid);
+    CCheckBlockTxMap::CShard::const_iterator it = mapShard.find(txid);
+    if (it == mapShard.end())
     {
         StdLog("Check", "CheckBlockFork: Check tx exist, find tx fail, txid: %s", txid.GetHex().c_str());
         return false;
@@ -815,7 +916,7 @@ bool CCheckBlockWalker::Initialize(const string& strPath)
 bool CCheckBlockWalker::Walk(const CBlockEx& block, uint32 nFile, uint32 nOffset)
 {
     const uint256 hashBlock = block.GetHash();
-    if (mapBlock.count(hashBlock) > 0)
+    if (mapBlockIndex.count(hashBlock) > 0)
     {
         StdError("Check", "Block walk: block exist, hash: %s.", hashBlock.GetHex().c_str());
         return true;
@@ -839,36 +940,19 @@ bool CCheckBlockWalker::Walk(const CBlockEx& block, uint32 nFile, uint32 nOffset
     }
     else
     {
-        if (mapBlock.empty() || hashGenesis == 0)
+        if (mapBlockIndex.empty() || hashGenesis == 0)
         {
             StdError("Check", "Block walk: no genesis block, block hash: %s.", hashBlock.GetHex().c_str());
             return false;
         }
     }
 
-    CBlockEx* pPrevBlock = nullptr;
-    if (block.hashPrev != 0)
-    {
-        map<uint256, CBlockEx>::iterator it = mapBlock.find(block.hashPrev);
-        if (it != mapBlock.end())
-        {
-            pPrevBlock = &(it->second);
-        }
-    }
-    if (!block.IsGenesis() && pPrevBlock == nullptr)
+    if (!block.IsGenesis() && (block.hashPrev == 0 || mapBlockIndex.count(block.hashPrev) == 0))
     {
         StdError("Check", "Block walk: Prev block not exist, block: %s.", hashBlock.GetHex().c_str());
         return false;
     }
 
-    map<uint256, CBlockEx>::iterator mt = mapBlock.insert(make_pair(hashBlock, block)).first;
-    if (mt == mapBlock.end())
-    {
-        StdError("Check", "Block walk: Insert block fail, block: %s.", hashBlock.GetHex().c_str());
-        return false;
-    }
-    CBlockEx& checkBlock = mt->second;
-
     CBlockIndex* pNewBlockIndex = nullptr;
     CBlockOutline* pBlockOutline = objBlockIndexWalker.GetBlockOutline(hashBlock);
     if (pBlockOutline == nullptr)
@@ -885,7 +969,7 @@ bool CCheckBlockWalker::Walk(const CBlockEx& block, uint32 nFile, uint32 nOffset
             // nChainTrust = 2**256 / (nTarget+1) = ~nTarget / (nTarget+1) + 1
             nChainTrust = (~nTarget / (nTarget + 1)) + 1;
         }
-        pNewBlockIndex = AddNewIndex(hashBlock, static_cast<const CBlock&>(checkBlock), nFile, nOffset, nChainTrust);
+        pNewBlockIndex = AddNewIndex(hashBlock, static_cast<const CBlock&>(block), nFile, nOffset, nChainTrust);
         if (pNewBlockIndex == nullptr)
         {
             StdError("Check", "Block walk: Add new block index fail 1, block: %s.", hashBlock.GetHex().c_str());
@@ -940,6 +1024,7 @@ bool CCheckBlockWalker::Walk(const CBlockEx& block, uint32 nFile, uint32 nOffset
     }
 
     nBlockCount++;
+    objWalkProgress.Update(1);
     return true;
 }
 
@@ -1002,65 +1087,81 @@ bool CCheckBlockWalker::UpdateBlockTx(CCheckForkManager& objForkMn)
                 StdError("Check", "UpdateBlockTx: pOrigin is null, fork: %s", it->first.GetHex().c_str());
                 continue;
             }
-            CBlockIndex* pIndex = checkFork.pOrigin;
-            while (pIndex)
+            vector<CBlockIndex*> vIndex;
+            for (CBlockIndex* pIndex = checkFork.pOrigin; pIndex; pIndex = pIndex->pNext)
             {
-                map<uint256, CBlockEx>::iterator it = mapBlock.find(pIndex->GetBlockHash());
-                if (it == mapBlock.end())
+                vIndex.push_back(pIndex);
+            }
+
+            // every shard replays the whole batch in chain order and keeps only its own outpoints
+            auto fnBatch = [&](const vector<CCheckStreamBlock>& vBlock) -> bool {
+                vector<vector<uint256>> vBlockFork(vBlock.size());
+                for (size_t i = 0; i < vBlock.size(); i++)
                 {
-                    StdError("Check", "UpdateBlockTx: Find block fail, block: %s", pIndex->GetBlockHash().GetHex().c_str());
-                    return false;
+                    objForkMn.GetTxFork(hashFork, vBlock[i].pIndex->GetBlockHeight(), vBlockFork[i]);
                 }
-                const CBlockEx& block = it->second;
-                if (!block.IsNull())
-                {
-                    vector<uint256> vFork;
-                    objForkMn.GetTxFork(hashFork, pIndex->GetBlockHeight(), vFork);
-
-                    CBufStream ss;
-                    CTxContxt txContxt;
-                    txContxt.destIn = block.txMint.sendTo;
-                    uint32 nTxOffset = pIndex->nOffset + block.GetTxSerializedOffset();
-                    if (!AddBlockTx(block.txMint, txContxt, block.GetBlockHeight(), hashFork, pIndex->nFile, nTxOffset, vFork))
+                return ParallelFor(CCheckUnspentMap::SHARD_COUNT, 1, [&](size_t nBegin, size_t nEnd) -> bool {
+                    for (size_t nShard = nBegin; nShard < nEnd; nShard++)
                     {
-                        StdError("Check", "UpdateBlockTx: Add mint tx fail, txid: %s, block: %s",
-                                 block.txMint.GetHash().GetHex().c_str(), pIndex->GetBlockHash().GetHex().c_str());
-                        return false;
-                    }
-                    nTxOffset += ss.GetSerializeSize(block.txMint);
-
-                    CVarInt var(block.vtx.size());
-                    nTxOffset += ss.GetSerializeSize(var);
-                    for (int i = 0; i < block.vtx.size(); i++)
-                    {
-                        if (!AddBlockTx(block.vtx[i], block.vTxContxt[i], block.GetBlockHeight(), hashFork, pIndex->nFile, nTxOffset, vFork))
+                        for (size_t i = 0; i < vBlock.size(); i++)
                         {
-                            StdError("Check", "UpdateBlockTx: Add tx fail, txid: %s, block: %s",
-                                     block.vtx[i].GetHash().GetHex().c_str(), pIndex->GetBlockHash().GetHex().c_str());
-                            return false;
+                            const CBlockIndex* pIndex = vBlock[i].pIndex;
+                            const CBlockEx& block = vBlock[i].block;
+                            if (block.IsNull())
+                            {
+                                continue;
+                            }
+
+                            CBufStream ss;
+                            CTxContxt txContxt;
+                            txContxt.destIn = block.txMint.sendTo;
+                            uint32 nTxOffset = pIndex->nOffset + block.GetTxSerializedOffset();
+                            if (!AddBlockTx(nShard, block.txMint, txContxt, block.GetBlockHeight(), hashFork, pIndex->nFile, nTxOffset, vBlockFork[i]))
+                            {
+                                StdError("Check", "UpdateBlockTx: Add mint tx fail, txid: %s, block: %s",
+                                         block.txMint.GetHash().GetHex().c_str(), pIndex->GetBlockHash().GetHex().c_str());
+                                return false;
+                            }
+                            nTxOffset += ss.GetSerializeSize(block.txMint);
+
+                            CVarInt var(block.vtx.size());
+                            nTxOffset += ss.GetSerializeSize(var);
+                            for (int n = 0; n < block.vtx.size(); n++)
+                            {
+                                if (!AddBlockTx(nShard, block.vtx[n], block.vTxContxt[n], block.GetBlockHeight(), hashFork, pIndex->nFile, nTxOffset, vBlockFork[i]))
+                                {
+                                    StdError("Check", "UpdateBlockTx: Add tx fail, txid: %s, block: %s",
+                                             block.vtx[n].GetHash().GetHex().c_str(), pIndex->GetBlockHash().GetHex().c_str());
+                                    return false;
+                                }
+                                nTxOffset += ss.GetSerializeSize(block.vtx[n]);
+                            }
                         }
-                        nTxOffset += ss.GetSerializeSize(block.vtx[i]);
                     }
-                }
-                pIndex = pIndex->pNext;
+                    return true;
+                });
+            };
+            if (!StreamBlock(vIndex, "Update block tx", fnBatch))
+            {
+                return false;
             }
             if (it->first == hashGenesis)
             {
-                nMainChainTxCount = checkFork.mapBlockTx.size();
+                nMainChainTxCount = checkFork.mapBlockTx.Size();
             }
         }
     }
     return true;
 }
 
-bool CCheckBlockWalker::AddBlockTx(const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn, const vector<uint256>& vFork)
+bool CCheckBlockWalker::AddBlockTx(size_t nShard, const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn, const vector<uint256>& vFork)
 {
     for (const uint256& hashFork : vFork)
     {
         map<uint256, CCheckBlockFork>::iterator it = mapCheckFork.find(hashFork);
         if (it != mapCheckFork.end())
         {
-            if (!it->second.AddBlockTx(txIn, contxtIn, nHeight, hashAtForkIn, nFileNoIn, nOffsetIn))
+            if (!it->second.AddBlockTx(nShard, txIn, contxtIn, nHeight, hashAtForkIn, nFileNoIn, nOffsetIn))
             {
                 StdError("Check", "Block add tx: Add fail, txid: %s, fork: %s",
                          txIn.GetHash().GetHex().c_str(), hashFork.GetHex().c_str());
@@ -1071,6 +1172,96 @@ bool CCheckBlockWalker::AddBlockTx(const CTransaction& txIn, const CTxContxt& co
     return true;
 }
 
+bool CCheckBlockWalker::StreamBlock(const vector<CBlockIndex*>& vIndex, const string& strName, const boost::function<bool(const vector<CCheckStreamBlock>&)>& fnBatch)
+{
+    // blocks are read ahead on a reader thread, at most STREAM_QUEUE_SIZE batches are held in memory
+    boost::mutex mtxQueue;
+    boost::condition_variable condQueue;
+    deque<vector<CCheckStreamBlock>> queBatch;
+    bool fReadDone = false;
+    bool fReadError = false;
+    bool fStop = false;
+
+    boost::thread thrReader([&]() {
+        for (size_t nBegin = 0; nBegin < vIndex.size(); nBegin += STREAM_BATCH_SIZE)
+        {
+            vector<CCheckStreamBlock> vBlock(min((size_t)STREAM_BATCH_SIZE, vIndex.size() - nBegin));
+            for (size_t i = 0; i < vBlock.size(); i++)
+            {
+                CCheckStreamBlock& streamBlock = vBlock[i];
+                streamBlock.pIndex = vIndex[nBegin + i];
+                if (!objTsBlock.Read(streamBlock.block, streamBlock.pIndex->nFile, streamBlock.pIndex->nOffset, false))
+                {
+                    StdError("Check", "%s: Read block fail, block: %s", strName.c_str(), streamBlock.pIndex->GetBlockHash().GetHex().c_str());
+                    boost::unique_lock<boost::mutex> lock(mtxQueue);
+                    fReadError = true;
+                    fReadDone = true;
+                    condQueue.notify_all();
+                    return;
+                }
+            }
+
+            boost::unique_lock<boost::mutex> lock(mtxQueue);
+            while (queBatch.size() >= STREAM_QUEUE_SIZE && !fStop)
+            {
+                condQueue.wait(lock);
+            }
+            if (fStop)
+            {
+                return;
+            }
+            queBatch.push_back(vector<CCheckStreamBlock>());
+            queBatch.back().swap(vBlock);
+            condQueue.notify_all();
+        }
+        boost::unique_lock<boost::mutex> lock(mtxQueue);
+        fReadDone = true;
+        condQueue.notify_all();
+    });
+
+    CCheckProgress progress(strName, vIndex.size());
+    bool fRet = true;
+    for (;;)
+    {
+        vector<CCheckStreamBlock> vBlock;
+        {
+            boost::unique_lock<boost::mutex> lock(mtxQueue);
+            while (queBatch.empty() && !fReadDone)
+            {
+                condQueue.wait(lock);
+            }
+            if (queBatch.empty())
+            {
+                fRet = !fReadError;
+                break;
+            }
+            vBlock.swap(queBatch.front());
+            queBatch.pop_front();
+            condQueue.notify_all();
+        }
+        if (!fnBatch(vBlock))
+        {
+            fRet = false;
+            break;
+        }
+        progress.Update(vBlock.size());
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(mtxQueue);
+        fStop = true;
+        condQueue.notify_all();
+    }
+    thrReader.join();
+    progress.Finish();
+    return fRet;
+}
+
+bool CCheckBlockWalker::ReadTx(const CTxIndex& txIndex, CTransaction& tx)
+{
+    return objTsBlock.Read(tx, txIndex.nFile, txIndex.nOffset, false);
+}
+
 CBlockIndex* CCheckBlockWalker::AddNewIndex(const uint256& hash, const CBlock& block, uint32 nFile, uint32 nOffset, const uint256& nChainTrust)
 {
     CBlockIndex* pIndexNew = new CBlockIndex(block, nFile, nOffset);
@@ -1175,7 +1366,6 @@ void CCheckBlockWalker::ClearBlockIndex()
         delete (*mi).second;
     }
     mapBlockIndex.clear();
-    mapBlock.clear();
 }
 
 bool CCheckBlockWalker::CheckTxExist(const uint256& hashFork, const uint256& txid, int& nHeight)
@@ -1201,37 +1391,42 @@ bool CCheckBlockWalker::GetBlockWalletTx(const set<CDestination>& setAddress, ve
             StdError("Check", "GetBlockWalletTx: pOrigin is null, fork: %s", hashFork.GetHex().c_str());
             return false;
         }
-        CBlockIndex* pBlockIndex = checkFork.pOrigin;
-        while (pBlockIndex)
+        vector<CBlockIndex*> vIndex;
+        for (CBlockIndex* pBlockIndex = checkFork.pOrigin; pBlockIndex; pBlockIndex = pBlockIndex->pNext)
         {
-            map<uint256, CBlockEx>::iterator it = mapBlock.find(pBlockIndex->GetBlockHash());
-            if (it == mapBlock.end())
-            {
-                StdError("Check", "GetBlockWalletTx: find block fail, block: %s, fork: %s", pBlockIndex->GetBlockHash().GetHex().c_str(), hashFork.GetHex().c_str());
-                return false;
-            }
-            const CBlockEx& block = it->second;
-            for (int i = 0; i < block.vtx.size(); i++)
+            vIndex.push_back(pBlockIndex);
+        }
+        auto fnBatch = [&](const vector<CCheckStreamBlock>& vBlock) -> bool {
+            for (const CCheckStreamBlock& streamBlock : vBlock)
             {
-                //CAssembledTx(const CTransaction& tx, int nBlockHeightIn, const CDestination& destInIn = CDestination(), int64 nValueInIn = 0)
-                //CWalletTx(const uint256& txidIn, const CAssembledTx& tx, const uint256& hashForkIn, bool fIsMine, bool fFromMe)
+                const CBlockEx& block = streamBlock.block;
+                for (int i = 0; i < block.vtx.size(); i++)
+                {
+                    //CAssembledTx(const CTransaction& tx, int nBlockHeightIn, const CDestination& destInIn = CDestination(), int64 nValueInIn = 0)
+                    //CWalletTx(const uint256& txidIn, const CAssembledTx& tx, const uint256& hashForkIn, bool fIsMine, bool fFromMe)
 
-                bool fIsMine = (setAddress.find(block.vtx[i].sendTo) != setAddress.end());
-                bool fFromMe = (setAddress.find(block.vTxContxt[i].destIn) != setAddress.end());
-                if (fIsMine || fFromMe)
+                    bool fIsMine = (setAddress.find(block.vtx[i].sendTo) != setAddress.end());
+                    bool fFromMe = (setAddress.find(block.vTxContxt[i].destIn) != setAddress.end());
+                    if (fIsMine || fFromMe)
+                    {
+                        CAssembledTx atx(block.vtx[i], block.GetBlockHeight(), block.vTxContxt[i].destIn, block.vTxContxt[i].GetValueIn());
+                        CWalletTx wtx(block.vtx[i].GetHash(), atx, hashFork, fIsMine, fFromMe);
+                        vWalletTx.push_back(wtx);
+                    }
+                }
+                if (!block.txMint.IsNull() && setAddress.find(block.txMint.sendTo) != setAddress.end())
                 {
-                    CAssembledTx atx(block.vtx[i], block.GetBlockHeight(), block.vTxContxt[i].destIn, block.vTxContxt[i].GetValueIn());
-                    CWalletTx wtx(block.vtx[i].GetHash(), atx, hashFork, fIsMine, fFromMe);
+                    CAssembledTx atx(block.txMint, block.GetBlockHeight(), CDestination(), 0);
+                    CWalletTx wtx(block.txMint.GetHash(), atx, hashFork, true, false);
                     vWalletTx.push_back(wtx);
                 }
             }
-            if (!block.txMint.IsNull() && setAddress.find(block.txMint.sendTo) != setAddress.end())
-            {
-                CAssembledTx atx(block.txMint, block.GetBlockHeight(), CDestination(), 0);
-                CWalletTx wtx(block.txMint.GetHash(), atx, hashFork, true, false);
-                vWalletTx.push_back(wtx);
-            }
-            pBlockIndex = pBlockIndex->pNext;
+            return true;
+        };
+        if (!StreamBlock(vIndex, "Get block wallet tx", fnBatch))
+        {
+            StdError("Check", "GetBlockWalletTx: stream block fail, fork: %s", hashFork.GetHex().c_str());
+            return false;
         }
     }
     return true;
@@ -2024,6 +2219,7 @@ bool CCheckRepairData::FetchBlockData()
         StdError("Check", "Fetch block and tx fail.");
         return false;
     }
+    objBlockWalker.objWalkProgress.Finish();
     StdLog("Check", "Fetch block and tx success, block: %ld.", objBlockWalker.nBlockCount);
 
     if (objBlockWalker.nBlockCount > 0)
@@ -2185,37 +2381,47 @@ bool CCheckRepairData::CheckWalletTx(vector<CWalletTx>& vAddTx, vector<uint256>&
         {
             const uint256& hashFork = mt->first;
             CCheckBlockFork& objBlockFork = mt->second;
-            map<uint256, CCheckBlockTx>::iterator it = objBlockFork.mapBlockTx.begin();
-            for (; it != objBlockFork.mapBlockTx.end(); ++it)
+            for (size_t nShard = 0; nShard < CCheckBlockTxMap::SHARD_COUNT; nShard++)
             {
-                const uint256& txid = it->first;
-                const CCheckBlockTx& cacheTx = it->second;
-                if (cacheTx.hashAtFork == hashFork && cacheTx.tx.nAmount > 0)
+                CCheckBlockTxMap::CShard& mapShard = objBlockFork.mapBlockTx.GetShard(nShard);
+                CCheckBlockTxMap::CShard::iterator it = mapShard.begin();
+                for (; it != mapShard.end(); ++it)
                 {
-                    bool fIsMine = objWalletAddressWalker.CheckAddress(cacheTx.tx.sendTo);
-                    bool fFromMe = objWalletAddressWalker.CheckAddress(cacheTx.txContxt.destIn);
-                    if (fIsMine || fFromMe)
+                    const uint256& txid = it->first;
+                    const CCheckBlockTx& cacheTx = it->second;
+                    if (cacheTx.hashAtFork == hashFork && cacheTx.nAmount > 0)
                     {
-                        CCheckWalletTx* pWalletTx = objWalletTxWalker.GetWalletTx(hashFork, txid);
-                        if (pWalletTx == nullptr)
+                        bool fIsMine = objWalletAddressWalker.CheckAddress(cacheTx.sendTo);
+                        bool fFromMe = objWalletAddressWalker.CheckAddress(cacheTx.txContxt.destIn);
+                        if (fIsMine || fFromMe)
                         {
-                            StdLog("Check", "CheckWalletTx: [block tx] find wallet tx fail, txid: %s, block height: %d, fork: %s",
-                                   txid.GetHex().c_str(), cacheTx.txIndex.nBlockHeight, hashFork.GetHex().c_str());
-                            //CAssembledTx(const CTransaction& tx, int nBlockHeightIn, const CDestination& destInIn = CDestination(), int64 nValueInIn = 0)
-                            //CWalletTx(const uint256& txidIn, const CAssembledTx& tx, const uint256& hashForkIn, bool fIsMine, bool fFromMe)
-                            CAssembledTx atx(cacheTx.tx, cacheTx.txIndex.nBlockHeight, cacheTx.txContxt.destIn, cacheTx.txContxt.GetValueIn());
-                            CWalletTx wtx(txid, atx, hashFork, fIsMine, fFromMe);
-                            objWalletTxWalker.AddWalletTx(wtx);
-                            vAddTx.push_back(wtx);
-                        }
-                        else
-                        {
-                            if (pWalletTx->nBlockHeight != cacheTx.txIndex.nBlockHeight)
+                            CCheckWalletTx* pWalletTx = objWalletTxWalker.GetWalletTx(hashFork, txid);
+                            if (pWalletTx == nullptr)
+                            {
+                                StdLog("Check", "CheckWalletTx: [block tx] find wallet tx fail, txid: %s, block height: %d, fork: %s",
+                                       txid.GetHex().c_str(), cacheTx.txIndex.nBlockHeight, hashFork.GetHex().c_str());
+                                CTransaction tx;
+                                if (!objBlockWalker.ReadTx(cacheTx.txIndex, tx))
+                                {
+                                    StdError("Check", "CheckWalletTx: [block tx] read tx fail, txid: %s", txid.GetHex().c_str());
+                                    return false;
+                                }
+                                //CAssembledTx(const CTransaction& tx, int nBlockHeightIn, const CDestination& destInIn = CDestination(), int64 nValueInIn = 0)
+                                //CWalletTx(const uint256& txidIn, const CAssembledTx& tx, const uint256& hashForkIn, bool fIsMine, bool fFromMe)
+                                CAssembledTx atx(tx, cacheTx.txIndex.nBlockHeight, cacheTx.txContxt.destIn, cacheTx.txContxt.GetValueIn());
+                                CWalletTx wtx(txid, atx, hashFork, fIsMine, fFromMe);
+                                objWalletTxWalker.AddWalletTx(wtx);
+                                vAddTx.push_back(wtx);
+                            }
+                            else
                             {
-                                StdLog("Check", "CheckWalletTx: [block tx] wallet tx height error, wtx height: %d, block height: %d, txid: %s",
-                                       pWalletTx->nBlockHeight, cacheTx.txIndex.nBlockHeight, txid.GetHex().c_str());
-                                pWalletTx->nBlockHeight = cacheTx.txIndex.nBlockHeight;
-                                vAddTx.push_back(*pWalletTx);
+                                if (pWalletTx->nBlockHeight != cacheTx.txIndex.nBlockHeight)
+                                {
+                                    StdLog("Check", "CheckWalletTx: [block tx] wallet tx height error, wtx height: %d, block height: %d, txid: %s",
+                                           pWalletTx->nBlockHeight, cacheTx.txIndex.nBlockHeight, txid.GetHex().c_str());
+                                    pWalletTx->nBlockHeight = cacheTx.txIndex.nBlockHeight;
+                                    vAddTx.push_back(*pWalletTx);
+                                }
                             }
                         }
                     }
@@ -2341,17 +2547,20 @@ bool CCheckRepairData::CheckWalletTx(vector<CWalletTx>& vAddTx, vector<uint256>&
         {
             const uint256& hashFork = mt->first;
             CCheckForkTxPool& fork = mt->second;
-            map<CTxOutPoint, CCheckTxOut>::iterator it = fork.mapTxPoolUnspent.begin();
-            for (; it != fork.mapTxPoolUnspent.end(); ++it)
-            {
-                if (objWalletAddressWalker.CheckAddress(it->second.destTo))
+            auto fnWalk = [&](const CTxOutPoint& point, const CCheckTxOut& out) -> bool {
+                if (objWalletAddressWalker.CheckAddress(out.destTo))
                 {
-                    if (!objWalletTxWalker.CheckWalletUnspent(hashFork, it->first, it->second))
+                    if (!objWalletTxWalker.CheckWalletUnspent(hashFork, point, out))
                     {
-                        StdLog("Check", "Check wallet unspent 2: check unspent fail, utxo: [%d] %s.", it->first.n, it->first.hash.GetHex().c_str());
+                        StdLog("Check", "Check wallet unspent 2: check unspent fail, utxo: [%d] %s.", point.n, point.hash.GetHex().c_str());
                         return false;
                     }
                 }
+                return true;
+            };
+            if (!fork.WalkThroughUnspent(fnWalk))
+            {
+                return false;
             }
         }
     }
@@ -2389,8 +2598,7 @@ bool CCheckRepairData::CheckBlockIndex()
     for (map<uint256, CBlockOutline>::iterator it = walker.mapBlockIndex.begin(); it != walker.mapBlockIndex.end(); ++it)
     {
         const CBlockOutline& blockOut = it->second;
-        map<uint256, CBlockEx>::iterator mt = objBlockWalker.mapBlock.find(blockOut.hashBlock);
-        if (mt == objBlockWalker.mapBlock.end())
+        if (objBlockWalker.mapBlockIndex.find(blockOut.hashBlock) == objBlockWalker.mapBlockIndex.end())
         {
             StdLog("Check", "CheckBlockIndex: Find block hash fail, remove block index, block: %s.", blockOut.hashBlock.GetHex().c_str());
             if (!fOnlyCheck)
@@ -2423,79 +2631,84 @@ bool CCheckRepairData::CheckTxIndex()
             dbTxIndex.Deinitialize();
             return false;
         }
-        CBlockIndex* pBlockIndex = mt->second.pLast;
-        while (pBlockIndex)
+        vector<CBlockIndex*> vIndex;
+        for (CBlockIndex* pBlockIndex = mt->second.pLast; pBlockIndex; pBlockIndex = pBlockIndex->pPrev)
         {
-            const uint256& hashBlock = pBlockIndex->GetBlockHash();
-            uint256 hashFork = pBlockIndex->GetOriginHash();
-            if (hashFork == 0)
-            {
-                StdLog("Check", "CheckTxIndex: fork is 0");
-                pBlockIndex = pBlockIndex->pNext;
-                continue;
-            }
-            map<uint256, CBlockEx>::iterator at = objBlockWalker.mapBlock.find(hashBlock);
-            if (at == objBlockWalker.mapBlock.end())
+            vIndex.push_back(pBlockIndex);
+            if (pBlockIndex->IsOrigin() || pBlockIndex == mt->second.pOrigin)
             {
-                StdLog("Check", "CheckTxIndex: find block fail");
-                return false;
+                break;
             }
-            const CBlockEx& block = at->second;
-            if (!block.IsNull())
+        }
+        auto fnBatch = [&](const vector<CCheckStreamBlock>& vBlock) -> bool {
+            for (const CCheckStreamBlock& streamBlock : vBlock)
             {
-                CBufStream ss;
-                CTxIndex txIndex;
-
-                uint32 nTxOffset = pBlockIndex->nOffset + block.GetTxSerializedOffset();
-                if (!dbTxIndex.Retrieve(hashFork, block.txMint.GetHash(), txIndex))
+                const CBlockIndex* pBlockIndex = streamBlock.pIndex;
+                uint256 hashFork = pBlockIndex->GetOriginHash();
+                if (hashFork == 0)
                 {
-                    StdLog("Check", "Retrieve db tx index fail, height: %d, block: %s, mint tx: %s.",
-                           block.GetBlockHeight(), block.GetHash().GetHex().c_str(), block.txMint.GetHash().GetHex().c_str());
-
-                    mapTxNew[hashFork].push_back(make_pair(block.txMint.GetHash(), CTxIndex(block.GetBlockHeight(), pBlockIndex->nFile, nTxOffset)));
+                    StdLog("Check", "CheckTxIndex: fork is 0");
+                    continue;
                 }
-                else
+                const CBlockEx& block = streamBlock.block;
+                if (!block.IsNull())
                 {
-                    if (!(txIndex.nFile == pBlockIndex->nFile && txIndex.nOffset == nTxOffset))
+                    CBufStream ss;
+                    CTxIndex txIndex;
+
+                    uint32 nTxOffset = pBlockIndex->nOffset + block.GetTxSerializedOffset();
+                    if (!dbTxIndex.Retrieve(hashFork, block.txMint.GetHash(), txIndex))
                     {
-                        StdLog("Check", "Check tx index fail, height: %d, block: %s, mint tx: %s, db offset: %d, block offset: %d.",
-                               block.GetBlockHeight(), block.GetHash().GetHex().c_str(),
-                               block.txMint.GetHash().GetHex().c_str(), txIndex.nOffset, nTxOffset);
+                        StdLog("Check", "Retrieve db tx index fail, height: %d, block: %s, mint tx: %s.",
+                               block.GetBlockHeight(), block.GetHash().GetHex().c_str(), block.txMint.GetHash().GetHex().c_str());
 
                         mapTxNew[hashFork].push_back(make_pair(block.txMint.GetHash(), CTxIndex(block.GetBlockHeight(), pBlockIndex->nFile, nTxOffset)));
                     }
-                }
-                nTxOffset += ss.GetSerializeSize(block.txMint);
-
-                CVarInt var(block.vtx.size());
-                nTxOffset += ss.GetSerializeSize(var);
-                for (int i = 0; i < block.vtx.size(); i++)
-                {
-                    if (!dbTxIndex.Retrieve(pBlockIndex->GetOriginHash(), block.vtx[i].GetHash(), txIndex))
+                    else
                     {
-                        StdLog("Check", "Retrieve db tx index fail, height: %d, block: %s, txid: %s.",
-                               block.GetBlockHeight(), block.GetHash().GetHex().c_str(), block.vtx[i].GetHash().GetHex().c_str());
+                        if (!(txIndex.nFile == pBlockIndex->nFile && txIndex.nOffset == nTxOffset))
+                        {
+                            StdLog("Check", "Check tx index fail, height: %d, block: %s, mint tx: %s, db offset: %d, block offset: %d.",
+                                   block.GetBlockHeight(), block.GetHash().GetHex().c_str(),
+                                   block.txMint.GetHash().GetHex().c_str(), txIndex.nOffset, nTxOffset);
 
-                        mapTxNew[hashFork].push_back(make_pair(block.vtx[i].GetHash(), CTxIndex(block.GetBlockHeight(), pBlockIndex->nFile, nTxOffset)));
+                            mapTxNew[hashFork].push_back(make_pair(block.txMint.GetHash(), CTxIndex(block.GetBlockHeight(), pBlockIndex->nFile, nTxOffset)));
+                        }
                     }
-                    else
+                    nTxOffset += ss.GetSerializeSize(block.txMint);
+
+                    CVarInt var(block.vtx.size());
+                    nTxOffset += ss.GetSerializeSize(var);
+                    for (int i = 0; i < block.vtx.size(); i++)
                     {
-                        if (!(txIndex.nFile == pBlockIndex->nFile && txIndex.nOffset == nTxOffset))
+                        if (!dbTxIndex.Retrieve(hashFork, block.vtx[i].GetHash(), txIndex))
                         {
-                            StdLog("Check", "Check tx index fail, height: %d, block: %s, txid: %s, db offset: %d, block offset: %d.",
-                                   block.GetBlockHeight(), block.GetHash().GetHex().c_str(), block.vtx[i].GetHash().GetHex().c_str(), txIndex.nOffset, nTxOffset);
+                            StdLog("Check", "Retrieve db tx index fail, height: %d, block: %s, txid: %s.",
+                                   block.GetBlockHeight(), block.GetHash().GetHex().c_str(), block.vtx[i].GetHash().GetHex().c_str());
 
                             mapTxNew[hashFork].push_back(make_pair(block.vtx[i].GetHash(), CTxIndex(block.GetBlockHeight(), pBlockIndex->nFile, nTxOffset)));
                         }
+                        else
+                        {
+                            if (!(txIndex.nFile == pBlockIndex->nFile && txIndex.nOffset == nTxOffset))
+                            {
+                                StdLog("Check", "Check tx index fail, height: %d, block: %s, txid: %s, db offset: %d, block offset: %d.",
+                                       block.GetBlockHeight(), block.GetHash().GetHex().c_str(), block.vtx[i].GetHash().GetHex().c_str(), txIndex.nOffset, nTxOffset);
+
+                                mapTxNew[hashFork].push_back(make_pair(block.vtx[i].GetHash(), CTxIndex(block.GetBlockHeight(), pBlockIndex->nFile, nTxOffset)));
+                            }
+                        }
+                        nTxOffset += ss.GetSerializeSize(block.vtx[i]);
                     }
-                    nTxOffset += ss.GetSerializeSize(block.vtx[i]);
                 }
             }
-            if (block.IsOrigin() || pBlockIndex == mt->second.pOrigin)
-            {
-                break;
-            }
-            pBlockIndex = pBlockIndex->pPrev;
+            return true;
+        };
+        if (!objBlockWalker.StreamBlock(vIndex, "Check tx index", fnBatch))
+        {
+            StdLog("Check", "CheckTxIndex: find block fail");
+            dbTxIndex.Deinitialize();
+            return false;
         }
     }
 
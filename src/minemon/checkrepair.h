@@ -5,6 +5,8 @@
 #ifndef STORAGE_CHECKREPAIR_H
 #define STORAGE_CHECKREPAIR_H
 
+#include <boost/function.hpp>
+
 #include "address.h"
 #include "block.h"
 #include "blockindexdb.h"
@@ -32,16 +34,18 @@ namespace minemon
 /////////////////////////////////////////////////////////////////////////
 // CCheckBlockTx
 
+// the blocks are not kept in memory, the tx is read again from txIndex when needed
 class CCheckBlockTx
 {
 public:
     CCheckBlockTx(const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn)
-      : tx(txIn), txContxt(contxtIn), hashAtFork(hashAtForkIn), txIndex(nHeight, nFileNoIn, nOffsetIn)
+      : sendTo(txIn.sendTo), nAmount(txIn.nAmount), txContxt(contxtIn), hashAtFork(hashAtForkIn), txIndex(nHeight, nFileNoIn, nOffsetIn)
     {
     }
 
 public:
-    const CTransaction& tx;
+    CDestination sendTo;
+    int64 nAmount;
     CTxContxt txContxt;
     CTxIndex txIndex;
     uint256 hashAtFork;
@@ -70,16 +74,101 @@ public:
     }
 };
 
+/////////////////////////////////////////////////////////////////////////
+// CCheckShardMap
+
+/* Map split into shards by the low word of the tx hash (the high word of a
+   txid is its timestamp). A shard is owned by one thread while the blocks
+   are replayed or the unspents are compared, so the shards have no lock. */
+template <typename K, typename V>
+class CCheckShardMap
+{
+public:
+    typedef std::map<K, V> CShard;
+    enum
+    {
+        SHARD_COUNT = 16
+    };
+
+    CCheckShardMap()
+      : vShard(SHARD_COUNT) {}
+
+    static std::size_t GetShardIndex(const uint256& hash)
+    {
+        return hash.Get32(0) % SHARD_COUNT;
+    }
+    CShard& GetShard(std::size_t nShard)
+    {
+        return vShard[nShard];
+    }
+    const CShard& GetShard(std::size_t nShard) const
+    {
+        return vShard[nShard];
+    }
+    CShard& GetShard(const uint256& hash)
+    {
+        return vShard[GetShardIndex(hash)];
+    }
+    const CShard& GetShard(const uint256& hash) const
+    {
+        return vShard[GetShardIndex(hash)];
+    }
+    std::size_t Size() const
+    {
+        std::size_t nSize = 0;
+        for (const CShard& shard : vShard)
+        {
+            nSize += shard.size();
+        }
+        return nSize;
+    }
+
+protected:
+    std::vector<CShard> vShard;
+};
+
+typedef CCheckShardMap<CTxOutPoint, CCheckTxOut> CCheckUnspentMap;
+typedef CCheckShardMap<uint256, CCheckBlockTx> CCheckBlockTxMap;
+
+/////////////////////////////////////////////////////////////////////////
+// CCheckProgress
+
+class CCheckProgress
+{
+public:
+    CCheckProgress(const std::string& strNameIn, int64 nTotalIn = 0);
+
+    void Update(int64 nAdd);
+    void Finish();
+
+protected:
+    void Report(int64 nTime);
+
+protected:
+    enum
+    {
+        REPORT_INTERVAL = 10
+    };
+    std::string strName;
+    int64 nTotal;
+    int64 nCount;
+    int64 nStartTime;
+    int64 nReportTime;
+};
+
+/////////////////////////////////////////////////////////////////////////
+// CCheckForkUnspentWalker
+
 class CCheckForkUnspentWalker : public CForkUnspentDBWalker
 {
 public:
     CCheckForkUnspentWalker() {}
 
     bool Walk(const CTxOutPoint& txout, const CTxOut& output) override;
-    bool CheckForkUnspent(map<CTxOutPoint, CCheckTxOut>& mapBlockForkUnspent);
+    bool CheckForkUnspent(const CCheckUnspentMap& mapBlockForkUnspent);
 
 public:
-    map<CTxOutPoint, CCheckTxOut> mapForkUnspent;
+    CCheckUnspentMap mapForkUnspent;
 
     vector<CTxUnspent> vAddUpdate;
     vector<CTxOutPoint> vRemove;
@@ -300,24 +389,31 @@ public:
 
 /////////////////////////////////////////////////////////////////////////
 // CCheckDbTxPool
+/* The pool unspents are kept on top of the block unspents of the fork:
+   outputs added by the pool txs and the block outputs the pool spends. */
 class CCheckForkTxPool
 {
 public:
-    CCheckForkTxPool() {}
+    CCheckForkTxPool()
+      : pBlockUnspent(nullptr) {}
 
     bool AddTx(const uint256& txid, const CAssembledTx& tx);
     bool CheckTxExist(const uint256& txid);
     bool CheckTxPoolUnspent(const CTxOutPoint& point, const CCheckTxOut& out);
     bool GetWalletTx(const uint256& hashFork, const set<CDestination>& setAddress, vector<CWalletTx>& vWalletTx);
+    bool WalkThroughUnspent(const boost::function<bool(const CTxOutPoint&, const CCheckTxOut&)>& fnWalk);
 
 protected:
     bool Spent(const CTxOutPoint& point, const uint256& txidSpent, const CDestination& sendTo);
     bool Unspent(const CTxOutPoint& point, const CTxOut& out);
+    const CCheckTxOut* GetBlockUnspent(const CTxOutPoint& point);
 
 public:
     uint256 hashFork;
     vector<pair<uint256, CAssembledTx>> vTx;
     map<uint256, CAssembledTx> mapTxPoolTx;
+    const CCheckUnspentMap* pBlockUnspent;
+    set<CTxOutPoint> setBlockSpent;
     map<CTxOutPoint, CCheckTxOut> mapTxPoolUnspent;
 };
 
@@ -326,7 +422,7 @@ class CCheckTxPoolData
 public:
     CCheckTxPoolData() {}
 
-    void AddForkUnspent(const uint256& hashFork, const map<CTxOutPoint, CCheckTxOut>& mapUnspent);
+    void AddForkUnspent(const uint256& hashFork, const CCheckUnspentMap& mapUnspent);
     bool FetchTxPool(const string& strPath);
     bool CheckTxExist(const uint256& hashFork, const uint256& txid);
     bool CheckTxPoolUnspent(const uint256& hashFork, const CTxOutPoint& point, const CCheckTxOut& out);
@@ -346,7 +442,8 @@ public:
       : pOrigin(nullptr), pLast(nullptr) {}
 
     void UpdateMaxTrust(CBlockIndex* pBlockIndex);
-    bool AddBlockTx(const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn);
+    // only the tx, the spents and the unspents that fall into nShard are added
+    bool AddBlockTx(std::size_t nShard, const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn);
     bool AddBlockSpent(const CTxOutPoint& txPoint, const uint256& txidSpent, const CDestination& sendTo);
     bool AddBlockUnspent(const CTxOutPoint& txPoint, const CTxOut& txOut);
     bool CheckTxExist(const uint256& txid, int& nHeight);
@@ -354,8 +451,22 @@ public:
 public:
     CBlockIndex* pOrigin;
     CBlockIndex* pLast;
-    map<uint256, CCheckBlockTx> mapBlockTx;
-    map<CTxOutPoint, CCheckTxOut> mapBlockUnspent;
+    CCheckBlockTxMap mapBlockTx;
+    CCheckUnspentMap mapBlockUnspent;
+};
+
+/////////////////////////////////////////////////////////////////////////
+// CCheckStreamBlock
+
+class CCheckStreamBlock
+{
+public:
+    CCheckStreamBlock()
+      : pIndex(nullptr) {}
+
+public:
+    CBlockIndex* pIndex;
+    CBlockEx block;
 };
 
 /////////////////////////////////////////////////////////////////////////
@@ -365,7 +476,7 @@ class CCheckBlockWalker : public CTSWalker<CBlockEx>
 public:
     CCheckBlockWalker(bool fTestnetIn, bool fOnlyCheckIn)
       : nBlockCount(0), nMainChainHeight(0), nMainChainTxCount(0), objProofParam(fTestnetIn),
-        fOnlyCheck(fOnlyCheckIn), dbTemplateData(false), dbPledge(false), dbRedeem(false) {}
+        fOnlyCheck(fOnlyCheckIn), objWalkProgress("Fetch block"), dbTemplateData(false), dbPledge(false), dbRedeem(false) {}
     ~CCheckBlockWalker();
 
     bool Initialize(const string& strPath);
@@ -374,7 +485,9 @@ public:
 
     bool UpdateBlockNext();
     bool UpdateBlockTx(CCheckForkManager& objForkMn);
-    bool AddBlockTx(const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn, const vector<uint256>& vFork);
+    bool AddBlockTx(std::size_t nShard, const CTransaction& txIn, const CTxContxt& contxtIn, int nHeight, const uint256& hashAtForkIn, uint32 nFileNoIn, uint32 nOffsetIn, const vector<uint256>& vFork);
+    bool StreamBlock(const vector<CBlockIndex*>& vIndex, const string& strName, const boost::function<bool(const vector<CCheckStreamBlock>&)>& fnBatch);
+    bool ReadTx(const CTxIndex& txIndex, CTransaction& tx);
     CBlockIndex* AddNewIndex(const uint256& hash, const CBlock& block, uint32 nFile, uint32 nOffset, const uint256& nChainTrust);
     CBlockIndex* AddNewIndex(const uint256& hash, const CBlockOutline& objBlockOutline);
     void ClearBlockIndex();
@@ -403,7 +516,6 @@ public:
     uint256 hashGenesis;
     CProofOfWorkParam objProofParam;
     map<uint256, CCheckBlockFork> mapCheckFork;
-    map<uint256, CBlockEx> mapBlock;
     map<uint256, CBlockIndex*> mapBlockIndex;
     map<CDestination, pair<vector<uint8>, int>> mapTemplateData;
     map<uint256, CPledgeContext> mapBlockPledge;
@@ -412,10 +524,18 @@ public:
     CBlockIndexDB dbBlockIndex;
     CCheckBlockIndexWalker objBlockIndexWalker;
     CCheckTsBlock objTsBlock;
+    CCheckProgress objWalkProgress;
     CTemplateDataDB dbTemplateData;
     CPledgeDB dbPledge;
     CRedeemDB dbRedeem;
     CCoreProtocol objCore;
+
+protected:
+    enum
+    {
+        STREAM_BATCH_SIZE = 256,
+        STREAM_QUEUE_SIZE = 8
+    };
 };
 
 /////////////////////////////////////////////////////////////////////////
@@ -281,7 +281,12 @@ Errno CCoreProtocol::VerifyProofOfWork(const CBlock& block, const CBlockIndex* p
     {
         return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "algo or bits error, nAlgo: %d, nBits: %d, vchProof size: %ld.", nAlgo, block.nBits, block.vchProof.size());
     }
+    return VerifyProofOfHashWork(block);
+}
 
+Errno CCoreProtocol::VerifyProofOfHashWork(const CBlock& block)
+{
+    uint32 nBits = block.nBits;
     bool fNegative;
     bool fOverflow;
     uint256 hashTarget;
@@ -302,7 +307,7 @@ Errno CCoreProtocol::VerifyProofOfWork(const CBlock& block, const CBlockIndex* p
     {
         return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "%d{btc time} != %d{mam time}.", proof.btcTime, block.nTimeStamp);
     }
-    xengine::CBufStream ss;
+    xengine::CSpanStream ss;
     ss << block.nVersion << block.nType << block.hashPrev << block.hashMerkle << nBits;
     uint256 pow_hash = minemon::crypto::CryptoSHA256(ss.GetData(), ss.GetSize());
 
@@ -321,7 +326,7 @@ Errno CCoreProtocol::VerifyProofOfWork(const CBlock& block, const CBlockIndex* p
         return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "proof txid data error: proof[%s] .", xengine::ToHexString(block.vchProof));
     }
 
-    xengine::CBufStream btc_ss;
+    xengine::CSpanStream btc_ss;
     btc_ss << proof.btcVersion << proof.btcHashPrevBlock << proof.btcHashMerkleRoot << proof.btcTime << proof.btcBits << proof.btcNonce;
 
     uint256 hash = minemon::crypto::CryptoSHA256D(btc_ss.GetData(), btc_ss.GetSize());
@@ -332,7 +337,7 @@ Errno CCoreProtocol::VerifyProofOfWork(const CBlock& block, const CBlockIndex* p
     return OK;
 }
 
-Errno CCoreProtocol::VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nForkHeight, const uint256& fork)
+Errno CCoreProtocol::VerifyBlockTxContext(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nForkHeight, const uint256& fork)
 {
     if (tx.IsMintTx())
     {
@@ -419,6 +424,13 @@ Errno CCoreProtocol::VerifyBlockTx(const CTransaction& tx, const CTxContxt& txCo
     }
     }
 
+    return OK;
+}
+
+Errno CCoreProtocol::VerifyBlockTxSignature(const CTransaction& tx, const CTxContxt& txContxt, int nForkHeight, const uint256& fork)
+{
+    const CDestination& destIn = txContxt.destIn;
+
     vector<uint8> vchSig;
     if (!CTemplate::VerifyDestRecorded(tx, vchSig))
     {
@@ -441,6 +453,17 @@ Errno CCoreProtocol::VerifyBlockTx(const CTransaction& tx, const CTxContxt& txCo
 
 Errno CCoreProtocol::VerifyTransaction(const CTransaction& tx, const vector<CTxOut>& vPrevOutput,
                                        int nForkHeight, const uint256& hashLastBlock, const uint256& fork)
+{
+    Errno err = VerifyTransactionContext(tx, vPrevOutput, nForkHeight, hashLastBlock, fork);
+    if (err != OK)
+    {
+        return err;
+    }
+    return VerifyTransactionSignature(tx, vPrevOutput[0].destTo, nForkHeight, fork);
+}
+
+Errno CCoreProtocol::VerifyTransactionContext(const CTransaction& tx, const vector<CTxOut>& vPrevOutput,
+                                              int nForkHeight, const uint256& hashLastBlock, const uint256& fork)
 {
     CDestination destIn = vPrevOutput[0].destTo;
     int64 nValueIn = 0;
@@ -537,6 +560,11 @@ Errno CCoreProtocol::VerifyTransaction(const CTransaction& tx, const vector<CTxO
     }
     }
 
+    return OK;
+}
+
+Errno CCoreProtocol::VerifyTransactionSignature(const CTransaction& tx, const CDestination& destIn, int nForkHeight, const uint256& fork)
+{
     // record destIn in vchSig
     vector<uint8> vchSig;
     if (!CTemplate::VerifyDestRecorded(tx, vchSig))
@@ -21,10 +21,14 @@ public:
     virtual Errno ValidateBlock(const CBlock& block) override;
     virtual Errno ValidateOrigin(const CBlock& block, const CProfile& parentProfile, CProfile& forkProfile) override;
 
-    virtual Errno VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nForkHeight, const uint256& fork) override;
+    virtual Errno VerifyBlockTxContext(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nForkHeight, const uint256& fork) override;
+    virtual Errno VerifyBlockTxSignature(const CTransaction& tx, const CTxContxt& txContxt, int nForkHeight, const uint256& fork) override;
     virtual Errno VerifyTransaction(const CTransaction& tx, const std::vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& hashLastBlock, const uint256& fork) override;
+    virtual Errno VerifyTransactionContext(const CTransaction& tx, const std::vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& hashLastBlock, const uint256& fork) override;
+    virtual Errno VerifyTransactionSignature(const CTransaction& tx, const CDestination& destIn, int nForkHeight, const uint256& fork) override;
 
     virtual Errno VerifyProofOfWork(const CBlock& block, const CBlockIndex* pIndexPrev) override;
+    virtual Errno VerifyProofOfHashWork(const CBlock& block) override;
     virtual bool GetBlockTrust(const CBlock& block, uint256& nChainTrust) override;
     virtual bool GetProofOfWorkTarget(const CBlockIndex* pIndexPrev, int nAlgo, uint32_t& nBits) override;
     virtual int64 GetMintWorkReward(const int nHeight) override;
@@ -256,6 +256,47 @@ Errno CDispatcher::AddNewTx(const CTransaction& tx, uint64 nNonce)
     return OK;
 }
 
+void CDispatcher::AddNewTx(const vector<CTransaction>& vtx, vector<Errno>& vErr, bool fPeerTx)
+{
+    uint256 hashFork;
+    vector<CDestination> vDestIn;
+    vector<int64> vValueIn;
+    pTxPool->Push(vtx, hashFork, vErr, vDestIn, vValueIn);
+
+    bool fAddNew = false;
+    for (size_t i = 0; i < vtx.size(); i++)
+    {
+        const CTransaction& tx = vtx[i];
+        if (vErr[i] != OK)
+        {
+            StdError("CDispatcher", "AddNewTx: TxPool Push fail, txid: %s", tx.GetHash().GetHex().c_str());
+            continue;
+        }
+
+        pDataStat->AddP2pSynTxSynStatData(hashFork, fPeerTx);
+
+        CAssembledTx assembledTx(tx, -1, vDestIn[i], vValueIn[i]);
+        if (!pWallet->AddNewTx(hashFork, assembledTx))
+        {
+            StdError("CDispatcher", "AddNewTx: Wallet AddNewTx fail, txid: %s", tx.GetHash().GetHex().c_str());
+            vErr[i] = ERR_SYS_DATABASE_ERROR;
+            continue;
+        }
+
+        CTransactionUpdate updateTransaction;
+        updateTransaction.hashFork = hashFork;
+        updateTransaction.txUpdate = tx;
+        updateTransaction.nChange = assembledTx.GetChange();
+        pService->NotifyTransactionUpdate(updateTransaction);
+        fAddNew = true;
+    }
+
+    if (fAddNew && !fPeerTx)
+    {
+        pNetChannel->BroadcastTxInv(hashFork);
+    }
+}
+
 void CDispatcher::ActivateFork(const uint256& hashFork, const uint64& nNonce)
 {
     Log("Activating fork %s ...", hashFork.GetHex().c_str());
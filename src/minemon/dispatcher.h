@@ -18,6 +18,7 @@ public:
     ~CDispatcher();
     Errno AddNewBlock(const CBlock& block, uint64 nNonce = 0) override;
     Errno AddNewTx(const CTransaction& tx, uint64 nNonce = 0) override;
+    void AddNewTx(const std::vector<CTransaction>& vtx, std::vector<Errno>& vErr, bool fPeerTx = false) override;
 
 protected:
     bool HandleInitialize() override;
@@ -689,6 +689,23 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetData& eventGetData)
                 eventGetFail.data.push_back(inv);
             }
         }
+        else if (inv.nType == network::CInv::MSG_CMPCTBLOCK)
+        {
+            CBlock block;
+            if (pBlockChain->GetBlock(inv.nHash, block))
+            {
+                network::CEventPeerCompactBlock eventCompactBlock(nNonce, hashFork);
+                eventCompactBlock.data = CCompactBlock(block, crypto::CryptoGetRand64());
+                pPeerNet->DispatchEvent(&eventCompactBlock);
+                StdTrace("NetChannel", "CEventPeerGetData: get compact block success, peer: %s, height: %d, block: %s",
+                         GetPeerAddressInfo(nNonce).c_str(), CBlock::GetBlockHeightByHash(inv.nHash), inv.nHash.GetHex().c_str());
+            }
+            else
+            {
+                StdError("NetChannel", "CEventPeerGetData: Get compact block fail, block hash: %s", inv.nHash.GetHex().c_str());
+                eventGetFail.data.push_back(inv);
+            }
+        }
         else
         {
             StdError("NetChannel", "CEventPeerGetData: inv.nType error, nType: %s, nHash: %s", inv.nType, inv.nHash.GetHex().c_str());
@@ -749,7 +766,7 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetBlocks& eventGetBlocks)
         }
         pPeerNet->DispatchEvent(&eventMsgRsp);
     }
-    else
+    else if (!IsHeadersPeer(nNonce) || !DispatchHeadersEvent(nNonce, hashFork, vBlockHash))
     {
         network::CEventPeerInv eventInv(nNonce, hashFork);
         for (const uint256& hash : vBlockHash)
@@ -761,6 +778,73 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetBlocks& eventGetBlocks)
     return true;
 }
 
+bool CNetChannel::HandleEvent(network::CEventPeerHeaders& eventHeaders)
+{
+    uint64 nNonce = eventHeaders.nNonce;
+    uint256& hashFork = eventHeaders.hashFork;
+    vector<CBlock>& vHeader = eventHeaders.data;
+    try
+    {
+        if (vHeader.empty() || vHeader.size() > MAX_GETBLOCKS_COUNT)
+        {
+            throw runtime_error(string("Headers count error, size: ") + to_string(vHeader.size()));
+        }
+
+        // header chain is checked before any body is asked for, bodies of a
+        // broken, unanchored or unworked chain are never downloaded
+        const uint256& hashFirstPrev = vHeader[0].hashPrev;
+        bool fKnownPrev = pBlockChain->Exists(hashFirstPrev);
+        if (!fKnownPrev)
+        {
+            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+            if (!GetSchedule(hashFork).Exists(network::CInv(network::CInv::MSG_BLOCK, hashFirstPrev)))
+            {
+                throw runtime_error(string("Headers not anchored, prev block: ") + hashFirstPrev.GetHex());
+            }
+        }
+
+        network::CEventPeerInv eventInv(nNonce, hashFork);
+        for (size_t i = 0; i < vHeader.size(); i++)
+        {
+            const CBlock& header = vHeader[i];
+            uint256 hash = header.GetHash();
+            if (i > 0 && header.hashPrev != eventInv.data.back().nHash)
+            {
+                throw runtime_error(string("Headers not continuous, block: ") + hash.GetHex());
+            }
+            if (header.IsProofOfWork())
+            {
+                // the target is only known when the parent is in the chain
+                uint32_t nBits = 0;
+                if (i == 0 && fKnownPrev
+                    && (!pBlockChain->GetProofOfWorkTarget(header.hashPrev, CM_SHA256D, nBits) || nBits != header.nBits))
+                {
+                    throw runtime_error(string("Header target error, block: ") + hash.GetHex());
+                }
+                if (pCoreProtocol->VerifyProofOfHashWork(header) != OK)
+                {
+                    throw runtime_error(string("Header proof of work error, block: ") + hash.GetHex());
+                }
+            }
+            if (Config()->nMagicNum == MAINNET_MAGICNUM && header.IsPrimary()
+                && !pBlockChain->VerifyCheckPoint((int)header.GetBlockHeight(), hash))
+            {
+                throw runtime_error(string("Header does not match checkpoint hash, block: ") + hash.GetHex());
+            }
+            eventInv.data.push_back(network::CInv(network::CInv::MSG_BLOCK, hash));
+        }
+
+        StdTrace("NetChannel", "CEventPeerHeaders: peer: %s, recv headers: %ld, last block: %s",
+                 GetPeerAddressInfo(nNonce).c_str(), vHeader.size(), eventInv.data.back().nHash.GetHex().c_str());
+        return HandleEvent(eventInv);
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventHeaders: ") + e.what());
+    }
+    return true;
+}
+
 bool CNetChannel::HandleEvent(network::CEventPeerTx& eventTx)
 {
     uint64 nNonce = eventTx.nNonce;
@@ -907,7 +991,14 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetFail& eventGetFail)
         {
             StdTrace("NetChannel", "CEventPeerGetFail: get data fail, peer: %s, inv: [%d] %s",
                      GetPeerAddressInfo(nNonce).c_str(), inv.nType, inv.nHash.GetHex().c_str());
-            sched.CancelAssignedInv(nNonce, inv);
+            if (inv.nType == network::CInv::MSG_CMPCTBLOCK)
+            {
+                sched.CancelAssignedInv(nNonce, network::CInv(network::CInv::MSG_BLOCK, inv.nHash));
+            }
+            else
+            {
+                sched.CancelAssignedInv(nNonce, inv);
+            }
         }
     }
     catch (exception& e)
@@ -1014,6 +1105,117 @@ bool CNetChannel::HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp)
     return true;
 }
 
+bool CNetChannel::HandleEvent(network::CEventPeerCompactBlock& eventCompactBlock)
+{
+    uint64 nNonce = eventCompactBlock.nNonce;
+    uint256& hashFork = eventCompactBlock.hashFork;
+    CCompactBlock& compact = eventCompactBlock.data;
+    uint256 hash = compact.GetHash();
+    try
+    {
+        {
+            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+            CSchedule& sched = GetSchedule(hashFork);
+            if (!sched.IsAssignedInv(nNonce, network::CInv(network::CInv::MSG_BLOCK, hash)))
+            {
+                StdLog("NetChannel", "CEventPeerCompactBlock: block not requested, block: %s", hash.GetHex().c_str());
+                return true;
+            }
+        }
+
+        vector<CTransaction> vtx;
+        vector<uint32> vMissing;
+        pTxPool->FillCompactBlock(hashFork, compact, vtx, vMissing);
+        if (vMissing.empty())
+        {
+            return ReconstructBlock(nNonce, hashFork, compact, vtx);
+        }
+
+        {
+            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+            CSchedule& sched = GetSchedule(hashFork);
+            if (!sched.AddPartialBlock(nNonce, compact, vtx, vMissing))
+            {
+                StdLog("NetChannel", "CEventPeerCompactBlock: AddPartialBlock fail, block: %s", hash.GetHex().c_str());
+                return true;
+            }
+        }
+        StdTrace("NetChannel", "CEventPeerCompactBlock: get missing txs, peer: %s, missing: %lu/%lu, block: %s",
+                 GetPeerAddressInfo(nNonce).c_str(), vMissing.size(), vtx.size(), hash.GetHex().c_str());
+
+        network::CEventPeerGetBlockTxn eventGetBlockTxn(nNonce, hashFork);
+        eventGetBlockTxn.data.hashBlock = hash;
+        eventGetBlockTxn.data.vIndex.swap(vMissing);
+        pPeerNet->DispatchEvent(&eventGetBlockTxn);
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventCompactBlock: ") + e.what());
+    }
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerGetBlockTxn& eventGetBlockTxn)
+{
+    uint64 nNonce = eventGetBlockTxn.nNonce;
+    uint256& hashFork = eventGetBlockTxn.hashFork;
+    const uint256& hashBlock = eventGetBlockTxn.data.hashBlock;
+
+    network::CEventPeerBlockTxn eventBlockTxn(nNonce, hashFork);
+    eventBlockTxn.data.hashBlock = hashBlock;
+    CBlock block;
+    if (pBlockChain->GetBlock(hashBlock, block))
+    {
+        for (const uint32 nIndex : eventGetBlockTxn.data.vIndex)
+        {
+            if (nIndex >= block.vtx.size())
+            {
+                StdError("NetChannel", "CEventPeerGetBlockTxn: tx index error, peer: %s, index: %u, block: %s",
+                         GetPeerAddressInfo(nNonce).c_str(), nIndex, hashBlock.GetHex().c_str());
+                eventBlockTxn.data.vtx.clear();
+                break;
+            }
+            eventBlockTxn.data.vtx.push_back(block.vtx[nIndex]);
+        }
+    }
+    if (eventBlockTxn.data.vtx.empty())
+    {
+        network::CEventPeerGetFail eventGetFail(nNonce, hashFork);
+        eventGetFail.data.push_back(network::CInv(network::CInv::MSG_CMPCTBLOCK, hashBlock));
+        pPeerNet->DispatchEvent(&eventGetFail);
+        return true;
+    }
+    pPeerNet->DispatchEvent(&eventBlockTxn);
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerBlockTxn& eventBlockTxn)
+{
+    uint64 nNonce = eventBlockTxn.nNonce;
+    uint256& hashFork = eventBlockTxn.hashFork;
+    try
+    {
+        CCompactBlock compact;
+        vector<CTransaction> vtx;
+        {
+            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+            CSchedule& sched = GetSchedule(hashFork);
+            if (!sched.FillPartialBlock(nNonce, eventBlockTxn.data.hashBlock, eventBlockTxn.data.vtx, compact, vtx))
+            {
+                StdLog("NetChannel", "CEventPeerBlockTxn: FillPartialBlock fail, block: %s",
+                       eventBlockTxn.data.hashBlock.GetHex().c_str());
+                return true;
+            }
+        }
+        return ReconstructBlock(nNonce, hashFork, compact, vtx);
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventBlockTxn: ") + e.what());
+    }
+    return true;
+}
+
 CSchedule& CNetChannel::GetSchedule(const uint256& hashFork)
 {
     map<uint256, CSchedule>::iterator it = mapSched.find(hashFork);
@@ -1103,7 +1305,7 @@ void CNetChannel::SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSched
     network::CEventPeerGetData eventGetData(nNonce, hashFork);
     bool fMissingPrev = false;
     bool fEmpty = true;
-    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, 1, fMissingPrev, fEmpty))
+    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, CSchedule::MAX_PEER_BLOCK_WINDOW, fMissingPrev, fEmpty))
     {
         if (fMissingPrev)
         {
@@ -1155,6 +1357,7 @@ void CNetChannel::SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSched
     }
     if (!eventGetData.data.empty())
     {
+        SetCompactBlockInv(nNonce, hashFork, eventGetData.data);
         pPeerNet->DispatchEvent(&eventGetData);
 
         string strInv;
@@ -1372,28 +1575,52 @@ void CNetChannel::AddNewTx(const uint256& hashFork, const uint256& txid, CSchedu
 
     vtx.push_back(txid);
     int nAddNewTx = 0;
-    for (size_t i = 0; i < vtx.size(); i++)
-    {
-        uint256 hashTx = vtx[i];
-        uint64 nNonceSender = 0;
-        CTransaction* pTx = sched.GetTransaction(hashTx, nNonceSender);
-        if (pTx != nullptr)
-        {
-            if (!CheckPrevTx(*pTx, nNonceSender, hashFork, sched, setSchedPeer))
+    // the txs waiting on the same wave of parents are pushed as one batch
+    for (size_t nWave = 0; nWave < vtx.size();)
+    {
+        size_t nWaveEnd = vtx.size();
+        vector<uint256> vBatchTxid;
+        vector<uint64> vBatchNonce;
+        vector<CTransaction> vBatchTx;
+        for (size_t i = nWave; i < nWaveEnd; i++)
+        {
+            uint256 hashTx = vtx[i];
+            uint64 nNonceSender = 0;
+            CTransaction* pTx = sched.GetTransaction(hashTx, nNonceSender);
+            if (pTx != nullptr)
             {
-                continue;
-            }
+                if (!CheckPrevTx(*pTx, nNonceSender, hashFork, sched, setSchedPeer))
+                {
+                    continue;
+                }
 
-            if (pTxPool->Exists(hashTx) || pBlockChain->ExistsTx(hashTx))
-            {
-                StdDebug("NetChannel", "NetChannel AddNewTx: tx at blockchain or txpool exists, peer: %s, txid: %s",
-                         GetPeerAddressInfo(nNonceSender).c_str(), hashTx.GetHex().c_str());
-                sched.GetNextTx(hashTx, vtx, setTx);
-                sched.RemoveInv(network::CInv(network::CInv::MSG_TX, hashTx), setSchedPeer);
-                continue;
+                if (pTxPool->Exists(hashTx) || pBlockChain->ExistsTx(hashTx))
+                {
+                    StdDebug("NetChannel", "NetChannel AddNewTx: tx at blockchain or txpool exists, peer: %s, txid: %s",
+                             GetPeerAddressInfo(nNonceSender).c_str(), hashTx.GetHex().c_str());
+                    sched.GetNextTx(hashTx, vtx, setTx);
+                    sched.RemoveInv(network::CInv(network::CInv::MSG_TX, hashTx), setSchedPeer);
+                    continue;
+                }
+
+                vBatchTxid.push_back(hashTx);
+                vBatchNonce.push_back(nNonceSender);
+                vBatchTx.push_back(*pTx);
             }
+        }
+        nWave = nWaveEnd;
+        if (vBatchTx.empty())
+        {
+            continue;
+        }
 
-            Errno err = pDispatcher->AddNewTx(*pTx, nNonceSender);
+        vector<Errno> vErr;
+        pDispatcher->AddNewTx(vBatchTx, vErr, true);
+        for (size_t i = 0; i < vBatchTx.size(); i++)
+        {
+            const uint256& hashTx = vBatchTxid[i];
+            uint64 nNonceSender = vBatchNonce[i];
+            Errno err = vErr[i];
             if (err == OK)
             {
                 StdDebug("NetChannel", "NetChannel AddNewTx success, peer: %s, txid: %s",
@@ -1592,6 +1819,75 @@ const string CNetChannel::GetPeerAddressInfo(uint64 nNonce)
     return string("0.0.0.0");
 }
 
+bool CNetChannel::IsCompactBlockPeer(uint64 nNonce)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
+    map<uint64, CNetChannelPeer>::iterator it = mapPeer.find(nNonce);
+    return (it != mapPeer.end() && ((*it).second.nService & network::NODE_COMPACT_BLOCK));
+}
+
+bool CNetChannel::IsHeadersPeer(uint64 nNonce)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
+    map<uint64, CNetChannelPeer>::iterator it = mapPeer.find(nNonce);
+    return (it != mapPeer.end() && ((*it).second.nService & network::NODE_HEADERS));
+}
+
+bool CNetChannel::DispatchHeadersEvent(uint64 nNonce, const uint256& hashFork, const vector<uint256>& vBlockHash)
+{
+    network::CEventPeerHeaders eventHeaders(nNonce, hashFork);
+    eventHeaders.data.resize(vBlockHash.size());
+    for (size_t i = 0; i < vBlockHash.size(); i++)
+    {
+        CBlock& header = eventHeaders.data[i];
+        if (!pBlockChain->GetBlock(vBlockHash[i], header))
+        {
+            StdLog("NetChannel", "DispatchHeadersEvent: GetBlock fail, block: %s", vBlockHash[i].GetHex().c_str());
+            return false;
+        }
+        header.vtx.clear();
+    }
+    pPeerNet->DispatchEvent(&eventHeaders);
+    return true;
+}
+
+void CNetChannel::SetCompactBlockInv(uint64 nNonce, const uint256& hashFork, vector<network::CInv>& vInv)
+{
+    // only a new block is likely made of txs in the pool, blocks behind the tip go in full
+    uint256 hashLastBlock;
+    int nLastHeight = 0;
+    int64 nLastTime = 0;
+    uint16 nMintType = 0;
+    if (!IsCompactBlockPeer(nNonce) || !pBlockChain->GetLastBlock(hashFork, hashLastBlock, nLastHeight, nLastTime, nMintType))
+    {
+        return;
+    }
+    for (network::CInv& inv : vInv)
+    {
+        if (inv.nType == network::CInv::MSG_BLOCK && (int)CBlock::GetBlockHeightByHash(inv.nHash) >= nLastHeight)
+        {
+            inv.nType = network::CInv::MSG_CMPCTBLOCK;
+        }
+    }
+}
+
+bool CNetChannel::ReconstructBlock(uint64 nNonce, const uint256& hashFork, const CCompactBlock& compact,
+                                   const vector<CTransaction>& vtx)
+{
+    network::CEventPeerBlock eventBlock(nNonce, hashFork);
+    if (!compact.Reconstruct(vtx, eventBlock.data))
+    {
+        // short id collision or a bad peer, fall back to the full block
+        StdLog("NetChannel", "ReconstructBlock: merkle root mismatch, get full block, peer: %s, block: %s",
+               GetPeerAddressInfo(nNonce).c_str(), compact.GetHash().GetHex().c_str());
+        network::CEventPeerGetData eventGetData(nNonce, hashFork);
+        eventGetData.data.push_back(network::CInv(network::CInv::MSG_BLOCK, compact.GetHash()));
+        pPeerNet->DispatchEvent(&eventGetData);
+        return true;
+    }
+    return HandleEvent(eventBlock);
+}
+
 bool CNetChannel::CheckPrevBlock(const uint256& hash, CSchedule& sched, uint256& hashFirst, uint256& hashPrev)
 {
     uint256 hashBlock = hash;
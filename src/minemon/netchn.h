@@ -295,6 +295,10 @@ protected:
     bool HandleEvent(network::CEventPeerBlock& eventBlock) override;
     bool HandleEvent(network::CEventPeerGetFail& eventGetFail) override;
     bool HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp) override;
+    bool HandleEvent(network::CEventPeerCompactBlock& eventCompactBlock) override;
+    bool HandleEvent(network::CEventPeerGetBlockTxn& eventGetBlockTxn) override;
+    bool HandleEvent(network::CEventPeerBlockTxn& eventBlockTxn) override;
+    bool HandleEvent(network::CEventPeerHeaders& eventHeaders) override;
 
     CSchedule& GetSchedule(const uint256& hashFork);
     void NotifyPeerUpdate(uint64 nNonce, bool fActive, const network::CAddress& addrPeer);
@@ -314,6 +318,12 @@ protected:
     bool PushTxInv(const uint256& hashFork);
     const string GetPeerAddressInfo(uint64 nNonce);
     bool CheckPrevBlock(const uint256& hash, CSchedule& sched, uint256& hashFirst, uint256& hashPrev);
+    bool IsCompactBlockPeer(uint64 nNonce);
+    bool IsHeadersPeer(uint64 nNonce);
+    bool DispatchHeadersEvent(uint64 nNonce, const uint256& hashFork, const std::vector<uint256>& vBlockHash);
+    void SetCompactBlockInv(uint64 nNonce, const uint256& hashFork, std::vector<network::CInv>& vInv);
+    bool ReconstructBlock(uint64 nNonce, const uint256& hashFork, const CCompactBlock& compact,
+                          const std::vector<CTransaction>& vtx);
 
     const CBasicConfig* Config()
     {
@@ -7,12 +7,13 @@
 #include "json/json_spirit_reader_template.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/regex.hpp>
 #include <regex>
-//#include <algorithm>
+#include <algorithm>
 
 #include "address.h"
 #include "rpc/auto_protocol.h"
@@ -34,6 +35,16 @@ const char* GetGitVersion();
 ///////////////////////////////
 // static function
 
+static string MaskRPCLog(const string& data)
+{
+    //remove all sensible information such as private key
+    // or passphrass from log content
+
+    //log for debug mode
+    static const boost::regex ptnSec(R"raw(("privkey"|"passphrase"|"oldpassphrase")(\s*:\s*)(".*?"))raw", boost::regex::perl);
+    return boost::regex_replace(data, ptnSec, string(R"raw($1$2"***")raw"));
+}
+
 static int64 AmountFromValue(const double dAmount)
 {
     if (IsDoubleEqual(dAmount, -1.0))
@@ -151,7 +162,7 @@ namespace minemon
 // CRPCMod
 
 CRPCMod::CRPCMod()
-  : IIOModule("rpcmod")
+  : IIOModule("rpcmod"), poolRPC("rpcexec")
 {
     pHttpServer = nullptr;
     pCoreProtocol = nullptr;
@@ -248,6 +259,8 @@ CRPCMod::CRPCMod()
         ("signrawtransactionwithwallet", &CRPCMod::RPCSignRawTransactionWithWallet)
         //
         ("sendrawtransaction", &CRPCMod::RPCSendRawTransaction)
+        //
+        ("sendrawtransactions", &CRPCMod::RPCSendRawTransactions)
         /* Util */
         ("verifymessage", &CRPCMod::RPCVerifyMessage)
         //
@@ -279,6 +292,20 @@ CRPCMod::CRPCMod()
         //
         ("getaddresspledge", &CRPCMod::RPCGetAddressPledge);
     mapRPCFunc = temp_map;
+
+    setSerialRPC = boost::assign::list_of
+        /* System */
+        ("stop")
+        /* Network */
+        ("addnode")("removenode")
+        /* Blockchain & TxPool */
+        ("sendtransaction")
+        /* Wallet */
+        ("getnewkey")("encryptkey")("lockkey")("unlockkey")("importprivkey")("importpubkey")("importkey")
+        ("addnewtemplate")("importtemplate")("resyncwallet")("sendfrom")("createtransaction")("signtransaction")
+        ("importwallet")("exportwallet")("signrawtransactionwithwallet")("sendrawtransaction")("sendrawtransactions")
+        /* Mint */
+        ("getwork")("submitwork");
     fWriteRPCLog = true;
 }
 
@@ -330,25 +357,42 @@ void CRPCMod::HandleDeinitialize()
     pForkManager = nullptr;
 }
 
-bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
+bool CRPCMod::HandleInvoke()
 {
-    auto lmdMask = [](const string& data) -> string
+    int nRPCThreads = RPCServerConfig()->nRPCThreads;
+    if (nRPCThreads <= 0)
     {
-        //remove all sensible information such as private key
-        // or passphrass from log content
+        nRPCThreads = boost::thread::hardware_concurrency();
+    }
+    if (!poolRPC.Start(max(nRPCThreads, 1)))
+    {
+        Error("Failed to start rpc pool");
+        return false;
+    }
+    return IIOModule::HandleInvoke();
+}
 
-        //log for debug mode
-        boost::regex ptnSec(R"raw(("privkey"|"passphrase"|"oldpassphrase")(\s*:\s*)(".*?"))raw", boost::regex::perl);
-        return boost::regex_replace(data, ptnSec, string(R"raw($1$2"***")raw"));
-    };
+void CRPCMod::HandleHalt()
+{
+    IIOModule::HandleHalt();
+    poolRPC.Stop();
+}
 
-    uint64 nNonce = eventHttpReq.nNonce;
+bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
+{
+    // the event thread only hands the request over, a slow method must not hold up the others
+    poolRPC.Post(boost::bind(&CRPCMod::ExecuteRequest, this, eventHttpReq.nNonce,
+                             eventHttpReq.data.mapHeader["url"], eventHttpReq.data.strContent));
+    return true;
+}
 
+void CRPCMod::ExecuteRequest(uint64 nNonce, const string& strURL, const string& strContent)
+{
     string strResult;
     try
     {
         // check version
-        string strVersion = eventHttpReq.data.mapHeader["url"].substr(1);
+        string strVersion = strURL.substr(1);
         if (!strVersion.empty())
         {
             if (!CheckVersion(strVersion))
@@ -360,49 +404,38 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
         }
 
         bool fArray;
-        CRPCReqVec vecReq = DeserializeCRPCReq(eventHttpReq.data.strContent, fArray);
-        CRPCRespVec vecResp;
+        CRPCReqVec vecReq = DeserializeCRPCReq(strContent, fArray);
+        CRPCRespVec vecResp(vecReq.size());
+        // a batch is fanned out on the pool only if it has no state changing method,
+        // these rely on the order of the batch
+        bool fParallel = (vecReq.size() > 1);
         for (auto& spReq : vecReq)
         {
-            CRPCErrorPtr spError;
-            CRPCResultPtr spResult;
-            try
-            {
-                map<string, RPCFunc>::iterator it = mapRPCFunc.find(spReq->strMethod);
-                if (it == mapRPCFunc.end())
-                {
-                    throw CRPCException(RPC_METHOD_NOT_FOUND, "Method not found");
-                }
-
-                if (fWriteRPCLog)
-                {
-                    Debug("request : %s ", lmdMask(spReq->Serialize()).c_str());
-                }
-
-                spResult = (this->*(*it).second)(spReq->spParam);
-            }
-            catch (CRPCException& e)
-            {
-                spError = CRPCErrorPtr(new CRPCError(e));
-            }
-            catch (exception& e)
-            {
-                spError = CRPCErrorPtr(new CRPCError(RPC_MISC_ERROR, e.what()));
-            }
-
-            if (spError)
+            if (setSerialRPC.count(spReq->strMethod))
             {
-                vecResp.push_back(MakeCRPCRespPtr(spReq->valID, spError));
+                fParallel = false;
+                break;
             }
-            else if (spResult)
+        }
+        if (fParallel)
+        {
+            vector<CWorkerPool::WorkFunc> vWork;
+            vWork.reserve(vecReq.size());
+            for (size_t i = 0; i < vecReq.size(); i++)
             {
-                vecResp.push_back(MakeCRPCRespPtr(spReq->valID, spResult));
+                vWork.push_back([&, i]() { vecResp[i] = ExecuteMethod(vecReq[i]); });
             }
-            else
+            poolRPC.Execute(vWork);
+        }
+        else
+        {
+            for (size_t i = 0; i < vecReq.size(); i++)
             {
-                // no result means no return
+                vecResp[i] = ExecuteMethod(vecReq[i]);
             }
         }
+        // no result means no return
+        vecResp.erase(remove(vecResp.begin(), vecResp.end(), CRPCRespPtr()), vecResp.end());
 
         if (fArray)
         {
@@ -433,7 +466,7 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
 
     if (fWriteRPCLog)
     {
-        Debug("response : %s ", lmdMask(strResult).c_str());
+        Debug("response : %s ", MaskRPCLog(strResult).c_str());
     }
 
     // no result means no return
@@ -441,8 +474,54 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
     {
         JsonReply(nNonce, strResult);
     }
+}
 
-    return true;
+CRPCRespPtr CRPCMod::ExecuteMethod(CRPCReqPtr spReq)
+{
+    CRPCErrorPtr spError;
+    CRPCResultPtr spResult;
+    try
+    {
+        map<string, RPCFunc>::iterator it = mapRPCFunc.find(spReq->strMethod);
+        if (it == mapRPCFunc.end())
+        {
+            throw CRPCException(RPC_METHOD_NOT_FOUND, "Method not found");
+        }
+
+        if (fWriteRPCLog)
+        {
+            Debug("request : %s ", MaskRPCLog(spReq->Serialize()).c_str());
+        }
+
+        if (setSerialRPC.count(spReq->strMethod))
+        {
+            boost::unique_lock<boost::mutex> lock(mtxSerialRPC);
+            spResult = (this->*(*it).second)(spReq->spParam);
+        }
+        else
+        {
+            spResult = (this->*(*it).second)(spReq->spParam);
+        }
+    }
+    catch (CRPCException& e)
+    {
+        spError = CRPCErrorPtr(new CRPCError(e));
+    }
+    catch (exception& e)
+    {
+        spError = CRPCErrorPtr(new CRPCError(RPC_MISC_ERROR, e.what()));
+    }
+
+    if (spError)
+    {
+        return MakeCRPCRespPtr(spReq->valID, spError);
+    }
+    else if (spResult)
+    {
+        return MakeCRPCRespPtr(spReq->valID, spResult);
+    }
+    // no result means no return
+    return CRPCRespPtr();
 }
 
 bool CRPCMod::HandleEvent(CEventHttpBroken& eventHttpBroken)
@@ -1610,6 +1689,7 @@ CRPCResultPtr CRPCMod::RPCSendFrom(CRPCParamPtr param)
                 txNew.vchSig.clear();
                 CODataStream ds(txNew.vchSig);
                 ds << vsm << vss << hashFork << pService->GetForkHeight(hashFork);
+                txNew.ResetHash();
             }
             else
             {
@@ -2163,6 +2243,65 @@ CRPCResultPtr CRPCMod::RPCSendRawTransaction(rpc::CRPCParamPtr param)
     return MakeCSendRawTransactionResultPtr(rawTx.GetHash().GetHex());
 }
 
+CRPCResultPtr CRPCMod::RPCSendRawTransactions(rpc::CRPCParamPtr param)
+{
+    auto spParam = CastParamPtr<CSendRawTransactionsParam>(param);
+
+    // a tx that can not be decoded is rejected on its own item, the others still go through
+    vector<CSendRawTransactionsResult::CResult> vResult;
+    vector<CTransaction> vtx;
+    vector<size_t> vDecoded;
+    vResult.reserve(spParam->vecTxdata.size());
+    vtx.reserve(spParam->vecTxdata.size());
+    for (const string& strTxdata : spParam->vecTxdata)
+    {
+        CSendRawTransactionsResult::CResult result;
+        result.strTxid = string();
+        result.fAccepted = false;
+
+        vector<unsigned char> txData = ParseHexString(strTxdata);
+        if (txData.empty())
+        {
+            result.strError = string("Signed offline raw tx is empty");
+            vResult.push_back(result);
+            continue;
+        }
+        CBufStream ss;
+        ss.Write((char*)&txData[0], txData.size());
+        CTransaction rawTx;
+        try
+        {
+            ss >> rawTx;
+        }
+        catch (const std::exception& e)
+        {
+            result.strError = string("Signed offline raw tx decode failed");
+            vResult.push_back(result);
+            continue;
+        }
+        vDecoded.push_back(vResult.size());
+        vResult.push_back(result);
+        vtx.push_back(rawTx);
+    }
+
+    if (!vtx.empty())
+    {
+        vector<Errno> vErr;
+        pService->SendOfflineSignedTransactions(vtx, vErr);
+        for (size_t i = 0; i < vtx.size(); i++)
+        {
+            CSendRawTransactionsResult::CResult& result = vResult[vDecoded[i]];
+            result.strTxid = vtx[i].GetHash().GetHex();
+            result.fAccepted = (vErr[i] == OK);
+            result.strError = (vErr[i] == OK ? string() : string("Tx rejected : ") + ErrorString(vErr[i]));
+        }
+    }
+
+    auto spResult = MakeCSendRawTransactionsResultPtr();
+    spResult->vecResult = vResult;
+    return spResult;
+}
+
 /* Util */
 CRPCResultPtr CRPCMod::RPCVerifyMessage(CRPCParamPtr param)
 {
@@ -7,6 +7,7 @@
 
 #include "json/json_spirit.h"
 #include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "base.h"
 #include "rpc/rpc.h"
@@ -27,6 +28,8 @@ public:
 protected:
     bool HandleInitialize() override;
     void HandleDeinitialize() override;
+    bool HandleInvoke() override;
+    void HandleHalt() override;
     const CNetworkConfig* Config()
     {
         return dynamic_cast<const CNetworkConfig*>(xengine::IBase::Config());
@@ -36,6 +39,8 @@ protected:
         return dynamic_cast<const CRPCServerConfig*>(IBase::Config());
     }
 
+    void ExecuteRequest(uint64 nNonce, const std::string& strURL, const std::string& strContent);
+    rpc::CRPCRespPtr ExecuteMethod(rpc::CRPCReqPtr spReq);
     void JsonReply(uint64 nNonce, const std::string& result);
 
     int GetInt(const rpc::CRPCInt64& i, int valDefault)
@@ -118,6 +123,7 @@ private:
     rpc::CRPCResultPtr RPCImportWallet(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCSignRawTransactionWithWallet(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCSendRawTransaction(rpc::CRPCParamPtr param);
+    rpc::CRPCResultPtr RPCSendRawTransactions(rpc::CRPCParamPtr param);
     /* Util */
     rpc::CRPCResultPtr RPCVerifyMessage(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCMakeKeyPair(rpc::CRPCParamPtr param);
@@ -146,6 +152,11 @@ protected:
 
 private:
     std::map<std::string, RPCFunc> mapRPCFunc;
+    // methods changing wallet or node state never run concurrently with each other,
+    // the others only reach state behind its own reader lock
+    std::set<std::string> setSerialRPC;
+    boost::mutex mtxSerialRPC;
+    xengine::CWorkerPool poolRPC;
     bool fWriteRPCLog;
 };
 
@@ -138,6 +138,19 @@ void CSchedule::RemovePeer(uint64 nPeerNonce, set<uint64>& setSchedPeer)
         }
         mapPeer.erase(it);
     }
+
+    map<uint256, CPartialBlock>::iterator mt = mapPartialBlock.begin();
+    while (mt != mapPartialBlock.end())
+    {
+        if ((*mt).second.nPeerNonce == nPeerNonce)
+        {
+            mapPartialBlock.erase(mt++);
+        }
+        else
+        {
+            ++mt;
+        }
+    }
 }
 
 bool CSchedule::CheckAddInvIdleLocation(uint64 nPeerNonce, uint32 nInvType)
@@ -180,6 +193,10 @@ bool CSchedule::RemoveInv(const network::CInv& inv, set<uint64>& setKnownPeer)
             RemoveOrphan(inv);
         }
         setMissPrevTxInv.erase(inv);
+        if (inv.nType == network::CInv::MSG_BLOCK)
+        {
+            mapPartialBlock.erase(inv.nHash);
+        }
         setKnownPeer.insert((*it).second.setKnownPeer.begin(), (*it).second.setKnownPeer.end());
         mapState.erase(it);
         return true;
@@ -199,7 +216,9 @@ bool CSchedule::ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBloc
             state.nRecvObjTime = GetTime();
             state.nClearObjTime = GetTime() + MAX_OBJ_WAIT_TIME;
             setSchedPeer.insert(state.setKnownPeer.begin(), state.setKnownPeer.end());
-            mapPeer[nPeerNonce].Completed((*it).first);
+            CInvPeer& peer = mapPeer[nPeerNonce];
+            peer.Completed((*it).first);
+            peer.UpdateBlockWindow(GetTimeMillis() - state.nAssignedTime);
             return true;
         }
     }
@@ -331,9 +350,11 @@ bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv,
     {
         CInvPeer& peer = (*it).second;
         fEmpty = peer.Empty(network::CInv::MSG_BLOCK);
-        if (!peer.IsAssigned())
+        size_t nBlockAssigned = peer.GetAssigned(network::CInv::MSG_BLOCK).size();
+        if (peer.GetAssigned(network::CInv::MSG_TX).empty() && nBlockAssigned < peer.GetBlockWindow())
         {
             bool fReceivedAll;
+            nMaxCount = min(nMaxCount, peer.GetBlockWindow() - nBlockAssigned);
             if (!ScheduleKnownInv(nPeerNonce, peer, network::CInv::MSG_BLOCK, vInv, nMaxCount, fReceivedAll))
             {
                 if (fReceivedAll && peer.CheckNextGetBlocksTime() && CheckAddInvIdleLocation(nPeerNonce, network::CInv::MSG_BLOCK))
@@ -383,6 +404,10 @@ bool CSchedule::CancelAssignedInv(uint64 nPeerNonce, const network::CInv& inv)
         StdWarn("Schedule", "CancelAssignedInv: find inv fail, peer nonce: %ld, inv: [%d] %s", nPeerNonce, inv.nType, inv.nHash.GetHex().c_str());
         return false;
     }
+    if (inv.nType == network::CInv::MSG_BLOCK)
+    {
+        mapPartialBlock.erase(inv.nHash);
+    }
     CInvState& state = (*it).second;
     if (state.nAssigned != nPeerNonce)
     {
@@ -483,6 +508,57 @@ bool CSchedule::SetDelayedClear(const network::CInv& inv, int64 nDelayedTime)
     return false;
 }
 
+bool CSchedule::IsAssignedInv(uint64 nPeerNonce, const network::CInv& inv)
+{
+    map<network::CInv, CInvState>::iterator it = mapState.find(inv);
+    return (it != mapState.end() && (*it).second.nAssigned == nPeerNonce && !(*it).second.IsReceived());
+}
+
+bool CSchedule::AddPartialBlock(uint64 nPeerNonce, const CCompactBlock& compact,
+                                const vector<CTransaction>& vtx, const vector<uint32>& vMissing)
+{
+    uint256 hash = compact.GetHash();
+    if (!IsAssignedInv(nPeerNonce, network::CInv(network::CInv::MSG_BLOCK, hash)))
+    {
+        return false;
+    }
+    CPartialBlock& partial = mapPartialBlock[hash];
+    partial.nPeerNonce = nPeerNonce;
+    partial.compact = compact;
+    partial.vtx = vtx;
+    partial.vMissing = vMissing;
+    return true;
+}
+
+bool CSchedule::FillPartialBlock(uint64 nPeerNonce, const uint256& hash, const vector<CTransaction>& vtxMissing,
+                                 CCompactBlock& compact, vector<CTransaction>& vtx)
+{
+    map<uint256, CPartialBlock>::iterator it = mapPartialBlock.find(hash);
+    if (it == mapPartialBlock.end() || (*it).second.nPeerNonce != nPeerNonce)
+    {
+        return false;
+    }
+    CPartialBlock& partial = (*it).second;
+    if (vtxMissing.size() != partial.vMissing.size())
+    {
+        mapPartialBlock.erase(it);
+        return false;
+    }
+    for (size_t i = 0; i < vtxMissing.size(); i++)
+    {
+        partial.vtx[partial.vMissing[i]] = vtxMissing[i];
+    }
+    compact = partial.compact;
+    vtx.swap(partial.vtx);
+    mapPartialBlock.erase(it);
+    return true;
+}
+
+void CSchedule::RemovePartialBlock(const uint256& hash)
+{
+    mapPartialBlock.erase(hash);
+}
+
 void CSchedule::RemoveOrphan(const network::CInv& inv)
 {
     if (inv.nType == network::CInv::MSG_TX)
@@ -565,6 +641,30 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                         continue;
                     }
                     state.nAssigned = nPeerNonce;
+                    state.nAssignedTime = GetTimeMillis();
+                    vInv.push_back(inv);
+                    peer.Assign(inv);
+                    state.nGetDataCount++;
+                    if (vInv.size() >= nMaxCount)
+                    {
+                        break;
+                    }
+                }
+                else if (type == network::CInv::MSG_BLOCK && !state.IsReceived() && state.nAssigned != nPeerNonce
+                         && GetTimeMillis() - state.nAssignedTime >= MAX_BLOCK_STALL_TIME * 1000)
+                {
+                    // the block stalls on a slow peer, ask this one instead
+                    StdLog("Schedule", "ScheduleKnownInv: block stalled, reassign, prev peer nonce: %ld, peer nonce: %ld, block: %s",
+                           state.nAssigned, nPeerNonce, inv.nHash.GetHex().c_str());
+                    map<uint64, CInvPeer>::iterator mt = mapPeer.find(state.nAssigned);
+                    if (mt != mapPeer.end())
+                    {
+                        (*mt).second.Completed(inv);
+                        (*mt).second.ResetBlockWindow();
+                    }
+                    mapPartialBlock.erase(inv.nHash);
+                    state.nAssigned = nPeerNonce;
+                    state.nAssignedTime = GetTimeMillis();
                     vInv.push_back(inv);
                     peer.Assign(inv);
                     state.nGetDataCount++;
@@ -33,8 +33,15 @@ class CInvPeer
     };
 
 public:
+    enum
+    {
+        BLOCK_WINDOW_INIT = 2,
+        BLOCK_WINDOW_MAX = 16,
+        BLOCK_FAST_RESPONSE_TIME = 1000,
+        BLOCK_SLOW_RESPONSE_TIME = 10000
+    };
     CInvPeer()
-      : nInvHeight(0)
+      : nInvHeight(0), nBlockWindow(BLOCK_WINDOW_INIT)
     {
     }
     ~CInvPeer()
@@ -162,6 +169,26 @@ public:
     {
         return (GetTime() >= invKnown[network::CInv::MSG_BLOCK - network::CInv::MSG_TX].nNextGetBlocksTime);
     }
+    std::size_t GetBlockWindow()
+    {
+        return nBlockWindow;
+    }
+    // grows by one block on a fast response, halves on a slow one (ms)
+    void UpdateBlockWindow(int64 nResponseTime)
+    {
+        if (nResponseTime <= BLOCK_FAST_RESPONSE_TIME)
+        {
+            nBlockWindow = std::min(nBlockWindow + 1, (std::size_t)BLOCK_WINDOW_MAX);
+        }
+        else if (nResponseTime >= BLOCK_SLOW_RESPONSE_TIME)
+        {
+            nBlockWindow = std::max(nBlockWindow / 2, (std::size_t)1);
+        }
+    }
+    void ResetBlockWindow()
+    {
+        nBlockWindow = 1;
+    }
     int64 AddRepeatBlock(const uint256& hash)
     {
         if (KnownInvExists(network::CInv(network::CInv::MSG_BLOCK, hash)))
@@ -178,6 +205,7 @@ public:
     uint256 hashGetBlockLocatorDepth;
     int nInvHeight;
     uint256 hashInvBlock;
+    std::size_t nBlockWindow;
 };
 
 class COrphan
@@ -198,11 +226,24 @@ protected:
 class CSchedule
 {
     typedef boost::variant<CNil, CBlock, CTransaction> CInvObject;
+    // compact block waiting for the txs missing from the pool
+    class CPartialBlock
+    {
+    public:
+        CPartialBlock()
+          : nPeerNonce(0) {}
+
+    public:
+        uint64 nPeerNonce;
+        CCompactBlock compact;
+        std::vector<CTransaction> vtx;
+        std::vector<uint32> vMissing;
+    };
     class CInvState
     {
     public:
         CInvState()
-          : nAssigned(0), objReceived(CNil()), nRecvInvTime(0), nRecvObjTime(0), nClearObjTime(0),
+          : nAssigned(0), nAssignedTime(0), objReceived(CNil()), nRecvInvTime(0), nRecvObjTime(0), nClearObjTime(0),
             nGetDataCount(0), fRepeatMintBlock(false), fVerifyPowBlock(false) {}
         bool IsReceived()
         {
@@ -211,6 +252,7 @@ class CSchedule
 
     public:
         uint64 nAssigned;
+        int64 nAssignedTime; // ms
         CInvObject objReceived;
         std::set<uint64> setKnownPeer;
         int64 nRecvInvTime;
@@ -235,7 +277,9 @@ public:
         MAX_SUB_BLOCK_DELAYED_TIME = 120,
         MAX_CERTTX_DELAYED_TIME = 180,
         MAX_SUBMIT_POW_TIMEOUT = 10,
-        MAX_MINTTX_DELAYED_TIME = 180
+        MAX_MINTTX_DELAYED_TIME = 180,
+        MAX_BLOCK_STALL_TIME = 30,
+        MAX_PEER_BLOCK_WINDOW = CInvPeer::BLOCK_WINDOW_MAX
     };
 
 public:
@@ -267,6 +311,12 @@ public:
     bool SetRepeatBlock(uint64 nNonce, const uint256& hash);
     bool IsRepeatBlock(const uint256& hash);
     bool SetDelayedClear(const network::CInv& inv, int64 nDelayedTime);
+    bool IsAssignedInv(uint64 nPeerNonce, const network::CInv& inv);
+    bool AddPartialBlock(uint64 nPeerNonce, const CCompactBlock& compact,
+                         const std::vector<CTransaction>& vtx, const std::vector<uint32>& vMissing);
+    bool FillPartialBlock(uint64 nPeerNonce, const uint256& hash, const std::vector<CTransaction>& vtxMissing,
+                          CCompactBlock& compact, std::vector<CTransaction>& vtx);
+    void RemovePartialBlock(const uint256& hash);
 
 protected:
     void RemoveOrphan(const network::CInv& inv);
@@ -279,6 +329,7 @@ protected:
     std::map<uint64, CInvPeer> mapPeer;
     std::map<network::CInv, CInvState> mapState;
     std::set<network::CInv> setMissPrevTxInv;
+    std::map<uint256, CPartialBlock> mapPartialBlock;
 };
 
 } // namespace minemon
@@ -186,6 +186,7 @@ bool CService::RemoveNode(const CNetHost& node)
 
 int CService::GetForkCount()
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwForkStatus);
     return mapForkStatus.size();
 }
 
@@ -577,7 +578,7 @@ bool CService::ListWalletTx(const uint256& hashFork, const CDestination& dest, i
 {
     if (nOffset < 0)
     {
-        nOffset = pWallet->GetTxCount() - nCount;
+        nOffset = pWallet->GetTxCount(hashFork, dest) - nCount;
         if (nOffset < 0)
         {
             nOffset = 0;
@@ -677,6 +678,11 @@ Errno CService::SendOfflineSignedTransaction(CTransaction& tx)
     return pDispatcher->AddNewTx(tx, 0);
 }
 
+void CService::SendOfflineSignedTransactions(const std::vector<CTransaction>& vtx, std::vector<Errno>& vErr)
+{
+    pDispatcher->AddNewTx(vtx, vErr);
+}
+
 bool CService::AesEncrypt(const crypto::CPubKey& pubkeyLocal, const crypto::CPubKey& pubkeyRemote, const std::vector<uint8>& vMessage, std::vector<uint8>& vCiphertext)
 {
     return pWallet->AesEncrypt(pubkeyLocal, pubkeyRemote, vMessage, vCiphertext);
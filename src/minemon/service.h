@@ -76,6 +76,7 @@ public:
     bool ResynchronizeWalletTx() override;
     bool SignOfflineTransaction(const CDestination& destIn, CTransaction& tx, bool& fCompleted) override;
     Errno SendOfflineSignedTransaction(CTransaction& tx) override;
+    void SendOfflineSignedTransactions(const std::vector<CTransaction>& vtx, std::vector<Errno>& vErr) override;
     bool AesEncrypt(const crypto::CPubKey& pubkeyLocal, const crypto::CPubKey& pubkeyRemote, const std::vector<uint8>& vMessage, std::vector<uint8>& vCiphertext) override;
     bool AesDecrypt(const crypto::CPubKey& pubkeyLocal, const crypto::CPubKey& pubkeyRemote, const std::vector<uint8>& vCiphertext, std::vector<uint8>& vMessage) override;
     /* Mint */
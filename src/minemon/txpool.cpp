@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <boost/range/adaptor/reversed.hpp>
 #include <deque>
+#include <limits>
 
 using namespace std;
 using namespace xengine;
@@ -138,7 +139,9 @@ bool CTxPoolView::AddTxIndex(const uint256& txid, CPooledTx& tx)
         }
     }
 
-    if (!setTxLinkIndex.insert(CPooledTxLink(&tx)).second)
+    CPooledTxLink link(&tx);
+    GetPackageScore(tx, link.nPackageFee, link.nPackageSize);
+    if (!setTxLinkIndex.insert(link).second)
     {
         StdError("CTxPoolView", "AddNew: setTxLinkIndex insert fail, txid: %s, nSequenceNumber: %ld",
                  txid.GetHex().c_str(), tx.nSequenceNumber);
@@ -150,6 +153,14 @@ bool CTxPoolView::AddTxIndex(const uint256& txid, CPooledTx& tx)
 
 bool CTxPoolView::AddNew(const uint256& txid, CPooledTx& tx)
 {
+    // a tx added back on a rollback goes before its pooled spenders, the template is rearranged
+    bool fRearrange = Exists(txid);
+    for (int i = 0; i < 2 && !fRearrange; i++)
+    {
+        uint256 txidNextTx;
+        fRearrange = (GetSpent(CTxOutPoint(txid, i), txidNextTx) && Get(txidNextTx) != nullptr);
+    }
+
     if (!AddTxIndex(txid, tx))
     {
         StdError("CTxPoolView", "AddNew: Add tx index fail, txid: %s, nSequenceNumber: %ld",
@@ -187,6 +198,7 @@ bool CTxPoolView::AddNew(const uint256& txid, CPooledTx& tx)
         {
             if (ptx->nSequenceNumber > vPrevTxid[i].second)
             {
+                fRearrange = true;
                 if (!AddTxIndex(txidPrev, *ptx))
                 {
                     StdError("CTxPoolView", "AddNew: Add prev tx index fail, txidPrev: %s, nSequenceNumber: %ld",
@@ -201,6 +213,17 @@ bool CTxPoolView::AddNew(const uint256& txid, CPooledTx& tx)
         }
     }
 
+    // pooled spenders of the outputs (added back on a rollback) get a new ancestor
+    UpdateDescendantPackage(txid);
+
+    if (fRearrange)
+    {
+        fTemplateValid = false;
+    }
+    else
+    {
+        AddTemplateTx(txid, tx);
+    }
     return true;
 }
 
@@ -237,6 +260,7 @@ void CTxPoolView::InvalidateSpent(const CTxOutPoint& out, CTxPoolView& viewInvol
                 mapSpent.erase(out1);
             }
             viewInvolvedTx.AddNew(txidNextTx, *pNextTx);
+            RemoveTemplateTx(txidNextTx, *pNextTx);
             setTxLinkIndex.erase(txidNextTx);
         }
         else
@@ -283,59 +307,227 @@ void CTxPoolView::GetAllPrevTxLink(const CPooledTxLink& link, vector<CPooledTxLi
     }
 }
 
-bool CTxPoolView::AddArrangeBlockTx(vector<CTransaction>& vtx, int64& nTotalTxFee, int64 nBlockTime, size_t nMaxSize,
-                                    size_t& nTotalSize, set<uint256>& setUnTx, CPooledTx* ptx)
+void CTxPoolView::GetPackageScore(const CPooledTx& tx, int64& nPackageFee, size_t& nPackageSize)
 {
-    if (ptx->GetTxTime() <= nBlockTime)
+    nPackageFee = tx.nTxFee;
+    nPackageSize = tx.nSerializeSize;
+
+    set<uint256> setPrevTxid;
+    vector<const CPooledTx*> vAncestor;
+    vAncestor.push_back(&tx);
+    for (size_t i = 0; i < vAncestor.size() && vAncestor.size() <= MAX_PACKAGE_TX_COUNT; i++)
     {
-        if (!setUnTx.empty())
+        for (const CTxIn& txin : vAncestor[i]->vInput)
         {
-            bool fMissPrev = false;
-            for (const auto& d : ptx->vInput)
+            if (setPrevTxid.insert(txin.prevout.hash).second)
             {
-                if (setUnTx.find(d.prevout.hash) != setUnTx.end())
+                CPooledTx* pPrevTx = Get(txin.prevout.hash);
+                if (pPrevTx != nullptr)
                 {
-                    fMissPrev = true;
-                    break;
+                    nPackageFee += pPrevTx->nTxFee;
+                    nPackageSize += pPrevTx->nSerializeSize;
+                    vAncestor.push_back(pPrevTx);
                 }
             }
-            if (fMissPrev)
+        }
+    }
+}
+
+void CTxPoolView::UpdateDescendantPackage(const uint256& txid)
+{
+    CPooledTxLinkSetByTxHash& idxTx = setTxLinkIndex.get<0>();
+    set<uint256> setDescendant;
+    vector<uint256> vDescendant;
+    vDescendant.push_back(txid);
+    for (size_t i = 0; i < vDescendant.size() && vDescendant.size() <= MAX_PACKAGE_TX_COUNT; i++)
+    {
+        for (int n = 0; n < 2; n++)
+        {
+            uint256 txidNextTx;
+            if (GetSpent(CTxOutPoint(vDescendant[i], n), txidNextTx) && setDescendant.insert(txidNextTx).second)
             {
-                setUnTx.insert(ptx->GetHash());
-                return true;
+                CPooledTxLinkSetByTxHash::iterator it = idxTx.find(txidNextTx);
+                if (it != idxTx.end())
+                {
+                    int64 nPackageFee = 0;
+                    size_t nPackageSize = 0;
+                    GetPackageScore(*(it->ptx), nPackageFee, nPackageSize);
+                    idxTx.modify(it, [&](CPooledTxLink& link) {
+                        link.nPackageFee = nPackageFee;
+                        link.nPackageSize = nPackageSize;
+                    });
+                    vDescendant.push_back(txidNextTx);
+                }
             }
         }
-        if (nTotalSize + ptx->nSerializeSize > nMaxSize)
+    }
+}
+
+bool CTxPoolView::GetArrangePackage(CPooledTx* ptx, int64 nBlockTime, const set<uint256>& setArranged, set<uint256>& setUnTx,
+                                    vector<CPooledTx*>& vPackage, int64& nNextTxTime)
+{
+    vPackage.clear();
+    vPackage.push_back(ptx);
+    set<uint256> setPackage;
+    setPackage.insert(ptx->GetHash());
+    for (size_t i = 0; i < vPackage.size(); i++)
+    {
+        CPooledTx* pCurTx = vPackage[i];
+        if (pCurTx->GetTxTime() > nBlockTime || setUnTx.count(pCurTx->GetHash()))
         {
+            if (pCurTx->GetTxTime() > nBlockTime && pCurTx->GetTxTime() < nNextTxTime)
+            {
+                nNextTxTime = pCurTx->GetTxTime();
+            }
+            setUnTx.insert(pCurTx->GetHash());
+            setUnTx.insert(ptx->GetHash());
             return false;
         }
-        vtx.push_back(*static_cast<CTransaction*>(ptx));
-        nTotalSize += ptx->nSerializeSize;
-        nTotalTxFee += ptx->nTxFee;
-    }
-    else
-    {
-        setUnTx.insert(ptx->GetHash());
+        for (const CTxIn& txin : pCurTx->vInput)
+        {
+            const uint256& txidPrev = txin.prevout.hash;
+            if (!setArranged.count(txidPrev) && setPackage.insert(txidPrev).second)
+            {
+                CPooledTx* pPrevTx = Get(txidPrev);
+                if (pPrevTx != nullptr)
+                {
+                    vPackage.push_back(pPrevTx);
+                }
+            }
+        }
     }
     return true;
 }
 
 void CTxPoolView::ArrangeBlockTx(vector<CTransaction>& vtx, int64& nTotalTxFee, int64 nBlockTime, size_t nMaxSize)
 {
+    // called under the shared fork lock by every GetWork, the template is rebuilt only when it can not be patched
+    boost::unique_lock<boost::mutex> lock(mtxTemplate);
+    if (fTemplateValid && nTemplateMaxSize == nMaxSize && nBlockTime >= nTemplateTime && nBlockTime < nTemplateNextTime)
+    {
+        PackTemplate();
+        vtx.reserve(vtx.size() + vTemplateTx.size());
+        for (const auto& tx : vTemplateTx)
+        {
+            vtx.push_back(tx.second);
+        }
+        nTotalTxFee = nTemplateTxFee;
+        return;
+    }
+
     size_t nTotalSize = 0;
+    size_t nFailure = 0;
+    set<uint256> setArranged;
     set<uint256> setUnTx;
-    std::vector<CPooledTxLink> prevLinks;
+    vector<CPooledTx*> vPackage;
+    int64 nNextTxTime = std::numeric_limits<int64>::max();
     nTotalTxFee = 0;
+    vTemplateTx.clear();
 
-    // process all tx in tx pool by seqnum
-    const CPooledTxLinkSetBySequenceNumber& idxTxLinkSeq = setTxLinkIndex.get<1>();
-    for (auto& i : idxTxLinkSeq)
+    // best package fee rate first, a package brings its unarranged ancestors in sequence order
+    const CPooledTxLinkSetByTxScore& idxTxLinkScore = setTxLinkIndex.get<tx_score>();
+    for (auto it = idxTxLinkScore.begin(); it != idxTxLinkScore.end() && nFailure < MAX_ARRANGE_FAILURE; ++it)
     {
-        if (!AddArrangeBlockTx(vtx, nTotalTxFee, nBlockTime, nMaxSize, nTotalSize, setUnTx, i.ptx))
+        if (setArranged.count(it->hashTX) || setUnTx.count(it->hashTX)
+            || !GetArrangePackage(it->ptx, nBlockTime, setArranged, setUnTx, vPackage, nNextTxTime))
         {
+            continue;
+        }
+
+        size_t nPackageSize = 0;
+        for (const CPooledTx* ptx : vPackage)
+        {
+            nPackageSize += ptx->nSerializeSize;
+        }
+        if (nTotalSize + nPackageSize > nMaxSize)
+        {
+            nFailure++;
+            continue;
+        }
+
+        sort(vPackage.begin(), vPackage.end(), [](const CPooledTx* a, const CPooledTx* b) { return a->nSequenceNumber < b->nSequenceNumber; });
+        for (const CPooledTx* ptx : vPackage)
+        {
+            const uint256 txid = ptx->GetHash();
+            vtx.push_back(*static_cast<const CTransaction*>(ptx));
+            vTemplateTx.push_back(make_pair(txid, vtx.back()));
+            nTotalTxFee += ptx->nTxFee;
+            setArranged.insert(txid);
+        }
+        nTotalSize += nPackageSize;
+    }
+
+    // txs left unvisited after too many failures may turn due at any time
+    fTemplateValid = true;
+    fTemplateComplete = (nFailure == 0);
+    nTemplateTime = nBlockTime;
+    nTemplateNextTime = (nFailure < MAX_ARRANGE_FAILURE ? nNextTxTime : nBlockTime + 1);
+    nTemplateMaxSize = nMaxSize;
+    nTemplateSize = nTotalSize;
+    setTemplateTx.swap(setArranged);
+    nTemplateTxFee = nTotalTxFee;
+}
+
+void CTxPoolView::AddTemplateTx(const uint256& txid, const CPooledTx& tx)
+{
+    if (!fTemplateValid)
+    {
+        return;
+    }
+    if (tx.GetTxTime() > nTemplateTime)
+    {
+        nTemplateNextTime = min(nTemplateNextTime, tx.GetTxTime());
+        return;
+    }
+    for (const CTxIn& txin : tx.vInput)
+    {
+        // a complete template leaves a pooled ancestor out only until nTemplateNextTime
+        if (!setTemplateTx.count(txin.prevout.hash) && Exists(txin.prevout.hash))
+        {
+            fTemplateValid = fTemplateComplete;
             return;
         }
     }
+    if (!fTemplateComplete || nTemplateSize + tx.nSerializeSize > nTemplateMaxSize)
+    {
+        // the fee rate decides which packages fit
+        fTemplateValid = false;
+        return;
+    }
+
+    PackTemplate();
+    vTemplateTx.push_back(make_pair(txid, static_cast<const CTransaction&>(tx)));
+    setTemplateTx.insert(txid);
+    nTemplateSize += tx.nSerializeSize;
+    nTemplateTxFee += tx.nTxFee;
+}
+
+void CTxPoolView::RemoveTemplateTx(const uint256& txid, const CPooledTx& tx)
+{
+    if (!fTemplateValid)
+    {
+        return;
+    }
+    if (!fTemplateComplete || !setTemplateTx.erase(txid))
+    {
+        // freed space goes to the next best package, or a left out tx is no longer waiting
+        fTemplateValid = false;
+        return;
+    }
+
+    // the pooled descendants are removed by the caller or spend a confirmed tx now
+    nTemplateSize -= tx.nSerializeSize;
+    nTemplateTxFee -= tx.nTxFee;
+}
+
+void CTxPoolView::PackTemplate()
+{
+    if (vTemplateTx.size() != setTemplateTx.size())
+    {
+        vTemplateTx.erase(remove_if(vTemplateTx.begin(), vTemplateTx.end(),
+                                    [this](const pair<uint256, CTransaction>& tx) { return !setTemplateTx.count(tx.first); }),
+                          vTemplateTx.end());
+    }
 }
 
 //////////////////////////////
@@ -414,10 +606,152 @@ bool CCertTxDestCache::IsOverMaxCertCount(const CDestination& dest)
     return true;
 }
 
+//////////////////////////////
+// CTxPoolTxIndex
+
+CTxPoolTxIndex::CTxPoolTxIndex()
+{
+    for (std::size_t i = 0; i < FILTER_SIZE; i++)
+    {
+        vFilter[i] = 0;
+    }
+}
+
+bool CTxPoolTxIndex::Exists(const uint256& txid) const
+{
+    if (GetFilter(txid) == 0)
+    {
+        return false;
+    }
+    CShard& shard = GetShard(txid);
+    boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+    return (!!shard.mapTxFork.count(txid));
+}
+
+bool CTxPoolTxIndex::GetFork(const uint256& txid, uint256& hashFork) const
+{
+    if (GetFilter(txid) == 0)
+    {
+        return false;
+    }
+    CShard& shard = GetShard(txid);
+    boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+    map<uint256, uint256>::const_iterator it = shard.mapTxFork.find(txid);
+    if (it == shard.mapTxFork.end())
+    {
+        return false;
+    }
+    hashFork = it->second;
+    return true;
+}
+
+void CTxPoolTxIndex::Add(const uint256& txid, const uint256& hashFork)
+{
+    CShard& shard = GetShard(txid);
+    boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+    if (shard.mapTxFork.insert(make_pair(txid, hashFork)).second)
+    {
+        GetFilter(txid)++;
+    }
+}
+
+void CTxPoolTxIndex::Remove(const uint256& txid)
+{
+    CShard& shard = GetShard(txid);
+    boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+    if (shard.mapTxFork.erase(txid))
+    {
+        GetFilter(txid)--;
+    }
+}
+
+void CTxPoolTxIndex::Clear()
+{
+    for (std::size_t i = 0; i < SHARD_COUNT; i++)
+    {
+        boost::unique_lock<boost::mutex> lock(vShard[i].mtxShard);
+        for (const auto& kv : vShard[i].mapTxFork)
+        {
+            GetFilter(kv.first)--;
+        }
+        vShard[i].mapTxFork.clear();
+    }
+}
+
+//////////////////////////////
+// CTxPoolDestIndex
+
+void CTxPoolDestIndex::Add(const uint256& txid, const CPooledTx& tx)
+{
+    boost::unique_lock<boost::mutex> lock(mtxDest);
+    mapDest[tx.sendTo].mapSendTo.insert(make_pair(txid, tx.nAmount));
+    if (!tx.destIn.IsNull())
+    {
+        CDestAmount& amount = mapDest[tx.destIn];
+        amount.nSpentAmount += (tx.nAmount + tx.nTxFee);
+        amount.nSpentCount++;
+    }
+}
+
+void CTxPoolDestIndex::Remove(const uint256& txid, const CPooledTx& tx)
+{
+    boost::unique_lock<boost::mutex> lock(mtxDest);
+    map<CDestination, CDestAmount>::iterator it = mapDest.find(tx.sendTo);
+    if (it != mapDest.end())
+    {
+        it->second.mapSendTo.erase(txid);
+        if (it->second.mapSendTo.empty() && it->second.nSpentCount == 0)
+        {
+            mapDest.erase(it);
+        }
+    }
+    if (!tx.destIn.IsNull())
+    {
+        it = mapDest.find(tx.destIn);
+        if (it != mapDest.end() && it->second.nSpentCount > 0)
+        {
+            it->second.nSpentAmount -= (tx.nAmount + tx.nTxFee);
+            if (--it->second.nSpentCount == 0 && it->second.mapSendTo.empty())
+            {
+                mapDest.erase(it);
+            }
+        }
+    }
+}
+
+int64 CTxPoolDestIndex::GetAmount(const CDestination& dest) const
+{
+    boost::unique_lock<boost::mutex> lock(mtxDest);
+    map<CDestination, CDestAmount>::const_iterator it = mapDest.find(dest);
+    if (it == mapDest.end())
+    {
+        return 0;
+    }
+    if (!it->second.mapSendTo.empty())
+    {
+        return it->second.mapSendTo.begin()->second;
+    }
+    return -it->second.nSpentAmount;
+}
+
+bool CTxPoolDestIndex::ExistsSendTo(const CDestination& dest) const
+{
+    boost::unique_lock<boost::mutex> lock(mtxDest);
+    map<CDestination, CDestAmount>::const_iterator it = mapDest.find(dest);
+    return (it != mapDest.end() && !it->second.mapSendTo.empty());
+}
+
+void CTxPoolDestIndex::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mtxDest);
+    mapDest.clear();
+}
+
 //////////////////////////////
 // CTxPool
 
 CTxPool::CTxPool()
+  : poolVerify("txverify")
 {
     pCoreProtocol = nullptr;
     pBlockChain = nullptr;
@@ -453,6 +787,18 @@ void CTxPool::HandleDeinitialize()
 
 bool CTxPool::HandleInvoke()
 {
+    // the pushing thread joins the verification, so it counts as one of them
+    int nVerifyThreads = StorageConfig()->nVerifyThreads;
+    if (nVerifyThreads <= 0)
+    {
+        nVerifyThreads = boost::thread::hardware_concurrency();
+    }
+    if (!poolVerify.Start(nVerifyThreads > 1 ? nVerifyThreads - 1 : 0))
+    {
+        Error("Failed to start verify pool");
+        return false;
+    }
+
     if (!datTxPool.Initialize(Config()->pathData))
     {
         Error("Failed to initialize txpool data");
@@ -470,6 +816,7 @@ bool CTxPool::HandleInvoke()
 
 void CTxPool::HandleHalt()
 {
+    poolVerify.Stop();
     if (!SaveData())
     {
         Error("Failed to save txpool data");
@@ -479,34 +826,33 @@ void CTxPool::HandleHalt()
 
 bool CTxPool::Exists(const uint256& txid)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    return (!!mapTx.count(txid));
+    return txIndex.Exists(txid);
 }
 
 void CTxPool::Clear()
 {
     boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
-    mapPoolView.clear();
-    mapTx.clear();
+    mapPoolFork.clear();
+    txIndex.Clear();
+    destIndex.Clear();
 }
 
 size_t CTxPool::Count(const uint256& fork) const
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(fork);
-    if (it != mapPoolView.end())
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(fork);
+    if (spFork)
     {
-        return ((*it).second.Count());
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        return spFork->view.Count();
     }
     return 0;
 }
 
 Errno CTxPool::Push(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn)
 {
-    boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
     uint256 txid = tx.GetHash();
 
-    if (mapTx.count(txid))
+    if (txIndex.Exists(txid))
     {
         StdError("CTxPool", "Push: tx existed, txid: %s", txid.GetHex().c_str());
         return ERR_ALREADY_HAVE;
@@ -526,6 +872,16 @@ Errno CTxPool::Push(const CTransaction& tx, uint256& hashFork, CDestination& des
         return ERR_TRANSACTION_INVALID;
     }
 
+    std::shared_ptr<CTxPoolFork> spFork = AddPoolFork(hashFork);
+    boost::unique_lock<boost::shared_mutex> wlock(spFork->rwFork);
+
+    // checked again under the fork lock, a concurrent push of the same tx may have won
+    if (spFork->mapTx.count(txid))
+    {
+        StdError("CTxPool", "Push: tx existed, txid: %s", txid.GetHex().c_str());
+        return ERR_ALREADY_HAVE;
+    }
+
     uint256 hashLast;
     int64 nTime;
     uint16 nMintType;
@@ -536,11 +892,10 @@ Errno CTxPool::Push(const CTransaction& tx, uint256& hashFork, CDestination& des
         return ERR_TRANSACTION_INVALID;
     }
 
-    CTxPoolView& txView = mapPoolView[hashFork];
-    Errno err = AddNew(txView, txid, tx, hashFork, nHeight, hashLast);
+    Errno err = AddNew(*spFork, txid, tx, hashFork, nHeight, hashLast);
     if (err == OK)
     {
-        CPooledTx* pPooledTx = txView.Get(txid);
+        CPooledTx* pPooledTx = spFork->view.Get(txid);
         if (pPooledTx == nullptr)
         {
             StdError("CTxPool", "Push: txView Get fail, txid: %s", txid.GetHex().c_str());
@@ -558,19 +913,143 @@ Errno CTxPool::Push(const CTransaction& tx, uint256& hashFork, CDestination& des
     return err;
 }
 
+void CTxPool::Push(const vector<CTransaction>& vtx, uint256& hashFork, vector<Errno>& vErr,
+                   vector<CDestination>& vDestIn, vector<int64>& vValueIn)
+{
+    vErr.assign(vtx.size(), OK);
+    vDestIn.assign(vtx.size(), CDestination());
+    vValueIn.assign(vtx.size(), 0);
+
+    int nHeight;
+    uint256 hashLast;
+    int64 nTime;
+    uint16 nMintType;
+    if (!pBlockChain->GetBlockLocation(pCoreProtocol->GetGenesisBlockHash(), hashFork, nHeight)
+        || !pBlockChain->GetLastBlock(hashFork, hashLast, nHeight, nTime, nMintType))
+    {
+        StdError("CTxPool", "Push: GetLastBlock fail, hashFork: %s", hashFork.GetHex().c_str());
+        vErr.assign(vtx.size(), ERR_TRANSACTION_INVALID);
+        return;
+    }
+
+    std::shared_ptr<CTxPoolFork> spFork = AddPoolFork(hashFork);
+
+    // the first input decides the signer, outputs of pooled txs are taken from the view
+    vector<CTxOut> vSigner(vtx.size());
+    {
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        for (size_t i = 0; i < vtx.size(); i++)
+        {
+            const CTransaction& tx = vtx[i];
+            if (txIndex.Exists(tx.GetHash()))
+            {
+                vErr[i] = ERR_ALREADY_HAVE;
+            }
+            else if (tx.IsMintTx())
+            {
+                vErr[i] = ERR_TRANSACTION_INVALID;
+            }
+            else if (!tx.vInput.empty())
+            {
+                spFork->view.GetUnspent(tx.vInput[0].prevout, vSigner[i]);
+            }
+        }
+    }
+
+    // stateless checks outside the fork lock, a tx whose signer is unknown yet
+    // (it spends a tx earlier in the batch) is fully verified when it is added
+    const size_t nGroup = min(vtx.size(), poolVerify.GetWorkerCount() + 1);
+    vector<CWorkerPool::WorkFunc> vWork;
+    vWork.reserve(nGroup);
+    for (size_t n = 0; n < nGroup; n++)
+    {
+        vWork.push_back([&, n]() {
+            for (size_t i = n; i < vtx.size(); i += nGroup)
+            {
+                if (vErr[i] != OK || (vErr[i] = pCoreProtocol->ValidateTransaction(vtx[i], nHeight)) != OK)
+                {
+                    continue;
+                }
+                if (vSigner[i].IsNull() && !vtx[i].vInput.empty())
+                {
+                    vector<CTxIn> vInput(vtx[i].vInput.begin(), vtx[i].vInput.begin() + 1);
+                    vector<CTxOut> vOutput(1);
+                    if (!pBlockChain->GetTxUnspent(hashFork, vInput, vOutput))
+                    {
+                        continue;
+                    }
+                    vSigner[i] = vOutput[0];
+                }
+                if (!vSigner[i].IsNull())
+                {
+                    vErr[i] = pCoreProtocol->VerifyTransactionSignature(vtx[i], vSigner[i].destTo, nHeight, hashFork);
+                }
+            }
+        });
+    }
+    poolVerify.Execute(vWork);
+
+    boost::unique_lock<boost::shared_mutex> wlock(spFork->rwFork);
+
+    // a block connected during the checks, the signatures are verified again at the new height
+    uint256 hashVerified = hashLast;
+    if (!pBlockChain->GetLastBlock(hashFork, hashLast, nHeight, nTime, nMintType))
+    {
+        StdError("CTxPool", "Push: GetLastBlock fail, hashFork: %s", hashFork.GetHex().c_str());
+        vErr.assign(vtx.size(), ERR_TRANSACTION_INVALID);
+        return;
+    }
+    const bool fVerified = (hashLast == hashVerified);
+
+    for (size_t i = 0; i < vtx.size(); i++)
+    {
+        if (vErr[i] != OK)
+        {
+            StdTrace("CTxPool", "Push fail, err: [%d] %s, txid: %s", vErr[i], ErrorString(vErr[i]), vtx[i].GetHash().GetHex().c_str());
+            continue;
+        }
+        const uint256 txid = vtx[i].GetHash();
+        if (spFork->mapTx.count(txid))
+        {
+            vErr[i] = ERR_ALREADY_HAVE;
+            continue;
+        }
+        vErr[i] = AddNew(*spFork, txid, vtx[i], hashFork, nHeight, hashLast, (fVerified ? vSigner[i].destTo : CDestination()));
+        if (vErr[i] == OK)
+        {
+            const CPooledTx& txPooled = spFork->mapTx[txid];
+            vDestIn[i] = txPooled.destIn;
+            vValueIn[i] = txPooled.nValueIn;
+        }
+        else
+        {
+            StdTrace("CTxPool", "Push fail, err: [%d] %s, txid: %s", vErr[i], ErrorString(vErr[i]), txid.GetHex().c_str());
+        }
+    }
+}
+
 void CTxPool::Pop(const uint256& txid)
 {
-    boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
-    RemoveTx(txid);
+    uint256 hashFork;
+    if (!txIndex.GetFork(txid, hashFork))
+    {
+        StdError("CTxPool", "Pop: find fail, txid: %s", txid.GetHex().c_str());
+        return;
+    }
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (spFork)
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(spFork->rwFork);
+        RemoveTx(*spFork, txid);
+    }
 }
 
 bool CTxPool::Get(const uint256& txid, CTransaction& tx) const
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    map<uint256, CPooledTx>::const_iterator it = mapTx.find(txid);
-    if (it != mapTx.end())
+    CAssembledTx txAssembled;
+    if (Get(txid, txAssembled))
     {
-        tx = (*it).second;
+        tx = txAssembled;
         return true;
     }
     return false;
@@ -578,23 +1057,32 @@ bool CTxPool::Get(const uint256& txid, CTransaction& tx) const
 
 bool CTxPool::Get(const uint256& txid, CAssembledTx& tx) const
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    map<uint256, CPooledTx>::const_iterator it = mapTx.find(txid);
-    if (it != mapTx.end())
+    uint256 hashFork;
+    if (!txIndex.GetFork(txid, hashFork))
     {
-        tx = (*it).second;
-        return true;
+        return false;
+    }
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (spFork)
+    {
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        map<uint256, CPooledTx>::const_iterator it = spFork->mapTx.find(txid);
+        if (it != spFork->mapTx.end())
+        {
+            tx = (*it).second;
+            return true;
+        }
     }
     return false;
 }
 
 void CTxPool::ListTx(const uint256& hashFork, vector<pair<uint256, size_t>>& vTxPool)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(hashFork);
-    if (it != mapPoolView.end())
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (spFork)
     {
-        const CPooledTxLinkSetBySequenceNumber& idxTx = (*it).second.setTxLinkIndex.get<1>();
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        const CPooledTxLinkSetBySequenceNumber& idxTx = spFork->view.setTxLinkIndex.get<1>();
         for (CPooledTxLinkSetBySequenceNumber::iterator mi = idxTx.begin(); mi != idxTx.end(); ++mi)
         {
             vTxPool.push_back(make_pair((*mi).hashTX, (*mi).ptx->nSerializeSize));
@@ -604,11 +1092,11 @@ void CTxPool::ListTx(const uint256& hashFork, vector<pair<uint256, size_t>>& vTx
 
 void CTxPool::ListTx(const uint256& hashFork, vector<uint256>& vTxPool)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(hashFork);
-    if (it != mapPoolView.end())
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (spFork)
     {
-        const CPooledTxLinkSetBySequenceNumber& idxTx = (*it).second.setTxLinkIndex.get<1>();
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        const CPooledTxLinkSetBySequenceNumber& idxTx = spFork->view.setTxLinkIndex.get<1>();
         for (CPooledTxLinkSetBySequenceNumber::const_iterator mi = idxTx.begin(); mi != idxTx.end(); ++mi)
         {
             vTxPool.push_back((*mi).hashTX);
@@ -618,12 +1106,11 @@ void CTxPool::ListTx(const uint256& hashFork, vector<uint256>& vTxPool)
 
 bool CTxPool::ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(hashFork);
-    if (it != mapPoolView.end())
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (spFork)
     {
-        const CTxPoolView& txPoolView = it->second;
-        ListUnspent(txPoolView, dest, nMax, vUnspentOnChain, vUnspent);
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        ListUnspent(spFork->view, dest, nMax, vUnspentOnChain, vUnspent);
         return true;
     }
 
@@ -632,11 +1119,11 @@ bool CTxPool::ListForkUnspent(const uint256& hashFork, const CDestination& dest,
 
 bool CTxPool::ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, const std::map<CDestination, std::vector<CTxUnspent>>& mapUnspentOnChain, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(hashFork);
-    if (it != mapPoolView.end())
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (spFork)
     {
-        const CTxPoolView& txPoolView = it->second;
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        const CTxPoolView& txPoolView = spFork->view;
         for (const auto& kv : mapUnspentOnChain)
         {
             const CDestination& dest = kv.first;
@@ -679,15 +1166,14 @@ void CTxPool::ListUnspent(const CTxPoolView& txPoolView, const CDestination& des
 
 bool CTxPool::FilterTx(const uint256& hashFork, CTxFilter& filter)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-
-    map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(hashFork);
-    if (it == mapPoolView.end())
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (!spFork)
     {
         return true;
     }
+    boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
 
-    const CPooledTxLinkSetByTxHash& idxTx = (*it).second.setTxLinkIndex.get<0>();
+    const CPooledTxLinkSetByTxHash& idxTx = spFork->view.setTxLinkIndex.get<0>();
     for (CPooledTxLinkSetByTxHash::const_iterator mi = idxTx.begin(); mi != idxTx.end(); ++mi)
     {
         if ((*mi).ptx && (filter.setDest.count((*mi).ptx->sendTo) || filter.setDest.count((*mi).ptx->destIn)))
@@ -706,17 +1192,22 @@ bool CTxPool::FilterTx(const uint256& hashFork, CTxFilter& filter)
 bool CTxPool::ArrangeBlockTx(const uint256& hashFork, const uint256& hashPrev, int64 nBlockTime, /*size_t nMaxSize, */
                              vector<CTransaction>& vtx, int64& nTotalTxFee)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-
-    auto it = mapTxCache.find(hashFork);
-    if (it == mapTxCache.end())
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (!spFork)
     {
         StdError("CTxPool", "ArrangeBlockTx: find hashFork failed");
         return false;
     }
-    CTxCache& cache = it->second;
+    boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
 
-    if (!cache.Retrieve(hashPrev, vtx))
+    // the pool view follows the last block of the fork, arrange from the current pool
+    if (spFork->view.hashLastBlock == hashPrev)
+    {
+        spFork->view.ArrangeBlockTx(vtx, nTotalTxFee, nBlockTime, MAX_BLOCK_TX_SIZE);
+        return true;
+    }
+
+    if (!spFork->cache.Retrieve(hashPrev, vtx))
     {
         StdError("CTxPool", "ArrangeBlockTx: find hashPrev in cache failed");
         return false;
@@ -730,16 +1221,12 @@ bool CTxPool::ArrangeBlockTx(const uint256& hashFork, const uint256& hashPrev, i
     return true;
 }
 
-void CTxPool::ArrangeBlockTx(const uint256& hashFork, int64 nBlockTime, const uint256& hashBlock, std::size_t nMaxSize,
-                             std::vector<CTransaction>& vtx, int64& nTotalTxFee, int nHeight)
-{
-    mapPoolView[hashFork].ArrangeBlockTx(vtx, nTotalTxFee, nBlockTime, nMaxSize);
-}
-
 bool CTxPool::FetchInputs(const uint256& hashFork, const CTransaction& tx, vector<CTxOut>& vUnspent)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    CTxPoolView& txView = mapPoolView[hashFork];
+    std::shared_ptr<CTxPoolFork> spFork = AddPoolFork(hashFork);
+    boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+    CTxPoolView& txView = spFork->view;
+
 
     vUnspent.resize(tx.vInput.size());
 
@@ -785,14 +1272,91 @@ bool CTxPool::FetchInputs(const uint256& hashFork, const CTransaction& tx, vecto
     return true;
 }
 
+void CTxPool::FillCompactBlock(const uint256& hashFork, const CCompactBlock& compact,
+                               vector<CTransaction>& vtx, vector<uint32>& vMissing)
+{
+    vtx.assign(compact.vShortId.size(), CTransaction());
+    vMissing.clear();
+
+    // an id carried twice or matched by two pooled txs is left to the peer
+    map<uint64, uint32> mapIndex;
+    set<uint32> setAmbiguous;
+    for (uint32 i = 0; i < compact.vShortId.size(); i++)
+    {
+        pair<map<uint64, uint32>::iterator, bool> ret = mapIndex.insert(make_pair(compact.vShortId[i], i));
+        if (!ret.second)
+        {
+            setAmbiguous.insert((*ret.first).second);
+            setAmbiguous.insert(i);
+        }
+    }
+
+    // the short id key is salted per block and sender, so the pooled txids are hashed again for
+    // every compact block. Only the txid copy and the final lookups are done under the fork lock.
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (spFork && !mapIndex.empty())
+    {
+        vector<uint256> vTxid;
+        {
+            boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+            vTxid.reserve(spFork->mapTx.size());
+            for (const auto& vd : spFork->mapTx)
+            {
+                vTxid.push_back(vd.first);
+            }
+        }
+
+        uint256 hashKey = compact.GetShortIdKey();
+        vector<uint256> vMatch(vtx.size());
+        for (const uint256& txid : vTxid)
+        {
+            map<uint64, uint32>::iterator it = mapIndex.find(CCompactBlock::GetShortId(hashKey, txid));
+            if (it != mapIndex.end())
+            {
+                if (vMatch[(*it).second] != 0)
+                {
+                    setAmbiguous.insert((*it).second);
+                }
+                else
+                {
+                    vMatch[(*it).second] = txid;
+                }
+            }
+        }
+
+        // a tx gone from the pool in between is simply missing
+        boost::shared_lock<boost::shared_mutex> rlock(spFork->rwFork);
+        for (uint32 i = 0; i < vMatch.size(); i++)
+        {
+            if (vMatch[i] != 0 && !setAmbiguous.count(i))
+            {
+                map<uint256, CPooledTx>::const_iterator mi = spFork->mapTx.find(vMatch[i]);
+                if (mi != spFork->mapTx.end())
+                {
+                    vtx[i] = (*mi).second;
+                }
+            }
+        }
+    }
+
+    for (uint32 i = 0; i < vtx.size(); i++)
+    {
+        if (vtx[i].IsNull() || setAmbiguous.count(i))
+        {
+            vMissing.push_back(i);
+        }
+    }
+}
+
 bool CTxPool::SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChange& change)
 {
     change.hashFork = update.hashFork;
 
-    boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
+    std::shared_ptr<CTxPoolFork> spFork = AddPoolFork(update.hashFork);
+    boost::unique_lock<boost::shared_mutex> wlock(spFork->rwFork);
 
     CTxPoolView viewInvolvedTx;
-    CTxPoolView& txView = mapPoolView[update.hashFork];
+    CTxPoolView& txView = spFork->view;
 
     //int nHeight = update.nLastBlockHeight - update.vBlockAddNew.size() + 1;
     for (const CBlockEx& block : boost::adaptors::reverse(update.vBlockAddNew))
@@ -812,7 +1376,7 @@ bool CTxPool::SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChang
                 if (txView.Exists(txid))
                 {
                     txView.Remove(txid);
-                    mapTx.erase(txid);
+                    ErasePooledTx(*spFork, txid);
                     change.mapTxUpdate.insert(make_pair(txid, nBlockHeight));
                 }
                 else
@@ -855,7 +1419,7 @@ bool CTxPool::SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChang
 
                     txView.GetSpent(CTxOutPoint(txid, 0), spent0);
                     txView.GetSpent(CTxOutPoint(txid, 1), spent1);
-                    if (AddNew(txView, txid, tx, update.hashFork, update.nLastBlockHeight, update.hashLastBlock) == OK)
+                    if (AddNew(*spFork, txid, tx, update.hashFork, update.nLastBlockHeight, update.hashLastBlock) == OK)
                     {
                         if (spent0 != 0)
                             txView.SetSpent(CTxOutPoint(txid, 0), spent0);
@@ -887,76 +1451,45 @@ bool CTxPool::SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChang
     change.vTxRemove.reserve(idxInvolvedTx.size() + vTxRemove.size());
     for (const auto& txseq : boost::adaptors::reverse(idxInvolvedTx))
     {
-        map<uint256, CPooledTx>::iterator it = mapTx.find(txseq.hashTX);
-        if (it != mapTx.end())
+        map<uint256, CPooledTx>::iterator it = spFork->mapTx.find(txseq.hashTX);
+        if (it != spFork->mapTx.end())
         {
             change.vTxRemove.push_back(make_pair(txseq.hashTX, (*it).second.vInput));
-            mapTx.erase(it);
+            ErasePooledTx(*spFork, txseq.hashTX);
         }
     }
     change.vTxRemove.insert(change.vTxRemove.end(), vTxRemove.rbegin(), vTxRemove.rend());
 
     // ArrangeBlockTx to cache
-    if (mapTxCache.find(update.hashFork) == mapTxCache.end())
-    {
-        mapTxCache.insert(std::make_pair(update.hashFork, CTxCache(CACHE_HEIGHT_INTERVAL)));
-    }
-
     std::vector<CTransaction> vtx;
     int64 nTotalFee = 0;
     const CBlockEx& lastBlockEx = update.vBlockAddNew[0];
-    ArrangeBlockTx(update.hashFork, lastBlockEx.GetBlockTime(), lastBlockEx.GetHash(), MAX_BLOCK_TX_SIZE, vtx, nTotalFee, lastBlockEx.GetBlockHeight() + 1);
+    txView.ArrangeBlockTx(vtx, nTotalFee, lastBlockEx.GetBlockTime(), MAX_BLOCK_TX_SIZE);
+    spFork->cache.AddNew(lastBlockEx.GetHash(), vtx);
 
-    auto& cache = mapTxCache[update.hashFork];
-    cache.AddNew(lastBlockEx.GetHash(), vtx);
-
-    mapPoolView[update.hashFork].SetLastBlock(lastBlockEx.GetHash(), lastBlockEx.GetBlockTime());
+    txView.SetLastBlock(lastBlockEx.GetHash(), lastBlockEx.GetBlockTime());
     return true;
 }
 
 // no lock
 int64 CTxPool::GetDestAmount(const CDestination& dest)
 {
-    int64 nAmount = 0;
-    for (const auto& kv : mapTx)
-    {
-        const CPooledTx& tx = kv.second;
-        if (tx.sendTo == dest)
-        {
-            return tx.nAmount;
-        }
-        if (tx.destIn == dest)
-        {
-            nAmount -= (tx.nAmount + tx.nTxFee);
-        }
-    }
-    return nAmount;
+    return destIndex.GetAmount(dest);
 }
 
 // no lock
 bool CTxPool::VerifyPledgeTx(const CDestination& dest)
 {
-    for (const auto& kv : mapTx)
-    {
-        const CPooledTx& tx = kv.second;
-        if (tx.sendTo == dest)
-        {
-            return false;
-        }
-    }
-    return true;
+    return !destIndex.ExistsSendTo(dest);
 }
 
 int64 CTxPool::GetDestAmountLock(const CDestination& dest)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-    return GetDestAmount(dest);
+    return destIndex.GetAmount(dest);
 }
 
 bool CTxPool::LoadData()
 {
-    boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
-
     vector<pair<uint256, pair<uint256, CAssembledTx>>> vTx;
     if (!datTxPool.Load(vTx))
     {
@@ -969,8 +1502,9 @@ bool CTxPool::LoadData()
         const uint256& hashFork = vTx[i].first;
         const uint256& txid = vTx[i].second.first;
         const CAssembledTx& tx = vTx[i].second.second;
-        map<uint256, CPooledTx>::iterator mi = mapTx.insert(make_pair(txid, CPooledTx(tx, GetSequenceNumber()))).first;
-        mapPoolView[hashFork].AddNew(txid, (*mi).second);
+        std::shared_ptr<CTxPoolFork> spFork = AddPoolFork(hashFork);
+        boost::unique_lock<boost::shared_mutex> wlock(spFork->rwFork);
+        spFork->view.AddNew(txid, AddPooledTx(*spFork, hashFork, txid, CPooledTx(tx, GetSequenceNumber())));
     }
 
     std::map<uint256, CForkStatus> mapForkStatus;
@@ -979,7 +1513,6 @@ bool CTxPool::LoadData()
     for (const auto& kv : mapForkStatus)
     {
         const uint256& hashFork = kv.first;
-        mapTxCache.insert(make_pair(hashFork, CTxCache(CACHE_HEIGHT_INTERVAL)));
 
         uint256 hashBlock;
         int nHeight = 0;
@@ -990,27 +1523,35 @@ bool CTxPool::LoadData()
             return false;
         }
 
+        std::shared_ptr<CTxPoolFork> spFork = AddPoolFork(hashFork);
+        boost::unique_lock<boost::shared_mutex> wlock(spFork->rwFork);
+
         std::vector<CTransaction> vtx;
         int64 nTotalFee = 0;
-        ArrangeBlockTx(hashFork, nTime, hashBlock, MAX_BLOCK_SIZE, vtx, nTotalFee, nHeight + 1);
-        mapTxCache[hashFork].AddNew(hashBlock, vtx);
+        spFork->view.ArrangeBlockTx(vtx, nTotalFee, nTime, MAX_BLOCK_SIZE);
+        spFork->cache.AddNew(hashBlock, vtx);
 
-        mapPoolView[hashFork].SetLastBlock(hashBlock, nTime);
+        spFork->view.SetLastBlock(hashBlock, nTime);
     }
     return true;
 }
 
 bool CTxPool::SaveData()
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+    vector<pair<uint256, std::shared_ptr<CTxPoolFork>>> vPoolFork;
+    {
+        boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+        vPoolFork.assign(mapPoolFork.begin(), mapPoolFork.end());
+    }
 
     map<size_t, pair<uint256, pair<uint256, CAssembledTx>>> mapSortTx;
-    for (map<uint256, CTxPoolView>::iterator it = mapPoolView.begin(); it != mapPoolView.end(); ++it)
+    for (const auto& kv : vPoolFork)
     {
-        CPooledTxLinkSetByTxHash& idxTx = (*it).second.setTxLinkIndex.get<0>();
-        for (CPooledTxLinkSetByTxHash::iterator mi = idxTx.begin(); mi != idxTx.end(); ++mi)
+        boost::shared_lock<boost::shared_mutex> rlock(kv.second->rwFork);
+        const CPooledTxLinkSetByTxHash& idxTx = kv.second->view.setTxLinkIndex.get<0>();
+        for (CPooledTxLinkSetByTxHash::const_iterator mi = idxTx.begin(); mi != idxTx.end(); ++mi)
         {
-            mapSortTx[(*mi).nSequenceNumber] = make_pair((*it).first, make_pair((*mi).hashTX, static_cast<CAssembledTx&>(*(*mi).ptx)));
+            mapSortTx[(*mi).nSequenceNumber] = make_pair(kv.first, make_pair((*mi).hashTX, static_cast<CAssembledTx&>(*(*mi).ptx)));
         }
     }
 
@@ -1025,8 +1566,10 @@ bool CTxPool::SaveData()
     return datTxPool.Save(vTx);
 }
 
-Errno CTxPool::AddNew(CTxPoolView& txView, const uint256& txid, const CTransaction& tx, const uint256& hashFork, int nForkHeight, const uint256& hashLastBlock)
+Errno CTxPool::AddNew(CTxPoolFork& fork, const uint256& txid, const CTransaction& tx, const uint256& hashFork, int nForkHeight, const uint256& hashLastBlock,
+                      const CDestination& destSigned)
 {
+    CTxPoolView& txView = fork.view;
     vector<CTxOut> vPrevOutput;
     vPrevOutput.resize(tx.vInput.size());
     for (int i = 0; i < tx.vInput.size(); i++)
@@ -1059,16 +1602,25 @@ Errno CTxPool::AddNew(CTxPoolView& txView, const uint256& txid, const CTransacti
         nValueIn += vPrevOutput[i].nAmount;
     }
 
-    Errno err = pCoreProtocol->VerifyTransaction(tx, vPrevOutput, nForkHeight, hashLastBlock, hashFork);
+    Errno err;
+    if (!destSigned.IsNull() && destSigned == vPrevOutput[0].destTo)
+    {
+        err = pCoreProtocol->VerifyTransactionContext(tx, vPrevOutput, nForkHeight, hashLastBlock, hashFork);
+    }
+    else
+    {
+        err = pCoreProtocol->VerifyTransaction(tx, vPrevOutput, nForkHeight, hashLastBlock, hashFork);
+    }
     if (err != OK)
     {
         StdTrace("CTxPool", "AddNew: VerifyTransaction fail, txid: %s", txid.GetHex().c_str());
         return err;
     }
 
+
     CDestination destIn = vPrevOutput[0].destTo;
-    map<uint256, CPooledTx>::iterator mi = mapTx.insert(make_pair(txid, CPooledTx(tx, -1, GetSequenceNumber(), destIn, nValueIn))).first;
-    if (!txView.AddNew(txid, (*mi).second))
+    CPooledTx& txPooled = AddPooledTx(fork, hashFork, txid, CPooledTx(tx, -1, GetSequenceNumber(), destIn, nValueIn));
+    if (!txView.AddNew(txid, txPooled))
     {
         StdTrace("CTxPool", "AddNew: txView AddNew fail, txid: %s", txid.GetHex().c_str());
         return ERR_NOT_FOUND;
@@ -1076,25 +1628,16 @@ Errno CTxPool::AddNew(CTxPoolView& txView, const uint256& txid, const CTransacti
     return OK;
 }
 
-void CTxPool::RemoveTx(const uint256& txid)
+void CTxPool::RemoveTx(CTxPoolFork& fork, const uint256& txid)
 {
-    map<uint256, CPooledTx>::iterator it = mapTx.find(txid);
-    if (it == mapTx.end())
+    map<uint256, CPooledTx>::iterator it = fork.mapTx.find(txid);
+    if (it == fork.mapTx.end())
     {
         StdError("CTxPool", "RemoveTx: find fail, txid: %s", txid.GetHex().c_str());
         return;
     }
 
-    //CPooledTx& tx = (*it).second;
-    uint256 hashFork;
-    int nHeight;
-    if (!pBlockChain->GetBlockLocation(/*tx.hashAnchor*/ pCoreProtocol->GetGenesisBlockHash(), hashFork, nHeight))
-    {
-        StdError("CTxPool", "RemoveTx: GetBlockLocation fail, txid: %s", txid.GetHex().c_str());
-        return;
-    }
-
-    CTxPoolView& txView = mapPoolView[hashFork];
+    CTxPoolView& txView = fork.view;
     txView.Remove(txid);
 
     CTxPoolView viewInvolvedTx;
@@ -1104,9 +1647,59 @@ void CTxPool::RemoveTx(const uint256& txid)
     const CPooledTxLinkSetBySequenceNumber& idxTx = viewInvolvedTx.setTxLinkIndex.get<1>();
     for (CPooledTxLinkSetBySequenceNumber::const_iterator mi = idxTx.begin(); mi != idxTx.end(); ++mi)
     {
-        mapTx.erase(mi->hashTX);
+        ErasePooledTx(fork, mi->hashTX);
     }
+    ErasePooledTx(fork, txid);
     StdTrace("CTxPool", "RemoveTx success, txid: %s", txid.GetHex().c_str());
 }
 
+std::shared_ptr<CTxPoolFork> CTxPool::GetPoolFork(const uint256& hashFork) const
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+    map<uint256, std::shared_ptr<CTxPoolFork>>::const_iterator it = mapPoolFork.find(hashFork);
+    if (it != mapPoolFork.end())
+    {
+        return it->second;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<CTxPoolFork> CTxPool::AddPoolFork(const uint256& hashFork)
+{
+    std::shared_ptr<CTxPoolFork> spFork = GetPoolFork(hashFork);
+    if (!spFork)
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
+        std::shared_ptr<CTxPoolFork>& spNew = mapPoolFork[hashFork];
+        if (!spNew)
+        {
+            spNew = std::make_shared<CTxPoolFork>();
+        }
+        spFork = spNew;
+    }
+    return spFork;
+}
+
+CPooledTx& CTxPool::AddPooledTx(CTxPoolFork& fork, const uint256& hashFork, const uint256& txid, const CPooledTx& tx)
+{
+    pair<map<uint256, CPooledTx>::iterator, bool> ret = fork.mapTx.insert(make_pair(txid, tx));
+    if (ret.second)
+    {
+        txIndex.Add(txid, hashFork);
+        destIndex.Add(txid, ret.first->second);
+    }
+    return ret.first->second;
+}
+
+void CTxPool::ErasePooledTx(CTxPoolFork& fork, const uint256& txid)
+{
+    map<uint256, CPooledTx>::iterator it = fork.mapTx.find(txid);
+    if (it != fork.mapTx.end())
+    {
+        txIndex.Remove(txid);
+        destIndex.Remove(txid, it->second);
+        fork.mapTx.erase(it);
+    }
+}
+
 } // namespace minemon
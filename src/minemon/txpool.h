@@ -5,6 +5,9 @@
 #ifndef MINEMON_TXPOOL_H
 #define MINEMON_TXPOOL_H
 
+#include <atomic>
+#include <memory>
+
 #include "base.h"
 #include "txpooldata.h"
 #include "util.h"
@@ -52,34 +55,46 @@ class CPooledTxLink
 {
 public:
     CPooledTxLink()
-      : nSequenceNumber(0), ptx(nullptr) {}
+      : nSequenceNumber(0), nPackageFee(0), nPackageSize(0), ptx(nullptr) {}
     CPooledTxLink(CPooledTx* ptxin)
       : ptx(ptxin)
     {
         hashTX = ptx->GetHash();
         nSequenceNumber = ptx->nSequenceNumber;
         nType = ptx->nType;
+        nPackageFee = ptx->nTxFee;
+        nPackageSize = ptx->nSerializeSize;
     }
 
 public:
     uint256 hashTX;
     uint64 nSequenceNumber;
     uint16 nType;
+    // fee and size of the tx with its pooled ancestors
+    int64 nPackageFee;
+    std::size_t nPackageSize;
     CPooledTx* ptx;
 };
 
+// higher package fee rate first, older tx first on the same rate
 class ComparePooledTxLinkByTxScore
 {
 public:
     bool operator()(const CPooledTxLink& a, const CPooledTxLink& b) const
     {
-        return GetScore(a) > GetScore(b);
+        double fScoreA = GetScore(a);
+        double fScoreB = GetScore(b);
+        if (fScoreA != fScoreB)
+        {
+            return fScoreA > fScoreB;
+        }
+        return a.nSequenceNumber < b.nSequenceNumber;
     }
 
 private:
     double GetScore(const CPooledTxLink& link) const
     {
-        return (double)((double)link.nType + (double)(1.0f / (double)(link.nSequenceNumber + 1)));
+        return (double)link.nPackageFee / (double)(link.nPackageSize + 1);
     }
 };
 
@@ -150,6 +165,9 @@ public:
     };
 
 public:
+    CTxPoolView()
+      : nLastBlockTime(0), fTemplateValid(false), fTemplateComplete(false), nTemplateTime(0), nTemplateNextTime(0),
+        nTemplateMaxSize(0), nTemplateSize(0), nTemplateTxFee(0) {}
     std::size_t Count() const
     {
         return setTxLinkIndex.size();
@@ -236,13 +254,16 @@ public:
             }
             xengine::StdTrace("CTxPoolView", "Remove: setTxLinkIndex erase, txid: %s, seq: %ld",
                               txid.GetHex().c_str(), pTx->nSequenceNumber);
+            RemoveTemplateTx(txid, *pTx);
             setTxLinkIndex.erase(txid);
+            UpdateDescendantPackage(txid);
         }
     }
     void Clear()
     {
         setTxLinkIndex.clear();
         mapSpent.clear();
+        fTemplateValid = false;
     }
     void SetLastBlock(const uint256& hash, int64 nTime)
     {
@@ -276,14 +297,43 @@ public:
     void ArrangeBlockTx(std::vector<CTransaction>& vtx, int64& nTotalTxFee, int64 nBlockTime, std::size_t nMaxSize);
 
 private:
+    enum
+    {
+        // ancestors counted into a package score, and descendants rescored after a change
+        MAX_PACKAGE_TX_COUNT = 32,
+        // packages that may not fit before the arrangement gives up
+        MAX_ARRANGE_FAILURE = 1000
+    };
     void GetAllPrevTxLink(const CPooledTxLink& link, std::vector<CPooledTxLink>& prevLinks, CPooledCertTxLinkSet& setCertTxLink);
-    bool AddArrangeBlockTx(std::vector<CTransaction>& vtx, int64& nTotalTxFee, int64 nBlockTime, std::size_t nMaxSize, std::size_t& nTotalSize, std::set<uint256>& setUnTx, CPooledTx* ptx);
+    void GetPackageScore(const CPooledTx& tx, int64& nPackageFee, std::size_t& nPackageSize);
+    void UpdateDescendantPackage(const uint256& txid);
+    bool GetArrangePackage(CPooledTx* ptx, int64 nBlockTime, const std::set<uint256>& setArranged, std::set<uint256>& setUnTx,
+                           std::vector<CPooledTx*>& vPackage, int64& nNextTxTime);
+    void AddTemplateTx(const uint256& txid, const CPooledTx& tx);
+    void RemoveTemplateTx(const uint256& txid, const CPooledTx& tx);
+    void PackTemplate();
 
 public:
     CPooledTxLinkSet setTxLinkIndex;
     std::map<CTxOutPoint, CSpent> mapSpent;
     uint256 hashLastBlock;
     int64 nLastBlockTime;
+
+protected:
+    /* The last arranged block template, reused for a block time before the earliest tx it
+       left out for being too new. While it holds every due tx, added txs are appended and
+       removed ones evicted (packed lazily), once the size limit cut it short it is rebuilt
+       after any change. Patched under the exclusive fork lock, read under mtxTemplate. */
+    boost::mutex mtxTemplate;
+    bool fTemplateValid;
+    bool fTemplateComplete;
+    int64 nTemplateTime;
+    int64 nTemplateNextTime;
+    std::size_t nTemplateMaxSize;
+    std::size_t nTemplateSize;
+    std::vector<std::pair<uint256, CTransaction>> vTemplateTx;
+    std::set<uint256> setTemplateTx;
+    int64 nTemplateTxFee;
 };
 
 class CTxCache
@@ -376,6 +426,89 @@ protected:
     std::map<CDestination, std::map<uint256, int64>> mapCertTxDest;
 };
 
+/* The pool of a fork, a push or a block update locks only the fork it
+   works on. */
+class CTxPoolFork
+{
+public:
+    CTxPoolFork()
+      : cache(CACHE_HEIGHT_INTERVAL) {}
+
+public:
+    mutable boost::shared_mutex rwFork;
+    CTxPoolView view;
+    std::map<uint256, CPooledTx> mapTx;
+    CTxCache cache;
+};
+
+/* The fork of every pooled tx, split into shards by the low word of the txid.
+   A counter per filter bucket lets Exists answer a miss without a lock. */
+class CTxPoolTxIndex
+{
+    class CShard
+    {
+    public:
+        boost::mutex mtxShard;
+        std::map<uint256, uint256> mapTxFork;
+    };
+
+public:
+    CTxPoolTxIndex();
+    bool Exists(const uint256& txid) const;
+    bool GetFork(const uint256& txid, uint256& hashFork) const;
+    void Add(const uint256& txid, const uint256& hashFork);
+    void Remove(const uint256& txid);
+    void Clear();
+
+protected:
+    enum
+    {
+        SHARD_COUNT = 16,
+        FILTER_SIZE = 0x10000
+    };
+    CShard& GetShard(const uint256& txid) const
+    {
+        return vShard[txid.Get32(0) % SHARD_COUNT];
+    }
+    std::atomic<uint32>& GetFilter(const uint256& txid) const
+    {
+        return vFilter[txid.Get32(1) % FILTER_SIZE];
+    }
+
+protected:
+    mutable CShard vShard[SHARD_COUNT];
+    mutable std::atomic<uint32> vFilter[FILTER_SIZE];
+};
+
+/* Pooled amounts by destination, read by the tx verification while the
+   fork of the tx is locked. */
+class CTxPoolDestIndex
+{
+    class CDestAmount
+    {
+    public:
+        CDestAmount()
+          : nSpentAmount(0), nSpentCount(0) {}
+
+    public:
+        std::map<uint256, int64> mapSendTo;
+        int64 nSpentAmount;
+        std::size_t nSpentCount;
+    };
+
+public:
+    void Add(const uint256& txid, const CPooledTx& tx);
+    void Remove(const uint256& txid, const CPooledTx& tx);
+    // amount of the first tx to dest, otherwise the negative amount spent by dest
+    int64 GetAmount(const CDestination& dest) const;
+    bool ExistsSendTo(const CDestination& dest) const;
+    void Clear();
+
+protected:
+    mutable boost::mutex mtxDest;
+    std::map<CDestination, CDestAmount> mapDest;
+};
+
 class CTxPool : public ITxPool
 {
 public:
@@ -385,6 +518,9 @@ public:
     void Clear() override;
     std::size_t Count(const uint256& fork) const override;
     Errno Push(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn) override;
+    // validate and check the signatures of the txs in parallel, then add them in order under one fork lock
+    void Push(const std::vector<CTransaction>& vtx, uint256& hashFork, std::vector<Errno>& vErr,
+              std::vector<CDestination>& vDestIn, std::vector<int64>& vValueIn) override;
     void Pop(const uint256& txid) override;
     bool Get(const uint256& txid, CTransaction& tx) const override;
     bool Get(const uint256& txid, CAssembledTx& tx) const override;
@@ -396,6 +532,8 @@ public:
     bool ArrangeBlockTx(const uint256& hashFork, const uint256& hashPrev, int64 nBlockTime, /*std::size_t nMaxSize, */
                         std::vector<CTransaction>& vtx, int64& nTotalTxFee) override;
     bool FetchInputs(const uint256& hashFork, const CTransaction& tx, std::vector<CTxOut>& vUnspent) override;
+    void FillCompactBlock(const uint256& hashFork, const CCompactBlock& compact,
+                          std::vector<CTransaction>& vtx, std::vector<uint32>& vMissing) override;
     bool SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChange& change) override;
     int64 GetDestAmount(const CDestination& dest) override;
     bool VerifyPledgeTx(const CDestination& dest) override;
@@ -408,30 +546,32 @@ protected:
     void HandleHalt() override;
     bool LoadData();
     bool SaveData();
-    Errno AddNew(CTxPoolView& txView, const uint256& txid, const CTransaction& tx, const uint256& hashFork, int nForkHeight, const uint256& hashLastBlock);
-    void RemoveTx(const uint256& txid);
+    // destSigned is the input owner the signature has been verified against, if any
+    Errno AddNew(CTxPoolFork& fork, const uint256& txid, const CTransaction& tx, const uint256& hashFork, int nForkHeight, const uint256& hashLastBlock,
+                 const CDestination& destSigned = CDestination());
+    void RemoveTx(CTxPoolFork& fork, const uint256& txid);
     uint64 GetSequenceNumber()
     {
-        if (mapTx.empty())
-        {
-            nLastSequenceNumber = 0;
-        }
         return ((++nLastSequenceNumber) << 24);
     }
-    void ArrangeBlockTx(const uint256& hashFork, int64 nBlockTime, const uint256& hashBlock, std::size_t nMaxSize,
-                        std::vector<CTransaction>& vtx, int64& nTotalTxFee, int nHeight);
+    std::shared_ptr<CTxPoolFork> GetPoolFork(const uint256& hashFork) const;
+    std::shared_ptr<CTxPoolFork> AddPoolFork(const uint256& hashFork);
+    CPooledTx& AddPooledTx(CTxPoolFork& fork, const uint256& hashFork, const uint256& txid, const CPooledTx& tx);
+    void ErasePooledTx(CTxPoolFork& fork, const uint256& txid);
 
     void ListUnspent(const CTxPoolView& txPoolView, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent);
 
 protected:
     storage::CTxPoolData datTxPool;
+    // guards mapPoolFork only, the fork pools have their own locks
     mutable boost::shared_mutex rwAccess;
     ICoreProtocol* pCoreProtocol;
     IBlockChain* pBlockChain;
-    std::map<uint256, CTxPoolView> mapPoolView;
-    std::map<uint256, CPooledTx> mapTx;
-    uint64 nLastSequenceNumber;
-    std::map<uint256, CTxCache> mapTxCache;
+    std::map<uint256, std::shared_ptr<CTxPoolFork>> mapPoolFork;
+    CTxPoolTxIndex txIndex;
+    CTxPoolDestIndex destIndex;
+    std::atomic<uint64> nLastSequenceNumber;
+    xengine::CWorkerPool poolVerify;
     //CCertTxDestCache certTxDest;
 };
 
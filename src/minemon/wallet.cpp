@@ -16,8 +16,91 @@ namespace minemon
 {
 
 #define MAX_TXIN_SELECTIONS 128
+#define MAX_SYNC_SCAN_RETRY 3
 //#define MAX_SIGNATURE_SIZE 2048
 
+//////////////////////////////
+// CWalletCoins
+
+int64 CWalletCoins::SelectCoins(int64 nTxTime, int64 nTargetValue, size_t nMaxInput, vector<CTxOutPoint>& vCoins) const
+{
+    // a coin newer than the tx can not be spent by it
+    int64 nValueRet = 0;
+    if (nTargetValue < 0)
+    {
+        for (CValueIndex::const_reverse_iterator it = setValueCoins.rbegin(); it != setValueCoins.rend() && vCoins.size() < nMaxInput; ++it)
+        {
+            if (it->second.GetTxTime() <= nTxTime)
+            {
+                vCoins.push_back(it->second.GetTxOutPoint());
+                nValueRet += it->first;
+            }
+        }
+        return nValueRet;
+    }
+
+    CValueIndex::const_iterator itBound = setValueCoins.lower_bound(make_pair(nTargetValue, CWalletTxOut()));
+    for (CValueIndex::const_iterator it = itBound; it != setValueCoins.end() && it->first == nTargetValue; ++it)
+    {
+        if (it->second.GetTxTime() <= nTxTime)
+        {
+            vCoins.push_back(it->second.GetTxOutPoint());
+            return nTargetValue;
+        }
+    }
+
+    // the largest coins below the target, until they cover it
+    multimap<int64, CWalletTxOut> mapValue;
+    int64 nTotalLower = 0;
+    for (CValueIndex::const_iterator it = itBound; it != setValueCoins.begin() && nTotalLower < nTargetValue && mapValue.size() < nMaxInput;)
+    {
+        --it;
+        if (it->second.GetTxTime() <= nTxTime)
+        {
+            mapValue.insert(*it);
+            nTotalLower += it->first;
+        }
+    }
+
+    if (nTotalLower >= nTargetValue)
+    {
+        while (nValueRet < nTargetValue)
+        {
+            int64 nShortage = nTargetValue - nValueRet;
+            multimap<int64, CWalletTxOut>::iterator it = mapValue.lower_bound(nShortage);
+            if (it == mapValue.end())
+            {
+                --it;
+            }
+            vCoins.push_back((*it).second.GetTxOutPoint());
+            nValueRet += (*it).first;
+            mapValue.erase(it);
+        }
+        return nValueRet;
+    }
+
+    // the lowest larger coin, plus a few of the smallest to sweep dust
+    CValueIndex::const_iterator itLarger = itBound;
+    while (itLarger != setValueCoins.end() && itLarger->second.GetTxTime() > nTxTime)
+    {
+        ++itLarger;
+    }
+    if (itLarger != setValueCoins.end())
+    {
+        vCoins.push_back(itLarger->second.GetTxOutPoint());
+        nValueRet += itLarger->first;
+        for (CValueIndex::const_iterator it = setValueCoins.begin(); it != itBound && vCoins.size() < 4; ++it)
+        {
+            if (it->second.GetTxTime() <= nTxTime)
+            {
+                vCoins.push_back(it->second.GetTxOutPoint());
+                nValueRet += it->first;
+            }
+        }
+    }
+    return nValueRet;
+}
+
 //////////////////////////////
 // CDBAddressWalker
 
@@ -98,6 +181,26 @@ class CWalletTxFilter : public CTxFilter
     CWallet* pWallet;
 };
 
+//////////////////////////////
+// CWalletTxCollector
+
+class CWalletTxCollector : public CTxFilter
+{
+public:
+    CWalletTxCollector(const set<CDestination>& setDestIn)
+      : CTxFilter(setDestIn)
+    {
+    }
+    bool FoundTx(const uint256& hashFork, const CAssembledTx& tx) override
+    {
+        vTx.push_back(make_pair(hashFork, tx));
+        return true;
+    }
+
+public:
+    vector<pair<uint256, CAssembledTx>> vTx;
+};
+
 //////////////////////////////
 // CInspectWtxFilter
 
@@ -214,8 +317,15 @@ void CWallet::HandleHalt()
     Clear();
 }
 
+bool CWallet::IsSyncedMine(const CDestination& dest)
+{
+    // a destination being synchronized gets its txs from the sync, in chain order
+    return (!setSyncDest.count(dest) && IsMine(dest));
+}
+
 bool CWallet::IsMine(const CDestination& dest)
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwKeyStore);
     crypto::CPubKey pubkey;
     CTemplateId nTemplateId;
     if (dest.GetPubKey(pubkey))
@@ -554,6 +664,12 @@ size_t CWallet::GetTxCount()
     return dbWallet.GetTxCount();
 }
 
+size_t CWallet::GetTxCount(const uint256& hashFork, const CDestination& dest)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwWalletTx);
+    return dbWallet.GetTxCount(hashFork, dest);
+}
+
 bool CWallet::ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, vector<CWalletTx>& vWalletTx)
 {
     boost::shared_lock<boost::shared_mutex> rlock(rwWalletTx);
@@ -563,28 +679,31 @@ bool CWallet::ListTx(const uint256& hashFork, const CDestination& dest, int nOff
 bool CWallet::GetBalance(const CDestination& dest, const uint256& hashFork, int nForkHeight, CWalletBalance& balance)
 {
     boost::shared_lock<boost::shared_mutex> rlock(rwWalletTx);
-    map<CDestination, CWalletUnspent>::iterator it = mapWalletUnspent.find(dest);
+    map<CDestination, CWalletUnspent>::const_iterator it = mapWalletUnspent.find(dest);
     if (it == mapWalletUnspent.end())
     {
         return false;
     }
-    CWalletCoins& coins = (*it).second.GetCoins(hashFork);
+    const CWalletCoins* pCoins = (*it).second.FindCoins(hashFork);
     balance.SetNull();
-    for (const CWalletTxOut& txout : coins.setCoins)
+    if (pCoins != nullptr)
     {
-        if (txout.IsLocked(nForkHeight))
+        for (const CWalletTxOut& txout : pCoins->setCoins)
         {
-            balance.nLocked += txout.GetAmount();
-        }
-        else
-        {
-            if (txout.GetDepth(nForkHeight) == 0)
+            if (txout.IsLocked(nForkHeight))
             {
-                balance.nUnconfirmed += txout.GetAmount();
+                balance.nLocked += txout.GetAmount();
+            }
+            else
+            {
+                if (txout.GetDepth(nForkHeight) == 0)
+                {
+                    balance.nUnconfirmed += txout.GetAmount();
+                }
             }
         }
+        balance.nAvailable = pCoins->nTotalValue - balance.nLocked;
     }
-    balance.nAvailable = coins.nTotalValue - balance.nLocked;
 
     if (dest.IsTemplate() && dest.GetTemplateId().GetType() == TEMPLATE_MINTREDEEM)
     {
@@ -648,15 +767,18 @@ bool CWallet::SignTransaction(const CDestination& destIn, CTransaction& tx, cons
     {
         tx.vchSig = move(vchSig);
     }
+    tx.ResetHash();
     return true;
 }
 
 bool CWallet::ArrangeInputs(const CDestination& destIn, const uint256& hashFork, int nForkHeight, CTransaction& tx)
 {
+    tx.ResetHash();
     tx.vInput.clear();
     vector<CTxOutPoint> vCoins;
     {
-        boost::shared_lock<boost::shared_mutex> rlock(rwWalletTx);
+        // selection moves expired timelock buckets into the value index
+        boost::unique_lock<boost::shared_mutex> wlock(rwWalletTx);
         int64 nValueIn = SelectCoins(destIn, hashFork, nForkHeight, tx.GetTxTime(), tx.nAmount, tx.nTxFee, MAX_TX_INPUT_COUNT, vCoins);
         if (nValueIn <= 0)
         {
@@ -679,14 +801,20 @@ bool CWallet::ArrangeInputs(const CDestination& destIn, const uint256& hashFork,
 
 bool CWallet::ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, std::vector<CTxUnspent>& vUnspent)
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwWalletTx);
     auto it = mapWalletUnspent.find(dest);
     if (it == mapWalletUnspent.end())
     {
         return false;
     }
-    auto& setCoins = it->second.GetCoins(hashFork).setCoins;
 
     vUnspent.clear();
+    const CWalletCoins* pCoins = it->second.FindCoins(hashFork);
+    if (pCoins == nullptr)
+    {
+        return true;
+    }
+    const std::set<CWalletTxOut>& setCoins = pCoins->setCoins;
     if (nMax > 0)
     {
         vUnspent.reserve(min(static_cast<size_t>(nMax), setCoins.size()));
@@ -851,44 +979,133 @@ bool CWallet::AddNewFork(const uint256& hashFork, const uint256& hashParent, int
 
 bool CWallet::ResynchronizeWalletTx()
 {
-    boost::unique_lock<boost::shared_mutex> wlock(rwWalletTx);
-
-    if (!ClearTx())
-    {
-        return false;
-    }
     set<CDestination> setDest;
     GetDestinations(setDest);
 
-    CWalletTxFilter txFilter(this, setDest);
-
-    return SyncWalletTx(txFilter);
+    return SyncDestTx(setDest, true);
 }
 
 bool CWallet::SynchronizeWalletTx(const CDestination& destNew)
 {
-    boost::unique_lock<boost::shared_mutex> wlock(rwWalletTx);
+    set<CDestination> setDest;
+    setDest.insert(destNew);
+
+    return SyncDestTx(setDest, false);
+}
+
+bool CWallet::SyncDestTx(const set<CDestination>& setDest, bool fClear)
+{
+    // The chain is scanned without the wallet lock, so block connection, relayed txs and
+    // wallet reads are not held up by it. Only the blocks connected since the scan, the
+    // pool and applying the found txs are done under the exclusive lock. Until then the
+    // live updates skip the destinations, so their txs are applied in chain order.
+    boost::unique_lock<boost::mutex> lockSync(mtxSync);
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwWalletTx);
+        setSyncDest = setDest;
+    }
 
-    CWalletTxFilter txFilter(this, destNew);
+    for (int nTry = 0; nTry < MAX_SYNC_SCAN_RETRY; nTry++)
+    {
+        vector<uint256> vFork;
+        {
+            boost::shared_lock<boost::shared_mutex> rlock(rwWalletTx);
+            if (!GetSyncFork(vFork))
+            {
+                break;
+            }
+        }
 
+        CWalletTxCollector collector(setDest);
+        map<uint256, uint256> mapLastBlock;
+        bool fScanned = true;
+        for (const uint256& hashFork : vFork)
+        {
+            if (!pBlockChain->FilterTx(hashFork, uint256(), collector, mapLastBlock[hashFork]))
+            {
+                StdLog("CWallet", "SyncDestTx: BlockChain filter fail, fork: %s.", hashFork.GetHex().c_str());
+                fScanned = false;
+                break;
+            }
+        }
+        if (!fScanned)
+        {
+            break;
+        }
+
+        boost::unique_lock<boost::shared_mutex> wlock(rwWalletTx);
+
+        // forks added during the scan are read whole, a reorganized fork restarts the scan
+        if (!GetSyncFork(vFork))
+        {
+            break;
+        }
+        bool fCaughtUp = true;
+        for (const uint256& hashFork : vFork)
+        {
+            uint256 hashLast;
+            if (!pBlockChain->FilterTx(hashFork, mapLastBlock[hashFork], collector, hashLast))
+            {
+                fCaughtUp = false;
+                break;
+            }
+        }
+        if (!fCaughtUp)
+        {
+            StdLog("CWallet", "SyncDestTx: Chain changed during the scan, retry: %d.", nTry + 1);
+            continue;
+        }
+
+        if (fClear && !ClearTx())
+        {
+            setSyncDest.clear();
+            return false;
+        }
+        setSyncDest.clear();
+        for (const auto& ftx : collector.vTx)
+        {
+            if (!UpdateTx(ftx.first, ftx.second))
+            {
+                StdLog("CWallet", "SyncDestTx: Update tx fail, txid: %s.", ftx.second.GetHash().GetHex().c_str());
+                return false;
+            }
+        }
+        CWalletTxFilter txFilter(this, setDest);
+        for (const uint256& hashFork : vFork)
+        {
+            if (!pTxPool->FilterTx(hashFork, txFilter))
+            {
+                StdLog("CWallet", "SyncDestTx: TxPool filter fail, fork: %s.", hashFork.GetHex().c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the scan failed or the chain kept changing under it, scan again under the lock
+    boost::unique_lock<boost::shared_mutex> wlock(rwWalletTx);
+    setSyncDest.clear();
+    if (fClear && !ClearTx())
+    {
+        return false;
+    }
+    CWalletTxFilter txFilter(this, setDest);
     return SyncWalletTx(txFilter);
 }
 
-bool CWallet::SyncWalletTx(CTxFilter& txFilter)
+bool CWallet::GetSyncFork(vector<uint256>& vFork)
 {
-    vector<uint256> vFork;
+    vFork.clear();
     vFork.reserve(mapFork.size());
 
     vFork.push_back(pCoreProtocol->GetGenesisBlockHash());
 
     for (int i = 0; i < vFork.size(); i++)
     {
-        const uint256& hashFork = vFork[i];
-
-        map<uint256, CWalletFork>::iterator it = mapFork.find(hashFork);
+        map<uint256, CWalletFork>::iterator it = mapFork.find(vFork[i]);
         if (it == mapFork.end())
         {
-            StdLog("CWallet", "SyncWalletTx: Find fork fail, fork: %s.", hashFork.GetHex().c_str());
+            StdLog("CWallet", "GetSyncFork: Find fork fail, fork: %s.", vFork[i].GetHex().c_str());
             return false;
         }
 
@@ -897,7 +1114,20 @@ bool CWallet::SyncWalletTx(CTxFilter& txFilter)
         {
             vFork.push_back((*mi).second);
         }
+    }
+    return true;
+}
+
+bool CWallet::SyncWalletTx(CTxFilter& txFilter)
+{
+    vector<uint256> vFork;
+    if (!GetSyncFork(vFork))
+    {
+        return false;
+    }
 
+    for (const uint256& hashFork : vFork)
+    {
         if (!pBlockChain->FilterTx(hashFork, txFilter))
         {
             StdLog("CWallet", "SyncWalletTx: BlockChain filter fail, fork: %s.", hashFork.GetHex().c_str());
@@ -1279,8 +1509,8 @@ bool CWallet::SynchronizeTxSet(const CTxSetChange& change)
     map<int, vector<uint256>> mapPreFork;
     for (const CAssembledTx& tx : change.vTxAddNew)
     {
-        bool fIsMine = IsMine(tx.sendTo);
-        bool fFromMe = IsMine(tx.destIn);
+        bool fIsMine = IsSyncedMine(tx.sendTo);
+        bool fFromMe = IsSyncedMine(tx.destIn);
         if (fFromMe || fIsMine)
         {
             uint256 txid = tx.GetHash();
@@ -1319,8 +1549,8 @@ bool CWallet::AddNewTx(const uint256& hashFork, const CAssembledTx& tx)
 {
     boost::unique_lock<boost::shared_mutex> wlock(rwWalletTx);
 
-    bool fIsMine = IsMine(tx.sendTo);
-    bool fFromMe = IsMine(tx.destIn);
+    bool fIsMine = IsSyncedMine(tx.sendTo);
+    bool fFromMe = IsSyncedMine(tx.destIn);
     if (fFromMe || fIsMine)
     {
         StdTrace("CWallet", "AddNewTx: txid: %s", tx.GetHash().GetHex().c_str());
@@ -1394,6 +1624,7 @@ int64 CWallet::SelectCoins(const CDestination& dest, const uint256& hashFork, co
     }
 
     CWalletCoins& walletCoins = it->second.GetCoins(hashFork);
+    int64 nLockedValue = walletCoins.Unlock(nForkHeight);
     int64 nTargetValue = 0;
     if (nAmount >= 0)
     {
@@ -1401,103 +1632,16 @@ int64 CWallet::SelectCoins(const CDestination& dest, const uint256& hashFork, co
     }
     else
     {
-        nTargetValue = walletCoins.nTotalValue;
+        nTargetValue = walletCoins.nTotalValue - nLockedValue;
     }
-    if (walletCoins.nTotalValue < nTargetValue)
+    if (walletCoins.nTotalValue - nLockedValue < nTargetValue)
     {
-        StdLog("CWallet", "Select Coins: Coins not enough, dest: %s, nTotalValue: %ld, nTargetValue: %ld.",
-               CAddress(dest).ToString().c_str(), walletCoins.nTotalValue, nTargetValue);
+        StdLog("CWallet", "Select Coins: Coins not enough, dest: %s, nTotalValue: %ld, nLockedValue: %ld, nTargetValue: %ld.",
+               CAddress(dest).ToString().c_str(), walletCoins.nTotalValue, nLockedValue, nTargetValue);
         return 0;
     }
 
-    pair<int64, CWalletTxOut> coinLowestLarger;
-    coinLowestLarger.first = std::numeric_limits<int64>::max();
-    int64 nTotalLower = 0;
-
-    multimap<int64, CWalletTxOut> mapValue;
-
-    for (const CWalletTxOut& out : walletCoins.setCoins)
-    {
-        if (out.IsLocked(nForkHeight) || out.GetTxTime() > nTxTime)
-        {
-            if (out.IsLocked(nForkHeight))
-            {
-                StdLog("CWallet", "Select Coins: unspent is locked, nForkHeight: %d, dest: %s.", nForkHeight, CAddress(dest).ToString().c_str());
-            }
-            else
-            {
-                StdLog("CWallet", "Select Coins: unspent time out, unspent time: %ld, tx time: %ld, unspent: [%d] %s, dest: %s.",
-                       out.GetTxTime(), nTxTime, out.n, out.spWalletTx->txid.GetHex().c_str(), CAddress(dest).ToString().c_str());
-            }
-            if (nAmount < 0)
-            {
-                nTargetValue -= out.GetAmount();
-            }
-            continue;
-        }
-
-        int64 nValue = out.GetAmount();
-        pair<int64, CWalletTxOut> coin = make_pair(nValue, out);
-
-        if (nValue == nTargetValue)
-        {
-            vCoins.push_back(out.GetTxOutPoint());
-            return nValue;
-        }
-        else if (nValue < nTargetValue)
-        {
-            mapValue.insert(coin);
-            nTotalLower += nValue;
-            if (nAmount < 0 && mapValue.size() >= nMaxInput)
-            {
-                nTargetValue = nTotalLower;
-                break;
-            }
-            while (mapValue.size() > nMaxInput)
-            {
-                multimap<int64, CWalletTxOut>::iterator mi = mapValue.begin();
-                nTotalLower -= (*mi).first;
-                mapValue.erase(mi);
-            }
-            if (nTotalLower >= nTargetValue)
-            {
-                break;
-            }
-        }
-        else if (nValue < coinLowestLarger.first)
-        {
-            coinLowestLarger = coin;
-        }
-    }
-
-    int64 nValueRet = 0;
-    if (nTotalLower >= nTargetValue)
-    {
-        while (nValueRet < nTargetValue)
-        {
-            int64 nShortage = nTargetValue - nValueRet;
-            multimap<int64, CWalletTxOut>::iterator it = mapValue.lower_bound(nShortage);
-            if (it == mapValue.end())
-            {
-                --it;
-            }
-            vCoins.push_back((*it).second.GetTxOutPoint());
-            nValueRet += (*it).first;
-            mapValue.erase(it);
-        }
-    }
-    else if (!coinLowestLarger.second.IsNull())
-    {
-        vCoins.push_back(coinLowestLarger.second.GetTxOutPoint());
-        nValueRet += coinLowestLarger.first;
-        multimap<int64, CWalletTxOut>::iterator it = mapValue.begin();
-        for (int i = 0; i < 3 && it != mapValue.end(); i++, ++it)
-        {
-            vCoins.push_back((*it).second.GetTxOutPoint());
-            nValueRet += (*it).first;
-        }
-    }
-    return nValueRet;
+    return walletCoins.SelectCoins(nTxTime, (nAmount < 0 ? -1 : nTargetValue), nMaxInput, vCoins);
 }
 
 bool CWallet::SignPubKey(const crypto::CPubKey& pubkey, const uint256& hash, vector<uint8>& vchSig, std::set<crypto::CPubKey>& setSignedKey)
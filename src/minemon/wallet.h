@@ -18,11 +18,17 @@ namespace minemon
 
 using namespace xengine;
 
+/* Coins of one address on one fork. Besides the plain set, spendable coins are
+   kept in value order and locked coins in buckets by lock height. Buckets are
+   moved into the value index once their height is reached, so a coin selection
+   touches only the coins it picks. */
 class CWalletCoins
 {
 public:
+    typedef std::set<std::pair<int64, CWalletTxOut>> CValueIndex;
+
     CWalletCoins()
-      : nTotalValue(0) {}
+      : nTotalValue(0), nLockedValue(0), nUnlockHeight(-1) {}
     void Push(const CWalletTxOut& out)
     {
         if (!out.IsNull())
@@ -31,6 +37,15 @@ public:
             {
                 nTotalValue += out.GetAmount();
                 out.AddRef();
+                if (out.GetLockUntil() != 0)
+                {
+                    mapLockedCoins[out.GetLockUntil()].insert(std::make_pair(out.GetAmount(), out));
+                    nLockedValue += out.GetAmount();
+                }
+                else
+                {
+                    setValueCoins.insert(std::make_pair(out.GetAmount(), out));
+                }
             }
         }
     }
@@ -42,13 +57,69 @@ public:
             {
                 nTotalValue -= out.GetAmount();
                 out.Release();
+                std::pair<int64, CWalletTxOut> coin = std::make_pair(out.GetAmount(), out);
+                std::map<uint32, CValueIndex>::iterator it = mapLockedCoins.find(out.GetLockUntil());
+                if (it != mapLockedCoins.end() && it->second.erase(coin))
+                {
+                    nLockedValue -= out.GetAmount();
+                    if (it->second.empty())
+                    {
+                        mapLockedCoins.erase(it);
+                    }
+                }
+                else
+                {
+                    setValueCoins.erase(coin);
+                }
             }
         }
     }
+    // moves the buckets expired at nHeight into the value index and returns the value
+    // still locked, a lower height after a rollback locks the coins again
+    int64 Unlock(int nHeight)
+    {
+        if (nHeight < nUnlockHeight)
+        {
+            for (CValueIndex::iterator it = setValueCoins.begin(); it != setValueCoins.end();)
+            {
+                uint32 nLockUntil = it->second.GetLockUntil();
+                if ((int64)nLockUntil > nHeight)
+                {
+                    mapLockedCoins[nLockUntil].insert(*it);
+                    nLockedValue += it->first;
+                    setValueCoins.erase(it++);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+        nUnlockHeight = nHeight;
+
+        std::map<uint32, CValueIndex>::iterator it = mapLockedCoins.begin();
+        while (it != mapLockedCoins.end() && (int64)it->first <= nHeight)
+        {
+            for (const auto& coin : it->second)
+            {
+                nLockedValue -= coin.first;
+            }
+            setValueCoins.insert(it->second.begin(), it->second.end());
+            mapLockedCoins.erase(it++);
+        }
+        return nLockedValue;
+    }
+    // picks unlocked coins not newer than nTxTime covering nTargetValue, all of them if
+    // nTargetValue < 0. Unlock is expected to have run for the current height.
+    int64 SelectCoins(int64 nTxTime, int64 nTargetValue, std::size_t nMaxInput, std::vector<CTxOutPoint>& vCoins) const;
 
 public:
     int64 nTotalValue;
+    int64 nLockedValue;
+    int nUnlockHeight;
     std::set<CWalletTxOut> setCoins;
+    CValueIndex setValueCoins;
+    std::map<uint32, CValueIndex> mapLockedCoins;
 };
 
 class CWalletUnspent
@@ -70,6 +141,12 @@ public:
     {
         return mapWalletCoins[hashFork];
     }
+    // for readers under the shared lock, nullptr if the fork has no coins
+    const CWalletCoins* FindCoins(const uint256& hashFork) const
+    {
+        std::map<uint256, CWalletCoins>::const_iterator it = mapWalletCoins.find(hashFork);
+        return (it != mapWalletCoins.end() ? &(*it).second : nullptr);
+    }
     void Dup(const uint256& hashFrom, const uint256& hashTo)
     {
         std::map<uint256, CWalletCoins>::iterator it = mapWalletCoins.find(hashFrom);
@@ -156,6 +233,7 @@ public:
     void GetDestinations(std::set<CDestination>& setDest);
     /* Wallet Tx */
     std::size_t GetTxCount() override;
+    std::size_t GetTxCount(const uint256& hashFork, const CDestination& dest) override;
     bool ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, std::vector<CWalletTx>& vWalletTx) override;
     bool GetBalance(const CDestination& dest, const uint256& hashFork, int nForkHeight, CWalletBalance& balance) override;
     bool SignTransaction(const CDestination& destIn, CTransaction& tx, const vector<uint8>& vchSendToData, const vector<uint8>& vchSignExtraData, const uint256& hashFork, const int32 nForkHeight, bool& fCompleted) override;
@@ -203,6 +281,9 @@ protected:
     void AddNewWalletTx(std::shared_ptr<CWalletTx>& spWalletTx, std::vector<uint256>& vFork);
     void RemoveWalletTx(std::shared_ptr<CWalletTx>& spWalletTx, const uint256& hashFork);
     bool SyncWalletTx(CTxFilter& txFilter);
+    bool SyncDestTx(const std::set<CDestination>& setDest, bool fClear);
+    bool GetSyncFork(std::vector<uint256>& vFork);
+    bool IsSyncedMine(const CDestination& dest);
     bool InspectWalletTx(int nCheckDepth);
     bool GetSendToDestRecorded(const CTransaction& tx, const std::vector<uint8>& vchSendToData, std::vector<uint8>& vchDestData);
 
@@ -219,6 +300,8 @@ protected:
     std::map<CDestination, CWalletUnspent> mapWalletUnspent;
     std::map<uint256, CWalletFork> mapFork;
     std::set<CTxOutPoint> setWalletTxOut;
+    boost::mutex mtxSync;
+    std::set<CDestination> setSyncDest;
 };
 
 // dummy wallet for on wallet server
@@ -304,6 +387,10 @@ public:
     {
         return 0;
     }
+    virtual std::size_t GetTxCount(const uint256& hashFork, const CDestination& dest) override
+    {
+        return 0;
+    }
     virtual bool ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, std::vector<CWalletTx>& vWalletTx) override
     {
         return true;
@@ -259,6 +259,16 @@ bool CBbPeer::HandshakeCompleted()
 bool CBbPeer::HandleReadCompleted()
 {
     CBufStream& ss = ReadStream();
+    if (ss.GetSize() >= PARALLEL_PAYLOAD_SIZE && pPeerNet->GetIOThreadCount() > 1)
+    {
+        std::shared_ptr<CBbPeerRecvWork> spWork(new CBbPeerRecvWork(hdrRecv));
+        spWork->ssPayload.Write(ss.GetData(), ss.GetSize());
+        pPeerNet->ExecuteParallel(boost::bind(&CBbPeer::HandleRecvWork, GetNonce(), spWork),
+                                  boost::bind(&CBbPeerNet::HandlePeerRecvWork, dynamic_cast<CBbPeerNet*>(pPeerNet),
+                                              GetNonce(), spWork));
+        return true;
+    }
+
     uint256 hash = minemon::crypto::CryptoHash(ss.GetData(), ss.GetSize());
     if (hdrRecv.nPayloadChecksum == hash.Get32())
     {
@@ -278,5 +288,68 @@ bool CBbPeer::HandleReadCompleted()
     return false;
 }
 
+void CBbPeer::HandleRecvWork(uint64 nNonce, std::shared_ptr<CBbPeerRecvWork> spWork)
+{
+    CBufStream& ss = spWork->ssPayload;
+    uint256 hash = minemon::crypto::CryptoHash(ss.GetData(), ss.GetSize());
+    if (spWork->hdr.nPayloadChecksum != hash.Get32())
+    {
+        return;
+    }
+    if (spWork->hdr.GetChannel() == PROTO_CHN_DATA)
+    {
+        int nCommand = spWork->hdr.GetCommand();
+        if (nCommand == PROTO_CMD_TX || nCommand == PROTO_CMD_BLOCK
+            || nCommand == PROTO_CMD_CMPCTBLOCK || nCommand == PROTO_CMD_BLOCKTXN)
+        {
+            try
+            {
+                uint256 hashFork;
+                ss >> hashFork;
+                spWork->pEvent = CBbPeerNet::DecodePeerData(nNonce, hashFork, nCommand, ss);
+            }
+            catch (exception& e)
+            {
+                StdError(__PRETTY_FUNCTION__, e.what());
+                return;
+            }
+        }
+    }
+    spWork->fValid = true;
+}
+
+bool CBbPeer::HandleRecvWorkCompleted(std::shared_ptr<CBbPeerRecvWork> spWork)
+{
+    if (!spWork->fValid)
+    {
+        return false;
+    }
+    try
+    {
+        CBbPeerNet* pBbPeerNet = dynamic_cast<CBbPeerNet*>(pPeerNet);
+        bool fRet = false;
+        if (spWork->pEvent != nullptr)
+        {
+            CEvent* pEvent = spWork->pEvent;
+            spWork->pEvent = nullptr;
+            fRet = pBbPeerNet->HandlePeerRecvData(this, pEvent);
+        }
+        else
+        {
+            fRet = pBbPeerNet->HandlePeerRecvMessage(this, spWork->hdr.GetChannel(), spWork->hdr.GetCommand(), spWork->ssPayload);
+        }
+        if (fRet)
+        {
+            Read(MESSAGE_HEADER_SIZE, boost::bind(&CBbPeer::HandleReadHeader, this));
+            return true;
+        }
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    return false;
+}
+
 } // namespace network
 } // namespace minemon
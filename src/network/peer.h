@@ -16,6 +16,28 @@ namespace minemon
 namespace network
 {
 
+/* Received payload handed to the io thread pool, the checksum and the
+   tx/block decoding run off the proc strand */
+class CBbPeerRecvWork
+{
+public:
+    CBbPeerRecvWork(const CPeerMessageHeader& hdrIn)
+      : hdr(hdrIn), fValid(false), pEvent(nullptr) {}
+    ~CBbPeerRecvWork()
+    {
+        if (pEvent != nullptr)
+        {
+            pEvent->Free();
+        }
+    }
+
+public:
+    CPeerMessageHeader hdr;
+    xengine::CBufStream ssPayload;
+    bool fValid;
+    xengine::CEvent* pEvent;
+};
+
 class CBbPeer : public xengine::CPeer
 {
 public:
@@ -35,8 +57,13 @@ public:
     void AskFor(const uint256& hashFork, const std::vector<CInv>& vInv);
     bool FetchAskFor(uint256& hashFork, CInv& inv);
     bool PingTimer(uint32 nTimerId) override;
+    bool HandleRecvWorkCompleted(std::shared_ptr<CBbPeerRecvWork> spWork);
 
 protected:
+    enum
+    {
+        PARALLEL_PAYLOAD_SIZE = 0x10000
+    };
     void SendHello();
     void SendHelloAck();
     void SendPing();
@@ -46,6 +73,7 @@ protected:
     virtual bool HandshakeCompleted();
     bool HandleReadHeader();
     bool HandleReadCompleted();
+    static void HandleRecvWork(uint64 nNonce, std::shared_ptr<CBbPeerRecvWork> spWork);
 
 public:
     int nVersion;
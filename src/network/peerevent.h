@@ -32,9 +32,48 @@ enum
     EVENT_PEER_BLOCK,
     EVENT_PEER_GETFAIL,
     EVENT_PEER_MSGRSP,
+    EVENT_PEER_CMPCTBLOCK,
+    EVENT_PEER_GETBLOCKTXN,
+    EVENT_PEER_BLOCKTXN,
+    EVENT_PEER_HEADERS,
     EVENT_PEER_MAX,
 };
 
+// the txs of a compact block the receiver could not find in its pool
+class CBlockTxnRequest
+{
+    friend class xengine::CStream;
+
+public:
+    uint256 hashBlock;
+    std::vector<uint32> vIndex;
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(vIndex, opt);
+    }
+};
+
+class CBlockTxn
+{
+    friend class xengine::CStream;
+
+public:
+    uint256 hashBlock;
+    std::vector<CTransaction> vtx;
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(vtx, opt);
+    }
+};
+
 template <int type, typename L, typename D>
 class CEventPeerData : public xengine::CEvent
 {
@@ -96,6 +135,10 @@ typedef TYPE_PEERDATAEVENT(EVENT_PEER_TX, CTransaction) CEventPeerTx;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK, CBlock) CEventPeerBlock;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_GETFAIL, std::vector<CInv>) CEventPeerGetFail;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_MSGRSP, CMsgRsp) CEventPeerMsgRsp;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_CMPCTBLOCK, CCompactBlock) CEventPeerCompactBlock;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_GETBLOCKTXN, CBlockTxnRequest) CEventPeerGetBlockTxn;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCKTXN, CBlockTxn) CEventPeerBlockTxn;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_HEADERS, std::vector<CBlock>) CEventPeerHeaders;
 
 class CBbPeerEventListener : virtual public xengine::CEventListener
 {
@@ -112,6 +155,10 @@ public:
     DECLARE_EVENTHANDLER(CEventPeerBlock);
     DECLARE_EVENTHANDLER(CEventPeerGetFail);
     DECLARE_EVENTHANDLER(CEventPeerMsgRsp);
+    DECLARE_EVENTHANDLER(CEventPeerCompactBlock);
+    DECLARE_EVENTHANDLER(CEventPeerGetBlockTxn);
+    DECLARE_EVENTHANDLER(CEventPeerBlockTxn);
+    DECLARE_EVENTHANDLER(CEventPeerHeaders);
 };
 
 } // namespace network
@@ -132,6 +132,46 @@ bool CBbPeerNet::HandleEvent(CEventPeerMsgRsp& eventMsgRsp)
     return SendDataMessage(eventMsgRsp.nNonce, PROTO_CMD_MSGRSP, ssPayload);
 }
 
+bool CBbPeerNet::HandleEvent(CEventPeerCompactBlock& eventCompactBlock)
+{
+    CBufStream ssPayload;
+    ssPayload << eventCompactBlock;
+    return SendDataMessage(eventCompactBlock.nNonce, PROTO_CMD_CMPCTBLOCK, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerGetBlockTxn& eventGetBlockTxn)
+{
+    CBufStream ssPayload;
+    ssPayload << eventGetBlockTxn;
+    vector<CInv> vInv;
+    vInv.push_back(CInv(CInv::MSG_CMPCTBLOCK, eventGetBlockTxn.data.hashBlock));
+    if (SendDataMessage(eventGetBlockTxn.nNonce, PROTO_CMD_GETBLOCKTXN, ssPayload))
+    {
+        if (SetInvTimer(eventGetBlockTxn.nNonce, vInv))
+        {
+            return true;
+        }
+    }
+    CEventPeerGetFail* pEvent = new CEventPeerGetFail(eventGetBlockTxn.nNonce, eventGetBlockTxn.hashFork);
+    pEvent->data.swap(vInv);
+    pNetChannel->PostEvent(pEvent);
+    return false;
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerBlockTxn& eventBlockTxn)
+{
+    CBufStream ssPayload;
+    ssPayload << eventBlockTxn;
+    return SendDataMessage(eventBlockTxn.nNonce, PROTO_CMD_BLOCKTXN, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerHeaders& eventHeaders)
+{
+    CBufStream ssPayload;
+    ssPayload << eventHeaders;
+    return SendDataMessage(eventHeaders.nNonce, PROTO_CMD_HEADERS, ssPayload);
+}
+
 CPeer* CBbPeerNet::CreatePeer(CIOClient* pClient, uint64 nNonce, bool fInBound)
 {
     uint32_t nTimerId = SetTimer(nNonce, HANDSHAKE_TIMEOUT, "Handshake Timer");
@@ -205,14 +245,14 @@ bool CBbPeerNet::SendDataMessage(uint64 nNonce, int nCommand, CBufStream& ssPayl
 
 bool CBbPeerNet::SetInvTimer(uint64 nNonce, vector<CInv>& vInv)
 {
-    const int64 nTimeout[] = { 0, RESPONSE_TX_TIMEOUT, RESPONSE_BLOCK_TIMEOUT };
+    const int64 nTimeout[] = { 0, RESPONSE_TX_TIMEOUT, RESPONSE_BLOCK_TIMEOUT, RESPONSE_BLOCK_TIMEOUT };
     CBbPeer* pBbPeer = static_cast<CBbPeer*>(GetPeer(nNonce));
     if (pBbPeer != nullptr)
     {
         int64 nElapse = 0;
         for (const CInv& inv : vInv)
         {
-            if (inv.nType >= CInv::MSG_TX && inv.nType <= CInv::MSG_BLOCK)
+            if (inv.nType >= CInv::MSG_TX && inv.nType <= CInv::MSG_CMPCTBLOCK)
             {
                 nElapse += nTimeout[inv.nType];
                 string strFunc = string("InvTimer: nNonce: ") + to_string(nNonce) + ", Inv: [" + to_string(inv.nType) + "] " + inv.nHash.GetHex();
@@ -486,41 +526,49 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
         }
         break;
         case PROTO_CMD_TX:
+        case PROTO_CMD_BLOCK:
+        case PROTO_CMD_CMPCTBLOCK:
+        case PROTO_CMD_BLOCKTXN:
+        {
+            CEvent* pEvent = DecodePeerData(pBbPeer->GetNonce(), hashFork, nCommand, ssPayload);
+            if (pEvent != nullptr)
+            {
+                return HandlePeerRecvData(pPeer, pEvent);
+            }
+        }
+        break;
+        case PROTO_CMD_GETFAIL:
         {
-            CEventPeerTx* pEvent = new CEventPeerTx(pBbPeer->GetNonce(), hashFork);
+            CEventPeerGetFail* pEvent = new CEventPeerGetFail(pBbPeer->GetNonce(), hashFork);
             if (pEvent != nullptr)
             {
                 ssPayload >> pEvent->data;
-                CInv inv(CInv::MSG_TX, pEvent->data.GetHash());
-                CancelTimer(pBbPeer->Responded(inv));
+                for (const CInv& inv : pEvent->data)
+                {
+                    CancelTimer(pBbPeer->Responded(inv));
+                }
                 pNetChannel->PostEvent(pEvent);
                 return true;
             }
         }
         break;
-        case PROTO_CMD_BLOCK:
+        case PROTO_CMD_HEADERS:
         {
-            CEventPeerBlock* pEvent = new CEventPeerBlock(pBbPeer->GetNonce(), hashFork);
+            CEventPeerHeaders* pEvent = new CEventPeerHeaders(pBbPeer->GetNonce(), hashFork);
             if (pEvent != nullptr)
             {
                 ssPayload >> pEvent->data;
-                CInv inv(CInv::MSG_BLOCK, pEvent->data.GetHash());
-                CancelTimer(pBbPeer->Responded(inv));
                 pNetChannel->PostEvent(pEvent);
                 return true;
             }
         }
         break;
-        case PROTO_CMD_GETFAIL:
+        case PROTO_CMD_GETBLOCKTXN:
         {
-            CEventPeerGetFail* pEvent = new CEventPeerGetFail(pBbPeer->GetNonce(), hashFork);
+            CEventPeerGetBlockTxn* pEvent = new CEventPeerGetBlockTxn(pBbPeer->GetNonce(), hashFork);
             if (pEvent != nullptr)
             {
                 ssPayload >> pEvent->data;
-                for (const CInv& inv : pEvent->data)
-                {
-                    CancelTimer(pBbPeer->Responded(inv));
-                }
                 pNetChannel->PostEvent(pEvent);
                 return true;
             }
@@ -544,6 +592,75 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
     return false;
 }
 
+bool CBbPeerNet::HandlePeerRecvData(CPeer* pPeer, CEvent* pEvent)
+{
+    CBbPeer* pBbPeer = static_cast<CBbPeer*>(pPeer);
+    CInv inv;
+    if (pEvent->nType == EVENT_PEER_TX)
+    {
+        inv = CInv(CInv::MSG_TX, static_cast<CEventPeerTx*>(pEvent)->data.GetHash());
+    }
+    else if (pEvent->nType == EVENT_PEER_BLOCK)
+    {
+        inv = CInv(CInv::MSG_BLOCK, static_cast<CEventPeerBlock*>(pEvent)->data.GetHash());
+    }
+    else if (pEvent->nType == EVENT_PEER_CMPCTBLOCK)
+    {
+        inv = CInv(CInv::MSG_CMPCTBLOCK, static_cast<CEventPeerCompactBlock*>(pEvent)->data.GetHash());
+    }
+    else if (pEvent->nType == EVENT_PEER_BLOCKTXN)
+    {
+        inv = CInv(CInv::MSG_CMPCTBLOCK, static_cast<CEventPeerBlockTxn*>(pEvent)->data.hashBlock);
+    }
+    else
+    {
+        pEvent->Free();
+        return false;
+    }
+    CancelTimer(pBbPeer->Responded(inv));
+    pNetChannel->PostEvent(pEvent);
+    return true;
+}
+
+void CBbPeerNet::HandlePeerRecvWork(uint64 nNonce, std::shared_ptr<CBbPeerRecvWork> spWork)
+{
+    // the peer may have been removed while the payload was decoded
+    CBbPeer* pBbPeer = static_cast<CBbPeer*>(GetPeer(nNonce));
+    if (pBbPeer != nullptr && !pBbPeer->HandleRecvWorkCompleted(spWork))
+    {
+        HandlePeerViolate(pBbPeer);
+    }
+}
+
+CEvent* CBbPeerNet::DecodePeerData(uint64 nNonce, const uint256& hashFork, int nCommand, CBufStream& ssPayload)
+{
+    if (nCommand == PROTO_CMD_TX)
+    {
+        std::unique_ptr<CEventPeerTx> spEvent(new CEventPeerTx(nNonce, hashFork));
+        ssPayload >> spEvent->data;
+        return spEvent.release();
+    }
+    else if (nCommand == PROTO_CMD_BLOCK)
+    {
+        std::unique_ptr<CEventPeerBlock> spEvent(new CEventPeerBlock(nNonce, hashFork));
+        ssPayload >> spEvent->data;
+        return spEvent.release();
+    }
+    else if (nCommand == PROTO_CMD_CMPCTBLOCK)
+    {
+        std::unique_ptr<CEventPeerCompactBlock> spEvent(new CEventPeerCompactBlock(nNonce, hashFork));
+        ssPayload >> spEvent->data;
+        return spEvent.release();
+    }
+    else if (nCommand == PROTO_CMD_BLOCKTXN)
+    {
+        std::unique_ptr<CEventPeerBlockTxn> spEvent(new CEventPeerBlockTxn(nNonce, hashFork));
+        ssPayload >> spEvent->data;
+        return spEvent.release();
+    }
+    return nullptr;
+}
+
 uint32 CBbPeerNet::SetPingTimer(uint32 nOldTimerId, uint64 nNonce, int64 nElapse)
 {
     if (nOldTimerId != 0)
@@ -14,6 +14,8 @@ namespace minemon
 namespace network
 {
 
+class CBbPeerRecvWork;
+
 class INetChannel : public xengine::IIOModule, virtual public CBbPeerEventListener
 {
 public:
@@ -38,6 +40,10 @@ public:
     virtual bool HandlePeerHandshaked(xengine::CPeer* pPeer, uint32 nTimerId);
     virtual bool HandlePeerRecvMessage(xengine::CPeer* pPeer, int nChannel, int nCommand,
                                        xengine::CBufStream& ssPayload);
+    bool HandlePeerRecvData(xengine::CPeer* pPeer, xengine::CEvent* pEvent);
+    void HandlePeerRecvWork(uint64 nNonce, std::shared_ptr<CBbPeerRecvWork> spWork);
+    static xengine::CEvent* DecodePeerData(uint64 nNonce, const uint256& hashFork, int nCommand,
+                                           xengine::CBufStream& ssPayload);
     uint32 SetPingTimer(uint32 nOldTimerId, uint64 nNonce, int64 nElapse);
 
 protected:
@@ -52,6 +58,10 @@ protected:
     bool HandleEvent(CEventPeerBlock& eventBlock) override;
     bool HandleEvent(CEventPeerGetFail& eventGetFail) override;
     bool HandleEvent(CEventPeerMsgRsp& eventMsgRsp) override;
+    bool HandleEvent(CEventPeerCompactBlock& eventCompactBlock) override;
+    bool HandleEvent(CEventPeerGetBlockTxn& eventGetBlockTxn) override;
+    bool HandleEvent(CEventPeerBlockTxn& eventBlockTxn) override;
+    bool HandleEvent(CEventPeerHeaders& eventHeaders) override;
     xengine::CPeer* CreatePeer(xengine::CIOClient* pClient, uint64 nNonce, bool fInBound) override;
     void DestroyPeer(xengine::CPeer* pPeer) override;
     xengine::CPeerInfo* GetPeerInfo(xengine::CPeer* pPeer, xengine::CPeerInfo* pInfo) override;
@@ -19,6 +19,8 @@ enum
 {
     NODE_NETWORK = (1 << 0),
     NODE_DELEGATED = (1 << 1),
+    NODE_COMPACT_BLOCK = (1 << 2),
+    NODE_HEADERS = (1 << 3),
 };
 
 enum
@@ -50,6 +52,10 @@ enum
     PROTO_CMD_BLOCK = 7,
     PROTO_CMD_GETFAIL = 8,
     PROTO_CMD_MSGRSP = 9,
+    PROTO_CMD_CMPCTBLOCK = 10,
+    PROTO_CMD_GETBLOCKTXN = 11,
+    PROTO_CMD_BLOCKTXN = 12,
+    PROTO_CMD_HEADERS = 13,
 };
 
 #define MESSAGE_HEADER_SIZE 16
@@ -157,7 +163,8 @@ public:
     {
         MSG_ERROR = 0,
         MSG_TX,
-        MSG_BLOCK
+        MSG_BLOCK,
+        MSG_CMPCTBLOCK
     };
     enum
     {
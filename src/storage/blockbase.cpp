@@ -4,6 +4,7 @@
 
 #include "blockbase.h"
 
+#include <algorithm>
 #include <boost/timer/timer.hpp>
 #include <cstdio>
 
@@ -18,6 +19,7 @@ using namespace xengine;
 
 #define BLOCKFILE_PREFIX "block"
 #define LOGFILE_NAME "storage.log"
+#define BLOCK_SNAPSHOT_MAX_JOURNAL 0x10000
 
 namespace minemon
 {
@@ -380,12 +382,13 @@ map<uint256, CBlockHeightIndex>* CForkHeightIndex::GetBlockMintList(uint32 nHeig
 // CBlockBase
 
 CBlockBase::CBlockBase()
-  : fDebugLog(false), fCfgAddrTxIndex(false)
+  : fDebugLog(false), fCfgAddrTxIndex(false), poolFilter("blockfilter")
 {
 }
 
 CBlockBase::~CBlockBase()
 {
+    poolFilter.Stop();
     dbBlock.Deinitialize();
     tsBlock.Deinitialize();
 }
@@ -412,6 +415,16 @@ bool CBlockBase::Initialize(const path& pathDataLocation, bool fDebug, bool fRen
         return false;
     }
 
+    // the calling thread joins the scan, so it counts as one of the readers
+    unsigned int nFilterThreads = min((unsigned int)FILTER_MAX_THREADS, boost::thread::hardware_concurrency());
+    if (!poolFilter.Start(nFilterThreads > 1 ? nFilterThreads - 1 : 0))
+    {
+        dbBlock.Deinitialize();
+        tsBlock.Deinitialize();
+        Error("B", "Failed to start filter pool");
+        return false;
+    }
+
     if (fRenewDB)
     {
         Clear();
@@ -425,6 +438,7 @@ bool CBlockBase::Initialize(const path& pathDataLocation, bool fDebug, bool fRen
 
             ClearCache();
         }
+        poolFilter.Stop();
         Error("B", "Failed to load block db");
         return false;
     }
@@ -434,6 +448,15 @@ bool CBlockBase::Initialize(const path& pathDataLocation, bool fDebug, bool fRen
 
 void CBlockBase::Deinitialize()
 {
+    {
+        CWriteLock wlock(rwAccess);
+
+        if (!mapIndex.Empty() && dbBlock.IsBlockSnapshotOutdated(0))
+        {
+            WriteIndexSnapshot();
+        }
+    }
+    poolFilter.Stop();
     dbBlock.Deinitialize();
     tsBlock.Deinitialize();
     {
@@ -448,7 +471,7 @@ bool CBlockBase::Exists(const uint256& hash) const
 {
     CReadLock rlock(rwAccess);
 
-    return (!!mapIndex.count(hash));
+    return (mapIndex.Find(hash) != nullptr);
 }
 
 bool CBlockBase::ExistsTx(const uint256& txid)
@@ -462,7 +485,7 @@ bool CBlockBase::IsEmpty() const
 {
     CReadLock rlock(rwAccess);
 
-    return mapIndex.empty();
+    return mapIndex.Empty();
 }
 
 void CBlockBase::Clear()
@@ -618,11 +641,15 @@ bool CBlockBase::AddNew(const uint256& hash, CBlockEx& block, CBlockIndex** ppIn
             StdError("BlockBase", "Add new block: AddNewBlock failed, block: %s", hash.ToString().c_str());
             //mapIndex.erase(hash);
             RemoveBlockIndex(pIndexNew->GetOriginHash(), hash);
-            delete pIndexNew;
             return false;
         }
 
         *ppIndexNew = pIndexNew;
+
+        if (dbBlock.IsBlockSnapshotOutdated(BLOCK_SNAPSHOT_MAX_JOURNAL))
+        {
+            WriteIndexSnapshot();
+        }
     }
 
     Log("B", "AddNew block, hash=%s", hash.ToString().c_str());
@@ -815,8 +842,7 @@ bool CBlockBase::RetrieveOrigin(const uint256& hash, CBlock& block)
 
     try
     {
-        CBufStream ss;
-        ss.Write((const char*)&tx.vchData[0], tx.vchData.size());
+        CSpanStream ss((const char*)tx.vchData.data(), tx.vchData.size());
         ss >> block;
     }
     catch (exception& e)
@@ -1118,28 +1144,8 @@ bool CBlockBase::CommitBlockView(CBlockView& view, CBlockIndex* pIndexNew)
 bool CBlockBase::LoadIndex(CBlockOutline& outline)
 {
     uint256 hash = outline.GetBlockHash();
-    CBlockIndex* pIndexNew = nullptr;
-
-    map<uint256, CBlockIndex*>::iterator mi = mapIndex.find(hash);
-    if (mi != mapIndex.end())
-    {
-        pIndexNew = (*mi).second;
-        *pIndexNew = static_cast<CBlockIndex&>(outline);
-    }
-    else
-    {
-        pIndexNew = new CBlockIndex(static_cast<CBlockIndex&>(outline));
-        if (pIndexNew == nullptr)
-        {
-            Log("B", "LoadIndex: new CBlockIndex fail");
-            return false;
-        }
-        mi = mapIndex.insert(make_pair(hash, pIndexNew)).first;
-    }
-
-    pIndexNew->phashBlock = &((*mi).first);
+    CBlockIndex* pIndexNew = mapIndex.Set(hash, static_cast<CBlockIndex&>(outline));
     pIndexNew->pPrev = nullptr;
-    pIndexNew->pOrigin = pIndexNew;
 
     if (outline.hashPrev != 0)
     {
@@ -1185,102 +1191,88 @@ bool CBlockBase::LoadTx(CTransaction& tx, uint32 nTxFile, uint32 nTxOffset, uint
 
 bool CBlockBase::FilterTx(const uint256& hashFork, CTxFilter& filter)
 {
-    CReadLock rlock(rwAccess);
-
-    boost::shared_ptr<CBlockFork> spFork = GetFork(hashFork);
-    if (spFork == nullptr)
+    // only the block positions are taken under the locks, blocks are append-only
+    // in the time series files so they stay readable after the locks are released
+    vector<pair<int, CDiskPos>> vBlockPos;
     {
-        StdTrace("BlockBase", "FilterTx::GetFork %s  failed", hashFork.ToString().c_str());
-        return false;
-    }
-
-    CReadLock rForkLock(spFork->GetRWAccess());
+        CReadLock rlock(rwAccess);
 
-    for (CBlockIndex* pIndex = spFork->GetOrigin(); pIndex != nullptr; pIndex = pIndex->pNext)
-    {
-        CBlockEx block;
-        if (!tsBlock.Read(block, pIndex->nFile, pIndex->nOffset))
+        boost::shared_ptr<CBlockFork> spFork = GetFork(hashFork);
+        if (spFork == nullptr)
         {
-            StdLog("BlockBase", "FilterTx: Block read fail, nFile: %d, nOffset: %d.", pIndex->nFile, pIndex->nOffset);
+            StdTrace("BlockBase", "FilterTx::GetFork %s  failed", hashFork.ToString().c_str());
             return false;
         }
-        int nBlockHeight = pIndex->GetBlockHeight();
-        if (block.txMint.nAmount > 0 && filter.setDest.count(block.txMint.sendTo))
-        {
-            if (!filter.FoundTx(hashFork, CAssembledTx(block.txMint, nBlockHeight)))
-            {
-                StdLog("BlockBase", "FilterTx: FoundTx mint tx fail, txid: %s.", block.txMint.GetHash().GetHex().c_str());
-                return false;
-            }
-        }
-        for (int i = 0; i < block.vtx.size(); i++)
-        {
-            CTransaction& tx = block.vtx[i];
-            CTxContxt& ctxt = block.vTxContxt[i];
 
-            if (filter.setDest.count(tx.sendTo) || filter.setDest.count(ctxt.destIn))
-            {
-                if (!filter.FoundTx(hashFork, CAssembledTx(tx, nBlockHeight, ctxt.destIn, ctxt.GetValueIn())))
-                {
-                    StdLog("BlockBase", "FilterTx: FoundTx tx fail, txid: %s.", tx.GetHash().GetHex().c_str());
-                    return false;
-                }
-            }
+        CReadLock rForkLock(spFork->GetRWAccess());
+
+        CBlockIndex* pIndexLast = spFork->GetLast();
+        vBlockPos.reserve(pIndexLast != nullptr ? pIndexLast->GetBlockHeight() + 1 : 0);
+        for (CBlockIndex* pIndex = spFork->GetOrigin(); pIndex != nullptr; pIndex = pIndex->pNext)
+        {
+            vBlockPos.push_back(make_pair(pIndex->GetBlockHeight(), CDiskPos(pIndex->nFile, pIndex->nOffset)));
         }
     }
-    return true;
+    return FilterBlockTx(hashFork, vBlockPos, filter);
 }
 
 bool CBlockBase::FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter)
 {
-    CReadLock rlock(rwAccess);
-
-    boost::shared_ptr<CBlockFork> spFork = GetFork(hashFork);
-    if (spFork == nullptr)
+    vector<pair<int, CDiskPos>> vBlockPos;
     {
-        StdTrace("BlockBase", "FilterTx2::GetFork %s  failed", hashFork.ToString().c_str());
-        return false;
-    }
+        CReadLock rlock(rwAccess);
 
-    CReadLock rForkLock(spFork->GetRWAccess());
+        boost::shared_ptr<CBlockFork> spFork = GetFork(hashFork);
+        if (spFork == nullptr)
+        {
+            StdTrace("BlockBase", "FilterTx2::GetFork %s  failed", hashFork.ToString().c_str());
+            return false;
+        }
 
-    int nCount = 0;
-    for (CBlockIndex* pIndex = spFork->GetLast(); pIndex != nullptr && nCount++ < nDepth; pIndex = pIndex->pPrev)
+        CReadLock rForkLock(spFork->GetRWAccess());
+
+        int nCount = 0;
+        for (CBlockIndex* pIndex = spFork->GetLast(); pIndex != nullptr && nCount++ < nDepth; pIndex = pIndex->pPrev)
+        {
+            vBlockPos.push_back(make_pair(pIndex->GetBlockHeight(), CDiskPos(pIndex->nFile, pIndex->nOffset)));
+        }
+    }
+    return FilterBlockTx(hashFork, vBlockPos, filter);
+}
+
+bool CBlockBase::FilterTx(const uint256& hashFork, const uint256& hashFrom, CTxFilter& filter, uint256& hashLast)
+{
+    // the blocks after hashFrom (all blocks if it is 0) up to the last block, which is returned in hashLast.
+    // It fails if hashFrom is no longer in the fork chain.
+    vector<pair<int, CDiskPos>> vBlockPos;
     {
-        CBlockEx block;
-        if (!tsBlock.Read(block, pIndex->nFile, pIndex->nOffset))
+        CReadLock rlock(rwAccess);
+
+        boost::shared_ptr<CBlockFork> spFork = GetFork(hashFork);
+        if (spFork == nullptr)
         {
-            StdLog("BlockBase", "FilterTx2: Block read fail, nFile: %d, nOffset: %d, block: %s.",
-                   pIndex->nFile, pIndex->nOffset, pIndex->GetBlockHash().GetHex().c_str());
+            StdTrace("BlockBase", "FilterTx3::GetFork %s  failed", hashFork.ToString().c_str());
             return false;
         }
-        int nBlockHeight = pIndex->GetBlockHeight();
-        if (block.txMint.nAmount > 0 && filter.setDest.count(block.txMint.sendTo))
+
+        CReadLock rForkLock(spFork->GetRWAccess());
+
+        CBlockIndex* pIndexOrigin = spFork->GetOrigin();
+        CBlockIndex* pIndex = spFork->GetLast();
+        hashLast = (pIndex != nullptr ? pIndex->GetBlockHash() : uint256());
+        while (pIndex != nullptr && pIndex->GetBlockHash() != hashFrom)
         {
-            if (!filter.FoundTx(hashFork, CAssembledTx(block.txMint, nBlockHeight)))
-            {
-                StdLog("BlockBase", "FilterTx2: FoundTx mint tx fail, height: %d, txid: %s, block: %s, fork: %s.",
-                       nBlockHeight, block.txMint.GetHash().GetHex().c_str(), pIndex->GetBlockHash().GetHex().c_str(), pIndex->GetOriginHash().GetHex().c_str());
-                return false;
-            }
+            vBlockPos.push_back(make_pair(pIndex->GetBlockHeight(), CDiskPos(pIndex->nFile, pIndex->nOffset)));
+            pIndex = (pIndex != pIndexOrigin ? pIndex->pPrev : nullptr);
         }
-        for (int i = 0; i < block.vtx.size(); i++)
+        if (pIndex == nullptr && hashFrom != 0)
         {
-            CTransaction& tx = block.vtx[i];
-            CTxContxt& ctxt = block.vTxContxt[i];
-
-            if (filter.setDest.count(tx.sendTo) || filter.setDest.count(ctxt.destIn))
-            {
-                if (!filter.FoundTx(hashFork, CAssembledTx(tx, nBlockHeight, ctxt.destIn, ctxt.GetValueIn())))
-                {
-                    StdLog("BlockBase", "FilterTx2: FoundTx tx fail, height: %d, txid: %s, block: %s, fork: %s.",
-                           nBlockHeight, tx.GetHash().GetHex().c_str(), pIndex->GetBlockHash().GetHex().c_str(), pIndex->GetOriginHash().GetHex().c_str());
-                    return false;
-                }
-            }
+            StdTrace("BlockBase", "FilterTx3::Block %s not in fork %s", hashFrom.ToString().c_str(), hashFork.ToString().c_str());
+            return false;
         }
     }
-    return true;
+    reverse(vBlockPos.begin(), vBlockPos.end());
+    return FilterBlockTx(hashFork, vBlockPos, filter);
 }
 
 bool CBlockBase::ListForkContext(std::vector<CForkContext>& vForkCtxt)
@@ -1404,15 +1396,19 @@ bool CBlockBase::ListForkUnspent(const uint256& hashFork, const CDestination& de
 {
     vUnspent.clear();
     CListUnspentWalker walker(hashFork, dest, nMax);
-    dbBlock.WalkThroughUnspent(hashFork, walker);
+    dbBlock.WalkThroughAddressUnspent(hashFork, dest, walker);
     vUnspent = walker.vUnspent;
     return true;
 }
 
 bool CBlockBase::ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent)
 {
-    CListUnspentBatchWalker walker(hashFork, mapUnspent, nMax);
-    dbBlock.WalkThroughUnspent(hashFork, walker);
+    for (auto& item : mapUnspent)
+    {
+        CListUnspentWalker walker(hashFork, item.first, nMax);
+        dbBlock.WalkThroughAddressUnspent(hashFork, item.first, walker);
+        item.second = walker.vUnspent;
+    }
     return true;
 }
 
@@ -1460,6 +1456,16 @@ bool CBlockBase::RetrieveAddressPledgeData(const uint256& hashBlock, const CDest
     return dbBlock.RetrieveAddressPledgeData(hashBlock, destPowMint, destPledge, nPledgeAmount, nPledgeHeight);
 }
 
+bool CBlockBase::AddBlockPledgeReward(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, int64>& mapBlockReward)
+{
+    return dbBlock.AddBlockPledgeReward(hashBlock, hashPrev, mapBlockReward);
+}
+
+bool CBlockBase::RetrieveDistributePledgeReward(const uint256& hashBlock, std::map<CDestination, int64>& mapPledgeReward)
+{
+    return dbBlock.RetrieveDistributePledgeReward(hashBlock, mapPledgeReward);
+}
+
 bool CBlockBase::GetMintPledgeData(const uint256& hashBlock, const CDestination& destMintPow, const int64 nMinPledge, const int64 nMaxPledge,
                                    map<CDestination, int64>& mapValidPledge, int64& nTotalPledge)
 {
@@ -1495,24 +1501,12 @@ bool CBlockBase::RetrieveTemplateData(const CDestination& dest, std::vector<uint
 
 CBlockIndex* CBlockBase::GetIndex(const uint256& hash) const
 {
-    map<uint256, CBlockIndex*>::const_iterator mi = mapIndex.find(hash);
-    return (mi != mapIndex.end() ? (*mi).second : nullptr);
+    return mapIndex.Find(hash);
 }
 
 CBlockIndex* CBlockBase::GetOrCreateIndex(const uint256& hash)
 {
-    map<uint256, CBlockIndex*>::const_iterator mi = mapIndex.find(hash);
-    if (mi == mapIndex.end())
-    {
-        CBlockIndex* pIndexNew = new CBlockIndex();
-        mi = mapIndex.insert(make_pair(hash, pIndexNew)).first;
-        if (mi == mapIndex.end())
-        {
-            return nullptr;
-        }
-        pIndexNew->phashBlock = &((*mi).first);
-    }
-    return ((*mi).second);
+    return mapIndex.Insert(hash);
 }
 
 CBlockIndex* CBlockBase::GetBranch(CBlockIndex* pIndexRef, CBlockIndex* pIndex, vector<CBlockIndex*>& vPath)
@@ -1564,31 +1558,25 @@ void CBlockBase::RemoveBlockIndex(const uint256& hashFork, const uint256& hashBl
     {
         it->second.RemoveHeightIndex(CBlock::GetBlockHeightByHash(hashBlock), hashBlock);
     }
-    mapIndex.erase(hashBlock);
+    mapIndex.Erase(hashBlock);
 }
 
 CBlockIndex* CBlockBase::AddNewIndex(const uint256& hash, const CBlock& block, uint32 nFile, uint32 nOffset, const uint256& nChainTrust)
 {
-    CBlockIndex* pIndexNew = new CBlockIndex(block, nFile, nOffset);
+    int64 nMoneySupply = block.GetBlockMint();
+    if (nMoneySupply < 0)
+    {
+        return nullptr;
+    }
+    CBlockIndex* pIndexNew = mapIndex.Set(hash, CBlockIndex(block, nFile, nOffset));
     if (pIndexNew != nullptr)
     {
-        map<uint256, CBlockIndex*>::iterator mi = mapIndex.insert(make_pair(hash, pIndexNew)).first;
-        pIndexNew->phashBlock = &((*mi).first);
         pIndexNew->nChainTrust = nChainTrust;
 
-        int64 nMoneySupply = block.GetBlockMint();
-        if (nMoneySupply < 0)
-        {
-            mapIndex.erase(hash);
-            delete pIndexNew;
-            return nullptr;
-        }
         uint64 nRandBeacon = block.GetBlockBeacon();
-        CBlockIndex* pIndexPrev = nullptr;
-        map<uint256, CBlockIndex*>::iterator miPrev = mapIndex.find(block.hashPrev);
-        if (miPrev != mapIndex.end())
+        CBlockIndex* pIndexPrev = mapIndex.Find(block.hashPrev);
+        if (pIndexPrev != nullptr)
         {
-            pIndexPrev = (*miPrev).second;
             pIndexNew->pPrev = pIndexPrev;
             if (!pIndexNew->IsOrigin())
             {
@@ -1945,14 +1933,75 @@ bool CBlockBase::UpdateRedeem(const uint256& hashBlock, const CBlockEx& block)
     return true;
 }
 
-void CBlockBase::ClearCache()
+bool CBlockBase::FilterBlockTx(const uint256& hashFork, const vector<pair<int, CDiskPos>>& vBlockPos, CTxFilter& filter)
 {
-    map<uint256, CBlockIndex*>::iterator mi;
-    for (mi = mapIndex.begin(); mi != mapIndex.end(); ++mi)
+    // blocks are read and matched on the filter pool a batch at a time,
+    // the found txs are handed to the filter in the order of vBlockPos
+    const size_t nGroup = poolFilter.GetWorkerCount() + 1;
+    for (size_t nBegin = 0; nBegin < vBlockPos.size(); nBegin += FILTER_BATCH_SIZE)
     {
-        delete (*mi).second;
+        const size_t nEnd = min(vBlockPos.size(), nBegin + FILTER_BATCH_SIZE);
+        vector<vector<CAssembledTx>> vFound(nEnd - nBegin);
+        vector<uint8> vReadFail(nEnd - nBegin, 0);
+
+        vector<CWorkerPool::WorkFunc> vWork;
+        vWork.reserve(nGroup);
+        for (size_t n = 0; n < nGroup; n++)
+        {
+            vWork.push_back([&, n]() {
+                for (size_t i = nBegin + n; i < nEnd; i += nGroup)
+                {
+                    CBlockEx block;
+                    if (!tsBlock.Read(block, vBlockPos[i].second, false))
+                    {
+                        vReadFail[i - nBegin] = 1;
+                        continue;
+                    }
+                    const int nBlockHeight = vBlockPos[i].first;
+                    vector<CAssembledTx>& vTx = vFound[i - nBegin];
+                    if (block.txMint.nAmount > 0 && filter.setDest.count(block.txMint.sendTo))
+                    {
+                        vTx.push_back(CAssembledTx(block.txMint, nBlockHeight));
+                    }
+                    for (size_t j = 0; j < block.vtx.size(); j++)
+                    {
+                        const CTransaction& tx = block.vtx[j];
+                        const CTxContxt& ctxt = block.vTxContxt[j];
+                        if (filter.setDest.count(tx.sendTo) || filter.setDest.count(ctxt.destIn))
+                        {
+                            vTx.push_back(CAssembledTx(tx, nBlockHeight, ctxt.destIn, ctxt.GetValueIn()));
+                        }
+                    }
+                }
+            });
+        }
+        poolFilter.Execute(vWork);
+
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            if (vReadFail[i - nBegin])
+            {
+                StdLog("BlockBase", "FilterBlockTx: Block read fail, height: %d, nFile: %d, nOffset: %d, fork: %s.",
+                       vBlockPos[i].first, vBlockPos[i].second.nFile, vBlockPos[i].second.nOffset, hashFork.GetHex().c_str());
+                return false;
+            }
+            for (const CAssembledTx& tx : vFound[i - nBegin])
+            {
+                if (!filter.FoundTx(hashFork, tx))
+                {
+                    StdLog("BlockBase", "FilterBlockTx: FoundTx fail, height: %d, txid: %s, fork: %s.",
+                           vBlockPos[i].first, tx.GetHash().GetHex().c_str(), hashFork.GetHex().c_str());
+                    return false;
+                }
+            }
+        }
     }
-    mapIndex.clear();
+    return true;
+}
+
+void CBlockBase::ClearCache()
+{
+    mapIndex.Clear();
     mapForkHeightIndex.clear();
     mapFork.clear();
 }
@@ -1963,12 +2012,20 @@ bool CBlockBase::LoadDB()
 
     ClearCache();
     CBlockWalker walker(this);
-    if (!dbBlock.WalkThroughBlock(walker))
+    int64 nStartTime = GetTimeMillis();
+    bool fSnapshot = dbBlock.WalkThroughBlockSnapshot(walker);
+    if (!fSnapshot)
     {
-        StdLog("CBlockBase", "LoadDB: WalkThroughBlock fail");
         ClearCache();
-        return false;
+        if (!dbBlock.WalkThroughBlock(walker))
+        {
+            StdLog("CBlockBase", "LoadDB: WalkThroughBlock fail");
+            ClearCache();
+            return false;
+        }
     }
+    StdLog("CBlockBase", "LoadDB: Load %lu block index from %s, time: %ld ms",
+           mapIndex.Size(), (fSnapshot ? "snapshot" : "db"), GetTimeMillis() - nStartTime);
 
     vector<pair<uint256, uint256>> vFork;
     if (!dbBlock.ListFork(vFork))
@@ -2000,6 +2057,24 @@ bool CBlockBase::LoadDB()
         }
     }
 
+    if (!fSnapshot && !mapIndex.Empty())
+    {
+        WriteIndexSnapshot();
+    }
+    return true;
+}
+
+bool CBlockBase::WriteIndexSnapshot()
+{
+    int64 nStartTime = GetTimeMillis();
+    vector<CBlockIndex*> vIndex;
+    mapIndex.ListIndex(vIndex);
+    if (!dbBlock.WriteBlockSnapshot(vIndex))
+    {
+        StdError("CBlockBase", "Write index snapshot: Write fail");
+        return false;
+    }
+    StdLog("CBlockBase", "Write index snapshot: %lu block index, time: %ld ms", vIndex.size(), GetTimeMillis() - nStartTime);
     return true;
 }
 
@@ -13,6 +13,7 @@
 
 #include "block.h"
 #include "blockdb.h"
+#include "blockindexmap.h"
 #include "forkcontext.h"
 #include "profile.h"
 #include "timeseries.h"
@@ -275,6 +276,7 @@ public:
     bool LoadTx(CTransaction& tx, uint32 nTxFile, uint32 nTxOffset, uint256& hashFork);
     bool FilterTx(const uint256& hashFork, CTxFilter& filter);
     bool FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter);
+    bool FilterTx(const uint256& hashFork, const uint256& hashFrom, CTxFilter& filter, uint256& hashLast);
     bool ListForkContext(std::vector<CForkContext>& vForkCtxt);
     bool GetForkBlockLocator(const uint256& hashFork, CBlockLocator& locator, uint256& hashDepth, int nIncStep);
     bool GetForkBlockInv(const uint256& hashFork, const CBlockLocator& locator, std::vector<uint256>& vBlockHash, size_t nMaxCount);
@@ -283,6 +285,8 @@ public:
     bool VerifyRepeatBlock(const uint256& hashFork, uint32 height, const CDestination& destMint);
     bool RetrieveAddressRedeem(const uint256& hashBlock, const CDestination& dest, CDestRedeem& destRedeem);
     bool RetrieveAddressPledgeData(const uint256& hashBlock, const CDestination& destPowMint, const CDestination& destPledge, int64& nPledgeAmount, int& nPledgeHeight);
+    bool AddBlockPledgeReward(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, int64>& mapBlockReward);
+    bool RetrieveDistributePledgeReward(const uint256& hashBlock, std::map<CDestination, int64>& mapPledgeReward);
     bool GetMintPledgeData(const uint256& hashBlock, const CDestination& destMintPow, const int64 nMinPledge, const int64 nMaxPledge,
                            std::map<CDestination, int64>& mapValidPledge, int64& nTotalPledge);
     bool RetrieveTemplateData(const CDestination& dest, std::vector<uint8>& vTemplateData);
@@ -304,8 +308,10 @@ protected:
     bool UpdateTxTemplateData(const uint256& hashBlock, const CBlockEx& block);
     bool UpdatePledge(const uint256& hashBlock, const CBlockEx& block);
     bool UpdateRedeem(const uint256& hashBlock, const CBlockEx& block);
+    bool FilterBlockTx(const uint256& hashFork, const std::vector<std::pair<int, CDiskPos>>& vBlockPos, CTxFilter& filter);
     void ClearCache();
     bool LoadDB();
+    bool WriteIndexSnapshot();
     bool SetupLog(const boost::filesystem::path& pathDataLocation, bool fDebug);
     void Log(const char* pszIdent, const char* pszFormat, ...)
     {
@@ -340,15 +346,21 @@ protected:
     }
 
 protected:
+    enum
+    {
+        FILTER_MAX_THREADS = 4,
+        FILTER_BATCH_SIZE = 256
+    };
     mutable xengine::CRWAccess rwAccess;
     xengine::CLog log;
     bool fDebugLog;
     bool fCfgAddrTxIndex;
     CBlockDB dbBlock;
     CTimeSeriesCached tsBlock;
-    std::map<uint256, CBlockIndex*> mapIndex;
+    CBlockIndexMap mapIndex;
     std::map<uint256, CForkHeightIndex> mapForkHeightIndex;
     std::map<uint256, boost::shared_ptr<CBlockFork>> mapFork;
+    xengine::CWorkerPool poolFilter;
 };
 
 } // namespace storage
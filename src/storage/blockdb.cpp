@@ -56,6 +56,11 @@ bool CBlockDB::Initialize(const boost::filesystem::path& pathData)
         return false;
     }
 
+    if (!dbPledgeReward.Initialize(pathData))
+    {
+        return false;
+    }
+
     if (!dbRedeem.Initialize(pathData))
     {
         return false;
@@ -67,6 +72,7 @@ bool CBlockDB::Initialize(const boost::filesystem::path& pathData)
 void CBlockDB::Deinitialize()
 {
     dbRedeem.Deinitialize();
+    dbPledgeReward.Deinitialize();
     dbPledge.Deinitialize();
     dbTemplateData.Deinitialize();
     dbUnspent.Deinitialize();
@@ -78,6 +84,7 @@ void CBlockDB::Deinitialize()
 bool CBlockDB::RemoveAll()
 {
     dbRedeem.Clear();
+    dbPledgeReward.Clear();
     dbPledge.Clear();
     dbTemplateData.Clear();
     dbUnspent.Clear();
@@ -198,6 +205,21 @@ bool CBlockDB::WalkThroughBlock(CBlockDBWalker& walker)
     return dbBlockIndex.WalkThroughBlock(walker);
 }
 
+bool CBlockDB::WalkThroughBlockSnapshot(CBlockDBWalker& walker)
+{
+    return dbBlockIndex.WalkThroughSnapshot(walker);
+}
+
+bool CBlockDB::WriteBlockSnapshot(const vector<CBlockIndex*>& vIndex)
+{
+    return dbBlockIndex.WriteSnapshot(vIndex);
+}
+
+bool CBlockDB::IsBlockSnapshotOutdated(size_t nMaxJournal)
+{
+    return (!dbBlockIndex.HasSnapshot() || dbBlockIndex.GetJournalCount() > nMaxJournal);
+}
+
 bool CBlockDB::RetrieveTxIndex(const uint256& txid, CTxIndex& txIndex, uint256& fork)
 {
     txIndex.SetNull();
@@ -220,6 +242,11 @@ bool CBlockDB::WalkThroughUnspent(const uint256& hashFork, CForkUnspentDBWalker&
     return dbUnspent.WalkThrough(hashFork, walker);
 }
 
+bool CBlockDB::WalkThroughAddressUnspent(const uint256& hashFork, const CDestination& dest, CForkUnspentDBWalker& walker)
+{
+    return dbUnspent.WalkThroughAddress(hashFork, dest, walker);
+}
+
 bool CBlockDB::AddBlockPledge(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, std::map<CDestination, std::pair<int64, int>>>& mapBlockPledgeIn)
 {
     return dbPledge.AddBlockPledge(hashBlock, hashPrev, mapBlockPledgeIn);
@@ -235,6 +262,16 @@ bool CBlockDB::RetrieveAddressPledgeData(const uint256& hashBlock, const CDestin
     return dbPledge.RetrieveAddressPledgeData(hashBlock, destPowMint, destPledge, nPledgeAmount, nPledgeHeight);
 }
 
+bool CBlockDB::AddBlockPledgeReward(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, int64>& mapBlockRewardIn)
+{
+    return dbPledgeReward.AddBlockReward(hashBlock, hashPrev, mapBlockRewardIn);
+}
+
+bool CBlockDB::RetrieveDistributePledgeReward(const uint256& hashBlock, std::map<CDestination, int64>& mapPledgeReward)
+{
+    return dbPledgeReward.RetrieveDistributeReward(hashBlock, mapPledgeReward);
+}
+
 bool CBlockDB::UpdateTemplateData(const CDestination& dest, const vector<uint8>& vTemplateData)
 {
     return dbTemplateData.AddNew(dest, vTemplateData);
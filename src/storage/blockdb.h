@@ -43,13 +43,19 @@ public:
     bool RemoveBlock(const uint256& hash);
     bool UpdatePledgeContext(const uint256& hash, const CPledgeContext& ctxtPledge);
     bool WalkThroughBlock(CBlockDBWalker& walker);
+    bool WalkThroughBlockSnapshot(CBlockDBWalker& walker);
+    bool WriteBlockSnapshot(const std::vector<CBlockIndex*>& vIndex);
+    bool IsBlockSnapshotOutdated(std::size_t nMaxJournal);
     bool RetrieveTxIndex(const uint256& txid, CTxIndex& txIndex, uint256& fork);
     bool RetrieveTxIndex(const uint256& fork, const uint256& txid, CTxIndex& txIndex);
     bool RetrieveTxUnspent(const uint256& fork, const CTxOutPoint& out, CTxOut& unspent);
     bool WalkThroughUnspent(const uint256& hashFork, CForkUnspentDBWalker& walker);
+    bool WalkThroughAddressUnspent(const uint256& hashFork, const CDestination& dest, CForkUnspentDBWalker& walker);
     bool AddBlockPledge(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, std::map<CDestination, std::pair<int64, int>>>& mapBlockPledgeIn);
     bool RetrievePowPledgeList(const uint256& hashBlock, const CDestination& destPowMint, std::map<CDestination, std::pair<int64, int>>& mapPowPledgeList);
     bool RetrieveAddressPledgeData(const uint256& hashBlock, const CDestination& destPowMint, const CDestination& destPledge, int64& nPledgeAmount, int& nPledgeHeight);
+    bool AddBlockPledgeReward(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, int64>& mapBlockRewardIn);
+    bool RetrieveDistributePledgeReward(const uint256& hashBlock, std::map<CDestination, int64>& mapPledgeReward);
     bool UpdateTemplateData(const CDestination& dest, const std::vector<uint8>& vTemplateData);
     bool RetrieveTemplateData(const CDestination& dest, std::vector<uint8>& vTemplateData);
     bool UpdateRedeemData(const uint256& hashBlock, const CRedeemContext& redeemData);
@@ -66,6 +72,7 @@ protected:
     CUnspentDB dbUnspent;
     CTemplateDataDB dbTemplateData;
     CPledgeDB dbPledge;
+    CPledgeRewardDB dbPledgeReward;
     CRedeemDB dbRedeem;
 };
 
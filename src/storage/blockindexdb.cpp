@@ -4,6 +4,12 @@
 
 #include "blockindexdb.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "crypto.h"
 #include "leveldbeng.h"
 
 using namespace std;
@@ -33,21 +39,50 @@ bool CBlockIndexDB::Initialize(const boost::filesystem::path& pathData)
         return false;
     }
 
+    pathSnapshot = pathData / "blockindex.snapshot";
+    pathJournal = pathData / "blockindex.journal";
+    fSnapshot = boost::filesystem::exists(pathSnapshot);
+    nJournalCount = 0;
+    if (fSnapshot)
+    {
+        pJournal = fopen(pathJournal.string().c_str(), "ab");
+        if (pJournal == nullptr)
+        {
+            StdError("CBlockIndexDB", "Initialize: Open journal fail, file: %s", pathJournal.string().c_str());
+            RemoveSnapshot();
+        }
+        else if (ftell(pJournal) % sizeof(uint256) != 0)
+        {
+            StdLog("CBlockIndexDB", "Initialize: Journal is torn, drop the snapshot");
+            RemoveSnapshot();
+        }
+        else
+        {
+            nJournalCount = ftell(pJournal) / sizeof(uint256);
+        }
+    }
     return true;
 }
 
 void CBlockIndexDB::Deinitialize()
 {
+    if (pJournal != nullptr)
+    {
+        fclose(pJournal);
+        pJournal = nullptr;
+    }
     Close();
 }
 
 bool CBlockIndexDB::AddNewBlock(const CBlockOutline& outline)
 {
+    AppendJournal(outline.GetBlockHash());
     return Write(outline.GetBlockHash(), outline);
 }
 
 bool CBlockIndexDB::RemoveBlock(const uint256& hashBlock)
 {
+    AppendJournal(hashBlock);
     return Erase(hashBlock);
 }
 
@@ -63,9 +98,197 @@ bool CBlockIndexDB::WalkThroughBlock(CBlockDBWalker& walker)
 
 void CBlockIndexDB::Clear()
 {
+    RemoveSnapshot();
     RemoveAll();
 }
 
+bool CBlockIndexDB::WriteSnapshot(const vector<CBlockIndex*>& vIndex)
+{
+    const size_t nRecordSize = GetSnapshotRecordSize();
+    vector<uint256> vChunkHash((vIndex.size() + SNAPSHOT_CHUNK_SIZE - 1) / SNAPSHOT_CHUNK_SIZE);
+
+    // write aside and rename, a torn file is never taken as a snapshot
+    boost::filesystem::path pathTemp = pathSnapshot.string() + ".tmp";
+    FILE* fp = fopen(pathTemp.string().c_str(), "wb");
+    if (fp == nullptr)
+    {
+        StdError("CBlockIndexDB", "Write snapshot: Open file fail, file: %s", pathTemp.string().c_str());
+        return false;
+    }
+
+    CBlockIndexSnapshotHeader header;
+    header.nMagic = SNAPSHOT_MAGIC;
+    header.nVersion = SNAPSHOT_VERSION;
+    header.nRecordSize = nRecordSize;
+    header.nCount = vIndex.size();
+    CBufStream ssHeader;
+    ssHeader << header;
+    bool fRet = (fwrite(ssHeader.GetData(), ssHeader.GetSize(), 1, fp) == 1);
+
+    vector<char> vData;
+    for (size_t nBatch = 0; fRet && nBatch < vIndex.size(); nBatch += SNAPSHOT_BATCH_SIZE)
+    {
+        const size_t nCount = min((size_t)SNAPSHOT_BATCH_SIZE, vIndex.size() - nBatch);
+        vData.resize(nCount * nRecordSize);
+        fRet = ParallelFor(nCount, SNAPSHOT_CHUNK_SIZE, [&](size_t nBegin, size_t nEnd) -> bool {
+            CBufStream ss;
+            for (size_t i = nBegin; i < nEnd; i++)
+            {
+                ss << CBlockOutline(vIndex[nBatch + i]);
+            }
+            if (ss.GetSize() != (nEnd - nBegin) * nRecordSize)
+            {
+                return false;
+            }
+            memcpy(&vData[nBegin * nRecordSize], ss.GetData(), ss.GetSize());
+            vChunkHash[(nBatch + nBegin) / SNAPSHOT_CHUNK_SIZE] = crypto::CryptoHash(ss.GetData(), ss.GetSize());
+            return true;
+        });
+        fRet = (fRet && fwrite(vData.data(), vData.size(), 1, fp) == 1);
+    }
+
+    // the checksum goes last into the header
+    header.hashChecksum = crypto::CryptoHash(vChunkHash.data(), vChunkHash.size() * sizeof(uint256));
+    ssHeader.Clear();
+    ssHeader << header;
+    fRet = (fRet && fseek(fp, 0, SEEK_SET) == 0 && fwrite(ssHeader.GetData(), ssHeader.GetSize(), 1, fp) == 1
+            && fflush(fp) == 0 && fsync(fileno(fp)) == 0);
+    fclose(fp);
+
+    boost::system::error_code ec;
+    if (fRet)
+    {
+        boost::filesystem::rename(pathTemp, pathSnapshot, ec);
+    }
+    if (!fRet || ec)
+    {
+        StdError("CBlockIndexDB", "Write snapshot: Write file fail, file: %s", pathTemp.string().c_str());
+        boost::filesystem::remove(pathTemp, ec);
+        return false;
+    }
+
+    // the snapshot covers the journaled blocks now
+    if (pJournal != nullptr)
+    {
+        fclose(pJournal);
+    }
+    pJournal = fopen(pathJournal.string().c_str(), "wb");
+    if (pJournal == nullptr)
+    {
+        StdError("CBlockIndexDB", "Write snapshot: Open journal fail, file: %s", pathJournal.string().c_str());
+        RemoveSnapshot();
+        return false;
+    }
+    fSnapshot = true;
+    nJournalCount = 0;
+    return true;
+}
+
+bool CBlockIndexDB::WalkThroughSnapshot(CBlockDBWalker& walker)
+{
+    set<uint256> setJournal;
+    if (!fSnapshot || !ReadJournal(setJournal))
+    {
+        return false;
+    }
+
+    int fd = open(pathSnapshot.string().c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        StdError("CBlockIndexDB", "Walk snapshot: Open file fail, file: %s", pathSnapshot.string().c_str());
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    const size_t nFileSize = (size_t)st.st_size;
+    void* pMap = mmap(nullptr, nFileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMap == MAP_FAILED)
+    {
+        StdError("CBlockIndexDB", "Walk snapshot: mmap fail, file: %s", pathSnapshot.string().c_str());
+        return false;
+    }
+    const char* pData = (const char*)pMap;
+
+    bool fRet = false;
+    try
+    {
+        CBlockIndexSnapshotHeader header;
+        CBufStream ssHeader;
+        const size_t nHeaderSize = ssHeader.GetSerializeSize(header);
+        const size_t nRecordSize = GetSnapshotRecordSize();
+        if (nFileSize >= nHeaderSize)
+        {
+            CSpanStream ss(pData, nHeaderSize);
+            ss >> header;
+        }
+        if (header.nMagic == SNAPSHOT_MAGIC && header.nVersion == SNAPSHOT_VERSION && header.nRecordSize == nRecordSize
+            && nFileSize == nHeaderSize + header.nCount * nRecordSize)
+        {
+            const char* pRecord = pData + nHeaderSize;
+            vector<uint256> vChunkHash((header.nCount + SNAPSHOT_CHUNK_SIZE - 1) / SNAPSHOT_CHUNK_SIZE);
+            fRet = ParallelFor(header.nCount, SNAPSHOT_CHUNK_SIZE, [&](size_t nBegin, size_t nEnd) -> bool {
+                vChunkHash[nBegin / SNAPSHOT_CHUNK_SIZE] = crypto::CryptoHash(pRecord + nBegin * nRecordSize, (nEnd - nBegin) * nRecordSize);
+                return true;
+            });
+            if (fRet && header.hashChecksum != crypto::CryptoHash(vChunkHash.data(), vChunkHash.size() * sizeof(uint256)))
+            {
+                StdError("CBlockIndexDB", "Walk snapshot: Checksum error, file: %s", pathSnapshot.string().c_str());
+                fRet = false;
+            }
+
+            vector<CBlockOutline> vOutline;
+            for (size_t nBatch = 0; fRet && nBatch < header.nCount; nBatch += SNAPSHOT_BATCH_SIZE)
+            {
+                const size_t nCount = min((size_t)SNAPSHOT_BATCH_SIZE, (size_t)header.nCount - nBatch);
+                vOutline.resize(nCount);
+                fRet = ParallelFor(nCount, SNAPSHOT_CHUNK_SIZE, [&](size_t nBegin, size_t nEnd) -> bool {
+                    CSpanStream ss(pRecord + (nBatch + nBegin) * nRecordSize, (nEnd - nBegin) * nRecordSize);
+                    for (size_t i = nBegin; i < nEnd; i++)
+                    {
+                        ss >> vOutline[i];
+                    }
+                    return true;
+                });
+                for (size_t i = 0; fRet && i < nCount; i++)
+                {
+                    if (!setJournal.count(vOutline[i].GetBlockHash()))
+                    {
+                        fRet = walker.Walk(vOutline[i]);
+                    }
+                }
+            }
+        }
+    }
+    catch (exception& e)
+    {
+        StdError("CBlockIndexDB", "Walk snapshot: %s", e.what());
+        fRet = false;
+    }
+    munmap(pMap, nFileSize);
+
+    // the leveldb has the last word on the journaled blocks
+    for (auto it = setJournal.begin(); fRet && it != setJournal.end(); ++it)
+    {
+        CBlockOutline outline;
+        if (Read(*it, outline))
+        {
+            fRet = walker.Walk(outline);
+        }
+    }
+
+    if (!fRet)
+    {
+        StdLog("CBlockIndexDB", "Walk snapshot: Snapshot is invalid, file: %s", pathSnapshot.string().c_str());
+        RemoveSnapshot();
+    }
+    return fRet;
+}
+
 bool CBlockIndexDB::LoadBlockWalker(CBufStream& ssKey, CBufStream& ssValue, CBlockDBWalker& walker)
 {
     CBlockOutline outline;
@@ -73,5 +296,58 @@ bool CBlockIndexDB::LoadBlockWalker(CBufStream& ssKey, CBufStream& ssValue, CBlo
     return walker.Walk(outline);
 }
 
+void CBlockIndexDB::AppendJournal(const uint256& hashBlock)
+{
+    if (fSnapshot)
+    {
+        // journaled before the leveldb write, a journaled block missing from the leveldb is skipped
+        if (fwrite(hashBlock.begin(), sizeof(uint256), 1, pJournal) != 1 || fflush(pJournal) != 0)
+        {
+            StdError("CBlockIndexDB", "Append journal: Write fail, file: %s", pathJournal.string().c_str());
+            RemoveSnapshot();
+            return;
+        }
+        nJournalCount++;
+    }
+}
+
+bool CBlockIndexDB::ReadJournal(set<uint256>& setJournal)
+{
+    setJournal.clear();
+    FILE* fp = fopen(pathJournal.string().c_str(), "rb");
+    if (fp == nullptr)
+    {
+        return (nJournalCount == 0);
+    }
+    // a torn last record was never written to the leveldb
+    uint256 hash;
+    while (fread(hash.begin(), sizeof(uint256), 1, fp) == 1)
+    {
+        setJournal.insert(hash);
+    }
+    fclose(fp);
+    return true;
+}
+
+void CBlockIndexDB::RemoveSnapshot()
+{
+    if (pJournal != nullptr)
+    {
+        fclose(pJournal);
+        pJournal = nullptr;
+    }
+    boost::system::error_code ec;
+    boost::filesystem::remove(pathSnapshot, ec);
+    boost::filesystem::remove(pathJournal, ec);
+    fSnapshot = false;
+    nJournalCount = 0;
+}
+
+size_t CBlockIndexDB::GetSnapshotRecordSize()
+{
+    CBufStream ss;
+    return ss.GetSerializeSize(CBlockOutline());
+}
+
 } // namespace storage
 } // namespace minemon
@@ -5,6 +5,8 @@
 #ifndef STORAGE_BLOCKINDEXDB_H
 #define STORAGE_BLOCKINDEXDB_H
 
+#include <set>
+
 #include "block.h"
 #include "xengine.h"
 
@@ -19,10 +21,42 @@ public:
     virtual bool Walk(CBlockOutline& outline) = 0;
 };
 
+class CBlockIndexSnapshotHeader
+{
+    friend class xengine::CStream;
+
+public:
+    CBlockIndexSnapshotHeader()
+      : nMagic(0), nVersion(0), nRecordSize(0), nCount(0) {}
+
+public:
+    uint32 nMagic;
+    uint32 nVersion;
+    uint32 nRecordSize;
+    uint64 nCount;
+    uint256 hashChecksum;
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(nMagic, opt);
+        s.Serialize(nVersion, opt);
+        s.Serialize(nRecordSize, opt);
+        s.Serialize(nCount, opt);
+        s.Serialize(hashChecksum, opt);
+    }
+};
+
+/* The snapshot is a flat file of fixed size outline records written next to
+   the leveldb, blocks added or removed after it are appended to a journal of
+   block hashes. Loading walks the snapshot, skipping the journaled blocks,
+   then reads the journaled blocks from the leveldb. */
 class CBlockIndexDB : public xengine::CKVDB
 {
 public:
-    CBlockIndexDB() {}
+    CBlockIndexDB()
+      : fSnapshot(false), pJournal(nullptr), nJournalCount(0) {}
     bool Initialize(const boost::filesystem::path& pathData);
     void Deinitialize();
     bool AddNewBlock(const CBlockOutline& outline);
@@ -30,10 +64,38 @@ public:
     bool RetrieveBlock(const uint256& hashBlock, CBlockOutline& outline);
     bool WalkThroughBlock(CBlockDBWalker& walker);
     void Clear();
+    bool HasSnapshot() const
+    {
+        return fSnapshot;
+    }
+    std::size_t GetJournalCount() const
+    {
+        return nJournalCount;
+    }
+    bool WriteSnapshot(const std::vector<CBlockIndex*>& vIndex);
+    bool WalkThroughSnapshot(CBlockDBWalker& walker);
 
 protected:
+    enum
+    {
+        SNAPSHOT_MAGIC = 0x58444942,
+        SNAPSHOT_VERSION = 1,
+        SNAPSHOT_CHUNK_SIZE = 0x1000,
+        SNAPSHOT_BATCH_SIZE = 0x40000
+    };
     bool LoadBlockWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                          CBlockDBWalker& walker);
+    void AppendJournal(const uint256& hashBlock);
+    bool ReadJournal(std::set<uint256>& setJournal);
+    void RemoveSnapshot();
+    static std::size_t GetSnapshotRecordSize();
+
+protected:
+    boost::filesystem::path pathSnapshot;
+    boost::filesystem::path pathJournal;
+    bool fSnapshot;
+    FILE* pJournal;
+    std::size_t nJournalCount;
 };
 
 } // namespace storage
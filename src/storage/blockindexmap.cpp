@@ -0,0 +1,190 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockindexmap.h"
+
+using namespace std;
+
+namespace minemon
+{
+namespace storage
+{
+
+//////////////////////////////
+// CBlockIndexMap
+
+CBlockIndexMap::CBlockIndexMap()
+  : nSlotUsed(0), nMask(0), nSize(0)
+{
+    Rehash(MIN_BUCKET_COUNT);
+}
+
+CBlockIndexMap::~CBlockIndexMap()
+{
+    Clear();
+}
+
+CBlockIndex* CBlockIndexMap::Find(const uint256& hash) const
+{
+    const CBucket& bucket = vBucket[FindBucket(hash)];
+    return (bucket.nSlot != 0 ? &(GetSlot(bucket.nSlot - 1).index) : nullptr);
+}
+
+CBlockIndex* CBlockIndexMap::Insert(const uint256& hash)
+{
+    if ((nSize + 1) * 4 > vBucket.size() * 3)
+    {
+        Rehash(vBucket.size() * 2);
+    }
+
+    CBucket& bucket = vBucket[FindBucket(hash)];
+    if (bucket.nSlot != 0)
+    {
+        return &(GetSlot(bucket.nSlot - 1).index);
+    }
+
+    uint32 nSlot = NewSlot();
+    CSlot& slot = GetSlot(nSlot);
+    slot.hash = hash;
+    slot.index = CBlockIndex();
+    slot.index.phashBlock = &slot.hash;
+    slot.index.pOrigin = &slot.index;
+
+    bucket.nTag = hash.Get32(0);
+    bucket.nSlot = nSlot + 1;
+    nSize++;
+    return &slot.index;
+}
+
+CBlockIndex* CBlockIndexMap::Set(const uint256& hash, const CBlockIndex& index)
+{
+    CBlockIndex* pIndex = Insert(hash);
+    const uint256* phashBlock = pIndex->phashBlock;
+    *pIndex = index;
+    pIndex->phashBlock = phashBlock;
+    pIndex->pOrigin = pIndex;
+    return pIndex;
+}
+
+bool CBlockIndexMap::Erase(const uint256& hash)
+{
+    size_t nPos = FindBucket(hash);
+    if (vBucket[nPos].nSlot == 0)
+    {
+        return false;
+    }
+
+    uint32 nSlot = vBucket[nPos].nSlot - 1;
+    GetSlot(nSlot).index = CBlockIndex();
+    vFreeSlot.push_back(nSlot);
+    nSize--;
+
+    // backward shift, keep every entry reachable from its home bucket
+    size_t i = nPos;
+    size_t j = nPos;
+    for (;;)
+    {
+        j = (j + 1) & nMask;
+        if (vBucket[j].nSlot == 0)
+        {
+            break;
+        }
+        size_t k = (size_t)(GetBucketHash(GetSlot(vBucket[j].nSlot - 1).hash) >> 32) & nMask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+        {
+            continue;
+        }
+        vBucket[i] = vBucket[j];
+        i = j;
+    }
+    vBucket[i] = CBucket();
+    return true;
+}
+
+void CBlockIndexMap::Clear()
+{
+    for (CSlot* pSlab : vSlab)
+    {
+        delete[] pSlab;
+    }
+    vSlab.clear();
+    vFreeSlot.clear();
+    nSlotUsed = 0;
+    nSize = 0;
+    vBucket.clear();
+    Rehash(MIN_BUCKET_COUNT);
+}
+
+size_t CBlockIndexMap::GetMemoryUsage() const
+{
+    return (vSlab.size() * SLAB_SIZE * sizeof(CSlot) + vBucket.capacity() * sizeof(CBucket)
+            + vFreeSlot.capacity() * sizeof(uint32));
+}
+
+void CBlockIndexMap::ListIndex(vector<CBlockIndex*>& vIndex) const
+{
+    vIndex.clear();
+    vIndex.reserve(nSize);
+    for (uint32 nSlot = 0; nSlot < nSlotUsed; nSlot++)
+    {
+        CSlot& slot = GetSlot(nSlot);
+        if (slot.index.phashBlock != nullptr)
+        {
+            vIndex.push_back(&slot.index);
+        }
+    }
+}
+
+size_t CBlockIndexMap::FindBucket(const uint256& hash) const
+{
+    uint32 nTag = hash.Get32(0);
+    size_t nPos = (size_t)(GetBucketHash(hash) >> 32) & nMask;
+    while (vBucket[nPos].nSlot != 0)
+    {
+        if (vBucket[nPos].nTag == nTag && GetSlot(vBucket[nPos].nSlot - 1).hash == hash)
+        {
+            break;
+        }
+        nPos = (nPos + 1) & nMask;
+    }
+    return nPos;
+}
+
+uint32 CBlockIndexMap::NewSlot()
+{
+    if (!vFreeSlot.empty())
+    {
+        uint32 nSlot = vFreeSlot.back();
+        vFreeSlot.pop_back();
+        return nSlot;
+    }
+    if (nSlotUsed == vSlab.size() * SLAB_SIZE)
+    {
+        vSlab.push_back(new CSlot[SLAB_SIZE]);
+    }
+    return nSlotUsed++;
+}
+
+void CBlockIndexMap::Rehash(size_t nBucketCount)
+{
+    vector<CBucket> vOld;
+    vOld.swap(vBucket);
+    vBucket.resize(nBucketCount);
+    nMask = nBucketCount - 1;
+    for (const CBucket& bucket : vOld)
+    {
+        if (bucket.nSlot != 0)
+        {
+            size_t nPos = (size_t)(GetBucketHash(GetSlot(bucket.nSlot - 1).hash) >> 32) & nMask;
+            while (vBucket[nPos].nSlot != 0)
+            {
+                nPos = (nPos + 1) & nMask;
+            }
+            vBucket[nPos] = bucket;
+        }
+    }
+}
+
+} // namespace storage
+} // namespace minemon
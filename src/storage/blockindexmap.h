@@ -0,0 +1,93 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef STORAGE_BLOCKINDEXMAP_H
+#define STORAGE_BLOCKINDEXMAP_H
+
+#include <vector>
+
+#include "block.h"
+#include "uint256.h"
+
+namespace minemon
+{
+namespace storage
+{
+
+/* Block index storage, the entries live in fixed size slabs so that an
+   entry keeps its address (and its slot id) until it is erased. Lookup is
+   an open addressing table with linear probing, every bucket holds the low
+   word of the block hash as tag and the slot id, the slab entry is touched
+   only when the tag matches. */
+class CBlockIndexMap
+{
+    class CSlot
+    {
+    public:
+        uint256 hash;
+        CBlockIndex index;
+    };
+    class CBucket
+    {
+    public:
+        CBucket()
+          : nTag(0), nSlot(0) {}
+
+    public:
+        uint32 nTag;
+        uint32 nSlot; // slot id + 1, 0 is empty
+    };
+
+public:
+    CBlockIndexMap();
+    ~CBlockIndexMap();
+    CBlockIndex* Find(const uint256& hash) const;
+    // find or add an empty entry
+    CBlockIndex* Insert(const uint256& hash);
+    // add or overwrite the entry, phashBlock and pOrigin refer to the stored entry
+    CBlockIndex* Set(const uint256& hash, const CBlockIndex& index);
+    bool Erase(const uint256& hash);
+    void Clear();
+    std::size_t Size() const
+    {
+        return nSize;
+    }
+    bool Empty() const
+    {
+        return (nSize == 0);
+    }
+    std::size_t GetMemoryUsage() const;
+    void ListIndex(std::vector<CBlockIndex*>& vIndex) const;
+
+protected:
+    enum
+    {
+        SLAB_SIZE = 0x1000,
+        MIN_BUCKET_COUNT = 0x400
+    };
+    static uint64 GetBucketHash(const uint256& hash)
+    {
+        return (((uint64)hash.Get32(1) << 32) | hash.Get32(0)) * 0x9E3779B97F4A7C15ULL;
+    }
+    CSlot& GetSlot(uint32 nSlot) const
+    {
+        return vSlab[nSlot / SLAB_SIZE][nSlot % SLAB_SIZE];
+    }
+    std::size_t FindBucket(const uint256& hash) const;
+    uint32 NewSlot();
+    void Rehash(std::size_t nBucketCount);
+
+protected:
+    std::vector<CSlot*> vSlab;
+    std::vector<uint32> vFreeSlot;
+    uint32 nSlotUsed;
+    std::vector<CBucket> vBucket;
+    std::size_t nMask;
+    std::size_t nSize;
+};
+
+} // namespace storage
+} // namespace minemon
+
+#endif //STORAGE_BLOCKINDEXMAP_H
@@ -8,8 +8,10 @@
 #include <boost/filesystem.hpp>
 #include <boost/range/algorithm.hpp>
 #include <iostream>
+#include <memory>
 #include <snappy.h>
 
+#include "cache.h"
 #include "timeseries.h"
 #include "xengine.h"
 
@@ -129,6 +131,88 @@ protected:
     }
 };
 
+/* Bloom filter over the keys of one chunk. Keys are hashed by their bytes,
+   chunk keys are plain data (see CCTSChunk::Serialize). An empty filter
+   matches nothing and marks a time without chunk. */
+template <typename K>
+class CCTSBloom
+{
+public:
+    enum
+    {
+        BITS_PER_KEY = 10,
+        HASH_COUNT = 7
+    };
+    CCTSBloom() {}
+    template <class InputIterator>
+    CCTSBloom(InputIterator first, InputIterator last, std::size_t nCount)
+    {
+        if (nCount == 0)
+        {
+            return;
+        }
+        vBit.resize((std::max(nCount * BITS_PER_KEY, (std::size_t)64) + 7) / 8);
+        for (InputIterator it = first; it != last; ++it)
+        {
+            uint64 h = Hash((*it).first);
+            uint32 h1 = (uint32)h, delta = (uint32)(h >> 32) | 1;
+            for (int i = 0; i < HASH_COUNT; i++, h1 += delta)
+            {
+                std::size_t nBit = h1 % (vBit.size() * 8);
+                vBit[nBit / 8] |= (1 << (nBit % 8));
+            }
+        }
+    }
+    bool MayContain(const K& k) const
+    {
+        if (vBit.empty())
+        {
+            return false;
+        }
+        uint64 h = Hash(k);
+        uint32 h1 = (uint32)h, delta = (uint32)(h >> 32) | 1;
+        for (int i = 0; i < HASH_COUNT; i++, h1 += delta)
+        {
+            std::size_t nBit = h1 % (vBit.size() * 8);
+            if (!(vBit[nBit / 8] & (1 << (nBit % 8))))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    std::size_t GetSize() const
+    {
+        return vBit.size();
+    }
+
+protected:
+    static uint64 Hash(const K& k)
+    {
+        // FNV-1a, then the murmur3 finalizer to spread it over 64 bits
+        const unsigned char* p = (const unsigned char*)&k;
+        uint64 h = 0xCBF29CE484222325ULL;
+        for (std::size_t i = 0; i < sizeof(K); i++)
+        {
+            h = (h ^ p[i]) * 0x100000001B3ULL;
+        }
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+protected:
+    std::vector<uint8> vBit;
+};
+
+/* Chunks on disk are immutable until the next flush, the decoded chunks are
+   kept in a LRU (cost is the entry count) and every chunk ever decoded or
+   written has a Bloom filter in a second LRU (cost is the entry memory), a
+   lookup of a key the filter rules out touches neither LevelDB nor the meta
+   file. Both are refreshed by Flush under the write lock. */
 template <typename K, typename V, typename C = CCTSChunk<K, V>>
 class CCTSDB
 {
@@ -164,12 +248,20 @@ class CCTSDB
         int nIdxUpper;
     };
 
+    typedef CCTSBloom<K> CBloom;
     enum
     {
-        CACHE_UPPER_DURATION = 600
+        CACHE_UPPER_DURATION = 600,
+        MAX_CHUNK_CACHE_COST = 0x10000,
+        MAX_BLOOM_CACHE_COST = 0x400000,
+        BLOOM_ENTRY_OVERHEAD = 128
     };
 
 public:
+    CCTSDB()
+      : cacheChunk(MAX_CHUNK_CACHE_COST), cacheBloom(MAX_BLOOM_CACHE_COST)
+    {
+    }
     bool Initialize(const boost::filesystem::path& pathCTSDB)
     {
         if (!boost::filesystem::exists(pathCTSDB))
@@ -199,11 +291,15 @@ public:
         dbIndex.Deinitialize();
         tsChunk.Deinitialize();
         dblMeta.Clear();
+        cacheChunk.Clear();
+        cacheBloom.Clear();
     }
     void RemoveAll()
     {
         dbIndex.RemoveAll();
         dblMeta.Clear();
+        cacheChunk.Clear();
+        cacheBloom.Clear();
     }
     void Update(const int64 nTime, const K& key, const V& value)
     {
@@ -234,9 +330,16 @@ public:
             return false;
         }
 
-        C chunk;
-        if (LoadFromFile(nTime, chunk))
+        std::shared_ptr<CBloom> spBloom;
+        if (cacheBloom.Retrieve(nTime, spBloom) && !spBloom->MayContain(key))
         {
+            return false;
+        }
+
+        std::shared_ptr<C> spChunk;
+        if (LoadChunk(nTime, spChunk))
+        {
+            const C& chunk = *spChunk;
             if (fSaveLoad)
             {
                 mapUpper[nTime].insert(chunk.begin(), chunk.end());
@@ -251,11 +354,16 @@ public:
                     mapUpper.erase(it++);
                 }
             }
-            return chunk.Find(key, value);
+            return spChunk->Find(key, value);
         }
 
         return false;
     }
+    void GetCacheStat(xengine::CCacheStat& statChunk, xengine::CCacheStat& statBloom) const
+    {
+        cacheChunk.GetStat(statChunk);
+        cacheBloom.GetStat(statBloom);
+    }
 
     bool Flush(bool fAll = true)
     {
@@ -301,6 +409,16 @@ public:
         }
 
         ulock.Upgrade();
+        for (std::size_t i = 0; i < vTime.size(); i++)
+        {
+            cacheChunk.Remove(vTime[i]);
+            AddBloom(vTime[i], std::make_shared<CBloom>(vChunk[i].begin(), vChunk[i].end(), vChunk[i].size()));
+        }
+        for (const int64 nTime : vDel)
+        {
+            cacheChunk.Remove(nTime);
+            AddBloom(nTime, std::make_shared<CBloom>());
+        }
         flushMap.clear();
 
         return true;
@@ -317,22 +435,41 @@ protected:
             return (*it).second;
         }
 
-        C chunk;
-        if (LoadFromFile(nTime, chunk))
+        std::shared_ptr<C> spChunk;
+        if (LoadChunk(nTime, spChunk))
         {
-            mapUpdate[nTime].insert(chunk.begin(), chunk.end());
+            mapUpdate[nTime].insert(spChunk->begin(), spChunk->end());
         }
         return mapUpdate[nTime];
     }
 
-    bool LoadFromFile(const int64 nTime, C& chunk)
+    bool LoadChunk(const int64 nTime, std::shared_ptr<C>& spChunk)
     {
+        if (cacheChunk.Retrieve(nTime, spChunk))
+        {
+            return true;
+        }
+
         CDiskPos pos;
-        if (dbIndex.Retrieve(nTime, pos))
+        if (!dbIndex.Retrieve(nTime, pos))
         {
-            return tsChunk.Read(chunk, pos);
+            AddBloom(nTime, std::make_shared<CBloom>());
+            return false;
         }
-        return false;
+        spChunk = std::make_shared<C>();
+        if (!tsChunk.Read(*spChunk, pos))
+        {
+            return false;
+        }
+        cacheChunk.AddNew(nTime, spChunk, std::max(spChunk->size(), (std::size_t)1));
+        AddBloom(nTime, std::make_shared<CBloom>(spChunk->begin(), spChunk->end(), spChunk->size()));
+        return true;
+    }
+
+    void AddBloom(const int64 nTime, const std::shared_ptr<CBloom>& spBloom)
+    {
+        // an empty filter still costs the cache node and the shared_ptr block
+        cacheBloom.AddNew(nTime, spBloom, sizeof(CBloom) + spBloom->GetSize() + BLOOM_ENTRY_OVERHEAD);
     }
 
 protected:
@@ -340,6 +477,8 @@ protected:
     CCTSIndex dbIndex;
     CTimeSeriesChunk tsChunk;
     CDblMap dblMeta;
+    xengine::CCache<int64, std::shared_ptr<C>> cacheChunk;
+    xengine::CCache<int64, std::shared_ptr<CBloom>> cacheBloom;
 };
 
 } // namespace storage
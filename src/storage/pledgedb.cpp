@@ -528,5 +528,144 @@ void CPledgeDB::AddCache(const uint256& hashBlock, const CPledgeContext& ctxtPle
     }
 }
 
+//////////////////////////////
+// CPledgeRewardDB
+
+bool CPledgeRewardDB::Initialize(const boost::filesystem::path& pathData)
+{
+    CLevelDBArguments args;
+    args.path = (pathData / "pledgereward").string();
+    args.syncwrite = false;
+    CLevelDBEngine* engine = new CLevelDBEngine(args);
+
+    if (!Open(engine))
+    {
+        delete engine;
+        return false;
+    }
+    return true;
+}
+
+void CPledgeRewardDB::Deinitialize()
+{
+    mapCacheAccumReward.clear();
+    Close();
+}
+
+bool CPledgeRewardDB::AddBlockReward(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, int64>& mapBlockRewardIn)
+{
+    xengine::CWriteLock wlock(rwData);
+
+    CPledgeReward reward;
+    reward.hashPrev = hashPrev;
+    reward.mapReward = mapBlockRewardIn;
+    if (!Write(hashBlock, reward))
+    {
+        StdError("CPledgeRewardDB", "Add block reward: Write fail, block: %s", hashBlock.GetHex().c_str());
+        return false;
+    }
+
+    if (IsWindowBegin(hashBlock))
+    {
+        AddCache(hashBlock, mapBlockRewardIn);
+    }
+    else
+    {
+        auto it = mapCacheAccumReward.find(hashPrev);
+        if (it != mapCacheAccumReward.end())
+        {
+            std::map<CDestination, int64> mapAccumReward = it->second;
+            for (const auto& kv : mapBlockRewardIn)
+            {
+                mapAccumReward[kv.first] += kv.second;
+            }
+            AddCache(hashBlock, mapAccumReward);
+        }
+    }
+    return true;
+}
+
+bool CPledgeRewardDB::RetrieveDistributeReward(const uint256& hashBlock, std::map<CDestination, int64>& mapRewardOut)
+{
+    xengine::CWriteLock wlock(rwData);
+    return GetAccumReward(hashBlock, mapRewardOut);
+}
+
+void CPledgeRewardDB::Clear()
+{
+    mapCacheAccumReward.clear();
+    RemoveAll();
+}
+
+///////////////////////////////////////////////
+bool CPledgeRewardDB::IsWindowBegin(const uint256& hashBlock)
+{
+    return ((CBlock::GetBlockHeightByHash(hashBlock) % BPX_PLEDGE_REWARD_DISTRIBUTE_HEIGHT) == 1);
+}
+
+bool CPledgeRewardDB::GetAccumReward(const uint256& hashBlock, std::map<CDestination, int64>& mapRewardOut)
+{
+    mapRewardOut.clear();
+
+    auto it = mapCacheAccumReward.find(hashBlock);
+    if (it != mapCacheAccumReward.end())
+    {
+        mapRewardOut = it->second;
+        return true;
+    }
+
+    uint256 hash = hashBlock;
+    while (hash != 0)
+    {
+        auto mt = mapCacheAccumReward.find(hash);
+        if (mt != mapCacheAccumReward.end())
+        {
+            for (const auto& kv : mt->second)
+            {
+                mapRewardOut[kv.first] += kv.second;
+            }
+            break;
+        }
+
+        CPledgeReward reward;
+        if (!Read(hash, reward))
+        {
+            return false;
+        }
+        for (const auto& kv : reward.mapReward)
+        {
+            mapRewardOut[kv.first] += kv.second;
+        }
+        if (IsWindowBegin(hash))
+        {
+            break;
+        }
+        hash = reward.hashPrev;
+    }
+    if (hash == 0)
+    {
+        return false;
+    }
+    AddCache(hashBlock, mapRewardOut);
+    return true;
+}
+
+void CPledgeRewardDB::AddCache(const uint256& hashBlock, const std::map<CDestination, int64>& mapAccumReward)
+{
+    auto it = mapCacheAccumReward.find(hashBlock);
+    if (it == mapCacheAccumReward.end())
+    {
+        while (mapCacheAccumReward.size() >= MAX_ACCUM_CACHE_COUNT)
+        {
+            mapCacheAccumReward.erase(mapCacheAccumReward.begin());
+        }
+        mapCacheAccumReward.insert(make_pair(hashBlock, mapAccumReward));
+    }
+    else
+    {
+        it->second = mapAccumReward;
+    }
+}
+
 } // namespace storage
 } // namespace minemon
@@ -141,6 +141,54 @@ protected:
     std::map<uint256, CPledgeContext> mapCacheIncPledge;
 };
 
+class CPledgeReward
+{
+    friend class xengine::CStream;
+
+public:
+    CPledgeReward() {}
+
+public:
+    uint256 hashPrev;
+    std::map<CDestination, int64> mapReward;
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(hashPrev, opt);
+        s.Serialize(mapReward, opt);
+    }
+};
+
+/* Pledge reward of every block, the sum over a distribution window is kept
+   as a running accumulator: a connected block extends the accumulator of its
+   parent, a block whose accumulator is not cached (after a rollback or a
+   restart) is rebuilt from the nearest cached ancestor or the window begin. */
+class CPledgeRewardDB : public xengine::CKVDB
+{
+public:
+    CPledgeRewardDB() {}
+    bool Initialize(const boost::filesystem::path& pathData);
+    void Deinitialize();
+    bool AddBlockReward(const uint256& hashBlock, const uint256& hashPrev, const std::map<CDestination, int64>& mapBlockRewardIn);
+    bool RetrieveDistributeReward(const uint256& hashBlock, std::map<CDestination, int64>& mapRewardOut);
+    void Clear();
+
+protected:
+    bool IsWindowBegin(const uint256& hashBlock);
+    bool GetAccumReward(const uint256& hashBlock, std::map<CDestination, int64>& mapRewardOut);
+    void AddCache(const uint256& hashBlock, const std::map<CDestination, int64>& mapAccumReward);
+
+protected:
+    enum
+    {
+        MAX_ACCUM_CACHE_COUNT = 8,
+    };
+    xengine::CRWAccess rwData;
+    std::map<uint256, std::map<CDestination, int64>> mapCacheAccumReward;
+};
+
 } // namespace storage
 } // namespace minemon
 
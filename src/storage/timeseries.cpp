@@ -4,6 +4,10 @@
 
 #include "timeseries.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace std;
 using namespace boost::filesystem;
 using namespace xengine;
@@ -23,6 +27,7 @@ CTimeSeriesBase::CTimeSeriesBase()
 
 CTimeSeriesBase::~CTimeSeriesBase()
 {
+    CloseReadFd();
 }
 
 bool CTimeSeriesBase::Initialize(const path& pathLocationIn, const string& strPrefixIn)
@@ -55,6 +60,7 @@ bool CTimeSeriesBase::Initialize(const path& pathLocationIn, const string& strPr
 
 void CTimeSeriesBase::Deinitialize()
 {
+    CloseReadFd();
 }
 
 bool CTimeSeriesBase::CheckDiskSpace()
@@ -108,6 +114,10 @@ bool CTimeSeriesBase::GetLastFilePath(uint32& nFile, std::string& strPath, const
 
 bool CTimeSeriesBase::RemoveFollowUpFile(uint32 nBeginFile)
 {
+    // keep readers out until the files are gone, so none of them reopens one
+    boost::unique_lock<boost::shared_mutex> wlock(rwReadFd);
+    ClearReadFd();
+
     std::string pathFile;
     while (GetFilePath(nBeginFile, pathFile))
     {
@@ -123,8 +133,13 @@ bool CTimeSeriesBase::RemoveFollowUpFile(uint32 nBeginFile)
 
 bool CTimeSeriesBase::TruncateFile(const string& pathFile, uint32 nOffset)
 {
+    // keep readers out until the file is replaced, a descriptor opened in
+    // between would still point at the old file
+    boost::unique_lock<boost::shared_mutex> wlock(rwReadFd);
+
     string strTempFilePath = pathFile + ".temp";
     boost::filesystem::rename(path(pathFile), path(strTempFilePath));
+    ClearReadFd();
 
     FILE* pReadFd = nullptr;
     FILE* pWriteFd = nullptr;
@@ -191,13 +206,92 @@ bool CTimeSeriesBase::RepairFile(uint32 nFile, uint32 nOffset)
     }
 }
 
+bool CTimeSeriesBase::ReadFileData(uint32 nFile, uint32 nOffset, size_t nSize, vector<char>& vData)
+{
+    for (;;)
+    {
+        {
+            boost::shared_lock<boost::shared_mutex> rlock(rwReadFd);
+            map<uint32, int>::iterator it = mapReadFd.find(nFile);
+            if (it != mapReadFd.end())
+            {
+                int fd = (*it).second;
+                struct stat st;
+                if (fstat(fd, &st) != 0 || (off_t)nOffset >= st.st_size)
+                {
+                    return false;
+                }
+                vData.resize(min(nSize, (size_t)(st.st_size - nOffset)));
+                size_t nRead = 0;
+                while (nRead < vData.size())
+                {
+                    ssize_t nLen = pread(fd, &vData[nRead], vData.size() - nRead, (off_t)nOffset + nRead);
+                    if (nLen <= 0)
+                    {
+                        StdError("TimeSeriesBase", "ReadFileData: pread fail, nFile: %d, nOffset: %d, nSize: %lu",
+                                 nFile, nOffset, vData.size());
+                        return false;
+                    }
+                    nRead += nLen;
+                }
+                return true;
+            }
+        }
+
+        string pathFile;
+        if (!GetFilePath(nFile, pathFile))
+        {
+            return false;
+        }
+        boost::unique_lock<boost::shared_mutex> wlock(rwReadFd);
+        if (!mapReadFd.count(nFile))
+        {
+            int fd = open(pathFile.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                StdError("TimeSeriesBase", "ReadFileData: open fail, file: %s", pathFile.c_str());
+                return false;
+            }
+            mapReadFd.insert(make_pair(nFile, fd));
+        }
+    }
+}
+
+bool CTimeSeriesBase::GetRecordSize(uint32 nFile, uint32 nOffset, uint32 nMagic, uint32& nSize)
+{
+    vector<char> vHeader;
+    if (nOffset < 8 || !ReadFileData(nFile, nOffset - 8, 8, vHeader) || vHeader.size() != 8)
+    {
+        return false;
+    }
+    uint32 nMagicRead;
+    memcpy(&nMagicRead, &vHeader[0], 4);
+    memcpy(&nSize, &vHeader[4], 4);
+    return (nMagicRead == nMagic && nSize <= MAX_FILE_SIZE);
+}
+
+void CTimeSeriesBase::CloseReadFd()
+{
+    boost::unique_lock<boost::shared_mutex> wlock(rwReadFd);
+    ClearReadFd();
+}
+
+void CTimeSeriesBase::ClearReadFd()
+{
+    for (map<uint32, int>::iterator it = mapReadFd.begin(); it != mapReadFd.end(); ++it)
+    {
+        close((*it).second);
+    }
+    mapReadFd.clear();
+}
+
 //////////////////////////////
 // CTimeSeriesCached
 
 const uint32 CTimeSeriesCached::nMagicNum = 0x8F4EBC9E;
 
 CTimeSeriesCached::CTimeSeriesCached()
-  : cacheStream(FILE_CACHE_SIZE)
+  : cacheRecord(FILE_CACHE_SIZE, FILE_CACHE_SHARD)
 {
 }
 
@@ -207,57 +301,23 @@ CTimeSeriesCached::~CTimeSeriesCached()
 
 bool CTimeSeriesCached::Initialize(const path& pathLocationIn, const string& strPrefixIn)
 {
-
     if (!CTimeSeriesBase::Initialize(pathLocationIn, strPrefixIn))
     {
         return false;
     }
-
-    {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        ResetCache();
-    }
+    cacheRecord.Clear();
     return true;
 }
 
 void CTimeSeriesCached::Deinitialize()
 {
-    boost::unique_lock<boost::mutex> lock(mtxCache);
-
-    ResetCache();
-}
-
-void CTimeSeriesCached::ResetCache()
-{
-    cacheStream.Clear();
-    mapCachePos.clear();
+    cacheRecord.Clear();
+    CTimeSeriesBase::Deinitialize();
 }
 
-bool CTimeSeriesCached::VacateCache(uint32 nNeeded)
+void CTimeSeriesCached::GetCacheStat(CCacheStat& stat) const
 {
-    const size_t nHdrSize = 12;
-
-    while (cacheStream.GetBufFreeSpace() < nNeeded + nHdrSize)
-    {
-        CDiskPos diskpos;
-        uint32 nSize = 0;
-
-        try
-        {
-            cacheStream.Rewind();
-            cacheStream >> diskpos >> nSize;
-        }
-        catch (exception& e)
-        {
-            StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
-        }
-
-        mapCachePos.erase(diskpos);
-        cacheStream.Consume(nSize + nHdrSize);
-    }
-    return true;
+    cacheRecord.GetStat(stat);
 }
 
 //////////////////////////////
@@ -6,6 +6,7 @@
 #define STORAGE_TIMESERIES_H
 
 #include <boost/filesystem.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/thread.hpp>
 #include <xengine.h>
 
@@ -53,6 +54,11 @@ protected:
     }
 };
 
+inline std::size_t hash_value(const CDiskPos& pos)
+{
+    return (std::size_t)(((uint64)pos.nFile << 32) | pos.nOffset);
+}
+
 template <typename T>
 class CTSWalker
 {
@@ -76,16 +82,63 @@ protected:
     bool RemoveFollowUpFile(uint32 nBeginFile);
     bool TruncateFile(const std::string& pathFile, uint32 nOffset);
     bool RepairFile(uint32 nFile, uint32 nOffset);
+    bool ReadFileData(uint32 nFile, uint32 nOffset, std::size_t nSize, std::vector<char>& vData);
+    bool GetRecordSize(uint32 nFile, uint32 nOffset, uint32 nMagic, uint32& nSize);
+    void CloseReadFd();
+    void ClearReadFd();
+    /* Object offsets either point at a record (right after its magic/size header)
+       or inside one (tx in a block). In the second case the size is unknown, so the
+       read window grows until the object deserializes. */
+    template <typename T>
+    bool ReadRecord(T& t, uint32 nFile, uint32 nOffset, uint32 nMagic, std::vector<char>* pvData = nullptr)
+    {
+        uint32 nSize = 0;
+        std::size_t nWindow = (GetRecordSize(nFile, nOffset, nMagic, nSize) ? nSize : (uint32)READ_WINDOW_SIZE);
+        for (;;)
+        {
+            std::vector<char> vData;
+            if (!ReadFileData(nFile, nOffset, nWindow, vData))
+            {
+                return false;
+            }
+            try
+            {
+                xengine::CSpanStream ss(vData.data(), vData.size());
+                ss >> t;
+                if (pvData != nullptr)
+                {
+                    vData.resize(vData.size() - ss.GetSize());
+                    pvData->swap(vData);
+                }
+                return true;
+            }
+            catch (std::exception& e)
+            {
+                if (vData.size() < nWindow)
+                {
+                    xengine::StdError(__PRETTY_FUNCTION__, e.what());
+                    return false;
+                }
+            }
+            nWindow = std::max(nWindow * 2, (std::size_t)READ_WINDOW_SIZE);
+        }
+    }
 
 protected:
     enum
     {
         MAX_FILE_SIZE = 0x7F000000,
-        MAX_CHUNK_SIZE = 0x200000
+        MAX_CHUNK_SIZE = 0x200000,
+        READ_WINDOW_SIZE = 0x1000
     };
     boost::filesystem::path pathLocation;
     std::string strPrefix;
     uint32 nLastFile;
+    /* Read-only descriptors opened once per file and shared by all readers.
+       pread does not move the file offset, so the shared lock is enough to
+       read, the unique lock is only taken to open or close descriptors. */
+    boost::shared_mutex rwReadFd;
+    std::map<uint32, int> mapReadFd;
 };
 
 class CTimeSeriesCached : public CTimeSeriesBase
@@ -95,12 +148,13 @@ public:
     ~CTimeSeriesCached();
     bool Initialize(const boost::filesystem::path& pathLocationIn, const std::string& strPrefixIn);
     void Deinitialize();
+    void GetCacheStat(xengine::CCacheStat& stat) const;
     template <typename T>
     bool Write(const T& t, uint32& nFile, uint32& nOffset, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
+        boost::unique_lock<boost::mutex> lock(mtxWriter);
 
-        xengine::CBufStream ss;
+        xengine::CSpanStream ss;
         ss << t;
 
         std::string pathFile;
@@ -124,19 +178,16 @@ public:
         }
         if (fWriteCache)
         {
-            if (!WriteToCache(ss.GetData(), ss.GetSize(), CDiskPos(nFile, nOffset)))
-            {
-                ResetCache();
-            }
+            WriteToCache(ss.GetData(), ss.GetSize(), CDiskPos(nFile, nOffset));
         }
         return true;
     }
     template <typename T>
     bool Write(const T& t, CDiskPos& pos, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
+        boost::unique_lock<boost::mutex> lock(mtxWriter);
 
-        xengine::CBufStream ss;
+        xengine::CSpanStream ss;
         ss << t;
 
         std::string pathFile;
@@ -160,84 +211,32 @@ public:
         }
         if (fWriteCache)
         {
-            if (!WriteToCache(ss.GetData(), ss.GetSize(), pos))
-            {
-                ResetCache();
-            }
+            WriteToCache(ss.GetData(), ss.GetSize(), pos);
         }
         return true;
     }
     template <typename T>
     bool Read(T& t, uint32 nFile, uint32 nOffset, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        if (ReadFromCache(t, CDiskPos(nFile, nOffset)))
-        {
-            return true;
-        }
-
-        std::string pathFile;
-        if (!GetFilePath(nFile, pathFile))
-        {
-            return false;
-        }
-        try
-        {
-            // Open history file to read
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.Seek(nOffset);
-            fs >> t;
-        }
-        catch (std::exception& e)
-        {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
-        }
-
-        if (fWriteCache)
-        {
-            if (!WriteToCache(t, CDiskPos(nFile, nOffset)))
-            {
-                ResetCache();
-            }
-        }
-        return true;
+        return Read(t, CDiskPos(nFile, nOffset), fWriteCache);
     }
     template <typename T>
     bool Read(T& t, const CDiskPos& pos, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
         if (ReadFromCache(t, pos))
         {
             return true;
         }
 
-        std::string pathFile;
-        if (!GetFilePath(pos.nFile, pathFile))
+        std::vector<char> vData;
+        if (!ReadRecord(t, pos.nFile, pos.nOffset, nMagicNum, &vData))
         {
             return false;
         }
-        try
-        {
-            // Open history file to read
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.Seek(pos.nOffset);
-            fs >> t;
-        }
-        catch (std::exception& e)
-        {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
-        }
 
         if (fWriteCache)
         {
-            if (!WriteToCache(t, pos))
-            {
-                ResetCache();
-            }
+            WriteToCache(vData.data(), vData.size(), pos);
         }
         return true;
     }
@@ -411,59 +410,27 @@ public:
     }
 
 protected:
-    void ResetCache();
-    bool VacateCache(uint32 nNeeded);
-    template <typename T>
-    bool WriteToCache(const T& t, const CDiskPos& diskpos)
+    void WriteToCache(const char* pData, const uint32 nSize, const CDiskPos& diskpos)
     {
-        xengine::CBufStream ss;
-        ss << t;
-        return WriteToCache(ss.GetData(), ss.GetSize(), diskpos);
-    }
-    bool WriteToCache(const char* pData, const uint32 nSize, const CDiskPos& diskpos)
-    {
-        if (mapCachePos.count(diskpos))
-        {
-            return true;
-        }
-        if (!VacateCache(nSize))
-        {
-            return false;
-        }
-        try
-        {
-            std::size_t nPos;
-            cacheStream << diskpos << nSize;
-            nPos = cacheStream.GetWritePos();
-            cacheStream.Write(pData, nSize);
-            mapCachePos.insert(std::make_pair(diskpos, nPos));
-            return true;
-        }
-        catch (std::exception& e)
-        {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-        }
-        return false;
+        cacheRecord.AddNew(diskpos, std::vector<char>(pData, pData + nSize), nSize + CACHE_ENTRY_OVERHEAD);
     }
     template <typename T>
     bool ReadFromCache(T& t, const CDiskPos& diskpos)
     {
-        std::map<CDiskPos, size_t>::iterator it = mapCachePos.find(diskpos);
-        if (it != mapCachePos.end())
+        std::vector<char> vData;
+        if (cacheRecord.Retrieve(diskpos, vData))
         {
-            if (cacheStream.Seek((*it).second))
+            try
             {
-                try
-                {
-                    cacheStream >> t;
-                    return true;
-                }
-                catch (std::exception& e)
-                {
-                    xengine::StdError(__PRETTY_FUNCTION__, e.what());
-                }
+                xengine::CSpanStream ss(vData.data(), vData.size());
+                ss >> t;
+                return true;
             }
-            ResetCache();
+            catch (std::exception& e)
+            {
+                xengine::StdError(__PRETTY_FUNCTION__, e.what());
+            }
+            cacheRecord.Remove(diskpos);
         }
         return false;
     }
@@ -471,11 +438,12 @@ protected:
 protected:
     enum
     {
-        FILE_CACHE_SIZE = 0x2000000
+        FILE_CACHE_SIZE = 0x2000000,
+        FILE_CACHE_SHARD = 8,
+        CACHE_ENTRY_OVERHEAD = 64
     };
-    boost::mutex mtxCache;
-    xengine::CCircularStream cacheStream;
-    std::map<CDiskPos, std::size_t> mapCachePos;
+    boost::mutex mtxWriter;
+    xengine::CCache<CDiskPos, std::vector<char>> cacheRecord;
     static const uint32 nMagicNum;
 };
 
@@ -489,7 +457,7 @@ public:
     {
         boost::unique_lock<boost::mutex> lock(mtxWriter);
 
-        xengine::CBufStream ss;
+        xengine::CSpanStream ss;
         ss << t;
 
         std::string pathFile;
@@ -522,7 +490,7 @@ public:
 
         while (n < vBatch.size())
         {
-            xengine::CBufStream ss;
+            xengine::CSpanStream ss;
             ss << vBatch[n];
 
             uint32 nFile, nOffset;
@@ -562,24 +530,7 @@ public:
     template <typename T>
     bool Read(T& t, const CDiskPos& pos)
     {
-        std::string pathFile;
-        if (!GetFilePath(pos.nFile, pathFile))
-        {
-            return false;
-        }
-        try
-        {
-            // Open history file to read
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.Seek(pos.nOffset);
-            fs >> t;
-        }
-        catch (std::exception& e)
-        {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
-        }
-        return true;
+        return ReadRecord(t, pos.nFile, pos.nOffset, nMagicNum);
     }
 
 protected:
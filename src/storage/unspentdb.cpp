@@ -17,6 +17,8 @@ namespace storage
 {
 
 #define UNSPENT_FLUSH_INTERVAL (60)
+#define UNSPENT_KEY_SIZE (sizeof(uint256) + sizeof(uint8))
+#define UNSPENT_ADDRESS_INDEX_VERSION (1)
 
 //////////////////////////////
 // CForkUnspentDB
@@ -55,10 +57,12 @@ bool CForkUnspentDB::UpdateUnspent(const vector<CTxUnspent>& vAddNew, const vect
     xengine::CWriteLock wlock(rwUpper);
 
     MapType& mapUpper = dblCache.GetUpperMap();
+    MapDestType& mapUpperDest = dblCache.GetUpperDestMap();
 
     for (const CTxUnspent& unspent : vAddNew)
     {
         mapUpper[static_cast<const CTxOutPoint&>(unspent)] = unspent.output;
+        mapUpperDest[unspent.output.destTo].insert(static_cast<const CTxOutPoint&>(unspent));
     }
 
     for (const CTxUnspent& unspent : vRemove)
@@ -78,11 +82,14 @@ bool CForkUnspentDB::RepairUnspent(const std::vector<CTxUnspent>& vAddUpdate, co
 
     for (const CTxUnspent& unspent : vAddUpdate)
     {
+        EraseAddressIndex(static_cast<const CTxOutPoint&>(unspent));
         Write(static_cast<const CTxOutPoint&>(unspent), unspent.output);
+        WriteAddressIndex(static_cast<const CTxOutPoint&>(unspent), unspent.output);
     }
 
     for (const CTxOutPoint& txout : vRemove)
     {
+        EraseAddressIndex(txout);
         Erase(txout);
     }
 
@@ -95,7 +102,7 @@ bool CForkUnspentDB::RepairUnspent(const std::vector<CTxUnspent>& vAddUpdate, co
 
 bool CForkUnspentDB::WriteUnspent(const CTxOutPoint& txout, const CTxOut& output)
 {
-    return Write(txout, output);
+    return (Write(txout, output) && WriteAddressIndex(txout, output));
 }
 
 bool CForkUnspentDB::ReadUnspent(const CTxOutPoint& txout, CTxOut& output)
@@ -151,6 +158,11 @@ bool CForkUnspentDB::Copy(CForkUnspentDB& dbUnspent)
             return false;
         }
 
+        if (!dbUnspent.Write(string("destver"), uint32(UNSPENT_ADDRESS_INDEX_VERSION)))
+        {
+            return false;
+        }
+
         dbUnspent.SetCache(dblCache);
     }
     catch (exception& e)
@@ -210,9 +222,142 @@ bool CForkUnspentDB::WalkThroughUnspent(CForkUnspentDBWalker& walker)
     return true;
 }
 
+bool CForkUnspentDB::WalkThroughAddressUnspent(const CDestination& dest, CForkUnspentDBWalker& walker)
+{
+    try
+    {
+        xengine::CReadLock rdlock(rwLower);
+        xengine::CReadLock rulock(rwUpper);
+
+        MapType& mapUpper = dblCache.GetUpperMap();
+        MapType& mapLower = dblCache.GetLowerMap();
+
+        if (!WalkThroughOfPrefix(boost::bind(&CForkUnspentDB::AddressWalker, this, _1, _2, boost::ref(walker),
+                                             boost::ref(mapUpper), boost::ref(mapLower)),
+                                 make_pair(string("dest"), dest), make_pair(string("dest"), dest)))
+        {
+            return false;
+        }
+
+        MapDestType& mapLowerDest = dblCache.GetLowerDestMap();
+        MapDestType::iterator itLower = mapLowerDest.find(dest);
+        if (itLower != mapLowerDest.end())
+        {
+            for (const CTxOutPoint& txout : (*itLower).second)
+            {
+                MapType::iterator it = mapLower.find(txout);
+                if (!mapUpper.count(txout) && it != mapLower.end() && !(*it).second.IsNull())
+                {
+                    if (!walker.Walk(txout, (*it).second))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        MapDestType& mapUpperDest = dblCache.GetUpperDestMap();
+        MapDestType::iterator itUpper = mapUpperDest.find(dest);
+        if (itUpper != mapUpperDest.end())
+        {
+            for (const CTxOutPoint& txout : (*itUpper).second)
+            {
+                MapType::iterator it = mapUpper.find(txout);
+                if (it != mapUpper.end() && !(*it).second.IsNull())
+                {
+                    if (!walker.Walk(txout, (*it).second))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CForkUnspentDB::CheckAddressIndex()
+{
+    uint32 nVersion = 0;
+    if (Read(string("destver"), nVersion) && nVersion == UNSPENT_ADDRESS_INDEX_VERSION)
+    {
+        return true;
+    }
+
+    // index entries are idempotent, an interrupted rebuild is simply redone on next load
+    if (!WalkThrough(boost::bind(&CForkUnspentDB::BuildAddressIndexWalker, this, _1, _2)))
+    {
+        return false;
+    }
+    return Write(string("destver"), uint32(UNSPENT_ADDRESS_INDEX_VERSION));
+}
+
+bool CForkUnspentDB::IsUnspentKey(CBufStream& ssKey) const
+{
+    return (ssKey.GetSize() == UNSPENT_KEY_SIZE);
+}
+
+bool CForkUnspentDB::WriteAddressIndex(const CTxOutPoint& txout, const CTxOut& output)
+{
+    return Write(make_pair(string("dest"), make_pair(output.destTo, txout)), output);
+}
+
+bool CForkUnspentDB::EraseAddressIndex(const CTxOutPoint& txout)
+{
+    CTxOut output;
+    if (!Read(txout, output))
+    {
+        return true;
+    }
+    return Erase(make_pair(string("dest"), make_pair(output.destTo, txout)));
+}
+
+bool CForkUnspentDB::BuildAddressIndexWalker(CBufStream& ssKey, CBufStream& ssValue)
+{
+    if (!IsUnspentKey(ssKey))
+    {
+        return true;
+    }
+
+    CTxOutPoint txout;
+    CTxOut output;
+    ssKey >> txout;
+    ssValue >> output;
+
+    return WriteAddressIndex(txout, output);
+}
+
+bool CForkUnspentDB::AddressWalker(CBufStream& ssKey, CBufStream& ssValue,
+                                   CForkUnspentDBWalker& walker, const MapType& mapUpper, const MapType& mapLower)
+{
+    pair<string, pair<CDestination, CTxOutPoint>> key;
+    ssKey >> key;
+
+    const CTxOutPoint& txout = key.second.second;
+    if (mapUpper.count(txout) || mapLower.count(txout))
+    {
+        return true;
+    }
+
+    CTxOut output;
+    ssValue >> output;
+
+    return walker.Walk(txout, output);
+}
+
 bool CForkUnspentDB::CopyWalker(CBufStream& ssKey, CBufStream& ssValue,
                                 CForkUnspentDB& dbUnspent)
 {
+    if (!IsUnspentKey(ssKey))
+    {
+        return true;
+    }
+
     CTxOutPoint txout;
     CTxOut output;
     ssKey >> txout;
@@ -224,6 +369,11 @@ bool CForkUnspentDB::CopyWalker(CBufStream& ssKey, CBufStream& ssValue,
 bool CForkUnspentDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
                                 CForkUnspentDBWalker& walker, const MapType& mapUpper, const MapType& mapLower)
 {
+    if (!IsUnspentKey(ssKey))
+    {
+        return true;
+    }
+
     CTxOutPoint txout;
     CTxOut output;
     ssKey >> txout;
@@ -267,10 +417,12 @@ bool CForkUnspentDB::Flush()
     for (int i = 0; i < vAddNew.size(); i++)
     {
         Write(vAddNew[i].first, vAddNew[i].second);
+        WriteAddressIndex(vAddNew[i].first, vAddNew[i].second);
     }
 
     for (int i = 0; i < vRemove.size(); i++)
     {
+        EraseAddressIndex(vRemove[i]);
         Erase(vRemove[i]);
     }
 
@@ -380,6 +532,11 @@ bool CUnspentDB::LoadFork(const uint256& hashFork)
     {
         return false;
     }
+    if (!spUnspent->CheckAddressIndex())
+    {
+        StdError("CUnspentDB", "Load fork: check address index fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
     mapUnspentDB.insert(make_pair(hashFork, spUnspent));
     return true;
 }
@@ -488,6 +645,18 @@ bool CUnspentDB::WalkThrough(const uint256& hashFork, CForkUnspentDBWalker& walk
     return false;
 }
 
+bool CUnspentDB::WalkThroughAddress(const uint256& hashFork, const CDestination& dest, CForkUnspentDBWalker& walker)
+{
+    CReadLock rlock(rwAccess);
+
+    map<uint256, std::shared_ptr<CForkUnspentDB>>::iterator it = mapUnspentDB.find(hashFork);
+    if (it != mapUnspentDB.end())
+    {
+        return (*it).second->WalkThroughAddressUnspent(dest, walker);
+    }
+    return false;
+}
+
 void CUnspentDB::Flush(const uint256& hashFork)
 {
     boost::unique_lock<boost::mutex> lock(mtxFlush);
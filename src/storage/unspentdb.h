@@ -87,54 +87,6 @@ public:
     std::vector<CTxUnspent> vUnspent;
 };
 
-//////////////////////////////
-// CListUnspentBatchWalker
-
-class CListUnspentBatchWalker : public CForkUnspentDBWalker
-{
-public:
-    CListUnspentBatchWalker(const uint256& forkidIn, std::map<CDestination, std::vector<CTxUnspent>>& mapOwnersIn, uint32 maxIn)
-      : forkId(forkidIn), mapUnspent(mapOwnersIn), nMax(maxIn)
-    {
-        for (const auto& i : mapUnspent)
-        {
-            mapCount.insert(std::make_pair(i.first, 0));
-        }
-    }
-    bool Walk(const CTxOutPoint& txout, const CTxOut& output) override
-    {
-        if (nMax != 0 && AllFill())
-        {
-            return false; //exit walk through processing
-        }
-        if (mapUnspent.count(output.destTo) && (nMax == 0 || mapUnspent[output.destTo].size() < nMax))
-        {
-            mapUnspent[output.destTo].emplace_back(CTxUnspent(txout, output));
-            ++mapCount[output.destTo];
-        }
-        return true; //continue walk through processing
-    }
-
-private:
-    bool AllFill() const
-    {
-        for (const auto& i : mapCount)
-        {
-            if (i.second < nMax)
-            {
-                return false;
-            }
-        }
-        return true;
-    }
-
-public:
-    const uint256& forkId;
-    uint32 nMax;
-    std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent;
-    std::map<CDestination, uint8> mapCount;
-};
-
 //////////////////////////////
 // CListAddressUnspentWalker
 
@@ -166,6 +118,7 @@ public:
 class CForkUnspentDB : public xengine::CKVDB
 {
     typedef std::map<CTxOutPoint, CTxOut> MapType;
+    typedef std::map<CDestination, std::set<CTxOutPoint>> MapDestType;
     class CDblMap
     {
     public:
@@ -179,21 +132,33 @@ class CForkUnspentDB : public xengine::CKVDB
         {
             return mapCache[nIdxUpper ^ 1];
         }
+        MapDestType& GetUpperDestMap()
+        {
+            return mapDestCache[nIdxUpper];
+        }
+        MapDestType& GetLowerDestMap()
+        {
+            return mapDestCache[nIdxUpper ^ 1];
+        }
         void Flip()
         {
             MapType& mapLower = mapCache[nIdxUpper ^ 1];
             mapLower.clear();
+            mapDestCache[nIdxUpper ^ 1].clear();
             nIdxUpper = nIdxUpper ^ 1;
         }
         void Clear()
         {
             mapCache[0].clear();
             mapCache[1].clear();
+            mapDestCache[0].clear();
+            mapDestCache[1].clear();
             nIdxUpper = 0;
         }
 
     protected:
         MapType mapCache[2];
+        MapDestType mapDestCache[2];
         int nIdxUpper;
     };
 
@@ -211,9 +176,17 @@ public:
         dblCache = dblCacheIn;
     }
     bool WalkThroughUnspent(CForkUnspentDBWalker& walker);
+    bool WalkThroughAddressUnspent(const CDestination& dest, CForkUnspentDBWalker& walker);
+    bool CheckAddressIndex();
     bool Flush();
 
 protected:
+    bool IsUnspentKey(xengine::CBufStream& ssKey) const;
+    bool WriteAddressIndex(const CTxOutPoint& txout, const CTxOut& output);
+    bool EraseAddressIndex(const CTxOutPoint& txout);
+    bool BuildAddressIndexWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue);
+    bool AddressWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
+                       CForkUnspentDBWalker& walker, const MapType& mapUpper, const MapType& mapLower);
     bool CopyWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkUnspentDB& dbUnspent);
     bool LoadWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
@@ -246,6 +219,7 @@ public:
     bool Retrieve(const uint256& hashFork, const CTxOutPoint& txout, CTxOut& output);
     bool Copy(const uint256& srcFork, const uint256& destFork);
     bool WalkThrough(const uint256& hashFork, CForkUnspentDBWalker& walker);
+    bool WalkThroughAddress(const uint256& hashFork, const CDestination& dest, CForkUnspentDBWalker& walker);
     void Flush(const uint256& hashFork);
 
 protected:
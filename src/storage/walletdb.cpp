@@ -98,6 +98,105 @@ bool CWalletAddrDB::AddressDBWalker(CBufStream& ssKey, CBufStream& ssValue, CWal
     return false;
 }
 
+//////////////////////////////
+// CWalletTxSeqIndex
+
+void CWalletTxSeqIndex::Clear()
+{
+    listAll.clear();
+    mapFork.clear();
+    mapDest.clear();
+    mapForkDest.clear();
+}
+
+void CWalletTxSeqIndex::AddNew(uint64 nSeq, const CWalletTx& wtx)
+{
+    Insert(listAll, nSeq);
+    Insert(mapFork[wtx.hashFork], nSeq);
+    for (const CDestination* pDest : { &wtx.destIn, &wtx.sendTo })
+    {
+        if (!pDest->IsNull())
+        {
+            Insert(mapDest[*pDest], nSeq);
+            Insert(mapForkDest[make_pair(wtx.hashFork, *pDest)], nSeq);
+        }
+    }
+}
+
+void CWalletTxSeqIndex::Remove(uint64 nSeq, const CWalletTx& wtx)
+{
+    Erase(listAll, nSeq);
+    Erase(mapFork[wtx.hashFork], nSeq);
+    for (const CDestination* pDest : { &wtx.destIn, &wtx.sendTo })
+    {
+        if (!pDest->IsNull())
+        {
+            Erase(mapDest[*pDest], nSeq);
+            Erase(mapForkDest[make_pair(wtx.hashFork, *pDest)], nSeq);
+        }
+    }
+}
+
+size_t CWalletTxSeqIndex::GetCount(const uint256& hashFork, const CDestination& dest) const
+{
+    const CSeqList* pList = GetList(hashFork, dest);
+    return (pList != nullptr ? pList->size() : 0);
+}
+
+void CWalletTxSeqIndex::List(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, vector<uint64>& vSeq) const
+{
+    const CSeqList* pList = GetList(hashFork, dest);
+    if (pList != nullptr && nOffset >= 0 && nOffset < pList->size() && nCount > 0)
+    {
+        CSeqList::const_iterator it = pList->begin() + nOffset;
+        vSeq.insert(vSeq.end(), it, it + min((size_t)nCount, (size_t)(pList->end() - it)));
+    }
+}
+
+const CWalletTxSeqIndex::CSeqList* CWalletTxSeqIndex::GetList(const uint256& hashFork, const CDestination& dest) const
+{
+    if (!hashFork && dest.IsNull())
+    {
+        return &listAll;
+    }
+    else if (dest.IsNull())
+    {
+        map<uint256, CSeqList>::const_iterator it = mapFork.find(hashFork);
+        return (it != mapFork.end() ? &(*it).second : nullptr);
+    }
+    else if (!hashFork)
+    {
+        map<CDestination, CSeqList>::const_iterator it = mapDest.find(dest);
+        return (it != mapDest.end() ? &(*it).second : nullptr);
+    }
+    map<pair<uint256, CDestination>, CSeqList>::const_iterator it = mapForkDest.find(make_pair(hashFork, dest));
+    return (it != mapForkDest.end() ? &(*it).second : nullptr);
+}
+
+void CWalletTxSeqIndex::Insert(CSeqList& listSeq, uint64 nSeq)
+{
+    // new txs get the next sequence, the list mostly grows at the back
+    if (listSeq.empty() || listSeq.back() < nSeq)
+    {
+        listSeq.push_back(nSeq);
+        return;
+    }
+    CSeqList::iterator it = lower_bound(listSeq.begin(), listSeq.end(), nSeq);
+    if (*it != nSeq)
+    {
+        listSeq.insert(it, nSeq);
+    }
+}
+
+void CWalletTxSeqIndex::Erase(CSeqList& listSeq, uint64 nSeq)
+{
+    CSeqList::iterator it = lower_bound(listSeq.begin(), listSeq.end(), nSeq);
+    if (it != listSeq.end() && *it == nSeq)
+    {
+        listSeq.erase(it);
+    }
+}
+
 //////////////////////////////
 // CWalletTxDB
 
@@ -119,6 +218,14 @@ bool CWalletTxDB::Initialize(const boost::filesystem::path& pathWallet)
         return Reset();
     }
 
+    seqIndex.Clear();
+    if (!WalkThroughOfPrefix(boost::bind(&CWalletTxDB::TxIndexWalker, this, _1, _2),
+                             make_pair(string("wtx"), uint256()), string("wtx")))
+    {
+        StdLog("CWalletTxDB", "Initialize: build sequence index fail.");
+        return false;
+    }
+
     return true;
 }
 
@@ -130,6 +237,7 @@ void CWalletTxDB::Deinitialize()
 bool CWalletTxDB::Clear()
 {
     RemoveAll();
+    seqIndex.Clear();
     return Reset();
 }
 
@@ -165,6 +273,7 @@ bool CWalletTxDB::AddNewTx(const CWalletTx& wtx)
     }
 
     ++nTxCount;
+    seqIndex.AddNew(pairWalletTx.first, wtx);
 
     return true;
 }
@@ -189,7 +298,7 @@ bool CWalletTxDB::UpdateTx(const vector<CWalletTx>& vWalletTx, const vector<uint
         }
     }
 
-    vector<pair<uint64, uint256>> vTxRemove;
+    vector<pair<uint64, CWalletTx>> vTxRemove;
     vTxRemove.reserve(vRemove.size());
 
     for (const uint256& txid : vRemove)
@@ -197,7 +306,7 @@ bool CWalletTxDB::UpdateTx(const vector<CWalletTx>& vWalletTx, const vector<uint
         pair<uint64, CWalletTx> pairWalletTx;
         if (Read(make_pair(string("wtx"), txid), pairWalletTx))
         {
-            vTxRemove.push_back(make_pair(pairWalletTx.first, txid));
+            vTxRemove.push_back(pairWalletTx);
         }
     }
 
@@ -221,7 +330,7 @@ bool CWalletTxDB::UpdateTx(const vector<CWalletTx>& vWalletTx, const vector<uint
 
     for (int i = 0; i < vTxRemove.size(); i++)
     {
-        if (!Erase(make_pair(string("wtx"), vTxRemove[i].second))
+        if (!Erase(make_pair(string("wtx"), vTxRemove[i].second.txid))
             || !Erase(make_pair(string("seq"), BSwap64(vTxRemove[i].first))))
         {
             StdLog("CWalletTxDB", "UpdateTx: Erase fail.");
@@ -245,6 +354,14 @@ bool CWalletTxDB::UpdateTx(const vector<CWalletTx>& vWalletTx, const vector<uint
     }
 
     nTxCount += nTxAddNew - vTxRemove.size();
+    for (const pair<uint64, CWalletTx>& pairWalletTx : vTxUpdate)
+    {
+        seqIndex.AddNew(pairWalletTx.first, pairWalletTx.second);
+    }
+    for (const pair<uint64, CWalletTx>& pairWalletTx : vTxRemove)
+    {
+        seqIndex.Remove(pairWalletTx.first, pairWalletTx.second);
+    }
 
     return true;
 }
@@ -271,6 +388,29 @@ size_t CWalletTxDB::GetTxCount()
     return nTxCount;
 }
 
+size_t CWalletTxDB::GetTxCount(const uint256& hashFork, const CDestination& dest)
+{
+    return seqIndex.GetCount(hashFork, dest);
+}
+
+bool CWalletTxDB::ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, vector<CWalletTx>& vWalletTx)
+{
+    vector<uint64> vSeq;
+    seqIndex.List(hashFork, dest, nOffset, nCount, vSeq);
+    for (const uint64 nSeq : vSeq)
+    {
+        CWalletTxSeq txSeq;
+        CWalletTx wtx;
+        if (!Read(make_pair(string("seq"), BSwap64(nSeq)), txSeq) || !RetrieveTx(txSeq.txid, wtx))
+        {
+            StdLog("CWalletTxDB", "ListTx: read tx fail, seq: %lu", nSeq);
+            return false;
+        }
+        vWalletTx.push_back(wtx);
+    }
+    return true;
+}
+
 bool CWalletTxDB::WalkThroughTxSeq(CWalletDBTxSeqWalker& walker)
 {
     return WalkThrough(boost::bind(&CWalletTxDB::TxSeqWalker, this, _1, _2, boost::ref(walker)),
@@ -335,6 +475,14 @@ bool CWalletTxDB::TxWalker(CBufStream& ssKey, CBufStream& ssValue, CWalletDBTxWa
     return walker.Walk(wtx);
 }
 
+bool CWalletTxDB::TxIndexWalker(CBufStream& ssKey, CBufStream& ssValue)
+{
+    pair<uint64, CWalletTx> pairWalletTx;
+    ssValue >> pairWalletTx;
+    seqIndex.AddNew(pairWalletTx.first, pairWalletTx.second);
+    return true;
+}
+
 bool CWalletTxDB::Reset()
 {
     nSequence = 0;
@@ -360,44 +508,6 @@ bool CWalletTxDB::Reset()
     return TxnCommit();
 }
 
-//////////////////////////////
-// CWalletDBListTxSeqWalker
-
-class CWalletDBListTxSeqWalker : public CWalletDBTxSeqWalker
-{
-public:
-    CWalletDBListTxSeqWalker(const uint256& hashForkIn, int nOffsetIn, int nMaxCountIn)
-      : nHashFork(hashForkIn), nOffset(nOffsetIn), nMaxCount(nMaxCountIn), nIndex(0)
-    {
-    }
-    bool Walk(const uint256& txid, const uint256& hashFork, const int nBlockHeight) override
-    {
-        if (nIndex++ < nOffset)
-        {
-            return true;
-        }
-
-        if (!!nHashFork && nHashFork == hashFork)
-        {
-            vWalletTxid.push_back(txid);
-        }
-
-        if (!nHashFork)
-        {
-            vWalletTxid.push_back(txid);
-        }
-
-        return (vWalletTxid.size() < nMaxCount);
-    }
-
-public:
-    int nOffset;
-    int nMaxCount;
-    int nIndex;
-    const uint256 nHashFork;
-    vector<uint256> vWalletTxid;
-};
-
 //////////////////////////////
 // CWalletDBRollBackTxSeqWalker
 
@@ -544,66 +654,33 @@ size_t CWalletDB::GetTxCount()
     return dbWtx.GetTxCount() + txCache.Count();
 }
 
+size_t CWalletDB::GetTxCount(const uint256& hashFork, const CDestination& dest)
+{
+    return dbWtx.GetTxCount(hashFork, dest) + txCache.Count(hashFork, dest);
+}
+
 bool CWalletDB::ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, vector<CWalletTx>& vWalletTx)
 {
-    size_t nDBTx = dbWtx.GetTxCount();
-    vector<CWalletTx> vTempWalletTx;
+    // stored txs first, then the unconfirmed ones in the cache
+    size_t nDBTx = dbWtx.GetTxCount(hashFork, dest);
     if (nOffset < nDBTx)
     {
-        if (!ListDBTx(hashFork, nOffset, nCount, vTempWalletTx))
+        size_t nSize = vWalletTx.size();
+        if (!dbWtx.ListTx(hashFork, dest, nOffset, nCount, vWalletTx))
         {
             return false;
         }
-        if (vTempWalletTx.size() < nCount)
-        {
-            txCache.ListTx(0, nCount - vTempWalletTx.size(), vTempWalletTx);
-        }
+        nCount -= (vWalletTx.size() - nSize);
+        nOffset = 0;
     }
     else
     {
-        txCache.ListTx(nOffset - nDBTx, nCount, vTempWalletTx);
-    }
-
-    std::copy_if(vTempWalletTx.begin(), vTempWalletTx.end(), std::back_inserter(vWalletTx), [&hashFork, &dest](const CWalletTx& tx) -> bool {
-        if (!!hashFork && !dest.IsNull())
-        {
-            return (tx.hashFork == hashFork && (tx.destIn == dest || tx.sendTo == dest));
-        }
-
-        if (!!hashFork && dest.IsNull())
-        {
-            return tx.hashFork == hashFork;
-        }
-
-        if (!hashFork && !dest.IsNull())
-        {
-            return (tx.destIn == dest || tx.sendTo == dest);
-        }
-
-        return true;
-    });
-
-    return true;
-}
-
-bool CWalletDB::ListDBTx(const uint256& hashFork, int nOffset, int nCount, vector<CWalletTx>& vWalletTx)
-{
-    CWalletDBListTxSeqWalker walker(hashFork, nOffset, nCount);
-    if (!dbWtx.WalkThroughTxSeq(walker))
-    {
-        return false;
+        nOffset -= nDBTx;
     }
-
-    for (const uint256& txid : walker.vWalletTxid)
+    if (nCount > 0)
     {
-        CWalletTx wtx;
-        if (!dbWtx.RetrieveTx(txid, wtx))
-        {
-            return false;
-        }
-        vWalletTx.push_back(wtx);
+        txCache.ListTx(hashFork, dest, nOffset, nCount, vWalletTx);
     }
-
     return true;
 }
 
@@ -76,6 +76,33 @@ protected:
     }
 };
 
+/* Sequence numbers of the stored wallet txs, for the whole wallet, by fork,
+   by address and by fork and address. Every list is kept sorted, a page at
+   any offset is located by position and its txs are read by sequence from
+   the db, only the sequence numbers are held in memory. */
+class CWalletTxSeqIndex
+{
+    typedef std::vector<uint64> CSeqList;
+
+public:
+    void Clear();
+    void AddNew(uint64 nSeq, const CWalletTx& wtx);
+    void Remove(uint64 nSeq, const CWalletTx& wtx);
+    std::size_t GetCount(const uint256& hashFork, const CDestination& dest) const;
+    void List(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, std::vector<uint64>& vSeq) const;
+
+protected:
+    const CSeqList* GetList(const uint256& hashFork, const CDestination& dest) const;
+    static void Insert(CSeqList& listSeq, uint64 nSeq);
+    static void Erase(CSeqList& listSeq, uint64 nSeq);
+
+protected:
+    CSeqList listAll;
+    std::map<uint256, CSeqList> mapFork;
+    std::map<CDestination, CSeqList> mapDest;
+    std::map<std::pair<uint256, CDestination>, CSeqList> mapForkDest;
+};
+
 class CWalletTxDB : public xengine::CKVDB
 {
 public:
@@ -97,17 +124,21 @@ public:
     bool RetrieveTx(const uint256& txid, CWalletTx& wtx);
     bool ExistsTx(const uint256& txid);
     std::size_t GetTxCount();
+    std::size_t GetTxCount(const uint256& hashFork, const CDestination& dest);
+    bool ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, std::vector<CWalletTx>& vWalletTx);
     bool WalkThroughTxSeq(CWalletDBTxSeqWalker& walker);
     bool WalkThroughTx(CWalletDBTxWalker& walker);
 
 protected:
     bool TxSeqWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, CWalletDBTxSeqWalker& walker);
     bool TxWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, CWalletDBTxWalker& walker);
+    bool TxIndexWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue);
     bool Reset();
 
 protected:
     uint64 nSequence;
     std::size_t nTxCount;
+    CWalletTxSeqIndex seqIndex;
 };
 
 class CWalletTxCache
@@ -131,6 +162,12 @@ public:
     {
         return listWalletTx.size();
     }
+    std::size_t Count(const uint256& hashFork, const CDestination& dest)
+    {
+        return std::count_if(listWalletTx.begin(), listWalletTx.end(), [&](const CWalletTx& wtx) -> bool {
+            return Match(wtx, hashFork, dest);
+        });
+    }
     void Clear()
     {
         listWalletTx.clear();
@@ -180,6 +217,21 @@ public:
             vWalletTx.push_back((*it));
         }
     }
+    void ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, std::vector<CWalletTx>& vWalletTx)
+    {
+        for (CWalletTxList::iterator it = listWalletTx.begin(); it != listWalletTx.end() && nCount > 0; ++it)
+        {
+            if (Match(*it, hashFork, dest) && nOffset-- <= 0)
+            {
+                vWalletTx.push_back((*it));
+                nCount--;
+            }
+        }
+    }
+    static bool Match(const CWalletTx& wtx, const uint256& hashFork, const CDestination& dest)
+    {
+        return ((!hashFork || wtx.hashFork == hashFork) && (dest.IsNull() || wtx.destIn == dest || wtx.sendTo == dest));
+    }
     void ListForkTx(const uint256& hashFork, std::vector<uint256>& vForkTx)
     {
         CWalletTxListByFork& idxByFork = listWalletTx.get<2>();
@@ -210,14 +262,12 @@ public:
     bool RetrieveTx(const uint256& txid, CWalletTx& wtx);
     bool ExistsTx(const uint256& txid);
     std::size_t GetTxCount();
+    std::size_t GetTxCount(const uint256& hashFork, const CDestination& dest);
     bool ListTx(const uint256& hashFork, const CDestination& dest, int nOffset, int nCount, std::vector<CWalletTx>& vWalletTx);
     bool ListRollBackTx(const uint256& hashFork, int nMinHeight, std::vector<uint256>& vForkTx);
     bool WalkThroughTx(CWalletDBTxWalker& walker);
     bool ClearTx();
 
-protected:
-    bool ListDBTx(const uint256& hashFork, int nOffset, int nCount, std::vector<CWalletTx>& vWalletTx);
-
 protected:
     CWalletAddrDB dbAddr;
     CWalletTxDB dbWtx;
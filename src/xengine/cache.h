@@ -5,18 +5,37 @@
 #ifndef XENGINE_CACHE_H
 #define XENGINE_CACHE_H
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/thread/thread.hpp>
 
-#include "rwlock.h"
-
 namespace xengine
 {
 
-template <typename K, typename V>
+class CCacheStat
+{
+public:
+    CCacheStat()
+      : nCount(0), nCost(0), nHit(0), nMiss(0), nEvict(0) {}
+
+public:
+    std::size_t nCount;
+    std::size_t nCost;
+    uint64_t nHit;
+    uint64_t nMiss;
+    uint64_t nEvict;
+};
+
+/* LRU cache split into shards by key hash, every shard has its own lock.
+   nMaxCost bounds the total cost of the entries (1 per entry unless AddNew
+   is given a cost), 0 means unlimited. Retrieve moves the entry to the back
+   of its shard list, eviction pops the front. An entry costing more than a
+   shard holds is kept alone in its shard until the next insert there. */
+template <typename K, typename V, typename H = boost::hash<K>>
 class CCache
 {
     class CKeyValue
@@ -24,11 +43,13 @@ class CCache
     public:
         K key;
         mutable V value;
+        mutable std::size_t nCost;
 
     public:
-        CKeyValue() {}
-        CKeyValue(const K& keyIn, const V& valueIn)
-          : key(keyIn), value(valueIn) {}
+        CKeyValue()
+          : nCost(0) {}
+        CKeyValue(const K& keyIn, const V& valueIn, std::size_t nCostIn)
+          : key(keyIn), value(valueIn), nCost(nCostIn) {}
     };
     typedef boost::multi_index_container<
         CKeyValue,
@@ -38,54 +59,142 @@ class CCache
         CKeyValueContainer;
     typedef typename CKeyValueContainer::template nth_index<1>::type CKeyValueList;
 
+    class CShard
+    {
+    public:
+        CShard()
+          : nMaxCost(0), nCost(0), nHit(0), nMiss(0), nEvict(0) {}
+
+    public:
+        boost::mutex mtxShard;
+        CKeyValueContainer cntrCache;
+        std::size_t nMaxCost;
+        std::size_t nCost;
+        uint64_t nHit;
+        uint64_t nMiss;
+        uint64_t nEvict;
+    };
+
 public:
-    CCache(std::size_t nMaxCountIn = 0)
-      : nMaxCount(nMaxCountIn) {}
+    enum
+    {
+        DEFAULT_SHARD_COUNT = 16
+    };
+    CCache(std::size_t nMaxCostIn = 0, std::size_t nShardCountIn = DEFAULT_SHARD_COUNT)
+    {
+        // every shard should be able to hold a few entries
+        nShardCount = std::max((std::size_t)1, nShardCountIn);
+        if (nMaxCostIn != 0)
+        {
+            nShardCount = std::min(nShardCount, std::max((std::size_t)1, nMaxCostIn / 4));
+        }
+        pShard = new CShard[nShardCount];
+        for (std::size_t i = 0; i < nShardCount; i++)
+        {
+            pShard[i].nMaxCost = (nMaxCostIn + nShardCount - 1) / nShardCount;
+        }
+    }
+    ~CCache()
+    {
+        delete[] pShard;
+    }
     bool Exists(const K& key) const
     {
-        CReadLock rlock(rwAccess);
-        return (!!cntrCache.count(key));
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+        return (!!shard.cntrCache.count(key));
     }
-    bool Retrieve(const K& key, V& value) const
+    bool Retrieve(const K& key, V& value)
     {
-        CReadLock rlock(rwAccess);
-        typename CKeyValueContainer::const_iterator it = cntrCache.find(key);
-        if (it != cntrCache.end())
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+        typename CKeyValueContainer::iterator it = shard.cntrCache.find(key);
+        if (it == shard.cntrCache.end())
         {
-            value = (*it).value;
-            return true;
+            shard.nMiss++;
+            return false;
         }
-        return false;
+        value = (*it).value;
+        CKeyValueList& listCache = shard.cntrCache.template get<1>();
+        listCache.relocate(listCache.end(), shard.cntrCache.template project<1>(it));
+        shard.nHit++;
+        return true;
     }
-    void AddNew(const K& key, const V& value)
+    void AddNew(const K& key, const V& value, std::size_t nCost = 1)
     {
-        CWriteLock wlock(rwAccess);
-        std::pair<typename CKeyValueContainer::iterator, bool> ret = cntrCache.insert(CKeyValue(key, value));
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+        std::pair<typename CKeyValueContainer::iterator, bool> ret = shard.cntrCache.insert(CKeyValue(key, value, nCost));
         if (!ret.second)
         {
+            shard.nCost -= (*(ret.first)).nCost;
             (*(ret.first)).value = value;
+            (*(ret.first)).nCost = nCost;
+            CKeyValueList& listCache = shard.cntrCache.template get<1>();
+            listCache.relocate(listCache.end(), shard.cntrCache.template project<1>(ret.first));
         }
-        if (nMaxCount != 0 && cntrCache.size() > nMaxCount)
+        shard.nCost += nCost;
+        if (shard.nMaxCost != 0)
         {
-            CKeyValueList& listCache = cntrCache.template get<1>();
-            listCache.pop_front();
+            // the new entry is at the back and always stays, even if it is larger than the shard
+            CKeyValueList& listCache = shard.cntrCache.template get<1>();
+            while (shard.nCost > shard.nMaxCost && listCache.size() > 1)
+            {
+                shard.nCost -= listCache.front().nCost;
+                listCache.pop_front();
+                shard.nEvict++;
+            }
         }
     }
     void Remove(const K& key)
     {
-        CWriteLock wlock(rwAccess);
-        cntrCache.erase(key);
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+        typename CKeyValueContainer::iterator it = shard.cntrCache.find(key);
+        if (it != shard.cntrCache.end())
+        {
+            shard.nCost -= (*it).nCost;
+            shard.cntrCache.erase(it);
+        }
     }
     void Clear()
     {
-        CWriteLock wlock(rwAccess);
-        cntrCache.clear();
+        for (std::size_t i = 0; i < nShardCount; i++)
+        {
+            boost::unique_lock<boost::mutex> lock(pShard[i].mtxShard);
+            pShard[i].cntrCache.clear();
+            pShard[i].nCost = 0;
+        }
+    }
+    void GetStat(CCacheStat& stat) const
+    {
+        stat = CCacheStat();
+        for (std::size_t i = 0; i < nShardCount; i++)
+        {
+            boost::unique_lock<boost::mutex> lock(pShard[i].mtxShard);
+            stat.nCount += pShard[i].cntrCache.size();
+            stat.nCost += pShard[i].nCost;
+            stat.nHit += pShard[i].nHit;
+            stat.nMiss += pShard[i].nMiss;
+            stat.nEvict += pShard[i].nEvict;
+        }
     }
 
 protected:
-    mutable CRWAccess rwAccess;
-    CKeyValueContainer cntrCache;
-    std::size_t nMaxCount;
+    CShard& GetShard(const K& key) const
+    {
+        // spread the key hash, some keys carry type bits in the low bits
+        uint64_t n = (uint64_t)H()(key) * 0x9E3779B97F4A7C15ULL;
+        return pShard[(std::size_t)(n >> 32) % nShardCount];
+    }
+
+private:
+    CCache(const CCache&);
+    CCache& operator=(const CCache&);
+
+protected:
+    std::size_t nShardCount;
+    CShard* pShard;
 };
 
 } // namespace xengine
@@ -0,0 +1,171 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workerpool.h"
+
+#include <boost/bind.hpp>
+
+#include "util.h"
+
+using namespace std;
+
+namespace xengine
+{
+
+///////////////////////////////
+// CWorkerPool
+
+CWorkerPool::CWorkerPool(const string& strNameIn)
+  : strName(strNameIn), fExit(false)
+{
+}
+
+CWorkerPool::~CWorkerPool()
+{
+    Stop();
+}
+
+bool CWorkerPool::Start(size_t nWorkerIn)
+{
+    Stop();
+
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWork);
+        fExit = false;
+    }
+
+    try
+    {
+        for (size_t i = 0; i < nWorkerIn; i++)
+        {
+            vThread.push_back(new boost::thread(boost::bind(&CWorkerPool::WorkerThreadFunc, this)));
+        }
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+void CWorkerPool::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWork);
+        fExit = true;
+    }
+    condWork.notify_all();
+
+    for (boost::thread* pThread : vThread)
+    {
+        pThread->join();
+        delete pThread;
+    }
+    vThread.clear();
+
+    // nobody is left to serve the queue, finish the remaining works in place
+    WorkItem item;
+    while (FetchWork(item, false))
+    {
+        RunWork(item);
+    }
+}
+
+void CWorkerPool::Execute(const vector<WorkFunc>& vWork)
+{
+    if (vWork.empty())
+    {
+        return;
+    }
+
+    CWorkBatch batch(vWork.size());
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWork);
+        for (const WorkFunc& fn : vWork)
+        {
+            qWork.push_back(make_pair(fn, &batch));
+        }
+    }
+    condWork.notify_all();
+
+    // only help with our own works, posted works of other callers are left to the workers
+    WorkItem item;
+    while (FetchBatchWork(item, &batch))
+    {
+        RunWork(item);
+    }
+
+    batch.Wait();
+}
+
+void CWorkerPool::Post(const WorkFunc& fn)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWork);
+        qWork.push_back(make_pair(fn, (CWorkBatch*)nullptr));
+    }
+    condWork.notify_one();
+}
+
+void CWorkerPool::WorkerThreadFunc()
+{
+    SetThreadName(strName.c_str());
+
+    WorkItem item;
+    while (FetchWork(item, true))
+    {
+        RunWork(item);
+    }
+}
+
+bool CWorkerPool::FetchWork(WorkItem& item, bool fWait)
+{
+    boost::unique_lock<boost::mutex> lock(mtxWork);
+    while (qWork.empty())
+    {
+        if (!fWait || fExit)
+        {
+            return false;
+        }
+        condWork.wait(lock);
+    }
+    item = qWork.front();
+    qWork.pop_front();
+    return true;
+}
+
+bool CWorkerPool::FetchBatchWork(WorkItem& item, CWorkBatch* pBatch)
+{
+    boost::unique_lock<boost::mutex> lock(mtxWork);
+    for (deque<WorkItem>::iterator it = qWork.begin(); it != qWork.end(); ++it)
+    {
+        if ((*it).second == pBatch)
+        {
+            item = *it;
+            qWork.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void CWorkerPool::RunWork(WorkItem& item)
+{
+    try
+    {
+        item.first();
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    if (item.second != nullptr)
+    {
+        item.second->Done();
+    }
+}
+
+} // namespace xengine
@@ -0,0 +1,86 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef XENGINE_DOCKER_WORKERPOOL_H
+#define XENGINE_DOCKER_WORKERPOOL_H
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace xengine
+{
+
+class CWorkerPool
+{
+public:
+    typedef boost::function<void()> WorkFunc;
+
+    CWorkerPool(const std::string& strNameIn);
+    ~CWorkerPool();
+    bool Start(std::size_t nWorkerIn);
+    void Stop();
+    std::size_t GetWorkerCount() const
+    {
+        return vThread.size();
+    }
+    /* Run all works on the pool and return when every one has finished.
+       The calling thread takes part in processing the works of this call only,
+       so it is safe to call it before Start or from inside a work. */
+    void Execute(const std::vector<WorkFunc>& vWork);
+    /* Queue the work and return at once. It is run by a worker or by Stop,
+       so the pool needs workers to serve it. */
+    void Post(const WorkFunc& fn);
+
+protected:
+    class CWorkBatch
+    {
+    public:
+        CWorkBatch(std::size_t nCountIn)
+          : nCount(nCountIn) {}
+        void Done()
+        {
+            boost::unique_lock<boost::mutex> lock(mtxBatch);
+            if (--nCount == 0)
+            {
+                condBatch.notify_all();
+            }
+        }
+        void Wait()
+        {
+            boost::unique_lock<boost::mutex> lock(mtxBatch);
+            while (nCount > 0)
+            {
+                condBatch.wait(lock);
+            }
+        }
+
+    protected:
+        std::size_t nCount;
+        boost::mutex mtxBatch;
+        boost::condition_variable condBatch;
+    };
+    typedef std::pair<WorkFunc, CWorkBatch*> WorkItem;
+
+    void WorkerThreadFunc();
+    bool FetchWork(WorkItem& item, bool fWait);
+    bool FetchBatchWork(WorkItem& item, CWorkBatch* pBatch);
+    void RunWork(WorkItem& item);
+
+protected:
+    const std::string strName;
+    std::vector<boost::thread*> vThread;
+    std::deque<WorkItem> qWork;
+    boost::mutex mtxWork;
+    boost::condition_variable condWork;
+    bool fExit;
+};
+
+} // namespace xengine
+
+#endif //XENGINE_DOCKER_WORKERPOOL_H
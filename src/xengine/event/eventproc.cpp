@@ -11,18 +11,236 @@ using namespace std;
 namespace xengine
 {
 
+///////////////////////////////
+// CEventQueue
+
+CEventQueue::CEventQueue()
+  : nEnqueuePos(0), nDequeuePos(0), nOverflowSize(0), nWaiting(0), fAbort(false),
+    nDepth(0), nPeakDepth(0), nProcessed(0), nOverflow(0), nTotalLatency(0), nMaxLatency(0)
+{
+    pRing = new CCell[RING_SIZE];
+    for (size_t i = 0; i < RING_SIZE; i++)
+    {
+        pRing[i].nSeq.store(i, memory_order_relaxed);
+        pRing[i].pEvent = nullptr;
+        pRing[i].nTime = 0;
+    }
+}
+
+CEventQueue::~CEventQueue()
+{
+    FreeAll();
+    delete[] pRing;
+}
+
+void CEventQueue::AddNew(CEvent* p)
+{
+    int64 nTime = GetTimeMicros();
+
+    // count the event before it is published, or the consumer may take it first and wrap the depth
+    size_t nNewDepth = ++nDepth;
+    try
+    {
+        if (nOverflowSize.load() != 0 || !PushRing(p, nTime))
+        {
+            boost::unique_lock<boost::mutex> lock(mtxOverflow);
+            qOverflow.push_back(make_pair(p, nTime));
+            nOverflowSize++;
+            nOverflow++;
+        }
+    }
+    catch (...)
+    {
+        --nDepth;
+        throw;
+    }
+
+    size_t nPeak = nPeakDepth.load(memory_order_relaxed);
+    while (nNewDepth > nPeak && !nPeakDepth.compare_exchange_weak(nPeak, nNewDepth, memory_order_relaxed))
+    {
+    }
+
+    if (nWaiting.load() > 0)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWait);
+        condWait.notify_one();
+    }
+}
+
+size_t CEventQueue::Fetch(vector<CEvent*>& vEvent, size_t nMax)
+{
+    vEvent.clear();
+    while (!fAbort.load())
+    {
+        if (FetchReady(vEvent, nMax) > 0)
+        {
+            break;
+        }
+
+        boost::unique_lock<boost::mutex> lock(mtxWait);
+        nWaiting++;
+        if (!fAbort.load() && nDepth.load() == 0)
+        {
+            condWait.wait(lock);
+        }
+        nWaiting--;
+    }
+    return vEvent.size();
+}
+
+void CEventQueue::Reset()
+{
+    FreeAll();
+    fAbort = false;
+}
+
+void CEventQueue::Interrupt()
+{
+    fAbort = true;
+    FreeAll();
+
+    boost::unique_lock<boost::mutex> lock(mtxWait);
+    condWait.notify_all();
+}
+
+void CEventQueue::GetStat(CEventQueueStat& stat) const
+{
+    stat.nDepth = nDepth.load();
+    stat.nPeakDepth = nPeakDepth.load();
+    stat.nProcessed = nProcessed.load();
+    stat.nOverflow = nOverflow.load();
+    stat.nAvgLatency = (stat.nProcessed != 0 ? nTotalLatency.load() / (int64)stat.nProcessed : 0);
+    stat.nMaxLatency = nMaxLatency.load();
+}
+
+bool CEventQueue::PushRing(CEvent* p, int64 nTime)
+{
+    size_t nPos = nEnqueuePos.load(memory_order_relaxed);
+    for (;;)
+    {
+        CCell& cell = pRing[nPos & (RING_SIZE - 1)];
+        size_t nSeq = cell.nSeq.load(memory_order_acquire);
+        intptr_t nDiff = (intptr_t)nSeq - (intptr_t)nPos;
+        if (nDiff == 0)
+        {
+            if (nEnqueuePos.compare_exchange_weak(nPos, nPos + 1, memory_order_relaxed))
+            {
+                cell.pEvent = p;
+                cell.nTime = nTime;
+                cell.nSeq.store(nPos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (nDiff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            nPos = nEnqueuePos.load(memory_order_relaxed);
+        }
+    }
+}
+
+bool CEventQueue::PopRing(CEvent*& p, int64& nTime)
+{
+    size_t nPos = nDequeuePos.load(memory_order_relaxed);
+    for (;;)
+    {
+        CCell& cell = pRing[nPos & (RING_SIZE - 1)];
+        size_t nSeq = cell.nSeq.load(memory_order_acquire);
+        intptr_t nDiff = (intptr_t)nSeq - (intptr_t)(nPos + 1);
+        if (nDiff == 0)
+        {
+            if (nDequeuePos.compare_exchange_weak(nPos, nPos + 1, memory_order_relaxed))
+            {
+                p = cell.pEvent;
+                nTime = cell.nTime;
+                cell.nSeq.store(nPos + RING_SIZE, memory_order_release);
+                return true;
+            }
+        }
+        else if (nDiff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            nPos = nDequeuePos.load(memory_order_relaxed);
+        }
+    }
+}
+
+bool CEventQueue::PopOverflow(CEvent*& p, int64& nTime)
+{
+    if (nOverflowSize.load() == 0)
+    {
+        return false;
+    }
+    boost::unique_lock<boost::mutex> lock(mtxOverflow);
+    if (qOverflow.empty())
+    {
+        return false;
+    }
+    p = qOverflow.front().first;
+    nTime = qOverflow.front().second;
+    qOverflow.pop_front();
+    nOverflowSize--;
+    return true;
+}
+
+size_t CEventQueue::FetchReady(vector<CEvent*>& vEvent, size_t nMax)
+{
+    size_t nCount = 0;
+    int64 nNow = GetTimeMicros();
+    while (nCount < nMax)
+    {
+        CEvent* p = nullptr;
+        int64 nTime = 0;
+        if (!PopRing(p, nTime) && !PopOverflow(p, nTime))
+        {
+            break;
+        }
+        vEvent.push_back(p);
+        nDepth--;
+        nCount++;
+
+        int64 nLatency = nNow - nTime;
+        nTotalLatency += nLatency;
+        int64 nPrevMax = nMaxLatency.load(memory_order_relaxed);
+        while (nLatency > nPrevMax && !nMaxLatency.compare_exchange_weak(nPrevMax, nLatency, memory_order_relaxed))
+        {
+        }
+    }
+    nProcessed += nCount;
+    return nCount;
+}
+
+void CEventQueue::FreeAll()
+{
+    CEvent* p = nullptr;
+    int64 nTime = 0;
+    while (PopRing(p, nTime) || PopOverflow(p, nTime))
+    {
+        nDepth--;
+        p->Free();
+    }
+}
+
 ///////////////////////////////
 // CEventProc
 
 CEventProc::CEventProc(const string& ownKeyIn)
   : IBase(ownKeyIn),
-    thrEventQue(ownKeyIn + "-eventq", boost::bind(&CEventProc::EventThreadFunc, this))
+    thrEventQue(ownKeyIn + "-eventq", boost::bind(&CEventProc::EventThreadFunc, this)),
+    nLastStatTime(0)
 {
 }
 
 bool CEventProc::HandleInvoke()
 {
     queEvent.Reset();
+    nLastStatTime = GetTime();
 
     return ThreadStart(thrEventQue);
 }
@@ -32,6 +250,8 @@ void CEventProc::HandleHalt()
     queEvent.Interrupt();
 
     ThreadExit(thrEventQue);
+
+    LogQueueStat();
 }
 
 void CEventProc::PostEvent(CEvent* pEvent)
@@ -41,14 +261,38 @@ void CEventProc::PostEvent(CEvent* pEvent)
 
 void CEventProc::EventThreadFunc()
 {
-    CEvent* pEvent = nullptr;
-    while ((pEvent = queEvent.Fetch()) != nullptr)
+    vector<CEvent*> vEvent;
+    vEvent.reserve(EVENT_FETCH_BATCH);
+    while (queEvent.Fetch(vEvent, EVENT_FETCH_BATCH) > 0)
     {
-        if (!pEvent->Handle(*this))
+        bool fReset = false;
+        for (CEvent* pEvent : vEvent)
+        {
+            // the rest of the batch is dropped together with the queue
+            if (!fReset && !pEvent->Handle(*this))
+            {
+                queEvent.Reset();
+                fReset = true;
+            }
+            pEvent->Free();
+        }
+
+        if (GetTime() - nLastStatTime >= EVENT_STAT_INTERVAL)
         {
-            queEvent.Reset();
+            LogQueueStat();
+            nLastStatTime = GetTime();
         }
-        pEvent->Free();
+    }
+}
+
+void CEventProc::LogQueueStat()
+{
+    CEventQueueStat stat;
+    GetQueueStat(stat);
+    if (stat.nProcessed != 0)
+    {
+        Log("Event queue: depth %lu, processed %lu, peak depth %lu, overflow %lu, latency avg %ld us, max %ld us",
+            stat.nDepth, stat.nProcessed, stat.nPeakDepth, stat.nOverflow, stat.nAvgLatency, stat.nMaxLatency);
     }
 }
 
@@ -7,7 +7,9 @@
 
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
-#include <queue>
+#include <atomic>
+#include <deque>
+#include <vector>
 
 #include "base/base.h"
 #include "event/event.h"
@@ -15,67 +17,76 @@
 namespace xengine
 {
 
+class CEventQueueStat
+{
+public:
+    CEventQueueStat()
+      : nDepth(0), nPeakDepth(0), nProcessed(0), nOverflow(0), nAvgLatency(0), nMaxLatency(0) {}
+
+public:
+    std::size_t nDepth;
+    std::size_t nPeakDepth;
+    uint64 nProcessed;
+    uint64 nOverflow;
+    int64 nAvgLatency; // in microseconds
+    int64 nMaxLatency;
+};
+
+/* Multi-producer multi-consumer queue on a bounded lock-free ring.
+   When the ring is full, events spill into a locked overflow list so that
+   AddNew never blocks nor drops an event; while the overflow list is not
+   empty, new events go there too to keep the order of each producer.
+   Consumers only take the wait lock when the queue is empty, producers only
+   take it when a consumer is sleeping. */
 class CEventQueue
 {
 public:
-    CEventQueue()
-      : fAbort(false) {}
-    ~CEventQueue()
-    {
-        Reset();
-    }
-    void AddNew(CEvent* p)
-    {
-        {
-            boost::unique_lock<boost::mutex> lock(mutex);
-            que.push(p);
-        }
-        cond.notify_one();
-    }
-    CEvent* Fetch()
-    {
-        CEvent* p = nullptr;
-        boost::unique_lock<boost::mutex> lock(mutex);
-        while (!fAbort && que.empty())
-        {
-            cond.wait(lock);
-        }
-        if (!fAbort && !que.empty())
-        {
-            p = que.front();
-            que.pop();
-        }
-        return p;
-    }
-    void Reset()
+    enum
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        while (!que.empty())
-        {
-            que.front()->Free();
-            que.pop();
-        }
-        fAbort = false;
-    }
-    void Interrupt()
+        RING_SIZE = 0x4000
+    };
+    CEventQueue();
+    ~CEventQueue();
+    void AddNew(CEvent* p);
+    std::size_t Fetch(std::vector<CEvent*>& vEvent, std::size_t nMax);
+    void Reset();
+    void Interrupt();
+    void GetStat(CEventQueueStat& stat) const;
+
+protected:
+    class CCell
     {
-        {
-            boost::unique_lock<boost::mutex> lock(mutex);
-            while (!que.empty())
-            {
-                que.front()->Free();
-                que.pop();
-            }
-            fAbort = true;
-        }
-        cond.notify_all();
-    }
+    public:
+        std::atomic<std::size_t> nSeq;
+        CEvent* pEvent;
+        int64 nTime;
+    };
+    bool PushRing(CEvent* p, int64 nTime);
+    bool PopRing(CEvent*& p, int64& nTime);
+    bool PopOverflow(CEvent*& p, int64& nTime);
+    std::size_t FetchReady(std::vector<CEvent*>& vEvent, std::size_t nMax);
+    void FreeAll();
 
 protected:
-    boost::condition_variable cond;
-    boost::mutex mutex;
-    std::queue<CEvent*> que;
-    bool fAbort;
+    CCell* pRing;
+    std::atomic<std::size_t> nEnqueuePos;
+    std::atomic<std::size_t> nDequeuePos;
+
+    boost::mutex mtxOverflow;
+    std::deque<std::pair<CEvent*, int64>> qOverflow;
+    std::atomic<std::size_t> nOverflowSize;
+
+    boost::mutex mtxWait;
+    boost::condition_variable condWait;
+    std::atomic<int> nWaiting;
+    std::atomic<bool> fAbort;
+
+    std::atomic<std::size_t> nDepth;
+    std::atomic<std::size_t> nPeakDepth;
+    std::atomic<uint64> nProcessed;
+    std::atomic<uint64> nOverflow;
+    std::atomic<int64> nTotalLatency;
+    std::atomic<int64> nMaxLatency;
 };
 
 class CEventProc : public IBase
@@ -83,15 +94,27 @@ class CEventProc : public IBase
 public:
     CEventProc(const std::string& ownKeyIn);
     void PostEvent(CEvent* pEvent);
+    void GetQueueStat(CEventQueueStat& stat) const
+    {
+        queEvent.GetStat(stat);
+    }
 
 protected:
     bool HandleInvoke() override;
     void HandleHalt() override;
     void EventThreadFunc();
+    void LogQueueStat();
 
 protected:
+    enum
+    {
+        EVENT_FETCH_BATCH = 64,
+        // seconds between two queue stat logs of the event thread
+        EVENT_STAT_INTERVAL = 600
+    };
     CThread thrEventQue;
     CEventQueue queEvent;
+    int64 nLastStatTime;
 };
 
 } // namespace xengine
@@ -156,14 +156,14 @@ CSocketClient::~CSocketClient()
 
 void CSocketClient::AsyncAccept(tcp::acceptor& acceptor, CallBackConn fnAccepted)
 {
-    acceptor.async_accept(sockClient, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                  fnAccepted, boost::asio::placeholders::error));
+    acceptor.async_accept(sockClient, pContainer->GetIoStrand().wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                                 fnAccepted, boost::asio::placeholders::error)));
 }
 
 void CSocketClient::AsyncConnect(const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
-    sockClient.async_connect(epRemote, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                   fnConnected, boost::asio::placeholders::error));
+    sockClient.async_connect(epRemote, pContainer->GetIoStrand().wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                                  fnConnected, boost::asio::placeholders::error)));
 }
 
 bool CSocketClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const tcp::endpoint& epRemote, CallBackConn fnConnected)
@@ -191,8 +191,8 @@ bool CSocketClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, cons
             }
         }
     }
-    sockClient.async_connect(epRemote, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                   fnConnected, boost::asio::placeholders::error));
+    sockClient.async_connect(epRemote, pContainer->GetIoStrand().wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                                  fnConnected, boost::asio::placeholders::error)));
     return true;
 }
 
@@ -201,9 +201,9 @@ void CSocketClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackFunc f
     boost::asio::async_read(sockClient,
                             (boost::asio::streambuf&)ssRecv,
                             boost::asio::transfer_exactly(nLength),
-                            boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred));
+                            pContainer->GetIoStrand().wrap(boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
+                                                                       boost::asio::placeholders::error,
+                                                                       boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSocketClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc fnCompleted)
@@ -211,9 +211,9 @@ void CSocketClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, Call
     boost::asio::async_read_until(sockClient,
                                   (boost::asio::streambuf&)ssRecv,
                                   delim,
-                                  boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred));
+                                  pContainer->GetIoStrand().wrap(boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
+                                                                             boost::asio::placeholders::error,
+                                                                             boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSocketClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
@@ -221,9 +221,9 @@ void CSocketClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
     boost::asio::async_write(sockClient,
                              (boost::asio::streambuf&)ssSend,
                              boost::asio::transfer_all(),
-                             boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred));
+                             pContainer->GetIoStrand().wrap(boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
+                                                                        boost::asio::placeholders::error,
+                                                                        boost::asio::placeholders::bytes_transferred)));
 }
 
 const tcp::endpoint CSocketClient::SocketGetRemote()
@@ -271,17 +271,17 @@ CSSLClient::~CSSLClient()
 void CSSLClient::AsyncAccept(tcp::acceptor& acceptor, CallBackConn fnAccepted)
 {
     acceptor.async_accept(sslClient.lowest_layer(),
-                          boost::bind(&CSSLClient::HandleConnected, this, fnAccepted,
-                                      boost::asio::ssl::stream_base::server,
-                                      boost::asio::placeholders::error));
+                          pContainer->GetIoStrand().wrap(boost::bind(&CSSLClient::HandleConnected, this, fnAccepted,
+                                                                     boost::asio::ssl::stream_base::server,
+                                                                     boost::asio::placeholders::error)));
 }
 
 void CSSLClient::AsyncConnect(const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
     sslClient.lowest_layer().async_connect(epRemote,
-                                           boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
-                                                       boost::asio::ssl::stream_base::client,
-                                                       boost::asio::placeholders::error));
+                                           pContainer->GetIoStrand().wrap(boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
+                                                                                      boost::asio::ssl::stream_base::client,
+                                                                                      boost::asio::placeholders::error)));
 }
 
 bool CSSLClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const tcp::endpoint& epRemote, CallBackConn fnConnected)
@@ -310,9 +310,9 @@ bool CSSLClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const t
         }
     }
     sslClient.lowest_layer().async_connect(epRemote,
-                                           boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
-                                                       boost::asio::ssl::stream_base::client,
-                                                       boost::asio::placeholders::error));
+                                           pContainer->GetIoStrand().wrap(boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
+                                                                                      boost::asio::ssl::stream_base::client,
+                                                                                      boost::asio::placeholders::error)));
     return true;
 }
 
@@ -321,9 +321,9 @@ void CSSLClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackFunc fnCo
     boost::asio::async_read(sslClient,
                             (boost::asio::streambuf&)ssRecv,
                             boost::asio::transfer_exactly(nLength),
-                            boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred));
+                            pContainer->GetIoStrand().wrap(boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
+                                                                       boost::asio::placeholders::error,
+                                                                       boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSSLClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc fnCompleted)
@@ -331,18 +331,18 @@ void CSSLClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBac
     boost::asio::async_read_until(sslClient,
                                   (boost::asio::streambuf&)ssRecv,
                                   delim,
-                                  boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred));
+                                  pContainer->GetIoStrand().wrap(boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
+                                                                             boost::asio::placeholders::error,
+                                                                             boost::asio::placeholders::bytes_transferred)));
 }
 
 void CSSLClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
 {
     boost::asio::async_write(sslClient,
                              (boost::asio::streambuf&)ssSend,
-                             boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred));
+                             pContainer->GetIoStrand().wrap(boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
+                                                                        boost::asio::placeholders::error,
+                                                                        boost::asio::placeholders::bytes_transferred)));
 }
 
 const tcp::endpoint CSSLClient::SocketGetRemote()
@@ -371,8 +371,8 @@ void CSSLClient::HandleConnected(CallBackConn fnHandshaked,
 {
     if (!err)
     {
-        sslClient.async_handshake(type, boost::bind(&CSSLClient::HandleConnCompleted, this, fnHandshaked,
-                                                    boost::asio::placeholders::error));
+        sslClient.async_handshake(type, pContainer->GetIoStrand().wrap(boost::bind(&CSSLClient::HandleConnCompleted, this, fnHandshaked,
+                                                                                   boost::asio::placeholders::error)));
     }
     else
     {
@@ -30,6 +30,7 @@ public:
     virtual void ClientClose(CIOClient* pClient) = 0;
     virtual std::size_t GetIdleCount();
     virtual const boost::asio::ip::tcp::endpoint GetServiceEndpoint();
+    boost::asio::io_service::strand& GetIoStrand();
 
 protected:
     CIOProc* pIOProc;
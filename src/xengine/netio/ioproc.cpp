@@ -73,7 +73,7 @@ void CIOCompletion::Reset()
 
 CIOProc::CIOProc(const string& ownKeyIn)
   : IIOProc(ownKeyIn),
-    thrIOProc(ownKeyIn, boost::bind(&CIOProc::IOThreadFunc, this)),
+    thrIOProc(ownKeyIn, boost::bind(&CIOProc::IOThreadFunc, this)), nIOThread(1),
     ioStrand(ioService), resolverHost(ioService), ioOutBound(this), ioSSLOutBound(this),
     timerHeartbeat(ioService, IOPROC_HEARTBEAT)
 {
@@ -93,6 +93,27 @@ boost::asio::io_service::strand& CIOProc::GetIoStrand()
     return ioStrand;
 }
 
+void CIOProc::SetIOThreadCount(size_t nIOThreadIn)
+{
+    nIOThread = (nIOThreadIn > 0 ? nIOThreadIn : 1);
+}
+
+size_t CIOProc::GetIOThreadCount() const
+{
+    return nIOThread;
+}
+
+void CIOProc::ExecuteParallel(const boost::function<void()>& fnWork, const boost::function<void()>& fnDone)
+{
+    if (nIOThread <= 1)
+    {
+        fnWork();
+        fnDone();
+        return;
+    }
+    ioService.post(boost::bind(&CIOProc::IOProcHandleWork, this, fnWork, fnDone));
+}
+
 bool CIOProc::DispatchEvent(CEvent* pEvent)
 {
     bool fResult = false;
@@ -266,9 +287,9 @@ void CIOProc::ResolveHost(const CNetHost& host)
     ss << host.nPort;
     tcp::resolver::query query(host.strHost, ss.str());
     resolverHost.async_resolve(query,
-                               boost::bind(&CIOProc::IOProcHandleResolved, this, host,
-                                           boost::asio::placeholders::error,
-                                           boost::asio::placeholders::iterator));
+                               ioStrand.wrap(boost::bind(&CIOProc::IOProcHandleResolved, this, host,
+                                                         boost::asio::placeholders::error,
+                                                         boost::asio::placeholders::iterator)));
 }
 
 void CIOProc::EnterLoop()
@@ -318,12 +339,31 @@ void CIOProc::IOThreadFunc()
 {
     ioService.reset();
 
-    timerHeartbeat.async_wait(boost::bind(&CIOProc::IOProcHeartBeat, this, _1));
+    timerHeartbeat.async_wait(ioStrand.wrap(boost::bind(&CIOProc::IOProcHeartBeat, this, _1)));
 
     EnterLoop();
 
+    for (size_t i = 1; i < nIOThread; i++)
+    {
+        CThread* pThread = new CThread(GetOwnKey() + "-io" + to_string(i), boost::bind(&CIOProc::IOWorkerThreadFunc, this));
+        if (!ThreadStart(*pThread))
+        {
+            Error("Failed to start io worker thread");
+            delete pThread;
+            break;
+        }
+        vThrIOWorker.push_back(pThread);
+    }
+
     ioService.run();
 
+    for (CThread* pThread : vThrIOWorker)
+    {
+        ThreadExit(*pThread);
+        delete pThread;
+    }
+    vThrIOWorker.clear();
+
     LeaveLoop();
 
     timerHeartbeat.cancel();
@@ -333,13 +373,31 @@ void CIOProc::IOThreadFunc()
     mapTimerByExpiry.clear();
 }
 
+void CIOProc::IOWorkerThreadFunc()
+{
+    ioService.run();
+}
+
+void CIOProc::IOProcHandleWork(const boost::function<void()>& fnWork, const boost::function<void()>& fnDone)
+{
+    try
+    {
+        fnWork();
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    ioStrand.post(fnDone);
+}
+
 void CIOProc::IOProcHeartBeat(const boost::system::error_code& err)
 {
     if (!err)
     {
         /* restart deadline timer */
         timerHeartbeat.expires_at(timerHeartbeat.expires_at() + IOPROC_HEARTBEAT);
-        timerHeartbeat.async_wait(boost::bind(&CIOProc::IOProcHeartBeat, this, _1));
+        timerHeartbeat.async_wait(ioStrand.wrap(boost::bind(&CIOProc::IOProcHeartBeat, this, _1)));
 
         /* handle io timer */
         IOProcPollTimer();
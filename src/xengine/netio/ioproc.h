@@ -7,9 +7,11 @@
 
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
+#include <boost/function.hpp>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/base.h"
 #include "netio/ioclient.h"
@@ -60,6 +62,15 @@ public:
     virtual ~CIOProc();
     boost::asio::io_service& GetIoService();
     boost::asio::io_service::strand& GetIoStrand();
+    /* Number of threads running the io service, must be set before Invoke.
+       Every handler that touches the state of the proc is wrapped in the io
+       strand, so handlers still run one at a time in posting order; the extra
+       threads serve the sockets and the works given to ExecuteParallel. */
+    void SetIOThreadCount(std::size_t nIOThreadIn);
+    std::size_t GetIOThreadCount() const;
+    /* Run fnWork outside the io strand, then fnDone inside it.
+       fnWork must not touch the state of the proc. */
+    void ExecuteParallel(const boost::function<void()>& fnWork, const boost::function<void()>& fnDone);
     virtual bool DispatchEvent(CEvent* pEvent) override;
     virtual CIOClient* CreateIOClient(CIOContainer* pContainer);
 
@@ -96,6 +107,8 @@ protected:
 
 private:
     void IOThreadFunc();
+    void IOWorkerThreadFunc();
+    void IOProcHandleWork(const boost::function<void()>& fnWork, const boost::function<void()>& fnDone);
     void IOProcHeartBeat(const boost::system::error_code& err);
     void IOProcPollTimer();
     void IOProcHandleEvent(CEvent* pEvent, std::shared_ptr<CIOCompletion> spComplt);
@@ -104,6 +117,8 @@ private:
 
 private:
     CThread thrIOProc;
+    std::size_t nIOThread;
+    std::vector<CThread*> vThrIOWorker;
     boost::asio::io_service ioService;
     boost::asio::io_service::strand ioStrand;
     boost::asio::ip::tcp::resolver resolverHost;
@@ -39,6 +39,7 @@ CPeerNet::~CPeerNet()
 void CPeerNet::ConfigNetwork(CPeerNetConfig& config)
 {
     confNetwork = config;
+    SetIOThreadCount(config.nIOThreads);
 }
 
 void CPeerNet::HandlePeerClose(CPeer* pPeer)
@@ -44,6 +44,7 @@ public:
     unsigned short nPortDefault;
     std::string strSocketBindLocalIpV4;
     std::string strSocketBindLocalIpV6;
+    std::size_t nIOThreads;
 };
 
 class CPeerNet : public CIOProc, virtual public CPeerEventListener
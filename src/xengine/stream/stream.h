@@ -5,12 +5,15 @@
 #ifndef XENGINE_STREAM_STREAM_H
 #define XENGINE_STREAM_STREAM_H
 
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <boost/type_traits.hpp>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <list>
+#include <vector>
 
 #include "../type.h"
 #include "stream/circular.h"
@@ -35,7 +38,8 @@ class CStream
 {
 public:
     CStream(std::streambuf* sb)
-      : ios(sb) {}
+      : ios(sb), fSpan(false), pSpanRead(nullptr), pSpanWrite(nullptr), pSpanEnd(nullptr) {}
+    virtual ~CStream() {}
 
     virtual std::size_t GetSize()
     {
@@ -49,12 +53,38 @@ public:
 
     CStream& Write(const char* s, std::size_t n)
     {
+        if (fSpan)
+        {
+            if ((std::size_t)(pSpanEnd - pSpanWrite) < n)
+            {
+                GrowSpan(n);
+            }
+            if (n > 0)
+            {
+                std::memcpy(pSpanWrite, s, n);
+                pSpanWrite += n;
+            }
+            return (*this);
+        }
         ios.write(s, n);
         return (*this);
     }
 
     CStream& Read(char* s, std::size_t n)
     {
+        if (fSpan)
+        {
+            if ((std::size_t)(pSpanWrite - pSpanRead) < n)
+            {
+                throw std::runtime_error((std::string("stream read error. To be reading ") + std::to_string(n) + " but " + std::to_string(pSpanWrite - pSpanRead)).c_str());
+            }
+            if (n > 0)
+            {
+                std::memcpy(s, pSpanRead, n);
+                pSpanRead += n;
+            }
+            return (*this);
+        }
         ios.read(s, n);
         if (ios.gcount() != n)
         {
@@ -161,8 +191,19 @@ protected:
     template <typename P1, typename P2, typename O>
     CStream& Serialize(std::pair<P1, P2>& t, ObjectType&, O& o);
 
+protected:
+    virtual void GrowSpan(std::size_t n)
+    {
+        throw std::runtime_error((std::string("stream write error. To be writing ") + std::to_string(n) + " but " + std::to_string(pSpanEnd - pSpanWrite)).c_str());
+    }
+
 protected:
     std::iostream ios;
+    // contiguous byte span, Write/Read bypass the iostream when it is set
+    bool fSpan;
+    char* pSpanRead;
+    char* pSpanWrite;
+    char* pSpanEnd;
 };
 
 // Autosize buffer stream
@@ -242,6 +283,75 @@ public:
     }
 };
 
+// Contiguous byte span stream
+//   serializes by memcpy on a plain cursor instead of the iostream.
+//   CSpanStream(nCapacity) writes into an own growable buffer,
+//   CSpanStream(pData, nSize) reads from an external span without copying it.
+class CSpanStream : public CStream
+{
+public:
+    CSpanStream(std::size_t nCapacity = 256)
+      : CStream(nullptr), fOwner(true), vBuffer(nCapacity)
+    {
+        fSpan = true;
+        pSpanRead = pSpanWrite = vBuffer.data();
+        pSpanEnd = pSpanWrite + vBuffer.size();
+    }
+    CSpanStream(const char* pData, std::size_t nSize)
+      : CStream(nullptr), fOwner(false)
+    {
+        fSpan = true;
+        pSpanRead = const_cast<char*>(pData);
+        pSpanWrite = pSpanEnd = pSpanRead + nSize;
+    }
+
+    void Clear()
+    {
+        if (fOwner)
+        {
+            pSpanRead = pSpanWrite = vBuffer.data();
+        }
+        else
+        {
+            pSpanRead = pSpanWrite;
+        }
+    }
+
+    char* GetData() const
+    {
+        return pSpanRead;
+    }
+
+    std::size_t GetSize()
+    {
+        return (pSpanWrite - pSpanRead);
+    }
+
+    friend CStream& operator<<(CStream& s, CSpanStream& ssAppend)
+    {
+        return s.Write(ssAppend.GetData(), ssAppend.GetSize());
+    }
+
+protected:
+    void GrowSpan(std::size_t n) override
+    {
+        if (!fOwner)
+        {
+            CStream::GrowSpan(n);
+        }
+        std::size_t nRead = pSpanRead - vBuffer.data();
+        std::size_t nWrite = pSpanWrite - vBuffer.data();
+        vBuffer.resize(std::max(vBuffer.size() * 2, nWrite + n));
+        pSpanRead = vBuffer.data() + nRead;
+        pSpanWrite = vBuffer.data() + nWrite;
+        pSpanEnd = vBuffer.data() + vBuffer.size();
+    }
+
+protected:
+    bool fOwner;
+    std::vector<char> vBuffer;
+};
+
 // Circular buffer stream
 class CCircularStream : public circularbuf, public CStream
 {
@@ -685,7 +795,7 @@ inline CStream& CStream::Serialize(std::pair<P1, P2>& t, ObjectType&, O& o)
 template <typename T>
 std::size_t GetSerializeSize(const T& obj)
 {
-    CBufStream ss;
+    CSpanStream ss(0);
     return ss.GetSerializeSize(obj);
 }
 
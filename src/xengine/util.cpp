@@ -22,6 +22,8 @@
 #include <boost/log/support/date_time.hpp>
 #include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/log/utility/setup/console.hpp>
+#include <atomic>
+#include <boost/thread/thread.hpp>
 #include <cstdarg>
 #include <thread>
 
@@ -314,4 +316,55 @@ bool InitLog(const boost::filesystem::path& pathData, bool debug, bool daemon, i
     return true;
 }
 
+bool ParallelFor(std::size_t nCount, std::size_t nChunkSize, const boost::function<bool(std::size_t, std::size_t)>& fn,
+                 std::size_t nThread)
+{
+    if (nChunkSize == 0)
+    {
+        nChunkSize = 1;
+    }
+    std::size_t nChunk = (nCount + nChunkSize - 1) / nChunkSize;
+    if (nThread == 0)
+    {
+        nThread = std::max(1u, boost::thread::hardware_concurrency());
+    }
+    nThread = std::min(nThread, nChunk);
+
+    std::atomic<std::size_t> nNext(0);
+    std::atomic<bool> fFail(false);
+    auto worker = [&]() {
+        std::size_t n;
+        while (!fFail && (n = nNext.fetch_add(1)) < nChunk)
+        {
+            try
+            {
+                if (!fn(n * nChunkSize, std::min(nCount, (n + 1) * nChunkSize)))
+                {
+                    fFail = true;
+                }
+            }
+            catch (std::exception& e)
+            {
+                StdError("ParallelFor", "%s", e.what());
+                fFail = true;
+            }
+        }
+    };
+
+    if (nThread <= 1)
+    {
+        worker();
+    }
+    else
+    {
+        boost::thread_group group;
+        for (std::size_t i = 0; i < nThread; i++)
+        {
+            group.create_thread(worker);
+        }
+        group.join_all();
+    }
+    return !fFail;
+}
+
 } // namespace xengine
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <boost/asio/ip/address.hpp>
 #include <boost/date_time.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
 #include <boost/log/common.hpp>
 
 #include "type.h"
@@ -61,6 +62,13 @@ inline int64 GetTimeMillis()
     return int64((microsec_clock::universal_time() - epoch).total_milliseconds());
 }
 
+inline int64 GetTimeMicros()
+{
+    using namespace boost::posix_time;
+    static ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return int64((microsec_clock::universal_time() - epoch).total_microseconds());
+}
+
 inline std::string GetLocalTime()
 {
     using namespace boost::posix_time;
@@ -130,6 +138,11 @@ void StdError(const char* pszName, const char* pszFormat, ...);
 
 bool InitLog(const boost::filesystem::path& pathData, bool debug, bool daemon, int nLogFileSizeIn, int nLogHistorySizeIn);
 
+// Run fn(nBegin, nEnd) over [0, nCount) in chunks of nChunkSize on up to nThread threads
+// (0 = number of cores), false if any chunk returns false or throws
+bool ParallelFor(std::size_t nCount, std::size_t nChunkSize, const boost::function<bool(std::size_t, std::size_t)>& fn,
+                 std::size_t nThread = 0);
+
 inline std::string PulsFileLine(const char* file, int line, const char* info)
 {
     std::stringstream ss;
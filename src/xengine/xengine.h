@@ -15,6 +15,7 @@
 #include <docker/log.h>
 #include <docker/thread.h>
 #include <docker/timer.h>
+#include <docker/workerpool.h>
 #include <entry/entry.h>
 #include <event/event.h>
 #include <event/eventproc.h>
@@ -9,6 +9,9 @@
 
 #include "crypto.h"
 //#include "curve25519/curve25519.h"
+#include "destination.h"
+#include "key.h"
+#include "sigcache.h"
 #include "test_big.h"
 #include "util.h"
 
@@ -62,4 +65,91 @@ BOOST_AUTO_TEST_CASE(multisign)
     std::cout << "multisign verify count : " << count << "; time per count : " << verifyTime / count << "us.; time per key: " << verifyTime / signCount << "us." << std::endl;
 }
 
+BOOST_AUTO_TEST_CASE(sha256d)
+{
+    const size_t count = 4096;
+    std::vector<uint8_t> vData(count * 64);
+    randombytes_buf(vData.data(), vData.size());
+
+    // 64-byte messages
+    std::vector<uint256> vHash(count);
+    CryptoSHA256D64Multi(vData.data(), count, vHash.data());
+    for (size_t i = 0; i < count; i++)
+    {
+        BOOST_CHECK(vHash[i] == CryptoSHA256D(&vData[i * 64], 64));
+        BOOST_CHECK(vHash[i] == CryptoSHA256D64(&vData[i * 64]));
+    }
+
+    // 80-byte headers sharing the first block
+    std::vector<uint8_t> vHeader(vData.begin(), vData.begin() + 80);
+    std::vector<uint8_t> vTails(count * 16);
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(&vTails[i * 16], &vHeader[64], 12);
+        memcpy(&vTails[i * 16 + 12], &i, 4);
+    }
+    CCryptoSHA256DMidstate midstate;
+    midstate.Init(vHeader.data());
+    midstate.HashMulti(vTails.data(), 16, count, vHash.data());
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(&vHeader[64], &vTails[i * 16], 16);
+        BOOST_CHECK(vHash[i] == CryptoSHA256D(vHeader.data(), vHeader.size()));
+        BOOST_CHECK(vHash[i] == midstate.Hash(&vTails[i * 16], 16));
+    }
+
+    // scalar path vs multi-lane path
+    const int loop = 64;
+    boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+    for (int n = 0; n < loop; n++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            memcpy(&vHeader[64], &vTails[i * 16], 16);
+            vHash[i] = CryptoSHA256D(vHeader.data(), vHeader.size());
+        }
+    }
+    boost::posix_time::ptime t1 = boost::posix_time::microsec_clock::universal_time();
+    for (int n = 0; n < loop; n++)
+    {
+        midstate.HashMulti(vTails.data(), 16, count, vHash.data());
+    }
+    boost::posix_time::ptime t2 = boost::posix_time::microsec_clock::universal_time();
+
+    int64_t nScalar = (t1 - t0).total_microseconds(), nMulti = (t2 - t1).total_microseconds();
+    std::cout << "sha256d header count : " << count * loop << ", lanes : " << CryptoSHA256Lanes() << std::endl;
+    std::cout << "sha256d scalar : " << nScalar << "us.; midstate multi : " << nMulti << "us.; speedup : "
+              << (nMulti > 0 ? (double)nScalar / nMulti : 0) << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE(sigcache)
+{
+    CKey key;
+    key.Renew();
+    CDestination dest(key.GetPubKey());
+    uint256 hash;
+    CryptoGetRand256(hash);
+    vector<uint8> vchSig;
+    BOOST_CHECK(key.Sign(hash, vchSig));
+
+    CSignatureCache cache(16);
+    BOOST_CHECK(!cache.Exists(dest, hash, vchSig));
+    cache.AddNew(dest, hash, vchSig);
+    BOOST_CHECK(cache.Exists(dest, hash, vchSig));
+
+    // any part of the key misses
+    vector<uint8> vchBadSig(vchSig);
+    vchBadSig[0] ^= 1;
+    BOOST_CHECK(!cache.Exists(dest, hash, vchBadSig));
+    BOOST_CHECK(!cache.Exists(CDestination(), hash, vchSig));
+    BOOST_CHECK(!cache.Exists(dest, uint256(), vchSig));
+
+    // a bad signature is rejected on every call, the valid one is served from the cache
+    bool fCompleted = false;
+    BOOST_CHECK(!dest.VerifyTxSignature(hash, 0, uint256(), CDestination(), vchBadSig, 0, fCompleted));
+    BOOST_CHECK(!dest.VerifyTxSignature(hash, 0, uint256(), CDestination(), vchBadSig, 0, fCompleted));
+    BOOST_CHECK(dest.VerifyTxSignature(hash, 0, uint256(), CDestination(), vchSig, 0, fCompleted) && fCompleted);
+    BOOST_CHECK(dest.VerifyTxSignature(hash, 0, uint256(), CDestination(), vchSig, 0, fCompleted) && fCompleted);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
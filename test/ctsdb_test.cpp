@@ -95,4 +95,69 @@ BOOST_AUTO_TEST_CASE(ctsdb)
     boost::filesystem::remove_all(fullpath);
 }
 
+BOOST_AUTO_TEST_CASE(ctsdbcache)
+{
+    CMetaDB db;
+
+    std::string fullpath = boost::filesystem::initial_path<boost::filesystem::path>().string() + "/dbpath_cache";
+    BOOST_CHECK(db.Initialize(boost::filesystem::path(fullpath)));
+    db.RemoveAll();
+
+    std::vector<CMetaData> vData;
+    for (int i = 0; i < 100; i++)
+    {
+        uint256 txid;
+        minemon::crypto::CryptoGetRand256(txid);
+
+        CMetaData data;
+        data.hash = uint224(txid);
+        data.file = 1;
+        data.offset = i;
+        data.blocktime = i / 10;
+        db.Update(data.blocktime, data.hash, data);
+        vData.push_back(data);
+    }
+    BOOST_CHECK(db.Flush());
+
+    for (int loop = 0; loop < 2; loop++)
+    {
+        for (const CMetaData& data : vData)
+        {
+            CMetaData dataRet;
+            BOOST_CHECK(db.Retrieve(data.blocktime, data.hash, dataRet));
+            BOOST_CHECK(dataRet.offset == data.offset);
+        }
+    }
+
+    xengine::CCacheStat statChunk, statBloom;
+    db.GetCacheStat(statChunk, statBloom);
+    BOOST_CHECK(statChunk.nCount == 10);
+    BOOST_CHECK(statChunk.nHit >= 190);
+
+    // unknown keys and times without chunk are answered by the filters
+    for (int i = 0; i < 1000; i++)
+    {
+        uint256 txid;
+        minemon::crypto::CryptoGetRand256(txid);
+
+        CMetaData dataRet;
+        BOOST_CHECK(!db.Retrieve(i % 20, uint224(txid), dataRet));
+    }
+    xengine::CCacheStat statChunkMiss;
+    db.GetCacheStat(statChunkMiss, statBloom);
+    BOOST_CHECK(statChunkMiss.nHit - statChunk.nHit < 50);
+
+    // flushed changes replace the cached chunks
+    db.Erase(vData[0].blocktime, vData[0].hash);
+    vData[1].offset = 1000;
+    db.Update(vData[1].blocktime, vData[1].hash, vData[1]);
+    BOOST_CHECK(db.Flush());
+    CMetaData dataRet;
+    BOOST_CHECK(!db.Retrieve(vData[0].blocktime, vData[0].hash, dataRet));
+    BOOST_CHECK(db.Retrieve(vData[1].blocktime, vData[1].hash, dataRet) && dataRet.offset == 1000);
+
+    db.Deinitialize();
+    boost::filesystem::remove_all(fullpath);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
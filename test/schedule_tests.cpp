@@ -0,0 +1,159 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "schedule.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "test_big.h"
+
+using namespace std;
+using namespace xengine;
+using namespace minemon;
+
+BOOST_FIXTURE_TEST_SUITE(schedule_tests, BasicUtfSetup)
+
+class CTestSchedule : public CSchedule
+{
+public:
+    void AgeAssigned(const network::CInv& inv, int64 nMillis)
+    {
+        mapState[inv].nAssignedTime -= nMillis;
+    }
+    size_t GetBlockWindow(uint64 nPeerNonce)
+    {
+        return mapPeer[nPeerNonce].GetBlockWindow();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(blockwindow_test)
+{
+    CInvPeer peer;
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::BLOCK_WINDOW_INIT);
+    for (int i = 0; i < 32; i++)
+    {
+        peer.UpdateBlockWindow(CInvPeer::BLOCK_FAST_RESPONSE_TIME);
+    }
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::BLOCK_WINDOW_MAX);
+    peer.UpdateBlockWindow(CInvPeer::BLOCK_FAST_RESPONSE_TIME + 1);
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::BLOCK_WINDOW_MAX);
+    peer.UpdateBlockWindow(CInvPeer::BLOCK_SLOW_RESPONSE_TIME);
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::BLOCK_WINDOW_MAX / 2);
+    peer.ResetBlockWindow();
+    peer.UpdateBlockWindow(CInvPeer::BLOCK_SLOW_RESPONSE_TIME);
+    BOOST_CHECK(peer.GetBlockWindow() == 1);
+
+    // a peer is never asked for more blocks than its window
+    const uint64 nPeer = 1;
+    CTestSchedule sched;
+    vector<network::CInv> vBlockInv;
+    for (uint32 i = 1; i <= 5; i++)
+    {
+        vBlockInv.push_back(network::CInv(network::CInv::MSG_BLOCK, uint256(i, uint224(i))));
+        BOOST_CHECK(sched.AddNewInv(vBlockInv.back(), nPeer));
+    }
+
+    vector<network::CInv> vInv;
+    bool fMissingPrev, fEmpty;
+    sched.ScheduleBlockInv(nPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.size() == CInvPeer::BLOCK_WINDOW_INIT);
+    vInv.clear();
+    sched.ScheduleBlockInv(nPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.empty());
+
+    // a fast response opens the window by one
+    set<uint64> setSchedPeer;
+    BOOST_CHECK(sched.ReceiveBlock(nPeer, vBlockInv[0].nHash, CBlock(), setSchedPeer));
+    BOOST_CHECK(sched.GetBlockWindow(nPeer) == CInvPeer::BLOCK_WINDOW_INIT + 1);
+    sched.ScheduleBlockInv(nPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.size() == 2 && vInv[0] == vBlockInv[2] && vInv[1] == vBlockInv[3]);
+}
+
+BOOST_AUTO_TEST_CASE(blockstall_test)
+{
+    const uint64 nSlowPeer = 1, nPeer = 2;
+    network::CInv inv(network::CInv::MSG_BLOCK, uint256(1, uint224(1)));
+    CTestSchedule sched;
+    BOOST_CHECK(sched.AddNewInv(inv, nSlowPeer));
+    BOOST_CHECK(sched.AddNewInv(inv, nPeer));
+
+    vector<network::CInv> vInv;
+    bool fMissingPrev, fEmpty;
+    sched.ScheduleBlockInv(nSlowPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.size() == 1 && sched.IsAssignedInv(nSlowPeer, inv));
+
+    // not stalled yet, the other peer waits
+    sched.ScheduleBlockInv(nPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.empty());
+    sched.AgeAssigned(inv, (CSchedule::MAX_BLOCK_STALL_TIME - 1) * 1000);
+    sched.ScheduleBlockInv(nPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.empty());
+
+    // stalled, the block moves to the other peer and the slow peer's window shrinks to one
+    sched.AgeAssigned(inv, 1000);
+    sched.ScheduleBlockInv(nPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.size() == 1 && vInv[0] == inv);
+    BOOST_CHECK(sched.IsAssignedInv(nPeer, inv) && !sched.IsAssignedInv(nSlowPeer, inv));
+    BOOST_CHECK(sched.GetBlockWindow(nSlowPeer) == 1);
+
+    // the late block of the slow peer is refused
+    set<uint64> setSchedPeer;
+    BOOST_CHECK(!sched.ReceiveBlock(nSlowPeer, inv.nHash, CBlock(), setSchedPeer));
+    BOOST_CHECK(sched.ReceiveBlock(nPeer, inv.nHash, CBlock(), setSchedPeer));
+}
+
+BOOST_AUTO_TEST_CASE(partialblock_test)
+{
+    CBlock block;
+    block.nType = CBlock::BLOCK_PRIMARY;
+    block.nTimeStamp = 100;
+    block.txMint.nType = CTransaction::TX_WORK;
+    block.txMint.nTimeStamp = 100;
+    for (uint32 i = 1; i <= 4; i++)
+    {
+        CTransaction tx;
+        tx.nTimeStamp = i;
+        block.vtx.push_back(tx);
+    }
+    block.hashMerkle = block.CalcMerkleTreeRoot();
+    CCompactBlock compactRecv(block, 12345);
+
+    const uint64 nPeer = 1, nOtherPeer = 2;
+    network::CInv inv(network::CInv::MSG_BLOCK, block.GetHash());
+    CSchedule sched;
+    BOOST_CHECK(sched.AddNewInv(inv, nPeer));
+    BOOST_CHECK(sched.AddNewInv(inv, nOtherPeer));
+
+    // only the peer the block is assigned to can start a partial block
+    vector<network::CInv> vInv;
+    bool fMissingPrev, fEmpty;
+    sched.ScheduleBlockInv(nPeer, vInv, 10, fMissingPrev, fEmpty);
+    BOOST_CHECK(vInv.size() == 1 && vInv[0] == inv);
+
+    vector<CTransaction> vtxPartial(block.vtx.size());
+    vtxPartial[0] = block.vtx[0];
+    vtxPartial[2] = block.vtx[2];
+    vector<uint32> vMissing = { 1, 3 };
+    BOOST_CHECK(!sched.AddPartialBlock(nOtherPeer, compactRecv, vtxPartial, vMissing));
+    BOOST_CHECK(sched.AddPartialBlock(nPeer, compactRecv, vtxPartial, vMissing));
+
+    // missing txs from another peer or of the wrong count are refused,
+    // the wrong count also drops the partial block
+    vector<CTransaction> vtxMissing = { block.vtx[1], block.vtx[3] };
+    CCompactBlock compact;
+    vector<CTransaction> vtx;
+    BOOST_CHECK(!sched.FillPartialBlock(nOtherPeer, inv.nHash, vtxMissing, compact, vtx));
+    BOOST_CHECK(!sched.FillPartialBlock(nPeer, inv.nHash, vector<CTransaction>(1, block.vtx[1]), compact, vtx));
+    BOOST_CHECK(!sched.FillPartialBlock(nPeer, inv.nHash, vtxMissing, compact, vtx));
+
+    BOOST_CHECK(sched.AddPartialBlock(nPeer, compactRecv, vtxPartial, vMissing));
+    BOOST_CHECK(sched.FillPartialBlock(nPeer, inv.nHash, vtxMissing, compact, vtx));
+    CBlock blockOut;
+    BOOST_CHECK(compact.Reconstruct(vtx, blockOut) && blockOut.GetHash() == block.GetHash());
+
+    // filled once, then it is gone
+    BOOST_CHECK(!sched.FillPartialBlock(nPeer, inv.nHash, vtxMissing, compact, vtx));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
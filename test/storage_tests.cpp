@@ -6,8 +6,15 @@
 
 #include "address.h"
 #include "block.h"
+#include "blockindexdb.h"
+#include "blockindexmap.h"
+#include "crypto.h"
+#include "param.h"
+#include "pledgedb.h"
 #include "test_big.h"
 #include "timeseries.h"
+#include "unspentdb.h"
+#include "walletdb.h"
 
 using namespace std;
 using namespace xengine;
@@ -167,4 +174,385 @@ BOOST_AUTO_TEST_CASE(fileread)
     free(pBuf);
 }
 
+BOOST_AUTO_TEST_CASE(unspentaddress)
+{
+    path pathData = path("./.minemon") / "unspenttest";
+    remove_all(pathData);
+
+    CUnspentDB dbUnspent;
+    BOOST_CHECK(dbUnspent.Initialize(pathData, false));
+
+    uint256 hashFork(1);
+    BOOST_CHECK(dbUnspent.AddNewFork(hashFork));
+
+    CDestination destA, destB;
+    destA.prefix = CDestination::PREFIX_PUBKEY;
+    destA.data = uint256(100);
+    destB.prefix = CDestination::PREFIX_PUBKEY;
+    destB.data = uint256(200);
+
+    vector<CTxUnspent> vAddNew;
+    for (int i = 0; i < 5; i++)
+    {
+        const CDestination& dest = (i < 3 ? destA : destB);
+        vAddNew.push_back(CTxUnspent(CTxOutPoint(uint256(i + 1), 0), CTxOut(dest, 1000 + i, 0, 0)));
+    }
+    BOOST_CHECK(dbUnspent.Update(hashFork, vAddNew, vector<CTxUnspent>()));
+
+    CListUnspentWalker walkerCache(hashFork, destA, 0);
+    BOOST_CHECK(dbUnspent.WalkThroughAddress(hashFork, destA, walkerCache));
+    BOOST_CHECK(walkerCache.vUnspent.size() == 3);
+
+    dbUnspent.Flush(hashFork);
+    dbUnspent.Flush(hashFork);
+
+    vector<CTxUnspent> vRemove;
+    vRemove.push_back(vAddNew[0]);
+    BOOST_CHECK(dbUnspent.Update(hashFork, vector<CTxUnspent>(), vRemove));
+
+    CListUnspentWalker walkerMixed(hashFork, destA, 0);
+    BOOST_CHECK(dbUnspent.WalkThroughAddress(hashFork, destA, walkerMixed));
+    BOOST_CHECK(walkerMixed.vUnspent.size() == 2);
+
+    dbUnspent.Flush(hashFork);
+    dbUnspent.Flush(hashFork);
+    dbUnspent.Deinitialize();
+
+    BOOST_CHECK(dbUnspent.Initialize(pathData, false));
+    BOOST_CHECK(dbUnspent.LoadFork(hashFork));
+
+    CListUnspentWalker walkerDB(hashFork, destA, 0);
+    BOOST_CHECK(dbUnspent.WalkThroughAddress(hashFork, destA, walkerDB));
+    BOOST_CHECK(walkerDB.vUnspent.size() == 2);
+
+    CListUnspentWalker walkerOther(hashFork, destB, 1);
+    BOOST_CHECK(dbUnspent.WalkThroughAddress(hashFork, destB, walkerOther));
+    BOOST_CHECK(walkerOther.vUnspent.size() == 1);
+
+    dbUnspent.Deinitialize();
+    remove_all(pathData);
+}
+
+BOOST_AUTO_TEST_CASE(wallettxlist)
+{
+    path pathData = path("./.minemon") / "wallettxtest";
+    remove_all(pathData);
+
+    CWalletDB dbWallet;
+    BOOST_CHECK(dbWallet.Initialize(pathData));
+
+    uint256 hashForkA(1), hashForkB(2);
+    CDestination destA, destB;
+    destA.prefix = CDestination::PREFIX_PUBKEY;
+    destA.data = uint256(100);
+    destB.prefix = CDestination::PREFIX_PUBKEY;
+    destB.data = uint256(200);
+
+    vector<CWalletTx> vWalletTx;
+    for (int i = 0; i < 20; i++)
+    {
+        CWalletTx wtx;
+        wtx.txid = uint256(i + 1);
+        wtx.hashFork = (i % 2 == 0 ? hashForkA : hashForkB);
+        wtx.destIn = destA;
+        wtx.sendTo = (i % 4 < 2 ? destA : destB);
+        wtx.nBlockHeight = i;
+        vWalletTx.push_back(wtx);
+    }
+    BOOST_CHECK(dbWallet.UpdateTx(vWalletTx));
+
+    CWalletTx wtxPool;
+    wtxPool.txid = uint256(100);
+    wtxPool.hashFork = hashForkA;
+    wtxPool.destIn = destB;
+    wtxPool.sendTo = destB;
+    wtxPool.nBlockHeight = -1;
+    BOOST_CHECK(dbWallet.AddNewTx(wtxPool));
+
+    BOOST_CHECK(dbWallet.GetTxCount(uint256(), CDestination()) == 21);
+    BOOST_CHECK(dbWallet.GetTxCount(hashForkA, CDestination()) == 11);
+    BOOST_CHECK(dbWallet.GetTxCount(uint256(), destB) == 11);
+    BOOST_CHECK(dbWallet.GetTxCount(hashForkA, destB) == 6);
+
+    // a page of the fork and address scope, running into the unconfirmed txs
+    vector<CWalletTx> vList;
+    BOOST_CHECK(dbWallet.ListTx(hashForkA, destB, 3, 10, vList));
+    BOOST_CHECK(vList.size() == 3);
+    BOOST_CHECK(vList[0].txid == uint256(15) && vList[1].txid == uint256(19) && vList[2].txid == uint256(100));
+
+    vector<uint256> vRemove;
+    vRemove.push_back(uint256(15));
+    BOOST_CHECK(dbWallet.UpdateTx(vector<CWalletTx>(), vRemove));
+    dbWallet.Deinitialize();
+
+    // the index is rebuilt from the stored txs
+    BOOST_CHECK(dbWallet.Initialize(pathData));
+    BOOST_CHECK(dbWallet.GetTxCount(hashForkA, destB) == 5);
+    vList.clear();
+    BOOST_CHECK(dbWallet.ListTx(hashForkA, destB, 3, 2, vList));
+    BOOST_CHECK(vList.size() == 2);
+    BOOST_CHECK(vList[0].txid == uint256(19) && vList[1].txid == uint256(100));
+    vList.clear();
+    BOOST_CHECK(dbWallet.ListTx(uint256(), CDestination(), 19, 5, vList));
+    BOOST_CHECK(vList.size() == 1 && vList[0].txid == uint256(100));
+
+    dbWallet.Deinitialize();
+    remove_all(pathData);
+}
+
+BOOST_AUTO_TEST_CASE(pledgereward)
+{
+    path pathData = path("./.minemon") / "pledgerewardtest";
+    remove_all(pathData);
+    create_directories(pathData);
+
+    CPledgeRewardDB dbPledgeReward;
+    BOOST_CHECK(dbPledgeReward.Initialize(pathData));
+
+    const uint32 nWindow = BPX_PLEDGE_REWARD_DISTRIBUTE_HEIGHT;
+    CDestination destA, destB;
+    destA.prefix = CDestination::PREFIX_PUBKEY;
+    destA.data = uint256((uint64)100);
+    destB.prefix = CDestination::PREFIX_PUBKEY;
+    destB.data = uint256((uint64)200);
+
+    // main chain over the second window
+    for (uint32 nHeight = nWindow + 1; nHeight <= nWindow * 2; nHeight++)
+    {
+        map<CDestination, int64> mapReward;
+        mapReward[destA] = 10;
+        if (nHeight == nWindow + 1)
+        {
+            mapReward[destB] = 5;
+        }
+        BOOST_CHECK(dbPledgeReward.AddBlockReward(uint256(nHeight, uint224((uint64)1)), uint256(nHeight - 1, uint224((uint64)1)), mapReward));
+    }
+    const uint256 hashEnd(nWindow * 2, uint224((uint64)1));
+
+    map<CDestination, int64> mapDistribute;
+    BOOST_CHECK(dbPledgeReward.RetrieveDistributeReward(hashEnd, mapDistribute));
+    BOOST_CHECK(mapDistribute.size() == 2 && mapDistribute[destA] == 10 * nWindow && mapDistribute[destB] == 5);
+
+    // a branch replacing the last block
+    const uint256 hashBranch(nWindow * 2, uint224((uint64)2));
+    map<CDestination, int64> mapBranchReward;
+    mapBranchReward[destB] = 7;
+    BOOST_CHECK(dbPledgeReward.AddBlockReward(hashBranch, uint256(nWindow * 2 - 1, uint224((uint64)1)), mapBranchReward));
+    BOOST_CHECK(dbPledgeReward.RetrieveDistributeReward(hashBranch, mapDistribute));
+    BOOST_CHECK(mapDistribute[destA] == 10 * (nWindow - 1) && mapDistribute[destB] == 12);
+
+    // rebuilt from the block rewards without the cache
+    dbPledgeReward.Deinitialize();
+    BOOST_CHECK(dbPledgeReward.Initialize(pathData));
+    BOOST_CHECK(dbPledgeReward.RetrieveDistributeReward(hashEnd, mapDistribute));
+    BOOST_CHECK(mapDistribute.size() == 2 && mapDistribute[destA] == 10 * nWindow && mapDistribute[destB] == 5);
+    BOOST_CHECK(!dbPledgeReward.RetrieveDistributeReward(uint256(nWindow * 3, uint224((uint64)1)), mapDistribute));
+
+    dbPledgeReward.Deinitialize();
+    remove_all(pathData);
+}
+
+BOOST_AUTO_TEST_CASE(blockindexmap)
+{
+    CBlockIndexMap mapIndex;
+    BOOST_CHECK(mapIndex.Empty());
+
+    const uint32 nCount = 10000;
+    vector<CBlockIndex*> vIndex;
+    for (uint32 i = 0; i < nCount; i++)
+    {
+        uint256 hash(i, uint224(crypto::CryptoHash(&i, sizeof(i))));
+        CBlockIndex* pIndex = mapIndex.Insert(hash);
+        BOOST_CHECK(pIndex != nullptr && pIndex->GetBlockHash() == hash && pIndex->pOrigin == pIndex);
+        pIndex->nHeight = i;
+        vIndex.push_back(pIndex);
+    }
+    BOOST_CHECK(mapIndex.Size() == nCount);
+
+    // entries keep their address over the table growth
+    for (uint32 i = 0; i < nCount; i++)
+    {
+        BOOST_CHECK(mapIndex.Find(vIndex[i]->GetBlockHash()) == vIndex[i]);
+        BOOST_CHECK(mapIndex.Insert(vIndex[i]->GetBlockHash()) == vIndex[i]);
+    }
+
+    vector<uint256> vHash;
+    for (uint32 i = 0; i < nCount; i++)
+    {
+        vHash.push_back(vIndex[i]->GetBlockHash());
+    }
+    for (uint32 i = 0; i < nCount; i += 2)
+    {
+        BOOST_CHECK(mapIndex.Erase(vHash[i]));
+    }
+    BOOST_CHECK(!mapIndex.Erase(vHash[0]));
+    BOOST_CHECK(mapIndex.Size() == nCount / 2);
+    for (uint32 i = 0; i < nCount; i++)
+    {
+        CBlockIndex* pIndex = mapIndex.Find(vHash[i]);
+        BOOST_CHECK((i % 2 == 0) ? (pIndex == nullptr) : (pIndex == vIndex[i] && pIndex->nHeight == i));
+    }
+
+    CBlockIndex index;
+    index.nHeight = 7;
+    CBlockIndex* pIndex = mapIndex.Set(vHash[0], index);
+    BOOST_CHECK(pIndex->nHeight == 7 && pIndex->GetBlockHash() == vHash[0] && pIndex->pOrigin == pIndex);
+
+    mapIndex.Clear();
+    BOOST_CHECK(mapIndex.Empty() && mapIndex.Find(vHash[1]) == nullptr);
+}
+
+class CListBlockWalker : public CBlockDBWalker
+{
+public:
+    bool Walk(CBlockOutline& outline) override
+    {
+        mapOutline[outline.GetBlockHash()] = outline.nHeight;
+        return true;
+    }
+
+public:
+    map<uint256, uint32> mapOutline;
+};
+
+BOOST_AUTO_TEST_CASE(blockindexsnapshot)
+{
+    path pathData = path("./.minemon") / "blockindexsnapshottest";
+    remove_all(pathData);
+    create_directories(pathData);
+
+    CBlockIndexDB dbBlockIndex;
+    BOOST_CHECK(dbBlockIndex.Initialize(pathData));
+    BOOST_CHECK(!dbBlockIndex.HasSnapshot());
+
+    CBlockIndexMap mapIndex;
+    vector<CBlockIndex*> vIndex;
+    for (uint32 i = 0; i < 5000; i++)
+    {
+        CBlockIndex* pIndex = mapIndex.Insert(uint256(i, uint224((uint64)i + 1)));
+        pIndex->nHeight = i;
+        pIndex->pPrev = (i > 0 ? vIndex.back() : nullptr);
+        vIndex.push_back(pIndex);
+        BOOST_CHECK(dbBlockIndex.AddNewBlock(CBlockOutline(pIndex)));
+    }
+    BOOST_CHECK(dbBlockIndex.WriteSnapshot(vIndex));
+    BOOST_CHECK(dbBlockIndex.HasSnapshot() && dbBlockIndex.GetJournalCount() == 0);
+
+    // journaled after the snapshot
+    CBlockIndex* pIndex = mapIndex.Insert(uint256(5000, uint224((uint64)5001)));
+    pIndex->nHeight = 5000;
+    BOOST_CHECK(dbBlockIndex.AddNewBlock(CBlockOutline(pIndex)));
+    BOOST_CHECK(dbBlockIndex.RemoveBlock(vIndex[10]->GetBlockHash()));
+    BOOST_CHECK(dbBlockIndex.GetJournalCount() == 2);
+    dbBlockIndex.Deinitialize();
+
+    BOOST_CHECK(dbBlockIndex.Initialize(pathData));
+    BOOST_CHECK(dbBlockIndex.HasSnapshot() && dbBlockIndex.GetJournalCount() == 2);
+    CListBlockWalker walkerSnapshot, walkerDB;
+    BOOST_CHECK(dbBlockIndex.WalkThroughSnapshot(walkerSnapshot));
+    BOOST_CHECK(dbBlockIndex.WalkThroughBlock(walkerDB));
+    BOOST_CHECK(walkerSnapshot.mapOutline.size() == 5000);
+    BOOST_CHECK(walkerSnapshot.mapOutline == walkerDB.mapOutline);
+    dbBlockIndex.Deinitialize();
+
+    // a damaged snapshot is dropped
+    {
+        FILE* fp = fopen((pathData / "blockindex.snapshot").string().c_str(), "r+b");
+        BOOST_CHECK(fp != nullptr && fseek(fp, 1000, SEEK_SET) == 0 && fputc(0x5a, fp) != EOF);
+        fclose(fp);
+    }
+    BOOST_CHECK(dbBlockIndex.Initialize(pathData));
+    CListBlockWalker walkerBad;
+    BOOST_CHECK(!dbBlockIndex.WalkThroughSnapshot(walkerBad));
+    BOOST_CHECK(!dbBlockIndex.HasSnapshot());
+    dbBlockIndex.Deinitialize();
+    remove_all(pathData);
+}
+
+BOOST_AUTO_TEST_CASE(tsread)
+{
+    path pathData = path("./.minemon") / "tsreadtest";
+    remove_all(pathData);
+
+    CTimeSeriesCached tsCached;
+    BOOST_CHECK(tsCached.Initialize(pathData, "tsread"));
+
+    // inner object crosses the initial read window of an unframed read
+    vector<unsigned char> vInner(6000, 0x5a);
+    CSpanStream ssInner;
+    ssInner << vInner;
+    vector<unsigned char> vOuter((unsigned char*)ssInner.GetData(), (unsigned char*)ssInner.GetData() + ssInner.GetSize());
+    vOuter.resize(10000, 0xa5);
+
+    CDiskPos pos;
+    BOOST_CHECK(tsCached.Write(vOuter, pos, false));
+    CDiskPos posSmall;
+    BOOST_CHECK(tsCached.Write(uint256(12345), posSmall, false));
+
+    vector<unsigned char> vRead;
+    BOOST_CHECK(tsCached.Read(vRead, pos));
+    BOOST_CHECK(vRead == vOuter);
+    vRead.clear();
+    BOOST_CHECK(tsCached.Read(vRead, pos));
+    BOOST_CHECK(vRead == vOuter);
+    CCacheStat stat;
+    tsCached.GetCacheStat(stat);
+    BOOST_CHECK(stat.nHit == 1 && stat.nCount == 1);
+
+    uint256 hash;
+    BOOST_CHECK(tsCached.Read(hash, posSmall.nFile, posSmall.nOffset));
+    BOOST_CHECK(hash == uint256(12345));
+
+    // the outer vector length is a 3-byte compact size
+    vRead.clear();
+    BOOST_CHECK(tsCached.Read(vRead, CDiskPos(pos.nFile, pos.nOffset + 3), false));
+    BOOST_CHECK(vRead == vInner);
+
+    BOOST_CHECK(!tsCached.Read(hash, CDiskPos(pos.nFile + 1, 8)));
+
+    tsCached.Deinitialize();
+    remove_all(pathData);
+}
+
+BOOST_AUTO_TEST_CASE(lrucache)
+{
+    CCache<uint256, int> cache(4, 1);
+    for (int i = 0; i < 4; i++)
+    {
+        cache.AddNew(uint256(i), i);
+    }
+
+    // touch the oldest entry, the next insert evicts the second one
+    int n = 0;
+    BOOST_CHECK(cache.Retrieve(uint256((uint64)0), n) && n == 0);
+    cache.AddNew(uint256(4), 4);
+    BOOST_CHECK(cache.Exists(uint256((uint64)0)));
+    BOOST_CHECK(!cache.Exists(uint256(1)));
+    BOOST_CHECK(!cache.Retrieve(uint256(1), n));
+
+    cache.AddNew(uint256(5), 5, 3);
+    CCacheStat stat;
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nCount == 2 && stat.nCost == 4);
+    BOOST_CHECK(stat.nHit == 1 && stat.nMiss == 1 && stat.nEvict == 4);
+
+    // an entry larger than the shard stays until something else comes in
+    cache.AddNew(uint256(6), 6, 10);
+    BOOST_CHECK(cache.Retrieve(uint256(6), n) && n == 6);
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nCount == 1 && stat.nCost == 10);
+    cache.AddNew(uint256(7), 7);
+    BOOST_CHECK(!cache.Exists(uint256(6)) && cache.Exists(uint256(7)));
+
+    CCache<CDestination, int> cacheSharded(1000);
+    for (int i = 0; i < 100; i++)
+    {
+        cacheSharded.AddNew(CDestination(CTemplateId(i, uint256((uint64)i))), i);
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        BOOST_CHECK(cacheSharded.Retrieve(CDestination(CTemplateId(i, uint256((uint64)i))), n) && n == i);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
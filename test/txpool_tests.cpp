@@ -6,6 +6,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include "blockchain.h"
+#include "core.h"
 #include "test_big.h"
 #include "transaction.h"
 #include "uint256.h"
@@ -96,4 +98,353 @@ BOOST_AUTO_TEST_CASE(seq_test)
     BOOST_CHECK(view.AddNew(tx2.GetHash(), tx2));
 }
 
+BOOST_AUTO_TEST_CASE(package_test)
+{
+    CTxPoolView view;
+
+    CPooledTx txParent;
+    txParent.nTimeStamp = 1;
+    txParent.nTxFee = 1;
+    txParent.nSerializeSize = 100;
+    txParent.nSequenceNumber = GetSequenceNumber();
+
+    CPooledTx txChild;
+    txChild.nTimeStamp = 2;
+    txChild.nTxFee = 1000;
+    txChild.nSerializeSize = 100;
+    txChild.vInput.push_back(CTxIn(CTxOutPoint(txParent.GetHash(), 0)));
+    txChild.nSequenceNumber = GetSequenceNumber();
+
+    CPooledTx txOther;
+    txOther.nTimeStamp = 3;
+    txOther.nTxFee = 300;
+    txOther.nSerializeSize = 100;
+    txOther.nSequenceNumber = GetSequenceNumber();
+
+    BOOST_CHECK(view.AddNew(txParent.GetHash(), txParent));
+    BOOST_CHECK(view.AddNew(txChild.GetHash(), txChild));
+    BOOST_CHECK(view.AddNew(txOther.GetHash(), txOther));
+
+    // the child pays for its parent, the package goes before the other tx
+    vector<CTransaction> vtx;
+    int64 nTotalTxFee = 0;
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 10, 1000);
+    BOOST_REQUIRE(vtx.size() == 3);
+    BOOST_CHECK(vtx[0].GetHash() == txParent.GetHash());
+    BOOST_CHECK(vtx[1].GetHash() == txChild.GetHash());
+    BOOST_CHECK(vtx[2].GetHash() == txOther.GetHash());
+    BOOST_CHECK(nTotalTxFee == 1301);
+
+    // the package does not fit, the other tx does
+    vtx.clear();
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 10, 150);
+    BOOST_CHECK(vtx.size() == 1 && vtx[0].GetHash() == txOther.GetHash());
+
+    // the template is reused until a tx turns due or the pool changes
+    CPooledTx txLate;
+    txLate.nTimeStamp = 20;
+    txLate.nTxFee = 2000;
+    txLate.nSerializeSize = 100;
+    txLate.nSequenceNumber = GetSequenceNumber();
+    BOOST_CHECK(view.AddNew(txLate.GetHash(), txLate));
+    vtx.clear();
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 10, 1000);
+    BOOST_CHECK(vtx.size() == 3 && nTotalTxFee == 1301);
+    vtx.clear();
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 19, 1000);
+    BOOST_CHECK(vtx.size() == 3 && nTotalTxFee == 1301);
+    vtx.clear();
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 20, 1000);
+    BOOST_CHECK(vtx.size() == 4 && vtx[0].GetHash() == txLate.GetHash() && nTotalTxFee == 3301);
+    view.Remove(txLate.GetHash());
+    vtx.clear();
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 20, 1000);
+    BOOST_CHECK(vtx.size() == 3 && nTotalTxFee == 1301);
+
+    // the template holds every due tx, it is patched rather than rearranged
+    CPooledTx txNew;
+    txNew.nTimeStamp = 15;
+    txNew.nTxFee = 5000;
+    txNew.nSerializeSize = 100;
+    txNew.nSequenceNumber = GetSequenceNumber();
+    BOOST_CHECK(view.AddNew(txNew.GetHash(), txNew));
+    vtx.clear();
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 20, 1000);
+    BOOST_CHECK(vtx.size() == 4 && vtx[3].GetHash() == txNew.GetHash() && nTotalTxFee == 6301);
+    view.Remove(txOther.GetHash());
+    vtx.clear();
+    view.ArrangeBlockTx(vtx, nTotalTxFee, 20, 1000);
+    BOOST_CHECK(vtx.size() == 3 && vtx[2].GetHash() == txNew.GetHash() && nTotalTxFee == 6001);
+
+    // the parent is packed into a block, the child stands alone
+    view.Remove(txParent.GetHash());
+    CPooledTxLinkSetByTxHash& idxTx = view.setTxLinkIndex.get<0>();
+    CPooledTxLinkSetByTxHash::iterator it = idxTx.find(txChild.GetHash());
+    BOOST_CHECK(it != idxTx.end() && it->nPackageFee == 1000 && it->nPackageSize == 100);
+}
+
+// accepts a tx with inputs and a signature, the chain has two outputs of hashChainTx
+class CPushTestCoreProtocol : public CCoreProtocol
+{
+public:
+    CPushTestCoreProtocol(const uint256& hashGenesisIn)
+    {
+        hashGenesisBlock = hashGenesisIn;
+    }
+    Errno ValidateTransaction(const CTransaction& tx, int nHeight) override
+    {
+        return (tx.vInput.empty() ? ERR_TRANSACTION_INPUT_INVALID : OK);
+    }
+    Errno VerifyTransaction(const CTransaction& tx, const vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& hashLastBlock, const uint256& fork) override
+    {
+        return VerifyTransactionSignature(tx, vPrevOutput[0].destTo, nForkHeight, fork);
+    }
+    Errno VerifyTransactionContext(const CTransaction& tx, const vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& hashLastBlock, const uint256& fork) override
+    {
+        return OK;
+    }
+    Errno VerifyTransactionSignature(const CTransaction& tx, const CDestination& destIn, int nForkHeight, const uint256& fork) override
+    {
+        return (tx.vchSig.empty() ? ERR_TRANSACTION_SIGNATURE_INVALID : OK);
+    }
+};
+
+class CPushTestBlockChain : public CBlockChain
+{
+public:
+    CPushTestBlockChain(const uint256& hashChainTxIn, const CDestination& destIn)
+      : hashChainTx(hashChainTxIn), dest(destIn) {}
+    bool GetBlockLocation(const uint256& hashBlock, uint256& hashFork, int& nHeight) override
+    {
+        hashFork = hashBlock;
+        nHeight = 0;
+        return true;
+    }
+    bool GetLastBlock(const uint256& hashFork, uint256& hashBlock, int& nHeight, int64& nTime, uint16& nMintType) override
+    {
+        hashBlock = hashFork;
+        nHeight = 10;
+        nTime = 1000;
+        nMintType = CTransaction::TX_WORK;
+        return true;
+    }
+    bool GetTxUnspent(const uint256& hashFork, const vector<CTxIn>& vInput, vector<CTxOut>& vOutput) override
+    {
+        vOutput.resize(vInput.size());
+        for (size_t i = 0; i < vInput.size(); i++)
+        {
+            if (vOutput[i].IsNull() && vInput[i].prevout.hash == hashChainTx && vInput[i].prevout.n < 2)
+            {
+                vOutput[i] = CTxOut(dest, 100, 1, 0);
+            }
+        }
+        return true;
+    }
+
+protected:
+    uint256 hashChainTx;
+    CDestination dest;
+};
+
+class CPushTestTxPool : public CTxPool
+{
+public:
+    CPushTestTxPool(ICoreProtocol* pCoreProtocolIn, IBlockChain* pBlockChainIn)
+    {
+        pCoreProtocol = pCoreProtocolIn;
+        pBlockChain = pBlockChainIn;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(push_batch_test)
+{
+    uint256 hashFork(1, uint224(1)), hashChainTx(2, uint224(2));
+    CDestination dest(crypto::CPubKey(uint256(1)));
+    CPushTestCoreProtocol coreProtocol(hashFork);
+    CPushTestBlockChain blockChain(hashChainTx, dest);
+    CPushTestTxPool txPool(&coreProtocol, &blockChain);
+
+    // the verify pool is not started, Push checks the batch on the calling thread
+    CTransaction txSpend;
+    txSpend.nTimeStamp = 1;
+    txSpend.vInput.push_back(CTxIn(CTxOutPoint(hashChainTx, 0)));
+    txSpend.sendTo = dest;
+    txSpend.nAmount = 90;
+    txSpend.nTxFee = 10;
+    txSpend.vchSig.push_back(1);
+
+    CTransaction txNoInput = txSpend;
+    txNoInput.vInput.clear();
+
+    CTransaction txChild = txSpend;
+    txChild.vInput[0] = CTxIn(CTxOutPoint(txSpend.GetHash(), 0));
+    txChild.nAmount = 80;
+
+    CTransaction txNoSig = txSpend;
+    txNoSig.vInput[0] = CTxIn(CTxOutPoint(hashChainTx, 1));
+    txNoSig.vchSig.clear();
+
+    CTransaction txConflict = txSpend;
+    txConflict.nAmount = 85;
+    txConflict.nTxFee = 15;
+
+    vector<CTransaction> vtx = { txSpend, txNoInput, txChild, txSpend, txNoSig, txConflict };
+    vector<Errno> vErr;
+    vector<CDestination> vDestIn;
+    vector<int64> vValueIn;
+    txPool.Push(vtx, hashFork, vErr, vDestIn, vValueIn);
+    BOOST_CHECK(vErr.size() == vtx.size());
+    BOOST_CHECK(vErr[0] == OK && vDestIn[0] == dest && vValueIn[0] == 100);
+    BOOST_CHECK(vErr[1] == ERR_TRANSACTION_INPUT_INVALID);
+    // the child spends a tx earlier in the same batch
+    BOOST_CHECK(vErr[2] == OK && vValueIn[2] == 90);
+    BOOST_CHECK(vErr[3] == ERR_ALREADY_HAVE);
+    BOOST_CHECK(vErr[4] == ERR_TRANSACTION_SIGNATURE_INVALID);
+    BOOST_CHECK(vErr[5] == ERR_TRANSACTION_CONFLICTING_INPUT);
+    BOOST_CHECK(txPool.Count(hashFork) == 2);
+    BOOST_CHECK(txPool.Exists(txSpend.GetHash()) && txPool.Exists(txChild.GetHash()));
+
+    // a later batch sees the pooled txs through the tx index
+    vtx = { txChild, txNoSig };
+    txPool.Push(vtx, hashFork, vErr, vDestIn, vValueIn);
+    BOOST_CHECK(vErr.size() == 2 && vErr[0] == ERR_ALREADY_HAVE && vErr[1] == ERR_TRANSACTION_SIGNATURE_INVALID);
+    BOOST_CHECK(txPool.Count(hashFork) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(index_test)
+{
+    CTxPoolTxIndex txIndex;
+    uint256 txid1(1, uint224(1)), txid2(2, uint224(2)), hashFork(3, uint224(3)), hash;
+    txIndex.Add(txid1, hashFork);
+    BOOST_CHECK(txIndex.Exists(txid1) && !txIndex.Exists(txid2));
+    BOOST_CHECK(txIndex.GetFork(txid1, hash) && hash == hashFork);
+    txIndex.Remove(txid1);
+    BOOST_CHECK(!txIndex.Exists(txid1) && !txIndex.GetFork(txid1, hash));
+
+    CDestination dest1(crypto::CPubKey(uint256(1))), dest2(crypto::CPubKey(uint256(2)));
+    CPooledTx tx1;
+    tx1.sendTo = dest2;
+    tx1.destIn = dest1;
+    tx1.nAmount = 100;
+    tx1.nTxFee = 1;
+    CPooledTx tx2 = tx1;
+    tx2.nAmount = 50;
+
+    // dest1 only spends, dest2 reports the first tx to it
+    CTxPoolDestIndex destIndex;
+    destIndex.Add(txid1, tx1);
+    destIndex.Add(txid2, tx2);
+    BOOST_CHECK(destIndex.GetAmount(dest1) == -152);
+    BOOST_CHECK(destIndex.GetAmount(dest2) == 100 && destIndex.ExistsSendTo(dest2));
+    destIndex.Remove(txid1, tx1);
+    BOOST_CHECK(destIndex.GetAmount(dest1) == -51);
+    BOOST_CHECK(destIndex.GetAmount(dest2) == 50);
+    destIndex.Remove(txid2, tx2);
+    BOOST_CHECK(destIndex.GetAmount(dest1) == 0 && !destIndex.ExistsSendTo(dest2));
+}
+
+BOOST_AUTO_TEST_CASE(compactblock_test)
+{
+    CBlock block;
+    block.nType = CBlock::BLOCK_PRIMARY;
+    block.nTimeStamp = 100;
+    block.txMint.nType = CTransaction::TX_WORK;
+    block.txMint.nTimeStamp = 100;
+    for (uint32 i = 1; i <= 5; i++)
+    {
+        CTransaction tx;
+        tx.nTimeStamp = i;
+        block.vtx.push_back(tx);
+    }
+    block.hashMerkle = block.CalcMerkleTreeRoot();
+
+    CCompactBlock compactSend(block, 12345);
+    BOOST_CHECK(compactSend.vShortId.size() == block.vtx.size());
+    BOOST_CHECK(compactSend.block.vtx.empty());
+
+    CBufStream ss;
+    ss << compactSend;
+    CCompactBlock compact;
+    ss >> compact;
+    BOOST_CHECK(compact.GetHash() == block.GetHash());
+
+    uint256 hashKey = compact.GetShortIdKey();
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        BOOST_CHECK(compact.vShortId[i] == CCompactBlock::GetShortId(hashKey, block.vtx[i].GetHash()));
+    }
+    // ids depend on the nonce
+    BOOST_CHECK(CCompactBlock(block, 54321).vShortId[0] != compact.vShortId[0]);
+
+    CBlock blockOut;
+    BOOST_CHECK(compact.Reconstruct(block.vtx, blockOut));
+    BOOST_CHECK(blockOut.GetHash() == block.GetHash());
+    BOOST_CHECK(blockOut.vtx.size() == block.vtx.size());
+
+    vector<CTransaction> vtx(block.vtx);
+    swap(vtx[0], vtx[1]);
+    BOOST_CHECK(!compact.Reconstruct(vtx, blockOut));
+    vtx.pop_back();
+    BOOST_CHECK(!compact.Reconstruct(vtx, blockOut));
+}
+
+BOOST_AUTO_TEST_CASE(fillcompactblock_test)
+{
+    uint256 hashFork(1, uint224(1)), hashChainTx(2, uint224(2));
+    CDestination dest(crypto::CPubKey(uint256(1)));
+    CPushTestCoreProtocol coreProtocol(hashFork);
+    CPushTestBlockChain blockChain(hashChainTx, dest);
+    CPushTestTxPool txPool(&coreProtocol, &blockChain);
+
+    vector<CTransaction> vtxPool;
+    for (uint8 n = 0; n < 2; n++)
+    {
+        CTransaction tx;
+        tx.nTimeStamp = 1;
+        tx.vInput.push_back(CTxIn(CTxOutPoint(hashChainTx, n)));
+        tx.sendTo = dest;
+        tx.nAmount = 90;
+        tx.nTxFee = 10;
+        tx.vchSig.push_back(1);
+        vtxPool.push_back(tx);
+    }
+    vector<Errno> vErr;
+    vector<CDestination> vDestIn;
+    vector<int64> vValueIn;
+    txPool.Push(vtxPool, hashFork, vErr, vDestIn, vValueIn);
+    BOOST_CHECK(txPool.Count(hashFork) == 2);
+
+    CTransaction txUnknown = vtxPool[0];
+    txUnknown.nTimeStamp = 2;
+
+    CBlock block;
+    block.nType = CBlock::BLOCK_PRIMARY;
+    block.nTimeStamp = 100;
+    block.txMint.nType = CTransaction::TX_WORK;
+    block.txMint.nTimeStamp = 100;
+    block.vtx = { vtxPool[1], txUnknown, vtxPool[0] };
+    block.hashMerkle = block.CalcMerkleTreeRoot();
+
+    // pooled txs are filled in, the unknown one is asked from the peer
+    CCompactBlock compact(block, 12345);
+    vector<CTransaction> vtx;
+    vector<uint32> vMissing;
+    txPool.FillCompactBlock(hashFork, compact, vtx, vMissing);
+    BOOST_CHECK(vtx.size() == 3 && vMissing.size() == 1 && vMissing[0] == 1);
+    BOOST_CHECK(vtx[0].GetHash() == vtxPool[1].GetHash() && vtx[2].GetHash() == vtxPool[0].GetHash());
+    vtx[vMissing[0]] = txUnknown;
+    CBlock blockOut;
+    BOOST_CHECK(compact.Reconstruct(vtx, blockOut) && blockOut.GetHash() == block.GetHash());
+
+    // a short id carried twice is ambiguous, both txs are asked from the peer
+    compact.vShortId[2] = compact.vShortId[0];
+    txPool.FillCompactBlock(hashFork, compact, vtx, vMissing);
+    BOOST_CHECK(vMissing.size() == 3);
+    BOOST_CHECK(vtx[0].IsNull() && vtx[2].IsNull());
+
+    // nothing is filled from an unknown fork
+    txPool.FillCompactBlock(uint256(3, uint224(3)), CCompactBlock(block, 1), vtx, vMissing);
+    BOOST_CHECK(vtx.size() == 3 && vMissing.size() == 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "test_big.h"
+
+using namespace std;
+using namespace xengine;
+using namespace minemon;
+
+BOOST_FIXTURE_TEST_SUITE(wallet_tests, BasicUtfSetup)
+
+static CWalletTxOut MakeCoin(uint32 nId, int64 nAmount, uint32 nTime = 1, uint32 nLockUntil = 0)
+{
+    std::shared_ptr<CWalletTx> spWalletTx(new CWalletTx());
+    spWalletTx->txid = uint256(nId, uint224(nId));
+    spWalletTx->sendTo = CDestination(crypto::CPubKey(uint256(1)));
+    spWalletTx->nAmount = nAmount;
+    spWalletTx->nTimeStamp = nTime;
+    spWalletTx->nLockUntil = nLockUntil;
+    return CWalletTxOut(spWalletTx, 0);
+}
+
+static int64 Select(const CWalletCoins& coins, int64 nTargetValue, vector<CTxOutPoint>& vCoins, int64 nTxTime = 100)
+{
+    vCoins.clear();
+    return coins.SelectCoins(nTxTime, nTargetValue, 16, vCoins);
+}
+
+BOOST_AUTO_TEST_CASE(selectcoins_test)
+{
+    CWalletCoins coins;
+    vector<CWalletTxOut> vOut = { MakeCoin(1, 1), MakeCoin(2, 2), MakeCoin(3, 30), MakeCoin(4, 40), MakeCoin(5, 500),
+                                  MakeCoin(6, 45, 200) };
+    for (const CWalletTxOut& out : vOut)
+    {
+        coins.Push(out);
+    }
+    BOOST_CHECK(coins.Unlock(10) == 0 && coins.nTotalValue == 618);
+
+    // exact match
+    vector<CTxOutPoint> vCoins;
+    BOOST_CHECK(Select(coins, 40, vCoins) == 40);
+    BOOST_CHECK(vCoins.size() == 1 && vCoins[0] == vOut[3].GetTxOutPoint());
+
+    // the coin newer than the tx is not an exact match
+    BOOST_CHECK(Select(coins, 45, vCoins) == 70);
+    BOOST_CHECK(vCoins.size() == 2 && vCoins[0] == vOut[3].GetTxOutPoint() && vCoins[1] == vOut[2].GetTxOutPoint());
+
+    // greedy, the largest coins below the target cover it
+    BOOST_CHECK(Select(coins, 71, vCoins) == 72);
+    BOOST_CHECK(vCoins.size() == 3 && vCoins[2] == vOut[1].GetTxOutPoint());
+
+    // the lowest larger coin plus the dust
+    BOOST_CHECK(Select(coins, 100, vCoins) == 533);
+    BOOST_CHECK(vCoins.size() == 4 && vCoins[0] == vOut[4].GetTxOutPoint() && vCoins[1] == vOut[0].GetTxOutPoint());
+
+    // all coins, largest first
+    BOOST_CHECK(Select(coins, -1, vCoins) == 573);
+    BOOST_CHECK(vCoins.size() == 5 && vCoins[0] == vOut[4].GetTxOutPoint());
+
+    coins.Pop(vOut[4]);
+    BOOST_CHECK(Select(coins, 100, vCoins) == 0 && vCoins.empty());
+}
+
+BOOST_AUTO_TEST_CASE(unlockcoins_test)
+{
+    CWalletCoins coins;
+    CWalletTxOut outFree = MakeCoin(1, 10), outLock20 = MakeCoin(2, 20, 1, 20), outLock30 = MakeCoin(3, 30, 1, 30);
+    coins.Push(outFree);
+    coins.Push(outLock20);
+    coins.Push(outLock30);
+
+    vector<CTxOutPoint> vCoins;
+    BOOST_CHECK(coins.Unlock(10) == 50);
+    BOOST_CHECK(Select(coins, 20, vCoins) == 0);
+
+    // the expired bucket joins the value index
+    BOOST_CHECK(coins.Unlock(20) == 30);
+    BOOST_CHECK(coins.mapLockedCoins.size() == 1 && coins.setValueCoins.size() == 2);
+    BOOST_CHECK(Select(coins, 20, vCoins) == 20 && vCoins[0] == outLock20.GetTxOutPoint());
+
+    // a rollback locks it again
+    BOOST_CHECK(coins.Unlock(19) == 50);
+    BOOST_CHECK(coins.setValueCoins.size() == 1);
+
+    // an unlocked coin is popped from the value index
+    BOOST_CHECK(coins.Unlock(30) == 0);
+    coins.Pop(outLock30);
+    BOOST_CHECK(coins.nTotalValue == 30 && coins.setValueCoins.size() == 2 && coins.mapLockedCoins.empty());
+    coins.Pop(outLock20);
+    BOOST_CHECK(coins.Unlock(30) == 0 && coins.setValueCoins.size() == 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
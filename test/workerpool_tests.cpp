@@ -0,0 +1,95 @@
+// Copyright (c) 2019-2021 The Minemon developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "docker/workerpool.h"
+#include "test_big.h"
+#include "util.h"
+
+using namespace std;
+using namespace xengine;
+
+BOOST_FIXTURE_TEST_SUITE(workerpool_tests, BasicUtfSetup)
+
+class CGate
+{
+public:
+    CGate()
+      : fOpen(false) {}
+    void Open()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mtx);
+            fOpen = true;
+        }
+        cond.notify_all();
+    }
+    void Pass()
+    {
+        boost::unique_lock<boost::mutex> lock(mtx);
+        // give up after a while, so a broken pool fails the test instead of hanging it
+        cond.wait_for(lock, boost::chrono::seconds(5), boost::bind(&CGate::IsOpen, this));
+    }
+    bool IsOpen() const
+    {
+        return fOpen;
+    }
+
+protected:
+    bool fOpen;
+    boost::mutex mtx;
+    boost::condition_variable cond;
+};
+
+static void SlowWork(CGate* pGate, boost::atomic<int>* pCount)
+{
+    pGate->Pass();
+    ++(*pCount);
+}
+
+static void FastWork(boost::atomic<int>* pCount)
+{
+    ++(*pCount);
+}
+
+BOOST_AUTO_TEST_CASE(execute)
+{
+    CWorkerPool pool("testpool");
+
+    // without workers the caller runs the whole batch by itself
+    boost::atomic<int> nFast(0);
+    vector<CWorkerPool::WorkFunc> vWork;
+    for (int i = 0; i < 8; i++)
+    {
+        vWork.push_back(boost::bind(&FastWork, &nFast));
+    }
+    pool.Execute(vWork);
+    BOOST_CHECK(nFast == 8);
+
+    // the only worker is stuck in a posted work and more posted works are queued,
+    // a batch must not run them inline nor wait for them
+    BOOST_CHECK(pool.Start(1));
+    CGate gate;
+    boost::atomic<int> nSlow(0);
+    for (int i = 0; i < 3; i++)
+    {
+        pool.Post(boost::bind(&SlowWork, &gate, &nSlow));
+    }
+
+    nFast = 0;
+    int64 nStart = GetTimeMillis();
+    pool.Execute(vWork);
+    BOOST_CHECK(nFast == 8);
+    BOOST_CHECK(nSlow == 0);
+    BOOST_CHECK(GetTimeMillis() - nStart < 1000);
+
+    gate.Open();
+    pool.Stop();
+    BOOST_CHECK(nSlow == 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()